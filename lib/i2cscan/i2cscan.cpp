@@ -111,14 +111,14 @@ namespace I2CSCAN
         return found;
     }
 
-    bool hasDevOnBus(uint8_t addr) {
+    bool hasDevOnBus(uint8_t addr, TwoWire &wire) {
         byte error;
 #if ESP32C3
         int retries = 2;
         do {
 #endif
-            Wire.beginTransmission(addr);
-            error = Wire.endTransmission();
+            wire.beginTransmission(addr);
+            error = wire.endTransmission();
 #if ESP32C3
         }
         while (error != 0 && retries--);
@@ -0,0 +1,171 @@
+/*
+    SlimeVR Code is placed under the MIT license
+    Copyright (c) 2024 SlimeVR Contributors
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+
+#include "mahonyfixed.h"
+
+namespace {
+    uint32_t isqrt32(uint32_t value)
+    {
+        uint32_t result = 0;
+        uint32_t bit = UINT32_C(1) << 30;
+        while (bit > value) {
+            bit >>= 2;
+        }
+        while (bit != 0) {
+            if (value >= result + bit) {
+                value -= result + bit;
+                result = (result >> 1) + bit;
+            } else {
+                result >>= 1;
+            }
+            bit >>= 2;
+        }
+        return result;
+    }
+
+    uint32_t absolute(int32_t value)
+    {
+        return value < 0 ? 0u - static_cast<uint32_t>(value) : static_cast<uint32_t>(value);
+    }
+
+    int32_t mulWide(int64_t a, int32_t b)
+    {
+        return static_cast<int32_t>((a * b + (INT64_C(1) << (MahonyFixed::FractionBits - 1))) >> MahonyFixed::FractionBits);
+    }
+}
+
+bool MahonyFixed::normalize(int32_t v[3])
+{
+    const uint32_t bits = absolute(v[0]) | absolute(v[1]) | absolute(v[2]);
+    if (bits == 0) {
+        return false;
+    }
+    // bring the largest component to [2^14, 2^15) so the squares fit 32 bits, that keeps
+    // about as many bits as the sensors deliver
+    const int shift = __builtin_clz(bits) - 17;
+    int32_t scaled[3];
+    for (int i = 0; i < 3; i++) {
+        scaled[i] = shift >= 0 ? v[i] * (INT32_C(1) << shift) : v[i] >> -shift;
+    }
+    const uint32_t norm = isqrt32(static_cast<uint32_t>(scaled[0] * scaled[0])
+                                + static_cast<uint32_t>(scaled[1] * scaled[1])
+                                + static_cast<uint32_t>(scaled[2] * scaled[2]));
+    // one division for all three components, the rounding in it only changes the length
+    // of the result and not its direction; scaled[i] * inverse >> 2 == scaled[i] / norm in Q30
+    const uint32_t inverse = UINT32_MAX / norm;
+    for (int i = 0; i < 3; i++) {
+        v[i] = static_cast<int32_t>((static_cast<int64_t>(scaled[i]) * inverse) >> 2);
+    }
+    return true;
+}
+
+void MahonyFixed::integrate(int32_t q[4], int32_t hx, int32_t hy, int32_t hz)
+{
+    const int32_t q1 = q[0], q2 = q[1], q3 = q[2], q4 = q[3];
+    int32_t n1 = q1 - mul(q2, hx) - mul(q3, hy) - mul(q4, hz);
+    int32_t n2 = q2 + mul(q1, hx) + mul(q3, hz) - mul(q4, hy);
+    int32_t n3 = q3 + mul(q1, hy) - mul(q2, hz) + mul(q4, hx);
+    int32_t n4 = q4 + mul(q1, hz) + mul(q2, hy) - mul(q3, hx);
+
+    // The step leaves the norm within a hair of one, a single Newton step
+    // of 1/sqrt around one renormalizes it without a square root
+    const int64_t norm2 = static_cast<int64_t>(mul(n1, n1)) + mul(n2, n2) + mul(n3, n3) + mul(n4, n4);
+    const int32_t factor = static_cast<int32_t>((3 * static_cast<int64_t>(One) - norm2) / 2);
+    q[0] = mul(n1, factor);
+    q[1] = mul(n2, factor);
+    q[2] = mul(n3, factor);
+    q[3] = mul(n4, factor);
+}
+
+// Same as Mahony<T>::update with the West reference from Acc cross Mag
+void MahonyFixed::update(int32_t q[4], int32_t ax, int32_t ay, int32_t az, int32_t hx, int32_t hy, int32_t hz,
+                         int32_t mx, int32_t my, int32_t mz, int32_t kpHalfDt)
+{
+    int32_t m[3] = {mx, my, mz};
+    if (!normalize(m)) {
+        update(q, ax, ay, az, hx, hy, hz, kpHalfDt);
+        return;
+    }
+
+    int32_t a[3] = {ax, ay, az};
+    if (normalize(a)) {
+        const int32_t q1 = q[0], q2 = q[1], q3 = q[2], q4 = q[3];
+
+        // Measured horizon vector = a x m (in body frame)
+        int32_t w[3] = {
+            mul(a[1], m[2]) - mul(a[2], m[1]),
+            mul(a[2], m[0]) - mul(a[0], m[2]),
+            mul(a[0], m[1]) - mul(a[1], m[0]),
+        };
+        normalize(w);
+
+        // Estimated direction of Up reference vector
+        const int32_t ux = 2 * (mul(q2, q4) - mul(q1, q3));
+        const int32_t uy = 2 * (mul(q1, q2) + mul(q3, q4));
+        const int32_t uz = mul(q1, q1) - mul(q2, q2) - mul(q3, q3) + mul(q4, q4);
+
+        // Estimated direction of horizon (West) reference vector
+        const int32_t wx = 2 * (mul(q2, q3) + mul(q1, q4));
+        const int32_t wy = mul(q1, q1) - mul(q2, q2) + mul(q3, q3) - mul(q4, q4);
+        const int32_t wz = 2 * (mul(q3, q4) - mul(q1, q2));
+
+        // Both cross products can reach one, so the sum is kept in 64 bits
+        const int64_t ex = static_cast<int64_t>(mul(a[1], uz)) - mul(a[2], uy) + mul(w[1], wz) - mul(w[2], wy);
+        const int64_t ey = static_cast<int64_t>(mul(a[2], ux)) - mul(a[0], uz) + mul(w[2], wx) - mul(w[0], wz);
+        const int64_t ez = static_cast<int64_t>(mul(a[0], uy)) - mul(a[1], ux) + mul(w[0], wy) - mul(w[1], wx);
+
+        // Apply proportional feedback to the gyro term
+        hx += mulWide(ex, kpHalfDt);
+        hy += mulWide(ey, kpHalfDt);
+        hz += mulWide(ez, kpHalfDt);
+    }
+
+    integrate(q, hx, hy, hz);
+}
+
+void MahonyFixed::update(int32_t q[4], int32_t ax, int32_t ay, int32_t az, int32_t hx, int32_t hy, int32_t hz,
+                         int32_t kpHalfDt)
+{
+    int32_t a[3] = {ax, ay, az};
+    if (normalize(a)) {
+        const int32_t q1 = q[0], q2 = q[1], q3 = q[2], q4 = q[3];
+
+        // Estimated direction of gravity in the body frame (factor of two divided out)
+        const int32_t vx = mul(q2, q4) - mul(q1, q3);
+        const int32_t vy = mul(q1, q2) + mul(q3, q4);
+        const int32_t vz = mul(q1, q1) - One / 2 + mul(q4, q4);
+
+        // Error is cross product between estimated and measured direction of gravity in body frame
+        // (half the actual magnitude)
+        const int32_t ex = mul(a[1], vz) - mul(a[2], vy);
+        const int32_t ey = mul(a[2], vx) - mul(a[0], vz);
+        const int32_t ez = mul(a[0], vy) - mul(a[1], vx);
+
+        // Apply proportional feedback to the gyro term
+        hx += mul(ex, kpHalfDt);
+        hy += mul(ey, kpHalfDt);
+        hz += mul(ez, kpHalfDt);
+    }
+
+    integrate(q, hx, hy, hz);
+}
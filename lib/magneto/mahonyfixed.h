@@ -0,0 +1,57 @@
+/*
+    SlimeVR Code is placed under the MIT license
+    Copyright (c) 2024 SlimeVR Contributors
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+
+#ifndef _MAHONY_FIXED_H_
+#define _MAHONY_FIXED_H_
+
+#include <cstdint>
+
+// Mahony filter in Q30 fixed point, same frames and gains as Mahony<T>. Experimental, no MCU benchmark yet.
+// Quaternions and unit vectors are Q30 (1.0 == 1 << 30). Accel and mag may be in any integer
+// scale as only their direction is used. Gyro comes in as the half rotation angle over the step,
+// 0.5 * w * deltat in Q30 radians, so no division by the time step is needed here.
+class MahonyFixed {
+public:
+    static constexpr int FractionBits = 30;
+    static constexpr int32_t One = INT32_C(1) << FractionBits;
+
+    // Same proportional gain as the float filter, integral feedback is not used there either
+    static constexpr float Kp = 10.0f;
+
+    // kpHalfDt is Kp * 0.5 * deltat in Q30
+    void update(int32_t q[4], int32_t ax, int32_t ay, int32_t az, int32_t hx, int32_t hy, int32_t hz,
+                int32_t mx, int32_t my, int32_t mz, int32_t kpHalfDt);
+    void update(int32_t q[4], int32_t ax, int32_t ay, int32_t az, int32_t hx, int32_t hy, int32_t hz,
+                int32_t kpHalfDt);
+
+    static int32_t mul(int32_t a, int32_t b) {
+        return static_cast<int32_t>((static_cast<int64_t>(a) * b + (INT64_C(1) << (FractionBits - 1))) >> FractionBits);
+    }
+    // Scales v to a Q30 unit vector, false if it is zero
+    static bool normalize(int32_t v[3]);
+
+private:
+    static void integrate(int32_t q[4], int32_t hx, int32_t hy, int32_t hz);
+};
+
+#endif /* _MAHONY_FIXED_H_ */
@@ -2,7 +2,8 @@
 //
 // SPDX-License-Identifier: MIT
 
-// Modified to add timestamps in: updateGyr(const vqf_real_t gyr[3], double gyrTs)
+// Modified to add timestamps in: updateGyr(const vqf_real_t gyr[3], vqf_real_t gyrTs)
+// Modified to optionally run the Butterworth filters in float (VQF_SINGLE_PRECISION_FILTERS)
 // Removed batch update functions
 
 #include "basicvqf.h"
@@ -45,7 +46,7 @@ BasicVQF::BasicVQF(const BasicVQFParams &params, vqf_real_t gyrTs, vqf_real_t ac
     setup();
 }
 
-void BasicVQF::updateGyr(const vqf_real_t gyr[3], double gyrTs)
+void BasicVQF::updateGyr(const vqf_real_t gyr[3], vqf_real_t gyrTs)
 {
     // gyroscope prediction step
     vqf_real_t gyrNorm = norm(gyr, 3);
@@ -175,8 +176,8 @@ void BasicVQF::setTauAcc(vqf_real_t tauAcc)
         return;
     }
     params.tauAcc = tauAcc;
-    double newB[3];
-    double newA[3];
+    vqf_filter_t newB[3];
+    vqf_filter_t newA[3];
 
     filterCoeffs(params.tauAcc, coeffs.accTs, newB, newA);
     filterAdaptStateForCoeffChange(state.lastAccLp, 3, coeffs.accLpB, coeffs.accLpA, newB, newA, state.accLpState);
@@ -313,7 +314,7 @@ vqf_real_t BasicVQF::gainFromTau(vqf_real_t tau, vqf_real_t Ts)
     }
 }
 
-void BasicVQF::filterCoeffs(vqf_real_t tau, vqf_real_t Ts, double outB[], double outA[])
+void BasicVQF::filterCoeffs(vqf_real_t tau, vqf_real_t Ts, vqf_filter_t outB[], vqf_filter_t outA[])
 {
     assert(tau > 0);
     assert(Ts > 0);
@@ -322,47 +323,86 @@ void BasicVQF::filterCoeffs(vqf_real_t tau, vqf_real_t Ts, double outB[], double
     double C = tan(M_PI*fc*double(Ts));
     double D = C*C + sqrt(2)*C + 1;
     double b0 = C*C/D;
+#ifndef VQF_SINGLE_PRECISION_FILTERS
     outB[0] = b0;
     outB[1] = 2*b0;
     outB[2] = b0;
     // a0 = 1.0
     outA[0] = 2*(C*C-1)/D; // a1
     outA[1] = (1-sqrt(2)*C+C*C)/D; // a2
+#else
+    // Same transfer function rewritten for the delta operator (z-1)/delta, see filterStep(). The coefficients are
+    // derived without the cancellation in 1+a1+a2, so they are all of order one and safe to store as float.
+    double c1 = (4*C*C + 2*sqrt(2)*C)/D; // 2+a1
+    double c0 = 4*C*C/D; // 1+a1+a2
+    double delta = sqrt(c0);
+    double c1Delta = c1/delta;
+    outB[0] = b0;
+    outB[1] = 4*b0/delta - b0*c1Delta; // velocity state gain
+    outB[2] = 1 - b0; // position state gain, the DC gain is one
+    outA[0] = c1Delta;
+    outA[1] = delta;
+#endif
 }
 
-void BasicVQF::filterInitialState(vqf_real_t x0, const double b[3], const double a[2], double out[])
+void BasicVQF::filterInitialState(vqf_real_t x0, const vqf_filter_t b[3], const vqf_filter_t a[2], vqf_filter_t out[])
 {
+#ifndef VQF_SINGLE_PRECISION_FILTERS
     // initial state for steady state (equivalent to scipy.signal.lfilter_zi, obtained by setting y=x=x0 in the filter
     // update equation)
     out[0] = x0*(1 - b[0]);
     out[1] = x0*(b[2] - a[1]);
+#else
+    // position at the input value, not moving
+    out[0] = x0;
+    out[1] = 0;
+#endif
 }
 
-void BasicVQF::filterAdaptStateForCoeffChange(vqf_real_t last_y[], size_t N, const double b_old[],
-                                              const double a_old[], const double b_new[],
-                                              const double a_new[], double state[])
+void BasicVQF::filterAdaptStateForCoeffChange(vqf_real_t last_y[], size_t N, const vqf_filter_t b_old[],
+                                            const vqf_filter_t a_old[], const vqf_filter_t b_new[],
+                                            const vqf_filter_t a_new[], vqf_filter_t state[])
 {
     if (isnan(state[0])) {
         return;
     }
+#ifndef VQF_SINGLE_PRECISION_FILTERS
     for (size_t i = 0; i < N; i++) {
         state[0+2*i] = state[0+2*i] + (b_old[0] - b_new[0])*last_y[i];
         state[1+2*i] = state[1+2*i] + (b_old[1] - b_new[1] - a_old[0] + a_new[0])*last_y[i];
     }
+#else
+    // the position state is the output in steady state for any coefficients, only the velocity is
+    // relative to the step size delta
+    for (size_t i = 0; i < N; i++) {
+        state[1+2*i] = state[1+2*i]*a_old[1]/a_new[1];
+    }
+#endif
 }
 
-vqf_real_t BasicVQF::filterStep(vqf_real_t x, const double b[3], const double a[2], double state[2])
+vqf_real_t BasicVQF::filterStep(vqf_real_t x, const vqf_filter_t b[3], const vqf_filter_t a[2], vqf_filter_t state[2])
 {
+#ifndef VQF_SINGLE_PRECISION_FILTERS
     // difference equations based on scipy.signal.lfilter documentation
     // assumes that a0 == 1.0
     double y = b[0]*x + state[0];
     state[0] = b[1]*x - a[0]*y + state[1];
     state[1] = b[2]*x - a[1]*y;
     return y;
+#else
+    // Delta operator form: state[0] follows the input like a damped mass (position), state[1] is its velocity.
+    // Direct form coefficients need 1+a1+a2 which cancels to almost nothing at low cutoffs, here every
+    // coefficient and state stays of order one, so float keeps the double filter's accuracy.
+    vqf_filter_t y = b[0]*x + b[2]*state[0] + b[1]*state[1];
+    vqf_filter_t position = state[0] + a[1]*state[1];
+    state[1] = state[1] + a[1]*(x - state[0] - a[0]*state[1]);
+    state[0] = position;
+    return y;
+#endif
 }
 
-void BasicVQF::filterVec(const vqf_real_t x[], size_t N, vqf_real_t tau, vqf_real_t Ts, const double b[3],
-                         const double a[2], double state[], vqf_real_t out[])
+void BasicVQF::filterVec(const vqf_real_t x[], size_t N, vqf_real_t tau, vqf_real_t Ts, const vqf_filter_t b[3],
+                         const vqf_filter_t a[2], vqf_filter_t state[], vqf_real_t out[])
 {
     assert(N>=2);
 
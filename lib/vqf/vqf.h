@@ -2,7 +2,8 @@
 //
 // SPDX-License-Identifier: MIT
 
-// Modified to add timestamps in: updateGyr(const vqf_real_t gyr[3], double gyrTs)
+// Modified to add timestamps in: updateGyr(const vqf_real_t gyr[3], vqf_real_t gyrTs)
+// Modified to optionally run the Butterworth filters in float (VQF_SINGLE_PRECISION_FILTERS)
 // Removed batch update functions
 
 #ifndef VQF_HPP
@@ -11,6 +12,7 @@
 #include <stddef.h>
 
 #define VQF_SINGLE_PRECISION
+#define VQF_SINGLE_PRECISION_FILTERS
 #define VQF_NO_MOTION_BIAS_ESTIMATION
 #define M_PI 3.14159265358979323846
 #define M_SQRT2 1.41421356237309504880
@@ -19,8 +21,8 @@
  * @brief Typedef for the floating-point data type used for most operations.
  *
  * By default, all floating-point calculations are performed using `double`. Set the `VQF_SINGLE_PRECISION` define to
- * change this type to `float`. Note that the Butterworth filter implementation will always use double precision as
- * using floats can cause numeric issues.
+ * change this type to `float`. Note that the Butterworth filter implementation uses double precision (see
+ * #vqf_filter_t) as using floats in its direct form can cause numeric issues.
  */
 #ifndef VQF_SINGLE_PRECISION
 typedef double vqf_real_t;
@@ -28,6 +30,20 @@ typedef double vqf_real_t;
 typedef float vqf_real_t;
 #endif
 
+/**
+ * @brief Typedef for the coefficients and states of the Butterworth filters.
+ *
+ * Double by default, as the direct form filter loses too much precision in float. With
+ * `VQF_SINGLE_PRECISION_FILTERS` the filters run in float in delta operator form instead, for MCUs without a
+ * double precision FPU. After a step settles, the float filter can stop up to about 1e-4 of the input short of the
+ * double filter, as the last increments fall below float resolution (see test/native/test_vqf_filter).
+ */
+#ifndef VQF_SINGLE_PRECISION_FILTERS
+typedef double vqf_filter_t;
+#else
+typedef float vqf_filter_t;
+#endif
+
 /**
  * @brief Struct containing all tuning parameters used by the VQF class.
  *
@@ -321,7 +337,7 @@ struct VQFState {
     /**
      * @brief Internal low-pass filter state for #lastAccLp.
      */
-    double accLpState[3*2];
+    vqf_filter_t accLpState[3*2];
     /**
      * @brief Last inclination correction angular rate.
      *
@@ -377,11 +393,11 @@ struct VQFState {
      * @brief Internal state of the Butterworth low-pass filter for the rotation matrix coefficients used in motion
      * bias estimation.
      */
-    double motionBiasEstRLpState[9*2];
+    vqf_filter_t motionBiasEstRLpState[9*2];
     /**
      * @brief Internal low-pass filter state for the rotated bias estimate used in motion bias estimation.
      */
-    double motionBiasEstBiasLpState[2*2];
+    vqf_filter_t motionBiasEstBiasLpState[2*2];
 #endif
     /**
      * @brief Last (squared) deviations from the reference of the last sample used in rest detection.
@@ -408,7 +424,7 @@ struct VQFState {
     /**
      * @brief Internal low-pass filter state for #restLastGyrLp.
      */
-    double restGyrLpState[3*2];
+    vqf_filter_t restGyrLpState[3*2];
     /**
      * @brief Last low-pass filtered accelerometer measurement used as the reference for rest detection.
      */
@@ -416,7 +432,7 @@ struct VQFState {
     /**
      * @brief Internal low-pass filter state for #restLastAccLp.
      */
-    double restAccLpState[3*2];
+    vqf_filter_t restAccLpState[3*2];
 
     /**
      * @brief Norm of the currently accepted magnetic field reference.
@@ -465,7 +481,7 @@ struct VQFState {
     /**
      * @brief Internal low-pass filter state for the current norm and dip angle.
      */
-    double magNormDipLpState[2*2];
+    vqf_filter_t magNormDipLpState[2*2];
 };
 
 /**
@@ -494,13 +510,13 @@ struct VQFCoefficients
      *
      * The array contains \f$\begin{bmatrix}b_0 & b_1 & b_2\end{bmatrix}\f$.
      */
-    double accLpB[3];
+    vqf_filter_t accLpB[3];
     /**
      * @brief Denominator coefficients of the acceleration low-pass filter.
      *
      * The array contains \f$\begin{bmatrix}a_1 & a_2\end{bmatrix}\f$ and \f$a_0=1\f$.
      */
-    double accLpA[2];
+    vqf_filter_t accLpA[2];
 
     /**
      * @brief Gain of the first-order filter used for heading correction.
@@ -533,19 +549,19 @@ struct VQFCoefficients
     /**
      * @brief Numerator coefficients of the gyroscope measurement low-pass filter for rest detection.
      */
-    double restGyrLpB[3];
+    vqf_filter_t restGyrLpB[3];
     /**
      * @brief Denominator coefficients of the gyroscope measurement low-pass filter for rest detection.
      */
-    double restGyrLpA[2];
+    vqf_filter_t restGyrLpA[2];
     /**
      * @brief Numerator coefficients of the accelerometer measurement low-pass filter for rest detection.
      */
-    double restAccLpB[3];
+    vqf_filter_t restAccLpB[3];
     /**
      * @brief Denominator coefficients of the accelerometer measurement low-pass filter for rest detection.
      */
-    double restAccLpA[2];
+    vqf_filter_t restAccLpA[2];
 
     /**
      * @brief Gain of the first-order filter used for to update the magnetic field reference and candidate.
@@ -554,11 +570,11 @@ struct VQFCoefficients
     /**
      * @brief Numerator coefficients of the low-pass filter for the current magnetic norm and dip.
      */
-    double magNormDipLpB[3];
+    vqf_filter_t magNormDipLpB[3];
     /**
      * @brief Denominator coefficients of the low-pass filter for the current magnetic norm and dip.
      */
-    double magNormDipLpA[2];
+    vqf_filter_t magNormDipLpA[2];
 };
 
 /**
@@ -653,7 +669,7 @@ public:
      *
      * @param gyr gyroscope measurement in rad/s
      */
-    void updateGyr(const vqf_real_t gyr[3], double gyrTs);
+    void updateGyr(const vqf_real_t gyr[3], vqf_real_t gyrTs);
     /**
      * @brief Performs accelerometer update step.
      *
@@ -895,7 +911,7 @@ public:
      * @param outB output array for numerator coefficients
      * @param outA output array for denominator coefficients (without \f$a_0=1\f$)
      */
-    static void filterCoeffs(vqf_real_t tau, vqf_real_t Ts, double outB[3], double outA[2]);
+    static void filterCoeffs(vqf_real_t tau, vqf_real_t Ts, vqf_filter_t outB[3], vqf_filter_t outA[2]);
     /**
      * @brief Calculates the initial filter state for a given steady-state value.
      * @param x0 steady state value
@@ -903,7 +919,7 @@ public:
      * @param a denominator coefficients (without \f$a_0=1\f$)
      * @param out output array for filter state
      */
-    static void filterInitialState(vqf_real_t x0, const double b[], const double a[], double out[2]);
+    static void filterInitialState(vqf_real_t x0, const vqf_filter_t b[], const vqf_filter_t a[], vqf_filter_t out[2]);
     /**
      * @brief Adjusts the filter state when changing coefficients.
      *
@@ -919,9 +935,9 @@ public:
      * @param a_new new denominator coefficients (without \f$a_0=1\f$)
      * @param state filter state (array of size N*2, will be modified)
      */
-    static void filterAdaptStateForCoeffChange(vqf_real_t last_y[], size_t N, const double b_old[3],
-                                               const double a_old[2], const double b_new[3],
-                                               const double a_new[2], double state[]);
+    static void filterAdaptStateForCoeffChange(vqf_real_t last_y[], size_t N, const vqf_filter_t b_old[3],
+                                               const vqf_filter_t a_old[2], const vqf_filter_t b_new[3],
+                                               const vqf_filter_t a_new[2], vqf_filter_t state[]);
     /**
      * @brief Performs a filter step for a scalar value.
      * @param x input value
@@ -930,7 +946,7 @@ public:
      * @param state filter state array (will be modified)
      * @return filtered value
      */
-    static vqf_real_t filterStep(vqf_real_t x, const double b[3], const double a[2], double state[2]);
+    static vqf_real_t filterStep(vqf_real_t x, const vqf_filter_t b[3], const vqf_filter_t a[2], vqf_filter_t state[2]);
     /**
      * @brief Performs filter step for vector-valued signal with averaging-based initialization.
      *
@@ -947,8 +963,8 @@ public:
      * @param state filter state (array of size N*2, will be modified)
      * @param out output array for filtered values (size N)
      */
-    static void filterVec(const vqf_real_t x[], size_t N, vqf_real_t tau, vqf_real_t Ts, const double b[3],
-                          const double a[2], double state[], vqf_real_t out[]);
+    static void filterVec(const vqf_real_t x[], size_t N, vqf_real_t tau, vqf_real_t Ts, const vqf_filter_t b[3],
+                          const vqf_filter_t a[2], vqf_filter_t state[], vqf_real_t out[]);
 #ifndef VQF_NO_MOTION_BIAS_ESTIMATION
     /**
      * @brief Sets a 3x3 matrix to a scaled version of the identity matrix.
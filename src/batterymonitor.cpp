@@ -92,6 +92,8 @@ void BatteryMonitor::Loop()
             #if BATTERY_MONITOR == BAT_MCP3021 || BATTERY_MONITOR == BAT_INTERNAL_MCP3021
                 if (address > 0)
                 {
+                    // the ADC shares Wire with the IMUs, which may be read from the acquisition task
+                    auto sensorsLock = sensorManager.lockSensors();
                     Wire.beginTransmission(address);
                     Wire.requestFrom(address, (uint8_t)2);
                     auto MSB = Wire.read();
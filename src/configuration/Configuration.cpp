@@ -30,6 +30,8 @@
 
 #define DIR_CALIBRATIONS "/calibrations"
 #define DIR_TEMPERATURE_CALIBRATIONS "/tempcalibrations"
+#define FILE_IMU_TOPOLOGY "/imutopology.bin"
+#define FILE_FUSION_ENGINES "/fusionengines.bin"
 
 namespace SlimeVR {
     namespace Configuration {
@@ -83,6 +85,7 @@ namespace SlimeVR {
             }
 
             loadCalibrations();
+            loadFusionEngines();
 
             m_Loaded = true;
 
@@ -123,6 +126,7 @@ namespace SlimeVR {
             LittleFS.format();
 
             m_Calibrations.clear();
+            m_FusionEngines.clear();
             m_Config.version = 1;
             save();
 
@@ -242,6 +246,66 @@ namespace SlimeVR {
             return true;
         }
 
+        std::vector<ImuTopologyEntry> Configuration::loadImuTopology() {
+            std::vector<ImuTopologyEntry> topology;
+            if (!LittleFS.exists(FILE_IMU_TOPOLOGY)) {
+                return topology;
+            }
+
+            auto f = SlimeVR::Utils::openFile(FILE_IMU_TOPOLOGY, "r");
+            if (f.isDirectory() || f.size() % sizeof(ImuTopologyEntry) != 0) {
+                m_Logger.debug("Found incompatible IMU topology, skipping");
+                return topology;
+            }
+
+            topology.resize(f.size() / sizeof(ImuTopologyEntry));
+            f.read((uint8_t*)topology.data(), topology.size() * sizeof(ImuTopologyEntry));
+            return topology;
+        }
+
+        void Configuration::saveImuTopology(const std::vector<ImuTopologyEntry>& topology) {
+            File file = LittleFS.open(FILE_IMU_TOPOLOGY, "w");
+            file.write((uint8_t*)topology.data(), topology.size() * sizeof(ImuTopologyEntry));
+            file.close();
+
+            m_Logger.debug("Saved IMU topology with %d addresses", topology.size());
+        }
+
+        uint8_t Configuration::getFusionEngine(uint8_t sensorId) const {
+            if (sensorId >= m_FusionEngines.size()) {
+                return 0;
+            }
+
+            return m_FusionEngines[sensorId];
+        }
+
+        void Configuration::setFusionEngine(uint8_t sensorId, uint8_t engine) {
+            if (sensorId >= m_FusionEngines.size()) {
+                m_FusionEngines.resize(sensorId + 1);
+            }
+            m_FusionEngines[sensorId] = engine;
+
+            File file = LittleFS.open(FILE_FUSION_ENGINES, "w");
+            file.write(m_FusionEngines.data(), m_FusionEngines.size());
+            file.close();
+
+            m_Logger.debug("Saved fusion engine %d for sensorId:%d", engine, sensorId);
+        }
+
+        void Configuration::loadFusionEngines() {
+            if (!LittleFS.exists(FILE_FUSION_ENGINES)) {
+                return;
+            }
+
+            auto f = SlimeVR::Utils::openFile(FILE_FUSION_ENGINES, "r");
+            if (f.isDirectory()) {
+                return;
+            }
+
+            m_FusionEngines.resize(f.size());
+            f.read(m_FusionEngines.data(), m_FusionEngines.size());
+        }
+
         bool Configuration::runMigrations(int32_t version) {
             return true;
         }
@@ -249,6 +313,11 @@ namespace SlimeVR {
         void Configuration::print() {
             m_Logger.info("Configuration:");
             m_Logger.info("  Version: %d", m_Config.version);
+            for (size_t i = 0; i < m_FusionEngines.size(); i++) {
+                if (m_FusionEngines[i] != 0) {
+                    m_Logger.info("  Fusion engine [%3d]: %d", i, m_FusionEngines[i]);
+                }
+            }
             m_Logger.info("  %d Calibrations:", m_Calibrations.size());
 
             for (size_t i = 0; i < m_Calibrations.size(); i++) {
@@ -32,6 +32,14 @@
 
 namespace SlimeVR {
     namespace Configuration {
+        // one configured I2C IMU address and whether it answered on the last boot
+        struct ImuTopologyEntry {
+            uint8_t sclPin;
+            uint8_t sdaPin;
+            uint8_t address;
+            bool present;
+        };
+
         class Configuration {
         public:
             void setup();
@@ -50,14 +58,23 @@ namespace SlimeVR {
             bool loadTemperatureCalibration(uint8_t sensorId, GyroTemperatureCalibrationConfig& config);
             bool saveTemperatureCalibration(uint8_t sensorId, const GyroTemperatureCalibrationConfig& config);
 
+            std::vector<ImuTopologyEntry> loadImuTopology();
+            void saveImuTopology(const std::vector<ImuTopologyEntry>& topology);
+
+            // 0 when the sensor uses the default engine, otherwise one of SENSOR_FUSION_*
+            uint8_t getFusionEngine(uint8_t sensorId) const;
+            void setFusionEngine(uint8_t sensorId, uint8_t engine);
+
         private:
             void loadCalibrations();
+            void loadFusionEngines();
             bool runMigrations(int32_t version);
 
             bool m_Loaded = false;
 
             DeviceConfig m_Config{};
             std::vector<CalibrationConfig> m_Calibrations;
+            std::vector<uint8_t> m_FusionEngines;
 
             Logging::Logger m_Logger = Logging::Logger("Configuration");
         };
@@ -62,6 +62,9 @@ enum class ImuID {
 #define IMU_LSM6DSO SoftFusionLSM6DSO
 #define IMU_LSM6DSR SoftFusionLSM6DSR
 #define IMU_MPU6050_SF SoftFusionMPU6050
+#define IMU_ICM42688_SPI SoftFusionICM42688SPI
+#define IMU_BMI270_SPI SoftFusionBMI270SPI
+#define IMU_LSM6DSV_SPI SoftFusionLSM6DSVSPI
 
 #define IMU_DEV_RESERVED 250 // Reserved, should not be used in any release firmware
 
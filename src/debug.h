@@ -34,6 +34,15 @@
 #define BIAS_DEBUG false // Printing BIAS Variables to serial (ICM20948 only)
 #define ENABLE_TAP false // monitor accel for (triple) tap events and send them. Uses more cpu, disable if problems. Server does nothing with value so disabled atm
 #define SEND_ACCELERATION true // send linear acceleration to the server
+#define SFUSION_DEBUG false // Print softfusion FIFO backlog and read time every second, time the fusion engines for GET INFO
+#define SFUSION_FIFO_CHUNKS_PER_LOOP 0 // 0 drains the softfusion FIFO on every read. Otherwise the FIFO bus transactions per IMU per loop, a bigger backlog is then drained over the next loops
+#define SFUSION_USE_FIFO_INTERRUPT false // Read softfusion IMU FIFOs on the watermark interrupt instead of a fixed poll. Needs the IMU INT pin wired to PIN_IMU_INT
+#define SFUSION_PROFILE Default // Softfusion ODR profile: LowPower, Default or HighRate1k (see sensors/softfusion/profiles.h), needs recalibration when changed
+#define SFUSION_GYRO_PREINTEGRATION 1 // Softfusion gyro samples integrated (with coning correction) into one fusion update, 1 fuses every sample. E.g. 4 at 450+ Hz gyro ODR cuts fusion CPU time ~4x
+#define SFUSION_USE_TEMPCAL true // Learn the softfusion gyro offset over temperature while at rest (GyroTemperatureCalibrator) and apply it
+#define SFUSION_BACKGROUND_CALIBRATION true // Refine the softfusion gyro offset (at rest) and sample rates while running, no blocking calibration needed
+#define SFUSION_BACKGROUND_CALIBRATION_SAVE_MINUTES 10 // Store the refined softfusion calibration at most this often
+#define SFUSION_PREDICTION_HORIZON_MS 0 // Extrapolate the softfusion rotation from the last gyro sample to the send time by up to this many ms, 0 sends the fused rotation as is
 
 //Debug information
 
@@ -64,6 +73,8 @@
 // Extra tunable for PACKET_BUNDLING_BUFFERED (10000us = 10ms timeout, 100hz target)
 #define PACKET_BUNDLING_BUFFER_SIZE_MICROS 10000
 
+#define NETWORK_RECEIVE_BUDGET_MICROS 2000 // Time a loop spends handling queued server packets, at least one is always handled
+
 // Setup for the Magnetometer
 #define useFullCalibrationMatrix true
 
@@ -78,7 +89,21 @@
 // Experimental
 #define OPTIMIZE_UPDATES true
 
+// Rotation send rate of fusion sensors (softfusion, BMI160), see sensors/SendRateScheduler.h
+#define SEND_RATE_ADAPTIVE true // Follow the motion, if false rotations are sent at SEND_RATE_MOVING_HZ
+#define SEND_RATE_REST_HZ 10 // Keep-alive rate while rest is detected
+#define SEND_RATE_MOVING_HZ 120 // Rate in slow motion
+#define SEND_RATE_MAX_HZ 250 // Rate at SEND_RATE_FAST_MOTION_DPS and above, capped at the gyro rate
+#define SEND_RATE_FAST_MOTION_DPS 360 // Angular speed (deg/s) that gets the full SEND_RATE_MAX_HZ
+
 #define I2C_SPEED 400000
+// On MCUs with two I2C controllers, IMUs on a second SCL/SDA pair get their own controller.
+// Set to true to share one controller and re-pin it between pairs instead (always the case on ESP8266/ESP32-C3)
+#define I2C_FORCE_BUS_SWAP false
+#define SPI_SPEED 8000000 // for IMUs on SPI (IMU_*_SPI), all supported ones can do at least 10MHz
+#define IMU_BOOT_TIMEOUT_MS 500 // IMUs are probed until they answer for this long after sensor setup started
+#define SENSOR_ACQUISITION_TASK true // On dual-core ESP32, read and fuse IMU data in a task on the other core than the main loop
+#define SENSOR_ACQUISITION_TASK_PRIORITY 5 // Above the Arduino loop (1), below the Wi-Fi and network stack tasks
 
 #define COMPLIANCE_MODE true
 #define USE_ATTENUATION COMPLIANCE_MODE && ESP8266
@@ -46,6 +46,12 @@
 IMU_DESC_ENTRY(IMU_BMP160, PRIMARY_IMU_ADDRESS_ONE, IMU_ROTATION, PIN_IMU_SCL, PIN_IMU_SDA, PRIMARY_IMU_OPTIONAL, BMI160_QMC_REMAP) \
 */
 
+// SPI IMU example (IMU_ICM42688_SPI, IMU_BMI270_SPI, IMU_LSM6DSV_SPI), the address field takes the chip select pin
+// The bus uses the default SPI pins of the board unless PIN_IMU_SPI_SCK/MISO/MOSI are defined (ESP32 only)
+/*
+IMU_DESC_ENTRY(IMU_ICM42688_SPI, PIN_IMU_CS, Quat(Vector3(0,1,0),IMU_ROTATION), PIN_IMU_SCL, PIN_IMU_SDA, PRIMARY_IMU_OPTIONAL, PIN_IMU_INT) \
+*/
+
 #ifndef IMU_DESC_LIST
 #define IMU_DESC_LIST \
         IMU_DESC_ENTRY(IMU,        PRIMARY_IMU_ADDRESS_ONE,   Quat(Vector3(0,1,0),IMU_ROTATION),        PIN_IMU_SCL, PIN_IMU_SDA, PRIMARY_IMU_OPTIONAL,   PIN_IMU_INT) \
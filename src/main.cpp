@@ -104,7 +104,7 @@ void setup()
 
     SerialCommands::setUp();
 
-    I2CSCAN::clearBus(PIN_IMU_SDA, PIN_IMU_SCL); // Make sure the bus isn't stuck when resetting ESP without powering it down
+    // The IMU buses are cleared by the sensor manager, once per SCL/SDA pair before probing them.
     // Fixes I2C issues for certain IMUs. Previously this feature was enabled for selected IMUs, now it's enabled for all.
     // If some IMU turned out to be broken by this, check needs to be re-added.
 
@@ -126,10 +126,10 @@ void setup()
 #endif
     Wire.setClock(I2C_SPEED);
 
-    // Wait for IMU to boot
-    delay(500);
-
+    // IMUs still booting are waited for by the sensor manager, only as long as they actually need
+    const unsigned long sensorSetupStart = millis();
     sensorManager.setup();
+    const unsigned long networkSetupStart = millis();
 
     networkManager.setup();
     OTA::otaSetup(otaPassword);
@@ -139,6 +139,10 @@ void setup()
 
     sensorManager.postSetup();
 
+    const unsigned long setupEnd = millis();
+    logger.info("Setup done %lu ms after power on (early init %lu ms, sensors %lu ms, network and post setup %lu ms)",
+        setupEnd, sensorSetupStart, networkSetupStart - sensorSetupStart, setupEnd - networkSetupStart);
+
     loopTime = micros();
 }
 
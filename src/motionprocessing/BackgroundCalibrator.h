@@ -0,0 +1,168 @@
+/*
+    SlimeVR Code is placed under the MIT license
+    Copyright (c) 2024 SlimeVR Contributors
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+
+#ifndef BACKGROUND_CALIBRATOR_H
+#define BACKGROUND_CALIBRATOR_H
+
+#include <stdint.h>
+#include <math.h>
+
+// Refines the gyro offset and the gyro and accel sample periods while the sensor is in use,
+// so they don't depend on the blocking calibration routines alone.
+// - Gyro offset: the mean raw gyro over RestWindowSeconds of uninterrupted rest. Rest detection
+//   lags the start of motion a little, so a window only counts once rest held for another
+//   RestGuardSeconds after it.
+// - Sample periods: samples counted between two empty FIFO reads at least RateWindowSeconds apart.
+//   A result further than RateTolerance from nominal (dropped samples after a FIFO overflow) is ignored.
+class BackgroundCalibrator {
+public:
+    static constexpr float RestWindowSeconds = 3.0f;
+    static constexpr float RestGuardSeconds = 0.5f;
+    static constexpr float RateWindowSeconds = 60.0f;
+    static constexpr float RateTolerance = 0.1f;
+
+    BackgroundCalibrator(float nominalGyrTs, float nominalAccTs)
+        : nominalGyrTs(nominalGyrTs),
+          nominalAccTs(nominalAccTs),
+          restWindowSamples(RestWindowSeconds / nominalGyrTs),
+          restGuardSamples(RestGuardSeconds / nominalGyrTs) {}
+
+    void onGyroSample(const int16_t xyz[3], bool atRest, float temperature) {
+        rateGyroSamples++;
+
+        if (!atRest) {
+            restSamples = 0;
+            guardSamples = 0;
+            return;
+        }
+
+        if (guardSamples > 0 && --guardSamples == 0) {
+            for (uint8_t i = 0; i < 3; i++) {
+                offset[i] = guardedOffset[i];
+            }
+            offsetTemperature = guardedTemperature;
+            offsetReady = true;
+        }
+
+        if (restSamples == 0) {
+            restSum[0] = restSum[1] = restSum[2] = 0;
+            restTemperatureSum = 0.0f;
+        }
+        restSum[0] += xyz[0];
+        restSum[1] += xyz[1];
+        restSum[2] += xyz[2];
+        restTemperatureSum += temperature;
+        if (++restSamples >= restWindowSamples) {
+            for (uint8_t i = 0; i < 3; i++) {
+                guardedOffset[i] = static_cast<float>(restSum[i]) / restSamples;
+            }
+            guardedTemperature = restTemperatureSum / restSamples;
+            guardSamples = restGuardSamples;
+            restSamples = 0;
+        }
+    }
+
+    void onAccelSample() {
+        rateAccelSamples++;
+    }
+
+    // call after every FIFO read that emptied the FIFO
+    void onFifoDrained(uint32_t now) {
+        if (!rateStarted) {
+            rateStarted = true;
+            rateStart = now;
+            rateGyroSamples = 0;
+            rateAccelSamples = 0;
+            return;
+        }
+
+        const uint32_t elapsedMicros = now - rateStart;
+        if (elapsedMicros < RateWindowSeconds * 1e6f) {
+            return;
+        }
+
+        const float elapsed = elapsedMicros * 1e-6f;
+        if (rateGyroSamples > 0 && rateAccelSamples > 0) {
+            const float measuredGyrTs = elapsed / rateGyroSamples;
+            const float measuredAccTs = elapsed / rateAccelSamples;
+            if (fabsf(measuredGyrTs - nominalGyrTs) <= nominalGyrTs * RateTolerance
+                && fabsf(measuredAccTs - nominalAccTs) <= nominalAccTs * RateTolerance) {
+                gyrTs = measuredGyrTs;
+                accTs = measuredAccTs;
+                periodsReady = true;
+            }
+        }
+        rateStart = now;
+        rateGyroSamples = 0;
+        rateAccelSamples = 0;
+    }
+
+    // true once per new estimate
+    bool takeGyroOffset(float out[3], float &temperature) {
+        if (!offsetReady) {
+            return false;
+        }
+        for (uint8_t i = 0; i < 3; i++) {
+            out[i] = offset[i];
+        }
+        temperature = offsetTemperature;
+        offsetReady = false;
+        return true;
+    }
+
+    bool takeSamplePeriods(float &outGyrTs, float &outAccTs) {
+        if (!periodsReady) {
+            return false;
+        }
+        outGyrTs = gyrTs;
+        outAccTs = accTs;
+        periodsReady = false;
+        return true;
+    }
+
+private:
+    float nominalGyrTs;
+    float nominalAccTs;
+    uint32_t restWindowSamples;
+    uint32_t restGuardSamples;
+
+    uint32_t restSamples = 0;
+    int32_t restSum[3]{0, 0, 0};
+    float restTemperatureSum = 0.0f;
+    uint32_t guardSamples = 0;
+    float guardedOffset[3]{0.0f, 0.0f, 0.0f};
+    float guardedTemperature = 0.0f;
+    bool offsetReady = false;
+    float offset[3]{0.0f, 0.0f, 0.0f};
+    float offsetTemperature = 0.0f;
+
+    bool rateStarted = false;
+    uint32_t rateStart = 0;
+    uint32_t rateGyroSamples = 0;
+    uint32_t rateAccelSamples = 0;
+    bool periodsReady = false;
+    float gyrTs = 0.0f;
+    float accTs = 0.0f;
+};
+
+#endif
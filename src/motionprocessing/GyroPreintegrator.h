@@ -0,0 +1,99 @@
+/*
+    SlimeVR Code is placed under the MIT license
+    Copyright (c) 2024 SlimeVR Contributors
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+
+#ifndef GYRO_PREINTEGRATOR_H
+#define GYRO_PREINTEGRATOR_H
+
+#include <stdint.h>
+
+#include "types.h"
+
+// Integrates a fixed number of gyro samples into one rotation vector, so fusion can run at a
+// fraction of the gyro ODR while the gyro keeps its full rate (and its anti-aliasing filter).
+// The sum of the sample increments misses the rotation of the axis within the interval,
+// which is added back with the usual first order coning term:
+//     phi = sum(dtheta_i) + 1/2 * sum(alpha_(i-1) x dtheta_i)
+// where alpha_(i-1) is the sum of the increments before sample i.
+class GyroPreintegrator {
+public:
+    explicit GyroPreintegrator(uint8_t samples)
+        : samples(samples > 0 ? samples : 1) {}
+
+    uint8_t getSamples() const {
+        return samples;
+    }
+
+    // true once the interval is complete, takeUpdate() then returns it
+    bool add(const sensor_real_t Gxyz[3], sensor_real_t deltat) {
+        const sensor_real_t dx = Gxyz[0] * deltat;
+        const sensor_real_t dy = Gxyz[1] * deltat;
+        const sensor_real_t dz = Gxyz[2] * deltat;
+
+        coning[0] += 0.5f * (alpha[1] * dz - alpha[2] * dy);
+        coning[1] += 0.5f * (alpha[2] * dx - alpha[0] * dz);
+        coning[2] += 0.5f * (alpha[0] * dy - alpha[1] * dx);
+        alpha[0] += dx;
+        alpha[1] += dy;
+        alpha[2] += dz;
+        time += deltat;
+
+        return ++count >= samples;
+    }
+
+    // The interval as one gyro sample: a constant rate over the summed sample time that
+    // rotates by the coning corrected rotation vector
+    void takeUpdate(sensor_real_t Gxyz[3], sensor_real_t &deltat) {
+        deltat = time;
+        const sensor_real_t invTime = time > 0 ? 1.0f / time : 0.0f;
+        for (uint8_t i = 0; i < 3; i++) {
+            Gxyz[i] = (alpha[i] + coning[i]) * invTime;
+        }
+        reset();
+    }
+
+    // rotation vector and time of the samples added since the last update
+    void getPending(sensor_real_t rotation[3], sensor_real_t &deltat) const {
+        deltat = time;
+        for (uint8_t i = 0; i < 3; i++) {
+            rotation[i] = alpha[i] + coning[i];
+        }
+    }
+
+    void reset() {
+        for (uint8_t i = 0; i < 3; i++) {
+            alpha[i] = 0.0f;
+            coning[i] = 0.0f;
+        }
+        time = 0.0f;
+        count = 0;
+    }
+
+private:
+    uint8_t samples;
+    uint8_t count = 0;
+    sensor_real_t alpha[3]{0.0f, 0.0f, 0.0f};
+    sensor_real_t coning[3]{0.0f, 0.0f, 0.0f};
+    sensor_real_t time = 0.0f;
+};
+
+#endif
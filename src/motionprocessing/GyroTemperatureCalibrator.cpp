@@ -23,6 +23,7 @@
 
 #include "GyroTemperatureCalibrator.h"
 #include "GlobalVars.h"
+#include "utils.h"
 
 void GyroTemperatureCalibrator::resetCurrentTemperatureState() {
     if (!state.numSamples) return;
@@ -60,7 +61,7 @@ void GyroTemperatureCalibrator::updateGyroTemperatureCalibration(const float tem
         lastTemp = 0;
         calibrationRunning = false;
         if (!configSaveFailed && !configSaved) {
-            saveConfig();
+            configSavePending = true;
         }
     }
     if (calibrationRunning) {
@@ -192,9 +193,16 @@ bool GyroTemperatureCalibrator::loadConfig(float newSensitivity) {
     return configSaved;
 }
 
+bool GyroTemperatureCalibrator::savePendingConfig() {
+    if (!configSavePending.exchange(false)) {
+        return false;
+    }
+    return saveConfig();
+}
+
 bool GyroTemperatureCalibrator::saveConfig() {
     if (configuration.saveTemperatureCalibration(sensorId, config)) {
-        m_Logger.info("Saved temperature calibration config (%0.1f%) for sensorId:%i",
+        m_Logger.info("Saved temperature calibration config (%0.1f%%) for sensorId:%i",
             config.getCalibrationDonePercent(),
             sensorId
         );
@@ -209,3 +217,48 @@ bool GyroTemperatureCalibrator::saveConfig() {
     }
     return configSaved;
 }
+
+void GyroTemperatureCalibrator::printState(SlimeVR::Logging::Logger &logger, float currentTemperature) {
+    const auto degCtoF = [](float degC) { return (degC * 9.0f/5.0f) + 32.0f; };
+
+    logger.info("Sensor %i temperature calibration state:", sensorId);
+    logger.info("  current temp: %0.4f C (%0.4f F)", currentTemperature, degCtoF(currentTemperature));
+    auto printTemperatureRange = [&](const char* label, float min, float max) {
+        logger.info("  %s: min %0.4f C max %0.4f C (min %0.4f F max %0.4f F)",
+            label, min, max, degCtoF(min), degCtoF(max)
+        );
+    };
+    printTemperatureRange("total range",
+        TEMP_CALIBRATION_MIN,
+        TEMP_CALIBRATION_MAX
+    );
+    printTemperatureRange("calibrated range",
+        config.minTemperatureRange,
+        config.maxTemperatureRange
+    );
+    logger.info("  done: %0.1f%%", config.getCalibrationDonePercent());
+}
+
+void GyroTemperatureCalibrator::printDebugState(SlimeVR::Logging::Logger &logger, float gyroOdrHz) {
+    logger.info("Sensor %i gyro odr %f hz, sensitivity %f lsb",
+        sensorId,
+        gyroOdrHz,
+        config.sensitivityLSB
+    );
+    logger.info("Sensor %i temperature calibration matrix (tempC x y z):", sensorId);
+    logger.info("BUF %i %i", sensorId, TEMP_CALIBRATION_BUFFER_SIZE);
+    logger.info("SENS %i %f", sensorId, config.sensitivityLSB);
+    logger.info("DATA %i", sensorId);
+    for (int i = 0; i < TEMP_CALIBRATION_BUFFER_SIZE; i++) {
+        logger.info("%f %f %f %f",
+            config.samples[i].t,
+            config.samples[i].x,
+            config.samples[i].y,
+            config.samples[i].z
+        );
+    }
+    logger.info("END %i", sensorId);
+    logger.info("y = %f + (%fx) + (%fxx) + (%fxxx)", UNPACK_VECTOR_ARRAY(config.cx), config.cx[3]);
+    logger.info("y = %f + (%fx) + (%fxx) + (%fxxx)", UNPACK_VECTOR_ARRAY(config.cy), config.cy[3]);
+    logger.info("y = %f + (%fx) + (%fxx) + (%fxxx)", UNPACK_VECTOR_ARRAY(config.cz), config.cz[3]);
+}
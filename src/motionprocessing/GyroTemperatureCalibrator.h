@@ -26,6 +26,7 @@
 
 #include <Arduino.h>
 #include <stdint.h>
+#include <atomic>
 #include "debug.h"
 #include "../logging/Logger.h"
 #include "../configuration/CalibrationConfig.h"
@@ -169,6 +170,9 @@ public:
     // left unset when sending saving command over serial so it can continue calibration and autosave later
     bool configSaved = false;
     bool configSaveFailed = false;
+    // set by updateGyroTemperatureCalibration when the calibration completes, the sensor saves
+    // it from the main loop with savePendingConfig() as the update may run on the acquisition task
+    std::atomic<bool> configSavePending{false};
 
     GyroTemperatureCalibrator(SlimeVR::Configuration::CalibrationConfigType _configType, uint8_t _sensorId, float sensitivity, uint32_t _samplesPerStep):
         sensorId(_sensorId),
@@ -185,6 +189,12 @@ public:
     bool approximateOffset(const float temperature, float GOxyz[3]);
     bool loadConfig(float newSensitivity);
     bool saveConfig();
+    bool savePendingConfig();
+
+    // progress and calibrated range, logged through the sensor's logger
+    void printState(SlimeVR::Logging::Logger &logger, float currentTemperature);
+    // collected samples and fitted curve in the format read by the tempcal tooling
+    void printDebugState(SlimeVR::Logging::Logger &logger, float gyroOdrHz);
 
     void reset() {
         config.reset();
@@ -51,55 +51,11 @@ public:
     }
 
 #ifndef REST_DETECTION_DISABLE_LPF
-    void filterInitialState(sensor_real_t x0, const double b[3], const double a[2], double out[])
+    // same Butterworth filters as VQF, including its float mode (VQF_SINGLE_PRECISION_FILTERS)
+    void filterVec(const sensor_real_t x[], size_t N, sensor_real_t tau, sensor_real_t Ts, const vqf_filter_t b[3],
+                        const vqf_filter_t a[2], vqf_filter_t state[], sensor_real_t out[])
     {
-        // initial state for steady state (equivalent to scipy.signal.lfilter_zi, obtained by setting y=x=x0 in the filter
-        // update equation)
-        out[0] = x0*(1 - b[0]);
-        out[1] = x0*(b[2] - a[1]);
-    }
-
-    sensor_real_t filterStep(sensor_real_t x, const double b[3], const double a[2], double state[2])
-    {
-        // difference equations based on scipy.signal.lfilter documentation
-        // assumes that a0 == 1.0
-        double y = b[0]*x + state[0];
-        state[0] = b[1]*x - a[0]*y + state[1];
-        state[1] = b[2]*x - a[1]*y;
-        return y;
-    }
-
-
-    void filterVec(const sensor_real_t x[], size_t N, sensor_real_t tau, sensor_real_t Ts, const double b[3],
-                        const double a[2], double state[], sensor_real_t out[])
-    {
-        assert(N>=2);
-
-        // to avoid depending on a single sample, average the first samples (for duration tau)
-        // and then use this average to calculate the filter initial state
-        if (isnan(state[0])) { // initialization phase
-            if (isnan(state[1])) { // first sample
-                state[1] = 0; // state[1] is used to store the sample count
-                for(size_t i = 0; i < N; i++) {
-                    state[2+i] = 0; // state[2+i] is used to store the sum
-                }
-            }
-            state[1]++;
-            for (size_t i = 0; i < N; i++) {
-                state[2+i] += x[i];
-                out[i] = state[2+i]/state[1];
-            }
-            if (state[1]*Ts >= tau) {
-                for(size_t i = 0; i < N; i++) {
-                    filterInitialState(out[i], b, a, state+2*i);
-                }
-            }
-            return;
-        }
-
-        for (size_t i = 0; i < N; i++) {
-            out[i] = filterStep(x[i], b, a, state+2*i);
-        }
+        VQF::filterVec(x, N, tau, Ts, b, a, state, out);
     }
 #endif
 
@@ -202,20 +158,8 @@ public:
         std::fill(restAccLpState, restAccLpState + 3*2, NaN);
     }
 
-    void filterCoeffs(sensor_real_t tau, sensor_real_t Ts, double outB[], double outA[]) {
-        assert(tau > 0);
-        assert(Ts > 0);
-        // second order Butterworth filter based on https://stackoverflow.com/a/52764064
-        double fc = (M_SQRT2 / (2.0*M_PI))/double(tau); // time constant of dampened, non-oscillating part of step response
-        double C = tan(M_PI*fc*double(Ts));
-        double D = C*C + sqrt(2)*C + 1;
-        double b0 = C*C/D;
-        outB[0] = b0;
-        outB[1] = 2*b0;
-        outB[2] = b0;
-        // a0 = 1.0
-        outA[0] = 2*(C*C-1)/D; // a1
-        outA[1] = (1-sqrt(2)*C+C*C)/D; // a2
+    void filterCoeffs(sensor_real_t tau, sensor_real_t Ts, vqf_filter_t outB[], vqf_filter_t outA[]) {
+        VQF::filterCoeffs(tau, Ts, outB, outA);
     }
 #endif
 
@@ -243,13 +187,13 @@ private:
     sensor_real_t accTs;
 #ifndef REST_DETECTION_DISABLE_LPF
     sensor_real_t restLastGyrLp[3];
-    double restGyrLpState[3*2];
-    double restGyrLpB[3];
-    double restGyrLpA[2];
+    vqf_filter_t restGyrLpState[3*2];
+    vqf_filter_t restGyrLpB[3];
+    vqf_filter_t restGyrLpA[2];
     sensor_real_t restLastAccLp[3];
-    double restAccLpState[3*2];
-    double restAccLpB[3];
-    double restAccLpA[2];
+    vqf_filter_t restAccLpState[3*2];
+    vqf_filter_t restAccLpB[3];
+    vqf_filter_t restAccLpA[2];
 #else
     struct {
         float gyr[3];
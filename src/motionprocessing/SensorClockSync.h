@@ -0,0 +1,183 @@
+/*
+    SlimeVR Code is placed under the MIT license
+    Copyright (c) 2024 SlimeVR Contributors
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+
+#ifndef SENSOR_CLOCK_SYNC_H
+#define SENSOR_CLOCK_SYNC_H
+
+#include <Arduino.h>
+#include <stdint.h>
+#include <math.h>
+
+// Maps the free running sensor time counter of an IMU onto the local micros() clock.
+// The counter and the sample rate come from the same IMU oscillator, so tracking
+// the ratio between both clocks gives the true sample period and a local timestamp
+// for every sample read from the FIFO.
+// Originally part of the BMI160 driver.
+class SensorClockSync {
+public:
+    // tickMicros: nominal duration of one sensor time LSB
+    // counterMask: width of the sensor time counter (0xFFFFFF for 24 bit)
+    // sampleMicros: nominal period of the sample stream that gets timestamped
+    // alignedToSamples: samples are taken when the counter crosses a multiple of the sample period
+    //                   (Bosch sensor time), otherwise timestamps are kept in line with anchorLastSample()
+    SensorClockSync(float tickMicros, uint32_t counterMask, float sampleMicros, bool alignedToSamples, uint32_t syncIntervalMicros = 25000)
+        : tickMicros(tickMicros),
+          counterMask(counterMask),
+          nominalSampleMicros(sampleMicros),
+          samplePeriodTicks(sampleMicros / tickMicros),
+          alignedToSamples(alignedToSamples),
+          syncIntervalMicros(syncIntervalMicros),
+          emaSamples((EMA_APPROX_SECONDS / 3 * 1e6) / syncIntervalMicros),
+          sampleDtMicros(sampleMicros)
+    { }
+
+    bool syncDue(uint32_t now) const {
+        return !hasSync || now - lastSyncPoll >= syncIntervalMicros;
+    }
+
+    // localTime is taken right before reading the sensor time, readMicros is how long the read took
+    void update(uint32_t localTime, uint32_t rawSensorTime, uint32_t readMicros) {
+        lastSyncPoll = localTime;
+        localTime0 = localTime1;
+        localTime1 = localTime;
+        syncLatencyMicros = readMicros * 0.3;
+        sensorTime0 = sensorTime1;
+        sensorTime1 = rawSensorTime & counterMask;
+        if (!hasSync) {
+            hasSync = true;
+            return;
+        }
+
+        // handle counter overflow
+        const double remoteDt = (sensorTime1 - sensorTime0) & counterMask;
+        const double localDt = localTime1 - localTime0;
+        const double nextSensorTimeRatio = localDt / (remoteDt * tickMicros);
+
+        // handle sdk lags, time travel and sensor resets
+        if (round(nextSensorTimeRatio) != 1.0) {
+            return;
+        }
+        sensorTimeRatio = nextSensorTimeRatio;
+        if (round(sensorTimeRatioEma) != 1.0) {
+            sensorTimeRatioEma = sensorTimeRatio;
+        }
+        sensorTimeRatioEma -= sensorTimeRatioEma / emaSamples;
+        sensorTimeRatioEma += sensorTimeRatio / emaSamples;
+
+        sampleDtMicros = nominalSampleMicros * sensorTimeRatioEma;
+        samplesSinceClockSync = 0;
+        synced = true;
+    }
+
+    bool isSynced() const {
+        return synced;
+    }
+
+    // local micros per nominal sensor micro, 1.0 when the IMU oscillator doesn't drift
+    double getRatio() const {
+        return sensorTimeRatioEma;
+    }
+
+    double getSampleDtMicros() const {
+        return sampleDtMicros;
+    }
+
+    // advances the timestamped stream by one sample, returns its dt in local clock
+    double nextSampleDtMicros() {
+        if (!alignedToSamples) {
+            // the sample phase is unknown, samples are spaced by the tracked period
+            timestamp0 = timestamp1;
+            timestampFraction += sampleDtMicros;
+            const uint32_t wholeMicros = timestampFraction;
+            timestampFraction -= wholeMicros;
+            timestamp1 += wholeMicros;
+            return sampleDtMicros;
+        }
+
+        // sensor time keeps counting between samples, back off to the last sample boundary
+        const uint32_t alignmentOffset =
+            fmod(static_cast<double>(sensorTime1), samplePeriodTicks) * tickMicros * sensorTimeRatioEma;
+
+        timestamp0 = timestamp1;
+        timestamp1 = (localTime1 - alignmentOffset - syncLatencyMicros) +
+            (++samplesSinceClockSync) * sampleDtMicros;
+        int32_t dtMicros = timestamp1 - timestamp0;
+
+        // snap to whole sample periods, jumps happen when the timeline is re-anchored by a sync
+        const float invPeriod = 1.0f / nominalSampleMicros;
+        int32_t sampleOffset = round((float)dtMicros * invPeriod) - 1;
+        if (abs(sampleOffset) > 3) {
+            dtMicros = sampleDtMicros;
+        } else if (sampleOffset != 0) {
+            dtMicros -= sampleOffset * sampleDtMicros;
+        }
+        return dtMicros;
+    }
+
+    // local clock timestamp of the last sample passed through nextSampleDtMicros
+    uint32_t getLastSampleTimestamp() const {
+        return timestamp1;
+    }
+
+    // called after the fifo was read empty at localTime, so the last sample is at most one period old
+    void anchorLastSample(uint32_t localTime) {
+        if (alignedToSamples) {
+            return;
+        }
+        const int32_t age = localTime - timestamp1;
+        if (age < 0) {
+            timestamp1 = localTime;
+        } else if (age > sampleDtMicros) {
+            timestamp1 = localTime - static_cast<uint32_t>(sampleDtMicros);
+        }
+    }
+
+private:
+    static constexpr double EMA_APPROX_SECONDS = 1.0;
+
+    float tickMicros;
+    uint32_t counterMask;
+    float nominalSampleMicros;
+    double samplePeriodTicks;
+    bool alignedToSamples;
+    uint32_t syncIntervalMicros;
+    uint32_t emaSamples;
+
+    bool hasSync = false;
+    bool synced = false;
+    uint32_t lastSyncPoll = 0;
+    uint32_t sensorTime0 = 0;
+    uint32_t sensorTime1 = 0;
+    uint32_t localTime0 = 0;
+    uint32_t localTime1 = 0;
+    double sensorTimeRatio = 1;
+    double sensorTimeRatioEma = 1;
+    double sampleDtMicros;
+    uint32_t syncLatencyMicros = 0;
+    uint32_t samplesSinceClockSync = 0;
+    uint32_t timestamp0 = 0;
+    uint32_t timestamp1 = 0;
+    double timestampFraction = 0;
+};
+
+#endif
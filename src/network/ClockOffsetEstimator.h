@@ -0,0 +1,119 @@
+/*
+	SlimeVR Code is placed under the MIT license
+	Copyright (c) 2024 SlimeVR Contributors
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+	THE SOFTWARE.
+*/
+#ifndef SLIMEVR_NETWORK_CLOCKOFFSETESTIMATOR_H_
+#define SLIMEVR_NETWORK_CLOCKOFFSETESTIMATOR_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace SlimeVR {
+namespace Network {
+
+// Offset between the local micros() clock and the server clock, measured NTP style from
+// ping round trips. Each round trip gives an offset that is off by at most half its
+// network delay, so like NTP's clock filter the estimate follows the least delayed of
+// the last few round trips, aged by the worst case drift of both clocks.
+class ClockOffsetEstimator {
+public:
+	// Round trips kept for the filter
+	static constexpr size_t Window = 16;
+	// Round trips needed before timestamps are trusted
+	static constexpr size_t MinSamples = 3;
+	// Worst case frequency difference of the two clocks in parts per million
+	static constexpr int64_t MaxDriftPpm = 50;
+
+	// Extends the 32-bit micros() clock to 64 bits, must see a time at least every 35 minutes
+	int64_t unwrap(uint32_t localMicros) {
+		m_LocalClock += static_cast<int32_t>(localMicros - static_cast<uint32_t>(m_LocalClock));
+		return m_LocalClock;
+	}
+
+	// localSent and localReceived in unwrapped local time, the others in server time
+	void addSample(int64_t localSent, int64_t serverReceived, int64_t serverSent, int64_t localReceived) {
+		const int64_t delay = (localReceived - localSent) - (serverSent - serverReceived);
+		if (delay < 0 || serverSent < serverReceived) {
+			// one of the clocks jumped
+			return;
+		}
+
+		m_Samples[m_NextSample] = {
+			((serverReceived - localSent) + (serverSent - localReceived)) / 2,
+			delay,
+			localReceived,
+		};
+		m_NextSample = (m_NextSample + 1) % Window;
+		if (m_SampleCount < Window) {
+			m_SampleCount++;
+		}
+
+		const Sample* best = nullptr;
+		int64_t bestError = 0;
+		for (size_t i = 0; i < m_SampleCount; i++) {
+			const Sample& sample = m_Samples[i];
+			const int64_t error = sample.delay / 2 + (localReceived - sample.localTime) * MaxDriftPpm / 1000000;
+			if (best == nullptr || error < bestError) {
+				best = &sample;
+				bestError = error;
+			}
+		}
+		m_Offset = best->offset;
+		m_Delay = best->delay;
+	}
+
+	void reset() {
+		m_SampleCount = 0;
+		m_NextSample = 0;
+	}
+
+	bool isSynced() const { return m_SampleCount >= MinSamples; }
+
+	// Server time of a micros() timestamp up to 35 minutes away from the last unwrapped time
+	int64_t toServerMicros(uint32_t localMicros) const {
+		const int64_t local = m_LocalClock + static_cast<int32_t>(localMicros - static_cast<uint32_t>(m_LocalClock));
+		return local + m_Offset;
+	}
+
+	int64_t getOffsetMicros() const { return m_Offset; }
+	// Round trip network delay of the round trip the offset comes from
+	int64_t getDelayMicros() const { return m_Delay; }
+
+private:
+	struct Sample {
+		int64_t offset;
+		int64_t delay;
+		int64_t localTime;
+	};
+
+	Sample m_Samples[Window]{};
+	size_t m_SampleCount = 0;
+	size_t m_NextSample = 0;
+
+	int64_t m_LocalClock = 0;
+	int64_t m_Offset = 0;
+	int64_t m_Delay = 0;
+};
+
+}  // namespace Network
+}  // namespace SlimeVR
+
+#endif  // SLIMEVR_NETWORK_CLOCKOFFSETESTIMATOR_H_
@@ -0,0 +1,108 @@
+/*
+	SlimeVR Code is placed under the MIT license
+	Copyright (c) 2024 SlimeVR Contributors
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+	THE SOFTWARE.
+*/
+#ifndef SLIMEVR_NETWORK_COMPACTENCODING_H_
+#define SLIMEVR_NETWORK_COMPACTENCODING_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "quat.h"
+#include "vector3.h"
+
+namespace SlimeVR {
+namespace Network {
+namespace CompactEncoding {
+
+// Smallest-three quaternion in 48 bits: the index of the largest component in bits
+// 46-45, then the other three in order as 15-bit signed fixed point of +-1/sqrt(2),
+// bit 47 is 0. The largest component is made positive and rebuilt from the
+// others, so the rotation is off by less than 0.01 degrees.
+constexpr float QuaternionRange = 0.70710678f;
+constexpr int32_t QuaternionMax = (1 << 14) - 1;
+
+// Acceleration as int16 in 1/128 m/s^2 steps, +-256 m/s^2 (+-26 g)
+constexpr float AccelerationScale = 128.0f;
+
+inline uint64_t encodeQuaternion(const Quat& q) {
+	const float length = q.length();
+	if (!(length > 0.0f)) {
+		return encodeQuaternion(Quat());
+	}
+
+	int largest = 0;
+	for (int i = 1; i < 4; i++) {
+		if (std::abs(q[i]) > std::abs(q[largest])) {
+			largest = i;
+		}
+	}
+	// q and -q are the same rotation
+	const float scale = (q[largest] < 0 ? -1.0f : 1.0f) / length * QuaternionMax / QuaternionRange;
+
+	uint64_t bits = largest;
+	for (int i = 0; i < 4; i++) {
+		if (i == largest) {
+			continue;
+		}
+		int32_t value = std::lround(q[i] * scale);
+		value = std::clamp(value, -QuaternionMax, QuaternionMax);
+		bits = (bits << 15) | (static_cast<uint32_t>(value) & 0x7fff);
+	}
+	return bits;
+}
+
+inline Quat decodeQuaternion(uint64_t bits) {
+	const int largest = (bits >> 45) & 3;
+
+	Quat q;
+	float sumSquares = 0.0f;
+	int shift = 30;
+	for (int i = 0; i < 4; i++) {
+		if (i == largest) {
+			continue;
+		}
+		int32_t value = (bits >> shift) & 0x7fff;
+		if (value & 0x4000) {
+			value -= 0x8000;
+		}
+		q[i] = value * (QuaternionRange / QuaternionMax);
+		sumSquares += q[i] * q[i];
+		shift -= 15;
+	}
+	q[largest] = std::sqrt(std::max(0.0f, 1.0f - sumSquares));
+	return q;
+}
+
+inline int16_t encodeAcceleration(float value) {
+	return std::clamp<long>(std::lround(value * AccelerationScale), INT16_MIN, INT16_MAX);
+}
+
+inline float decodeAcceleration(int16_t value) {
+	return value / AccelerationScale;
+}
+
+}  // namespace CompactEncoding
+}  // namespace Network
+}  // namespace SlimeVR
+
+#endif  // SLIMEVR_NETWORK_COMPACTENCODING_H_
@@ -0,0 +1,245 @@
+/*
+	SlimeVR Code is placed under the MIT license
+	Copyright (c) 2023 SlimeVR Contributors
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+	THE SOFTWARE.
+*/
+#ifndef SLIMEVR_NETWORK_PACKETWRITER_H_
+#define SLIMEVR_NETWORK_PACKETWRITER_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "packets.h"
+
+namespace SlimeVR {
+namespace Network {
+
+// Largest UDP payload that goes out in one Wi-Fi frame: 1500 byte MTU minus IPv4 and UDP headers
+constexpr size_t MaxDatagramSize = 1472;
+
+// Encodes big-endian fields straight into a caller-owned buffer. A field that doesn't fit
+// fails the writer instead of being written, the packet must not be sent then.
+class PacketWriter {
+public:
+	PacketWriter(uint8_t* buffer, size_t capacity)
+		: m_Buffer(buffer)
+		, m_Capacity(capacity) {}
+
+	template <typename T>
+	void put(T value) {
+		static_assert(std::is_arithmetic_v<T>, "only numbers have a wire encoding");
+		if (!reserve(sizeof(T))) {
+			return;
+		}
+		uint8_t* target = m_Buffer + m_Size;
+		m_Size += sizeof(T);
+		if constexpr (sizeof(T) == 1) {
+			*target = static_cast<uint8_t>(value);
+			return;
+		}
+		using Bits = std::conditional_t<sizeof(T) == 2, uint16_t, std::conditional_t<sizeof(T) == 4, uint32_t, uint64_t>>;
+		Bits bits;
+		memcpy(&bits, &value, sizeof(T));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+		if constexpr (sizeof(T) == 2) {
+			bits = __builtin_bswap16(bits);
+		} else if constexpr (sizeof(T) == 4) {
+			bits = __builtin_bswap32(bits);
+		} else {
+			bits = __builtin_bswap64(bits);
+		}
+#endif
+		memcpy(target, &bits, sizeof(T));
+	}
+
+	void putBytes(const uint8_t* data, size_t length) {
+		if (!reserve(length)) {
+			return;
+		}
+		memcpy(m_Buffer + m_Size, data, length);
+		m_Size += length;
+	}
+
+	// Length as one byte, then the characters without the terminator
+	void putShortString(const char* str) {
+		const size_t length = strlen(str);
+		if (length > UINT8_MAX) {
+			m_Failed = true;
+			return;
+		}
+		put<uint8_t>(length);
+		putBytes(reinterpret_cast<const uint8_t*>(str), length);
+	}
+
+	bool ok() const { return !m_Failed; }
+	size_t size() const { return m_Size; }
+	const uint8_t* data() const { return m_Buffer; }
+
+private:
+	bool reserve(size_t length) {
+		if (m_Failed || m_Size + length > m_Capacity) {
+			m_Failed = true;
+			return false;
+		}
+		return true;
+	}
+
+	uint8_t* m_Buffer;
+	size_t m_Capacity;
+	size_t m_Size = 0;
+	bool m_Failed = false;
+};
+
+// Packs packets into one PACKET_BUNDLE datagram in a caller-owned buffer: the bundle type and
+// packet number, then every packet as its length (u16) and the packet without a packet number
+class BundleWriter {
+public:
+	static constexpr size_t HeaderSize = sizeof(uint32_t) + sizeof(uint64_t);
+
+	BundleWriter(uint8_t* buffer, size_t capacity)
+		: m_Buffer(buffer)
+		, m_Capacity(capacity) {}
+
+	// Encodes the next packet in place behind the packets added so far, leaving room for
+	// the bundle header and its length prefix
+	PacketWriter beginPacket() {
+		size_t start = (m_PacketCount == 0 ? HeaderSize : m_Size) + sizeof(uint16_t);
+		start = std::min(start, m_Capacity);
+		return PacketWriter(m_Buffer + start, m_Capacity - start);
+	}
+
+	// Adds the packet encoded by the last beginPacket(), which must be ok(). The first
+	// packet also writes the bundle header, which takes the next packet number
+	void addPacket(const PacketWriter& packet, uint64_t& packetNumber) {
+		if (m_PacketCount == 0) {
+			PacketWriter header(m_Buffer, HeaderSize);
+			header.put<uint32_t>(PACKET_BUNDLE);
+			header.put<uint64_t>(packetNumber++);
+			m_Size = HeaderSize;
+		}
+
+		PacketWriter length(m_Buffer + m_Size, sizeof(uint16_t));
+		length.put<uint16_t>(packet.size());
+		m_Size += sizeof(uint16_t) + packet.size();
+		m_PacketCount++;
+	}
+
+	void clear() {
+		m_Size = 0;
+		m_PacketCount = 0;
+	}
+
+	size_t size() const { return m_Size; }
+	uint16_t packetCount() const { return m_PacketCount; }
+	const uint8_t* data() const { return m_Buffer; }
+
+private:
+	uint8_t* m_Buffer;
+	size_t m_Capacity;
+	size_t m_Size = 0;
+	uint16_t m_PacketCount = 0;
+};
+
+// Fixed wire layout of one packet type, the fields after the header in order. write() only
+// compiles when it gets exactly one value convertible to each field.
+template <uint8_t PacketType, typename... Fields>
+struct PacketLayout {
+	static constexpr uint8_t Type = PacketType;
+	// packet type as a 32-bit int, then the packet number unless the packet is inside a bundle
+	static constexpr size_t HeaderSize = sizeof(uint32_t) + sizeof(uint64_t);
+	static constexpr size_t BundledHeaderSize = sizeof(uint32_t);
+	static constexpr size_t PayloadSize = (sizeof(Fields) + ... + 0);
+	static constexpr size_t Size = HeaderSize + PayloadSize;
+
+	template <typename... Args>
+	static void write(PacketWriter& packet, Args... args) {
+		static_assert(sizeof...(Args) == sizeof...(Fields), "wrong number of fields for this packet");
+		static_assert((std::is_convertible_v<Args, Fields> && ...), "field type doesn't match this packet");
+		(packet.put(static_cast<Fields>(args)), ...);
+	}
+};
+
+namespace Packets {
+	using Heartbeat = PacketLayout<PACKET_HEARTBEAT>;
+	// x, y, z, sensor id
+	using Acceleration = PacketLayout<PACKET_ACCEL, float, float, float, uint8_t>;
+	// voltage, percentage
+	using BatteryLevel = PacketLayout<PACKET_BATTERY_LEVEL, float, float>;
+	// sensor id, value
+	using Tap = PacketLayout<PACKET_TAP, uint8_t, uint8_t>;
+	// sensor id, error
+	using Error = PacketLayout<PACKET_ERROR, uint8_t, uint8_t>;
+	// sensor id, sensor state, IMU type
+	using SensorInfo = PacketLayout<PACKET_SENSOR_INFO, uint8_t, uint8_t, uint8_t>;
+	// sensor id, data type, x, y, z, w, accuracy
+	using RotationData = PacketLayout<PACKET_ROTATION_DATA, uint8_t, uint8_t, float, float, float, float, uint8_t>;
+	// sensor id, accuracy
+	using MagnetometerAccuracy = PacketLayout<PACKET_MAGNETOMETER_ACCURACY, uint8_t, float>;
+	// sensor id (always 255), signal strength
+	using SignalStrength = PacketLayout<PACKET_SIGNAL_STRENGTH, uint8_t, uint8_t>;
+	// sensor id, temperature
+	using Temperature = PacketLayout<PACKET_TEMPERATURE, uint8_t, float>;
+	// sensor id, rotation as a 48-bit smallest-three quaternion in three words,
+	// acceleration x, y, z as fixed point, accuracy
+	using RotationAccelerationCompact = PacketLayout<PACKET_ROTATION_ACCELERATION_COMPACT, uint8_t,
+		uint16_t, uint16_t, uint16_t,
+		int16_t, int16_t, int16_t,
+		uint8_t>;
+	// sensor id, server clock time of the sample in microseconds, then as RotationAccelerationCompact
+	using RotationAccelerationTimestamped = PacketLayout<PACKET_ROTATION_ACCELERATION_TIMESTAMPED, uint8_t,
+		uint64_t,
+		uint16_t, uint16_t, uint16_t,
+		int16_t, int16_t, int16_t,
+		uint8_t>;
+	// inspection type, sensor id, data type, then rotation, acceleration and magnetometer
+	// as x, y, z and accuracy each
+	using InspectionRawInt = PacketLayout<PACKET_INSPECTION, uint8_t, uint8_t, uint8_t,
+		uint32_t, uint32_t, uint32_t, uint8_t,
+		uint32_t, uint32_t, uint32_t, uint8_t,
+		uint32_t, uint32_t, uint32_t, uint8_t>;
+	using InspectionRawFloat = PacketLayout<PACKET_INSPECTION, uint8_t, uint8_t, uint8_t,
+		float, float, float, uint8_t,
+		float, float, float, uint8_t,
+		float, float, float, uint8_t>;
+
+	// sizes the server parses, changing one breaks the protocol
+	static_assert(Heartbeat::Size == 12);
+	static_assert(Acceleration::Size == 25);
+	static_assert(BatteryLevel::Size == 20);
+	static_assert(Tap::Size == 14);
+	static_assert(Error::Size == 14);
+	static_assert(SensorInfo::Size == 15);
+	static_assert(RotationData::Size == 31);
+	static_assert(MagnetometerAccuracy::Size == 17);
+	static_assert(SignalStrength::Size == 14);
+	static_assert(Temperature::Size == 17);
+	static_assert(RotationAccelerationCompact::Size == 26);
+	static_assert(RotationAccelerationTimestamped::Size == 34);
+	static_assert(InspectionRawInt::Size == 54);
+	static_assert(InspectionRawFloat::Size == 54);
+}  // namespace Packets
+
+}  // namespace Network
+}  // namespace SlimeVR
+
+#endif  // SLIMEVR_NETWORK_PACKETWRITER_H_
@@ -23,25 +23,13 @@
 
 #include "connection.h"
 
+#include "CompactEncoding.h"
 #include "GlobalVars.h"
 #include "logging/Logger.h"
 #include "packets.h"
 
 #define TIMEOUT 3000UL
 
-template <typename T>
-unsigned char* convert_to_chars(T src, unsigned char* target) {
-	union uwunion {
-		unsigned char c[sizeof(T)];
-		T v;
-	} un;
-	un.v = src;
-	for (size_t i = 0; i < sizeof(T); i++) {
-		target[i] = un.c[sizeof(T) - i - 1];
-	}
-	return target;
-}
-
 template <typename T>
 T convert_chars(unsigned char* const src) {
 	union uwunion {
@@ -65,154 +53,125 @@ namespace Network {
 	if (!b)     \
 		return;
 
-bool Connection::beginPacket() {
+PacketWriter Connection::beginPacket() {
 	if (m_IsBundle) {
-		m_BundlePacketPosition = 0;
-		return true;
-	}
-
-	int r = m_UDP.beginPacket(m_ServerHost, m_ServerPort);
-	if (r == 0) {
-		// This *technically* should *never* fail, since the underlying UDP
-		// library just returns 1.
-
-		m_Logger.warn("UDP beginPacket() failed");
+		return m_Bundle.beginPacket();
 	}
 
-	return r > 0;
+	return PacketWriter(m_TxBuffer, sizeof(m_TxBuffer));
 }
 
-bool Connection::endPacket() {
-	if (m_IsBundle) {
-		uint32_t innerPacketSize = m_BundlePacketPosition;
-
-		MUST_TRANSFER_BOOL((innerPacketSize > 0));
+void Connection::writePacketHeader(PacketWriter& packet, uint8_t type) {
+	packet.put<uint32_t>(type);
 
-		m_IsBundle = false;
-		
-		if (m_BundlePacketInnerCount == 0) {
-			sendPacketType(PACKET_BUNDLE);
-			sendPacketNumber();
-		}
-		sendShort(innerPacketSize);
-		sendBytes(m_Packet, innerPacketSize);
-
-		m_BundlePacketInnerCount++;
-		m_IsBundle = true;
-		return true;
+	// Inner packets of a bundle share the number of the bundle
+	if (!m_IsBundle) {
+		packet.put<uint64_t>(m_PacketNumber++);
 	}
-	
-	int r = m_UDP.endPacket();
-	if (r == 0) {
-		// This is usually just `ERR_ABRT` but the UDP client doesn't expose
-		// the full error code to us, so we just have to live with it.
+}
 
-		// m_Logger.warn("UDP endPacket() failed");
+bool Connection::endPacket(PacketWriter& packet) {
+	if (!packet.ok()) {
+		if (m_IsBundle) {
+			m_BundleStats.packetsDropped++;
+		}
+		return false;
 	}
 
-	return r > 0;
-}
+	if (m_IsBundle) {
+		MUST_TRANSFER_BOOL((packet.size() > 0));
 
-bool Connection::beginBundle() {
-	MUST_TRANSFER_BOOL(m_ServerFeatures.has(ServerFeatures::PROTOCOL_BUNDLE_SUPPORT));
-	MUST_TRANSFER_BOOL(m_Connected);
-	MUST_TRANSFER_BOOL(!m_IsBundle);
-	MUST_TRANSFER_BOOL(beginPacket());
+		m_Bundle.addPacket(packet, m_PacketNumber);
+		return true;
+	}
 
-	m_IsBundle = true;
-	m_BundlePacketInnerCount = 0;
-	return true;
+	return sendDatagram(m_TxBuffer, packet.size());
 }
 
-bool Connection::endBundle() {
-	MUST_TRANSFER_BOOL(m_IsBundle);
-
-	m_IsBundle = false;
-	
-	MUST_TRANSFER_BOOL((m_BundlePacketInnerCount > 0));
+template <typename Encode>
+bool Connection::sendEncoded(Encode&& encode) {
+	PacketWriter packet = beginPacket();
+	encode(packet);
 
-	return endPacket();
-}
+	if (!packet.ok() && m_IsBundle && m_Bundle.packetCount() > 0) {
+		// The bundle is full, send it and start the next one with this packet
+		m_BundleStats.overflowFlushes++;
+		flushBundle();
 
-size_t Connection::write(const uint8_t *buffer, size_t size) {
-	if (m_IsBundle) {
-		if (m_BundlePacketPosition + size > sizeof(m_Packet)) {
-			return 0;
-		}
-		memcpy(m_Packet + m_BundlePacketPosition, buffer, size);
-		m_BundlePacketPosition += size;
-		return size;
+		packet = beginPacket();
+		encode(packet);
 	}
-	return m_UDP.write(buffer, size);
-}
 
-size_t Connection::write(uint8_t byte) {
-	return write(&byte, 1);
+	return endPacket(packet);
 }
 
-bool Connection::sendFloat(float f) {
-	convert_to_chars(f, m_Buf);
-
-	return write(m_Buf, sizeof(f)) != 0;
+template <typename Layout, typename... Args>
+bool Connection::sendPacket(Args... args) {
+	return sendEncoded([&](PacketWriter& packet) {
+		writePacketHeader(packet, Layout::Type);
+		Layout::write(packet, args...);
+	});
 }
 
-bool Connection::sendByte(uint8_t c) { return write(&c, 1) != 0; }
+bool Connection::flushBundle() {
+	bool sent = sendDatagram(m_Bundle.data(), m_Bundle.size());
 
-bool Connection::sendShort(uint16_t i) {
-	convert_to_chars(i, m_Buf);
+	if (sent) {
+		m_BundleStats.bundlesSent++;
+		m_BundleStats.bundledPackets += m_Bundle.packetCount();
+		m_BundleStats.maxPacketsPerBundle
+			= std::max<uint32_t>(m_BundleStats.maxPacketsPerBundle, m_Bundle.packetCount());
+	} else {
+		m_BundleStats.sendFailures++;
+	}
 
-	return write(m_Buf, sizeof(i)) != 0;
+	m_Bundle.clear();
+	return sent;
 }
 
-bool Connection::sendInt(uint32_t i) {
-	convert_to_chars(i, m_Buf);
-
-	return write(m_Buf, sizeof(i)) != 0;
-}
+bool Connection::sendDatagram(const uint8_t* data, size_t size) {
+	int r = m_UDP.beginPacket(m_ServerHost, m_ServerPort);
+	if (r == 0) {
+		// This *technically* should *never* fail, since the underlying UDP
+		// library just returns 1.
 
-bool Connection::sendLong(uint64_t l) {
-	convert_to_chars(l, m_Buf);
+		m_Logger.warn("UDP beginPacket() failed");
+		return false;
+	}
 
-	return write(m_Buf, sizeof(l)) != 0;
-}
+	// The whole datagram goes to the UDP stack in one call instead of a
+	// write per field
+	m_UDP.write(data, size);
 
-bool Connection::sendBytes(const uint8_t* c, size_t length) {
-	return write(c, length) != 0;
-}
+	r = m_UDP.endPacket();
+	if (r == 0) {
+		// This is usually just `ERR_ABRT` but the UDP client doesn't expose
+		// the full error code to us, so we just have to live with it.
 
-bool Connection::sendPacketNumber() {
-	if (m_IsBundle) {
-		return true;
+		// m_Logger.warn("UDP endPacket() failed");
 	}
 
-	uint64_t pn = m_PacketNumber++;
-
-	return sendLong(pn);
+	return r > 0;
 }
 
-bool Connection::sendShortString(const char* str) {
-	uint8_t size = strlen(str);
-
-	MUST_TRANSFER_BOOL(sendByte(size));
-	MUST_TRANSFER_BOOL(sendBytes((const uint8_t*)str, size));
+bool Connection::beginBundle() {
+	MUST_TRANSFER_BOOL(m_ServerFeatures.has(ServerFeatures::PROTOCOL_BUNDLE_SUPPORT));
+	MUST_TRANSFER_BOOL(m_Connected);
+	MUST_TRANSFER_BOOL(!m_IsBundle);
 
+	m_IsBundle = true;
+	m_Bundle.clear();
 	return true;
 }
 
-bool Connection::sendPacketType(uint8_t type) {
-	MUST_TRANSFER_BOOL(sendByte(0));
-	MUST_TRANSFER_BOOL(sendByte(0));
-	MUST_TRANSFER_BOOL(sendByte(0));
-
-	return sendByte(type);
-}
+bool Connection::endBundle() {
+	MUST_TRANSFER_BOOL(m_IsBundle);
 
-bool Connection::sendLongString(const char* str) {
-	int size = strlen(str);
+	m_IsBundle = false;
 
-	MUST_TRANSFER_BOOL(sendInt(size));
+	MUST_TRANSFER_BOOL((m_Bundle.packetCount() > 0));
 
-	return sendBytes((const uint8_t*)str, size);
+	return flushBundle();
 }
 
 int Connection::getWriteError() { return m_UDP.getWriteError(); }
@@ -221,85 +180,46 @@ int Connection::getWriteError() { return m_UDP.getWriteError(); }
 void Connection::sendHeartbeat() {
 	MUST(m_Connected);
 
-	MUST(beginPacket());
-
-	MUST(sendPacketType(PACKET_HEARTBEAT));
-	MUST(sendPacketNumber());
-
-	MUST(endPacket());
+	sendPacket<Packets::Heartbeat>();
 }
 
 // PACKET_ACCEL 4
 void Connection::sendSensorAcceleration(uint8_t sensorId, Vector3 vector) {
 	MUST(m_Connected);
 
-	MUST(beginPacket());
-
-	MUST(sendPacketType(PACKET_ACCEL));
-	MUST(sendPacketNumber());
-	MUST(sendFloat(vector.x));
-	MUST(sendFloat(vector.y));
-	MUST(sendFloat(vector.z));
-	MUST(sendByte(sensorId));
-
-	MUST(endPacket());
+	sendPacket<Packets::Acceleration>(vector.x, vector.y, vector.z, sensorId);
 }
 
 // PACKET_BATTERY_LEVEL 12
 void Connection::sendBatteryLevel(float batteryVoltage, float batteryPercentage) {
 	MUST(m_Connected);
 
-	MUST(beginPacket());
-
-	MUST(sendPacketType(PACKET_BATTERY_LEVEL));
-	MUST(sendPacketNumber());
-	MUST(sendFloat(batteryVoltage));
-	MUST(sendFloat(batteryPercentage));
-
-	MUST(endPacket());
+	sendPacket<Packets::BatteryLevel>(batteryVoltage, batteryPercentage);
 }
 
 // PACKET_TAP 13
 void Connection::sendSensorTap(uint8_t sensorId, uint8_t value) {
 	MUST(m_Connected);
 
-	MUST(beginPacket());
-
-	MUST(sendPacketType(PACKET_TAP));
-	MUST(sendPacketNumber());
-	MUST(sendByte(sensorId));
-	MUST(sendByte(value));
-
-	MUST(endPacket());
+	sendPacket<Packets::Tap>(sensorId, value);
 }
 
 // PACKET_ERROR 14
 void Connection::sendSensorError(uint8_t sensorId, uint8_t error) {
 	MUST(m_Connected);
 
-	MUST(beginPacket());
-
-	MUST(sendPacketType(PACKET_ERROR));
-	MUST(sendPacketNumber());
-	MUST(sendByte(sensorId));
-	MUST(sendByte(error));
-
-	MUST(endPacket());
+	sendPacket<Packets::Error>(sensorId, error);
 }
 
 // PACKET_SENSOR_INFO 15
 void Connection::sendSensorInfo(Sensor& sensor) {
 	MUST(m_Connected);
 
-	MUST(beginPacket());
-
-	MUST(sendPacketType(PACKET_SENSOR_INFO));
-	MUST(sendPacketNumber());
-	MUST(sendByte(sensor.getSensorId()));
-	MUST(sendByte(static_cast<uint8_t>(sensor.getSensorState())));
-	MUST(sendByte(static_cast<uint8_t>(sensor.getSensorType())));
-
-	MUST(endPacket());
+	sendPacket<Packets::SensorInfo>(
+		sensor.getSensorId(),
+		static_cast<uint8_t>(sensor.getSensorState()),
+		static_cast<uint8_t>(sensor.getSensorType())
+	);
 }
 
 // PACKET_ROTATION_DATA 17
@@ -311,74 +231,94 @@ void Connection::sendRotationData(
 ) {
 	MUST(m_Connected);
 
-	MUST(beginPacket());
-
-	MUST(sendPacketType(PACKET_ROTATION_DATA));
-	MUST(sendPacketNumber());
-	MUST(sendByte(sensorId));
-	MUST(sendByte(dataType));
-	MUST(sendFloat(quaternion->x));
-	MUST(sendFloat(quaternion->y));
-	MUST(sendFloat(quaternion->z));
-	MUST(sendFloat(quaternion->w));
-	MUST(sendByte(accuracyInfo));
-
-	MUST(endPacket());
+	sendPacket<Packets::RotationData>(
+		sensorId,
+		dataType,
+		quaternion->x,
+		quaternion->y,
+		quaternion->z,
+		quaternion->w,
+		accuracyInfo
+	);
 }
 
 // PACKET_MAGNETOMETER_ACCURACY 18
 void Connection::sendMagnetometerAccuracy(uint8_t sensorId, float accuracyInfo) {
 	MUST(m_Connected);
 
-	MUST(beginPacket());
-
-	MUST(sendPacketType(PACKET_MAGNETOMETER_ACCURACY));
-	MUST(sendPacketNumber());
-	MUST(sendByte(sensorId));
-	MUST(sendFloat(accuracyInfo));
-
-	MUST(endPacket());
+	sendPacket<Packets::MagnetometerAccuracy>(sensorId, accuracyInfo);
 }
 
 // PACKET_SIGNAL_STRENGTH 19
 void Connection::sendSignalStrength(uint8_t signalStrength) {
 	MUST(m_Connected);
 
-	MUST(beginPacket());
-
-	MUST(sendPacketType(PACKET_SIGNAL_STRENGTH));
-	MUST(sendPacketNumber());
-	MUST(sendByte(255));
-	MUST(sendByte(signalStrength));
-
-	MUST(endPacket());
+	sendPacket<Packets::SignalStrength>(255, signalStrength);
 }
 
 // PACKET_TEMPERATURE 20
 void Connection::sendTemperature(uint8_t sensorId, float temperature) {
 	MUST(m_Connected);
 
-	MUST(beginPacket());
-
-	MUST(sendPacketType(PACKET_TEMPERATURE));
-	MUST(sendPacketNumber());
-	MUST(sendByte(sensorId));
-	MUST(sendFloat(temperature));
-
-	MUST(endPacket());
+	sendPacket<Packets::Temperature>(sensorId, temperature);
 }
 
 // PACKET_FEATURE_FLAGS 22
 void Connection::sendFeatureFlags() {
 	MUST(m_Connected);
 
-	MUST(beginPacket());
+	sendEncoded([&](PacketWriter& packet) {
+		writePacketHeader(packet, PACKET_FEATURE_FLAGS);
+		packet.putBytes(FirmwareFeatures::flags.data(), FirmwareFeatures::flags.size());
+	});
+}
+
+// PACKET_ROTATION_ACCELERATION_COMPACT 240
+void Connection::sendRotationAccelerationCompact(
+	uint8_t sensorId,
+	const Quat& quaternion,
+	Vector3 acceleration,
+	uint8_t accuracyInfo
+) {
+	MUST(m_Connected);
+
+	const uint64_t rotation = CompactEncoding::encodeQuaternion(quaternion);
+
+	sendPacket<Packets::RotationAccelerationCompact>(
+		sensorId,
+		static_cast<uint16_t>(rotation >> 32),
+		static_cast<uint16_t>(rotation >> 16),
+		static_cast<uint16_t>(rotation),
+		CompactEncoding::encodeAcceleration(acceleration.x),
+		CompactEncoding::encodeAcceleration(acceleration.y),
+		CompactEncoding::encodeAcceleration(acceleration.z),
+		accuracyInfo
+	);
+}
 
-	MUST(sendPacketType(PACKET_FEATURE_FLAGS));
-	MUST(sendPacketNumber());
-	MUST(write(FirmwareFeatures::flags.data(), FirmwareFeatures::flags.size()));
+// PACKET_ROTATION_ACCELERATION_TIMESTAMPED 241
+void Connection::sendRotationAccelerationTimestamped(
+	uint8_t sensorId,
+	const Quat& quaternion,
+	Vector3 acceleration,
+	uint8_t accuracyInfo,
+	uint32_t sampleMicros
+) {
+	MUST(m_Connected);
 
-	MUST(endPacket());
+	const uint64_t rotation = CompactEncoding::encodeQuaternion(quaternion);
+
+	sendPacket<Packets::RotationAccelerationTimestamped>(
+		sensorId,
+		m_ClockOffset.toServerMicros(sampleMicros),
+		static_cast<uint16_t>(rotation >> 32),
+		static_cast<uint16_t>(rotation >> 16),
+		static_cast<uint16_t>(rotation),
+		CompactEncoding::encodeAcceleration(acceleration.x),
+		CompactEncoding::encodeAcceleration(acceleration.y),
+		CompactEncoding::encodeAcceleration(acceleration.z),
+		accuracyInfo
+	);
 }
 
 void Connection::sendTrackerDiscovery() {
@@ -387,26 +327,26 @@ void Connection::sendTrackerDiscovery() {
 	uint8_t mac[6];
 	WiFi.macAddress(mac);
 
-	MUST(beginPacket());
+	PacketWriter packet = beginPacket();
 
-	MUST(sendPacketType(PACKET_HANDSHAKE));
+	packet.put<uint32_t>(PACKET_HANDSHAKE);
 	// Packet number is always 0 for handshake
-	MUST(sendLong(0));
-	MUST(sendInt(BOARD));
+	packet.put<uint64_t>(0);
+	packet.put<uint32_t>(BOARD);
 	// This is kept for backwards compatibility,
 	// but the latest SlimeVR server will not initialize trackers
 	// with firmware build > 8 until it recieves a sensor info packet
-	MUST(sendInt(static_cast<int>(sensorManager.getSensorType(0))));
-	MUST(sendInt(HARDWARE_MCU));
-	MUST(sendInt(0));
-	MUST(sendInt(0));
-	MUST(sendInt(0));
-	MUST(sendInt(FIRMWARE_BUILD_NUMBER));
-	MUST(sendShortString(FIRMWARE_VERSION));
+	packet.put<uint32_t>(static_cast<int>(sensorManager.getSensorType(0)));
+	packet.put<uint32_t>(HARDWARE_MCU);
+	packet.put<uint32_t>(0);
+	packet.put<uint32_t>(0);
+	packet.put<uint32_t>(0);
+	packet.put<uint32_t>(FIRMWARE_BUILD_NUMBER);
+	packet.putShortString(FIRMWARE_VERSION);
 	// MAC address string
-	MUST(sendBytes(mac, 6));
+	packet.putBytes(mac, 6);
 
-	MUST(endPacket());
+	endPacket(packet);
 }
 
 #if ENABLE_INSPECTION
@@ -427,32 +367,14 @@ void Connection::sendInspectionRawIMUData(
 ) {
 	MUST(m_Connected);
 
-	MUST(beginPacket());
-
-	MUST(sendPacketType(PACKET_INSPECTION));
-	MUST(sendPacketNumber());
-
-	MUST(sendByte(PACKET_INSPECTION_PACKETTYPE_RAW_IMU_DATA));
-
-	MUST(sendByte(sensorId));
-	MUST(sendByte(PACKET_INSPECTION_DATATYPE_INT));
-
-	MUST(sendInt(rX));
-	MUST(sendInt(rY));
-	MUST(sendInt(rZ));
-	MUST(sendByte(rA));
-
-	MUST(sendInt(aX));
-	MUST(sendInt(aY));
-	MUST(sendInt(aZ));
-	MUST(sendByte(aA));
-
-	MUST(sendInt(mX));
-	MUST(sendInt(mY));
-	MUST(sendInt(mZ));
-	MUST(sendByte(mA));
-
-	MUST(endPacket());
+	sendPacket<Packets::InspectionRawInt>(
+		PACKET_INSPECTION_PACKETTYPE_RAW_IMU_DATA,
+		sensorId,
+		PACKET_INSPECTION_DATATYPE_INT,
+		rX, rY, rZ, rA,
+		aX, aY, aZ, aA,
+		mX, mY, mZ, mA
+	);
 }
 
 void Connection::sendInspectionRawIMUData(
@@ -472,43 +394,55 @@ void Connection::sendInspectionRawIMUData(
 ) {
 	MUST(m_Connected);
 
-	MUST(beginPacket());
-
-	MUST(sendPacketType(PACKET_INSPECTION));
-	MUST(sendPacketNumber());
-
-	MUST(sendByte(PACKET_INSPECTION_PACKETTYPE_RAW_IMU_DATA));
-
-	MUST(sendByte(sensorId));
-	MUST(sendByte(PACKET_INSPECTION_DATATYPE_FLOAT));
-
-	MUST(sendFloat(rX));
-	MUST(sendFloat(rY));
-	MUST(sendFloat(rZ));
-	MUST(sendByte(rA));
-
-	MUST(sendFloat(aX));
-	MUST(sendFloat(aY));
-	MUST(sendFloat(aZ));
-	MUST(sendByte(aA));
-
-	MUST(sendFloat(mX));
-	MUST(sendFloat(mY));
-	MUST(sendFloat(mZ));
-	MUST(sendByte(mA));
-
-	MUST(endPacket());
+	sendPacket<Packets::InspectionRawFloat>(
+		PACKET_INSPECTION_PACKETTYPE_RAW_IMU_DATA,
+		sensorId,
+		PACKET_INSPECTION_DATATYPE_FLOAT,
+		rX, rY, rZ, rA,
+		aX, aY, aZ, aA,
+		mX, mY, mZ, mA
+	);
 }
 #endif
 
 void Connection::returnLastPacket(int len) {
 	MUST(m_Connected);
+	MUST((len > 0));
+
+	sendEncoded([&](PacketWriter& packet) { packet.putBytes(m_Packet, len); });
+}
+
+void Connection::answerClockSyncPing(int len, uint32_t receivedMicros) {
+	MUST(m_Connected);
 
-	MUST(beginPacket());
+	// Packet type (4) + Packet number (8) + ping id (4), then the clock sync timestamps
+	constexpr int PingSize = 16;
+	constexpr int ClockSyncPingSize = PingSize + 3 * static_cast<int>(sizeof(uint64_t));
+	if (len < ClockSyncPingSize) {
+		returnLastPacket(len);
+		return;
+	}
 
-	MUST(sendBytes(m_Packet, len));
+	const int64_t localSent = convert_chars<uint64_t>(&m_Packet[PingSize]);
+	const int64_t serverReceived = convert_chars<uint64_t>(&m_Packet[PingSize + 8]);
+	const int64_t serverSent = convert_chars<uint64_t>(&m_Packet[PingSize + 16]);
+
+	// Only a pong the server answered directly closes a round trip, an older one
+	// would count the time we waited for this ping as network delay
+	if (localSent != 0 && localSent == m_LastPongMicros) {
+		m_ClockOffset.addSample(
+			localSent,
+			serverReceived,
+			serverSent,
+			m_ClockOffset.unwrap(receivedMicros)
+		);
+	}
 
-	MUST(endPacket());
+	m_LastPongMicros = m_ClockOffset.unwrap(micros());
+	sendEncoded([&](PacketWriter& packet) {
+		packet.putBytes(m_Packet, PingSize);
+		packet.put<uint64_t>(m_LastPongMicros);
+	});
 }
 
 void Connection::updateSensorState(std::vector<std::unique_ptr<Sensor>> & sensors) {
@@ -574,6 +508,8 @@ void Connection::searchForServer() {
 			
 			m_FeatureFlagsRequestAttempts = 0;
 			m_ServerFeatures = ServerFeatures { };
+			m_ClockOffset.reset();
+			m_LastPongMicros = 0;
 
 			statusManager.setStatus(SlimeVR::Status::SERVER_CONNECTING, false);
 			ledManager.off();
@@ -609,6 +545,8 @@ void Connection::reset() {
 void Connection::update() {
 	auto & sensors = sensorManager.getSensors();
 
+	m_ClockOffset.unwrap(micros());
+
 	updateSensorState(sensors);
 	maybeRequestFeatureFlags();
 
@@ -631,11 +569,39 @@ void Connection::update() {
 		return;
 	}
 
-	int packetSize = m_UDP.parsePacket();
-	if (!packetSize) {
-		return;
+	// Drain what queued up since the last loop, a burst (acks, pings, feature flags)
+	// shouldn't take one loop per packet
+	// parsePacket() already dequeues the datagram, so once the budget is used up the
+	// next one (if there is any) is still handled and the rest waits for the next loop
+	const uint32_t receiveStart = micros();
+	uint32_t handled = 0;
+	bool budgetLeft = true;
+	while (true) {
+		int packetSize = m_UDP.parsePacket();
+		if (!packetSize) {
+			break;
+		}
+		if (!budgetLeft) {
+			m_ReceiveStats.budgetExhausted++;
+		}
+
+		receivePacket(packetSize, micros());
+		handled++;
+
+		if (!budgetLeft) {
+			break;
+		}
+		budgetLeft = micros() - receiveStart < NETWORK_RECEIVE_BUDGET_MICROS;
 	}
 
+	if (handled > 0) {
+		m_ReceiveStats.updatesWithPackets++;
+		m_ReceiveStats.packetsHandled += handled;
+		m_ReceiveStats.maxPacketsPerUpdate = std::max(m_ReceiveStats.maxPacketsPerUpdate, handled);
+	}
+}
+
+void Connection::receivePacket(int packetSize, uint32_t receivedMicros) {
 	m_LastPacketTimestamp = millis();
 	int len = m_UDP.read(m_Packet, sizeof(m_Packet));
 
@@ -651,65 +617,89 @@ void Connection::update() {
 	(void)packetSize;
 #endif
 
-	switch (convert_chars<int>(m_Packet)) {
-		case PACKET_RECEIVE_HEARTBEAT:
-			sendHeartbeat();
-			break;
+	if (len < 4) {
+		m_ReceiveStats.unknownPackets++;
+		return;
+	}
 
-		case PACKET_RECEIVE_VIBRATE:
-			break;
+	PacketHandler handler = getPacketHandler(convert_chars<uint32_t>(m_Packet));
+	if (handler == nullptr) {
+		m_ReceiveStats.unknownPackets++;
+		return;
+	}
 
-		case PACKET_RECEIVE_HANDSHAKE:
-			// Assume handshake successful
-			m_Logger.warn("Handshake received again, ignoring");
-			break;
+	(this->*handler)(len, receivedMicros);
+}
 
-		case PACKET_RECEIVE_COMMAND:
-			break;
+Connection::PacketHandler Connection::getPacketHandler(uint32_t type) {
+	static constexpr auto handlers = [] {
+		std::array<PacketHandler, PACKET_FEATURE_FLAGS + 1> table{};
 
-		case PACKET_CONFIG:
-			break;
+		table[PACKET_RECEIVE_HEARTBEAT] = &Connection::handleHeartbeat;
+		table[PACKET_RECEIVE_VIBRATE] = &Connection::handleIgnored;
+		table[PACKET_RECEIVE_HANDSHAKE] = &Connection::handleHandshake;
+		table[PACKET_RECEIVE_COMMAND] = &Connection::handleIgnored;
+		table[PACKET_CONFIG] = &Connection::handleIgnored;
+		table[PACKET_PING_PONG] = &Connection::handlePingPong;
+		table[PACKET_SENSOR_INFO] = &Connection::handleSensorInfo;
+		table[PACKET_FEATURE_FLAGS] = &Connection::handleFeatureFlags;
 
-		case PACKET_PING_PONG:
-			returnLastPacket(len);
-			break;
+		return table;
+	}();
 
-		case PACKET_SENSOR_INFO:
-			if (len < 6) {
-				m_Logger.warn("Wrong sensor info packet");
-				break;
-			}
+	return type < handlers.size() ? handlers[type] : nullptr;
+}
 
-			for (int i = 0; i < (int)sensors.size(); i++) {
-				if (m_Packet[4] == sensors[i]->getSensorId()) {
-					m_AckedSensorState[i] = (SensorStatus)m_Packet[5];
-					break;
-				}
-			}
+void Connection::handleIgnored(int, uint32_t) {}
 
-			break;
+void Connection::handleHeartbeat(int, uint32_t) { sendHeartbeat(); }
 
-		case PACKET_FEATURE_FLAGS:
-			// Packet type (4) + Packet number (8) + flags (len - 12)
-			if (len < 13) {
-				m_Logger.warn("Invalid feature flags packet: too short");
-				break;
-			}
+void Connection::handleHandshake(int, uint32_t) {
+	// Assume handshake successful
+	m_Logger.warn("Handshake received again, ignoring");
+}
 
-			bool hadFlags = m_ServerFeatures.isAvailable();
-			
-			uint32_t flagsLength = len - 12;
-			m_ServerFeatures = ServerFeatures::from(&m_Packet[12], flagsLength);
-
-			if (!hadFlags) {
-				#if PACKET_BUNDLING != PACKET_BUNDLING_DISABLED
-					if (m_ServerFeatures.has(ServerFeatures::PROTOCOL_BUNDLE_SUPPORT)) {
-						m_Logger.debug("Server supports packet bundling");
-					}
-				#endif
-			}
+void Connection::handlePingPong(int len, uint32_t receivedMicros) {
+	if (m_ServerFeatures.has(ServerFeatures::PROTOCOL_CLOCK_SYNC)) {
+		answerClockSyncPing(len, receivedMicros);
+	} else {
+		returnLastPacket(len);
+	}
+}
+
+void Connection::handleSensorInfo(int len, uint32_t) {
+	if (len < 6) {
+		m_Logger.warn("Wrong sensor info packet");
+		return;
+	}
 
+	auto & sensors = sensorManager.getSensors();
+	for (int i = 0; i < (int)sensors.size(); i++) {
+		if (m_Packet[4] == sensors[i]->getSensorId()) {
+			m_AckedSensorState[i] = (SensorStatus)m_Packet[5];
 			break;
+		}
+	}
+}
+
+void Connection::handleFeatureFlags(int len, uint32_t) {
+	// Packet type (4) + Packet number (8) + flags (len - 12)
+	if (len < 13) {
+		m_Logger.warn("Invalid feature flags packet: too short");
+		return;
+	}
+
+	bool hadFlags = m_ServerFeatures.isAvailable();
+
+	uint32_t flagsLength = len - 12;
+	m_ServerFeatures = ServerFeatures::from(&m_Packet[12], flagsLength);
+
+	if (!hadFlags) {
+		#if PACKET_BUNDLING != PACKET_BUNDLING_DISABLED
+			if (m_ServerFeatures.has(ServerFeatures::PROTOCOL_BUNDLE_SUPPORT)) {
+				m_Logger.debug("Server supports packet bundling");
+			}
+		#endif
 	}
 }
 
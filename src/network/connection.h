@@ -26,11 +26,15 @@
 #include <Arduino.h>
 #include <WiFiUdp.h>
 
+#include <array>
+
 #include "globals.h"
 #include "quat.h"
 #include "sensors/sensor.h"
 #include "wifihandler.h"
 #include "featureflags.h"
+#include "ClockOffsetEstimator.h"
+#include "PacketWriter.h"
 
 namespace SlimeVR {
 namespace Network {
@@ -84,6 +88,33 @@ public:
 	// PACKET_FEATURE_FLAGS 22
 	void sendFeatureFlags();
 
+	// PACKET_ROTATION_ACCELERATION_COMPACT 240
+	void sendRotationAccelerationCompact(
+		uint8_t sensorId,
+		const Quat& quaternion,
+		Vector3 acceleration,
+		uint8_t accuracyInfo
+	);
+	// Whether the server takes the compact packet instead of PACKET_ROTATION_DATA + PACKET_ACCEL
+	bool supportsCompactRotationAcceleration() const {
+		return m_ServerFeatures.has(ServerFeatures::PROTOCOL_COMPACT_ROTATION_ACCELERATION);
+	}
+
+	// PACKET_ROTATION_ACCELERATION_TIMESTAMPED 241
+	// sampleMicros is the micros() time of the IMU sample the rotation comes from
+	void sendRotationAccelerationTimestamped(
+		uint8_t sensorId,
+		const Quat& quaternion,
+		Vector3 acceleration,
+		uint8_t accuracyInfo,
+		uint32_t sampleMicros
+	);
+	// Whether timestamped packets can be sent, needs a few clock sync pings after connecting
+	bool canSendSampleTimestamps() const {
+		return m_ServerFeatures.has(ServerFeatures::PROTOCOL_CLOCK_SYNC) && m_ClockOffset.isSynced();
+	}
+	const ClockOffsetEstimator& getClockOffset() const { return m_ClockOffset; }
+
 #if ENABLE_INSPECTION
 	void sendInspectionRawIMUData(
 		uint8_t sensorId,
@@ -121,34 +152,71 @@ public:
 		return m_ServerFeatures;
 	}
 
+	// Packets between these go out together in as few datagrams as possible, a
+	// packet that doesn't fit anymore sends the bundle so far and starts the next one
 	bool beginBundle();
 	bool endBundle();
 
+	struct BundleStats {
+		uint32_t bundlesSent = 0;
+		uint32_t bundledPackets = 0;
+		uint32_t maxPacketsPerBundle = 0;
+		// bundles sent before endBundle() because the next packet didn't fit
+		uint32_t overflowFlushes = 0;
+		// packets too big even for an empty bundle
+		uint32_t packetsDropped = 0;
+		// bundles the UDP stack refused, their packets are lost
+		uint32_t sendFailures = 0;
+	};
+
+	const BundleStats& getBundleStats() const { return m_BundleStats; }
+
+	struct ReceiveStats {
+		uint32_t packetsHandled = 0;
+		// update() calls that handled at least one packet
+		uint32_t updatesWithPackets = 0;
+		uint32_t maxPacketsPerUpdate = 0;
+		// update() calls that stopped at NETWORK_RECEIVE_BUDGET_MICROS with datagrams still queued
+		uint32_t budgetExhausted = 0;
+		uint32_t unknownPackets = 0;
+	};
+
+	const ReceiveStats& getReceiveStats() const { return m_ReceiveStats; }
+
 private:
 	void updateSensorState(std::vector<std::unique_ptr<Sensor>> & sensors);
 	void maybeRequestFeatureFlags();
 
-	bool beginPacket();
-	bool endPacket();
-
-	size_t write(const uint8_t *buffer, size_t size);
-	size_t write(uint8_t byte);
+	// Starts encoding a packet, in place behind the bundle built so far while bundling
+	PacketWriter beginPacket();
+	void writePacketHeader(PacketWriter& packet, uint8_t type);
+	// Sends the packet as one datagram, or appends it to the bundle
+	bool endPacket(PacketWriter& packet);
+	bool sendDatagram(const uint8_t* data, size_t size);
 
-	bool sendPacketType(uint8_t type);
-	bool sendPacketNumber();
-	bool sendFloat(float f);
-	bool sendByte(uint8_t c);
-	bool sendShort(uint16_t i);
-	bool sendInt(uint32_t i);
-	bool sendLong(uint64_t l);
-	bool sendBytes(const uint8_t* c, size_t length);
-	bool sendShortString(const char* str);
-	bool sendLongString(const char* str);
+	// Runs encode on a new packet and sends it, flushing a full bundle first if needed
+	template <typename Encode>
+	bool sendEncoded(Encode&& encode);
+	template <typename Layout, typename... Args>
+	bool sendPacket(Args... args);
+	bool flushBundle();
 
 	int getWriteError();
 
 	void returnLastPacket(int len);
 
+	// Handles one received packet, dispatched on its type
+	void receivePacket(int packetSize, uint32_t receivedMicros);
+	using PacketHandler = void (Connection::*)(int len, uint32_t receivedMicros);
+	static PacketHandler getPacketHandler(uint32_t type);
+	void handleIgnored(int len, uint32_t receivedMicros);
+	void handleHeartbeat(int len, uint32_t receivedMicros);
+	void handleHandshake(int len, uint32_t receivedMicros);
+	void handlePingPong(int len, uint32_t receivedMicros);
+	void handleSensorInfo(int len, uint32_t receivedMicros);
+	void handleFeatureFlags(int len, uint32_t receivedMicros);
+	void answerClockSyncPing(int len, uint32_t receivedMicros);
+
 	// PACKET_HEARTBEAT 0
 	void sendHeartbeat();
 
@@ -177,11 +245,16 @@ private:
 	unsigned long m_FeatureFlagsRequestTimestamp = millis();
 	ServerFeatures m_ServerFeatures{};
 
+	ClockOffsetEstimator m_ClockOffset;
+	int64_t m_LastPongMicros = 0;
+
 	bool m_IsBundle = false;
-	uint16_t m_BundlePacketPosition = 0;
-	uint16_t m_BundlePacketInnerCount = 0;
+	BundleStats m_BundleStats;
+
+	ReceiveStats m_ReceiveStats;
 
-	unsigned char m_Buf[8];
+	uint8_t m_TxBuffer[MaxDatagramSize];  // buffer for outgoing packets and bundles
+	BundleWriter m_Bundle{m_TxBuffer, sizeof(m_TxBuffer)};
 };
 
 }  // namespace Network
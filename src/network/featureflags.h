@@ -38,12 +38,29 @@ public:
         // Server can parse bundle packets: `PACKET_BUNDLE` = 100 (0x64).
         PROTOCOL_BUNDLE_SUPPORT,
 
+        // Upstream server: compact bundles `PACKET_BUNDLE_COMPACT` = 101 (0x65) and
+        // `PACKET_ROTATION_AND_ACCELERATION` = 23 (0x17). Not used by this firmware, only
+        // listed so the bit isn't taken for something else.
+        PROTOCOL_BUNDLE_COMPACT_SUPPORT,
+
+        // This fork's server protocol extensions start at bit 16, the upstream flags are
+        // numbered from 0 and keep growing from there.
+
+        // Server can parse `PACKET_ROTATION_ACCELERATION_COMPACT` = 240 (0xf0).
+        PROTOCOL_COMPACT_ROTATION_ACCELERATION = 16,
+
+        // Server sends clock sync pings and parses `PACKET_ROTATION_ACCELERATION_TIMESTAMPED` = 241 (0xf1).
+        // A clock sync ping appends to the ping id the firmware time of the last pong (u64),
+        // the server time it was received (u64) and the server time of this ping (u64), the
+        // pong appends its firmware send time (u64) to the ping id.
+        PROTOCOL_CLOCK_SYNC,
+
         // Add new flags here
 
         BITS_TOTAL,
     };
 
-    bool has(EServerFeatureFlags flag) {
+    bool has(EServerFeatureFlags flag) const {
         uint32_t bit = static_cast<uint32_t>(flag);
         return m_Available && (m_Flags[bit / 8] & (1 << (bit % 8)));
     }
@@ -52,7 +69,7 @@ public:
      * Whether the server supports the "feature flags" feature,
      * set to true when we've received flags packet from the server.
     */
-    bool isAvailable() {
+    bool isAvailable() const {
         return m_Available;
     }
 
@@ -47,11 +47,23 @@
 #define PACKET_TEMPERATURE 20
 // #define PACKET_USER_ACTION 21 // Joycon buttons only currently
 #define PACKET_FEATURE_FLAGS 22
+// #define PACKET_ROTATION_AND_ACCELERATION 23 // Upstream server protocol, not sent by this firmware
 
 #define PACKET_BUNDLE 100
+// #define PACKET_BUNDLE_COMPACT 101 // Upstream server protocol, not sent by this firmware
 
 #define PACKET_INSPECTION 105  // 0x69
 
+// Packets of this fork's server protocol extensions, numbered from 240 (0xf0) so they stay
+// clear of the upstream packet types, which count up from 0 and use 100-105 and 200
+
+// Rotation and acceleration in 14 bytes (see CompactEncoding.h), only sent when the
+// server sets ServerFeatures::PROTOCOL_COMPACT_ROTATION_ACCELERATION
+#define PACKET_ROTATION_ACCELERATION_COMPACT 240
+// Compact rotation and acceleration with the server clock time of the IMU sample, only
+// sent when the server sets ServerFeatures::PROTOCOL_CLOCK_SYNC and the clocks are synced
+#define PACKET_ROTATION_ACCELERATION_TIMESTAMPED 241
+
 #define PACKET_RECEIVE_HEARTBEAT 1
 #define PACKET_RECEIVE_VIBRATE 2
 #define PACKET_RECEIVE_HANDSHAKE 3
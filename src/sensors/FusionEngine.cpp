@@ -0,0 +1,272 @@
+#include "FusionEngine.h"
+
+#include <algorithm>
+#include <iterator>
+#include <strings.h>
+
+#include "mahony.h"
+#include "madgwick.h"
+#include "mahonyfixed.h"
+#include <vqf.h>
+#include <basicvqf.h>
+
+namespace SlimeVR
+{
+    namespace Sensors
+    {
+        namespace
+        {
+            struct SensorVQFParams: VQFParams {
+                SensorVQFParams() : VQFParams() {
+                    #ifndef VQF_NO_MOTION_BIAS_ESTIMATION
+                    motionBiasEstEnabled = true;
+                    #endif
+                    tauAcc = 2.0f;
+                    restMinT = 2.0f;
+                    restThGyr = 0.6f; // 400 norm
+                    restThAcc = 0.06f; // 100 norm
+                }
+            };
+
+            // Mahony and Madgwick, both integrate the last accel and mag sample on every gyro sample
+            template <typename Filter, FusionEngineType Type>
+            class ComplementaryFusionEngine : public FusionEngine
+            {
+            public:
+                FusionEngineType getType() const override {
+                    return Type;
+                }
+
+                void updateAcc(const sensor_real_t Axyz[3]) override
+                {
+                    std::copy(Axyz, Axyz+3, bAxyz);
+                    accelUpdated = true;
+                }
+
+                void updateMag(const sensor_real_t Mxyz[3]) override
+                {
+                    std::copy(Mxyz, Mxyz+3, bMxyz);
+                    magExist = true;
+                }
+
+                void updateGyro(const sensor_real_t Gxyz[3], sensor_real_t deltat) override
+                {
+                    sensor_real_t Axyz[3] {0.0f, 0.0f, 0.0f};
+                    if (accelUpdated) {
+                        std::copy(bAxyz, bAxyz+3, Axyz);
+                        accelUpdated = false;
+                    }
+
+                    if (!magExist) {
+                        filter.update(qwxyz, Axyz[0], Axyz[1], Axyz[2],
+                                             Gxyz[0], Gxyz[1], Gxyz[2],
+                                             deltat);
+                    } else {
+                        filter.update(qwxyz,  Axyz[0],  Axyz[1],  Axyz[2],
+                                              Gxyz[0],  Gxyz[1],  Gxyz[2],
+                                             bMxyz[0], bMxyz[1], bMxyz[2],
+                                             deltat);
+                    }
+                }
+
+                void getQuaternion(sensor_real_t out[4]) override
+                {
+                    std::copy(qwxyz, qwxyz+4, out);
+                }
+
+            private:
+                Filter filter;
+                sensor_real_t qwxyz[4]{1.0f, 0.0f, 0.0f, 0.0f};
+                sensor_real_t bAxyz[3]{0.0f, 0.0f, 0.0f};
+                // Buffer M here to keep the behavior of BMI160
+                sensor_real_t bMxyz[3]{0.0f, 0.0f, 0.0f};
+                bool accelUpdated = false;
+                bool magExist = false;
+            };
+
+            // Experimental Mahony in Q30 fixed point. The filter runs on integers, but the samples
+            // still arrive calibrated in floats and are converted on every update. It matches the
+            // float Mahony in accuracy, not in speed: on the host it is slower
+            class FixedMahonyFusionEngine : public FusionEngine
+            {
+            public:
+                FusionEngineType getType() const override {
+                    return FusionEngineType::FixedMahony;
+                }
+
+                void updateAcc(const sensor_real_t Axyz[3]) override
+                {
+                    toFixed(Axyz, AccelScale, bAxyz);
+                    accelUpdated = true;
+                }
+
+                void updateMag(const sensor_real_t Mxyz[3]) override
+                {
+                    toFixed(Mxyz, MagScale, bMxyz);
+                    magExist = true;
+                }
+
+                void updateGyro(const sensor_real_t Gxyz[3], sensor_real_t deltat) override
+                {
+                    const sensor_real_t halfDt = deltat * 0.5f;
+                    if (halfDt != lastHalfDt) {
+                        lastHalfDt = halfDt;
+                        kpHalfDt = static_cast<int32_t>(MahonyFixed::Kp * halfDt * MahonyFixed::One);
+                    }
+                    int32_t h[3];
+                    toFixed(Gxyz, halfDt * MahonyFixed::One, h);
+
+                    int32_t Axyz[3] {0, 0, 0};
+                    if (accelUpdated) {
+                        std::copy(bAxyz, bAxyz+3, Axyz);
+                        accelUpdated = false;
+                    }
+
+                    if (!magExist) {
+                        filter.update(q, Axyz[0], Axyz[1], Axyz[2], h[0], h[1], h[2], kpHalfDt);
+                    } else {
+                        filter.update(q,  Axyz[0],  Axyz[1],  Axyz[2], h[0], h[1], h[2],
+                                         bMxyz[0], bMxyz[1], bMxyz[2], kpHalfDt);
+                    }
+                }
+
+                void getQuaternion(sensor_real_t qwxyz[4]) override
+                {
+                    constexpr sensor_real_t scale = 1.0f / MahonyFixed::One;
+                    for (uint8_t i = 0; i < 4; i++) {
+                        qwxyz[i] = q[i] * scale;
+                    }
+                }
+
+            private:
+                // only the direction of accel and mag is used, the scales just have to keep
+                // enough resolution without overflowing for any value the sensors report
+                static constexpr sensor_real_t AccelScale = 65536.0f;
+                static constexpr sensor_real_t MagScale = 256.0f;
+
+                static void toFixed(const sensor_real_t in[3], sensor_real_t scale, int32_t out[3])
+                {
+                    for (uint8_t i = 0; i < 3; i++) {
+                        out[i] = static_cast<int32_t>(in[i] * scale);
+                    }
+                }
+
+                MahonyFixed filter;
+                int32_t q[4]{MahonyFixed::One, 0, 0, 0};
+                int32_t bAxyz[3]{0, 0, 0};
+                int32_t bMxyz[3]{0, 0, 0};
+                sensor_real_t lastHalfDt = 0.0f;
+                int32_t kpHalfDt = 0;
+                bool accelUpdated = false;
+                bool magExist = false;
+            };
+
+            template <typename Filter, FusionEngineType Type>
+            class VQFFusionEngine : public FusionEngine
+            {
+            public:
+                template <typename... Args>
+                explicit VQFFusionEngine(Args&&... args)
+                    : filter(std::forward<Args>(args)...) {}
+
+                FusionEngineType getType() const override {
+                    return Type;
+                }
+
+                void updateAcc(const sensor_real_t Axyz[3]) override
+                {
+                    filter.updateAcc(Axyz);
+                }
+
+                void updateMag(const sensor_real_t Mxyz[3]) override
+                {
+                    filter.updateMag(Mxyz);
+                    magExist = true;
+                }
+
+                void updateGyro(const sensor_real_t Gxyz[3], sensor_real_t deltat) override
+                {
+                    filter.updateGyr(Gxyz, deltat);
+                }
+
+                void getQuaternion(sensor_real_t qwxyz[4]) override
+                {
+                    if (magExist) {
+                        filter.getQuat9D(qwxyz);
+                    } else {
+                        filter.getQuat6D(qwxyz);
+                    }
+                }
+
+                void getGyroBias(sensor_real_t bias[3]) const override
+                {
+                    if constexpr (requires (const Filter &f, sensor_real_t out[3]) { f.getBiasEstimate(out); }) {
+                        filter.getBiasEstimate(bias);
+                    } else {
+                        FusionEngine::getGyroBias(bias);
+                    }
+                }
+
+                bool hasRestDetection() const override {
+                    return requires (const Filter &f) { f.getRestDetected(); };
+                }
+
+                bool getRestDetected() const override {
+                    if constexpr (requires (const Filter &f) { f.getRestDetected(); }) {
+                        return filter.getRestDetected();
+                    } else {
+                        return false;
+                    }
+                }
+
+            private:
+                Filter filter;
+                bool magExist = false;
+            };
+
+            constexpr const char *FusionEngineNames[] = {"mahony", "madgwick", "bvqf", "vqf", "fixedmahony"};
+        }
+
+        const char *getFusionEngineName(FusionEngineType type)
+        {
+            const uint8_t value = static_cast<uint8_t>(type);
+            if (!isValidFusionEngine(value)) {
+                return "unknown";
+            }
+            return FusionEngineNames[value - SENSOR_FUSION_MAHONY];
+        }
+
+        bool parseFusionEngineName(const char *name, FusionEngineType &type)
+        {
+            for (uint8_t i = 0; i < std::size(FusionEngineNames); i++) {
+                if (strcasecmp(name, FusionEngineNames[i]) == 0) {
+                    type = static_cast<FusionEngineType>(SENSOR_FUSION_MAHONY + i);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        bool isValidFusionEngine(uint8_t value)
+        {
+            return value >= SENSOR_FUSION_MAHONY && value <= SENSOR_FUSION_FIXED_MAHONY;
+        }
+
+        std::unique_ptr<FusionEngine> createFusionEngine(FusionEngineType type, sensor_real_t gyrTs, sensor_real_t accTs, sensor_real_t magTs)
+        {
+            switch (type) {
+            case FusionEngineType::Mahony:
+                return std::make_unique<ComplementaryFusionEngine<Mahony<sensor_real_t>, FusionEngineType::Mahony>>();
+            case FusionEngineType::Madgwick:
+                return std::make_unique<ComplementaryFusionEngine<Madgwick<sensor_real_t>, FusionEngineType::Madgwick>>();
+            case FusionEngineType::FixedMahony:
+                return std::make_unique<FixedMahonyFusionEngine>();
+            case FusionEngineType::BasicVQF:
+                return std::make_unique<VQFFusionEngine<BasicVQF, FusionEngineType::BasicVQF>>(gyrTs, accTs, magTs);
+            case FusionEngineType::VQF:
+            default:
+                return std::make_unique<VQFFusionEngine<VQF, FusionEngineType::VQF>>(SensorVQFParams{}, gyrTs, accTs, magTs);
+            }
+        }
+    }
+}
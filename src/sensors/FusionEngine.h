@@ -0,0 +1,88 @@
+/*
+    SlimeVR Code is placed under the MIT license
+    Copyright (c) 2024 SlimeVR Contributors
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+
+#ifndef SLIMEVR_FUSIONENGINE_H_
+#define SLIMEVR_FUSIONENGINE_H_
+
+#include <cstdint>
+#include <memory>
+
+#include "../motionprocessing/types.h"
+
+#define SENSOR_FUSION_MAHONY 1
+#define SENSOR_FUSION_MADGWICK 2
+#define SENSOR_FUSION_BASICVQF 3
+#define SENSOR_FUSION_VQF 4
+// Experimental: Mahony in fixed point. It gets the same float samples as the other engines and
+// has not been benchmarked on an MCU, so it is not known to be faster than Mahony anywhere
+#define SENSOR_FUSION_FIXED_MAHONY 5
+
+namespace SlimeVR
+{
+    namespace Sensors
+    {
+        // Values are stored in the configuration, do not renumber
+        enum class FusionEngineType : uint8_t {
+            Mahony = SENSOR_FUSION_MAHONY,
+            Madgwick = SENSOR_FUSION_MADGWICK,
+            BasicVQF = SENSOR_FUSION_BASICVQF,
+            VQF = SENSOR_FUSION_VQF,
+            FixedMahony = SENSOR_FUSION_FIXED_MAHONY,
+        };
+
+        const char *getFusionEngineName(FusionEngineType type);
+        // Accepts the names returned by getFusionEngineName(), case insensitive
+        bool parseFusionEngineName(const char *name, FusionEngineType &type);
+        bool isValidFusionEngine(uint8_t value);
+
+        // Orientation filter behind SensorFusion. Magnetometer data is only passed once the sensor
+        // reported a non-zero field, getQuaternion() includes it from then on
+        class FusionEngine
+        {
+        public:
+            virtual ~FusionEngine() = default;
+
+            virtual FusionEngineType getType() const = 0;
+            virtual void updateAcc(const sensor_real_t Axyz[3]) = 0;
+            virtual void updateMag(const sensor_real_t Mxyz[3]) = 0;
+            virtual void updateGyro(const sensor_real_t Gxyz[3], sensor_real_t deltat) = 0;
+            virtual void getQuaternion(sensor_real_t qwxyz[4]) = 0;
+            // Gyro bias the engine removes on top of the calibration, in rad/s
+            virtual void getGyroBias(sensor_real_t bias[3]) const {
+                bias[0] = bias[1] = bias[2] = 0.0f;
+            }
+
+            // Engines without their own rest detection get it from SensorFusionRestDetect
+            virtual bool hasRestDetection() const {
+                return false;
+            }
+            virtual bool getRestDetected() const {
+                return false;
+            }
+        };
+
+        std::unique_ptr<FusionEngine> createFusionEngine(FusionEngineType type, sensor_real_t gyrTs, sensor_real_t accTs, sensor_real_t magTs);
+    }
+}
+
+#endif // SLIMEVR_FUSIONENGINE_H_
@@ -0,0 +1,67 @@
+/*
+    SlimeVR Code is placed under the MIT license
+    Copyright (c) 2024 SlimeVR Contributors
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+
+#ifndef SLIMEVR_RAWSAMPLEBATCH_H_
+#define SLIMEVR_RAWSAMPLEBATCH_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "../motionprocessing/types.h"
+
+namespace SlimeVR
+{
+    namespace Sensors
+    {
+        // Consecutive raw samples of one kind as they came out of the FIFO, one array per axis,
+        // so calibration runs over the whole batch in one loop before it goes into fusion
+        struct RawSampleBatch
+        {
+            static constexpr size_t Capacity = 32;
+
+            int16_t x[Capacity];
+            int16_t y[Capacity];
+            int16_t z[Capacity];
+            // samples of the other kind the FIFO delivered before this one in the same burst,
+            // fusion merges the gyro and accel batches back into FIFO order with it
+            uint8_t otherBefore[Capacity];
+            sensor_real_t dt[Capacity]; // per sample time step, filled in right before fusion
+            bool atRest[Capacity]; // rest state the gyro sample was fused with, filled in by fusion
+            size_t count = 0;
+
+            bool empty() const { return count == 0; }
+            bool full() const { return count == Capacity; }
+            void clear() { count = 0; }
+            void push(const int16_t xyz[3], size_t otherCount = 0)
+            {
+                x[count] = xyz[0];
+                y[count] = xyz[1];
+                z[count] = xyz[2];
+                otherBefore[count] = static_cast<uint8_t>(otherCount);
+                count++;
+            }
+        };
+    }
+}
+
+#endif // SLIMEVR_RAWSAMPLEBATCH_H_
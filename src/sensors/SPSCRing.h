@@ -0,0 +1,84 @@
+/*
+    SlimeVR Code is placed under the MIT license
+    Copyright (c) 2024 SlimeVR Contributors
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+
+#ifndef SLIMEVR_SPSCRING_H_
+#define SLIMEVR_SPSCRING_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+namespace SlimeVR
+{
+    namespace Sensors
+    {
+        // Lock-free ring for exactly one producer and one consumer thread.
+        // Head and tail only ever grow and are masked on access, so a full ring
+        // needs no extra flag; Capacity has to be a power of two for that.
+        template <typename T, size_t Capacity>
+        class SPSCRing
+        {
+            static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "SPSCRing capacity must be a power of two");
+
+        public:
+            // producer side, returns false and drops the item if the ring is full
+            bool push(const T &item)
+            {
+                const size_t head = m_Head.load(std::memory_order_relaxed);
+                if (head - m_Tail.load(std::memory_order_acquire) == Capacity) {
+                    return false;
+                }
+                m_Items[head & Mask] = item;
+                m_Head.store(head + 1, std::memory_order_release);
+                return true;
+            }
+
+            // consumer side
+            bool pop(T &item)
+            {
+                const size_t tail = m_Tail.load(std::memory_order_relaxed);
+                if (tail == m_Head.load(std::memory_order_acquire)) {
+                    return false;
+                }
+                item = m_Items[tail & Mask];
+                m_Tail.store(tail + 1, std::memory_order_release);
+                return true;
+            }
+
+            // only a snapshot, the other side may change it right after
+            size_t size() const
+            {
+                return m_Head.load(std::memory_order_acquire) - m_Tail.load(std::memory_order_acquire);
+            }
+
+        private:
+            static constexpr size_t Mask = Capacity - 1;
+
+            std::array<T, Capacity> m_Items{};
+            std::atomic<size_t> m_Head{0};
+            std::atomic<size_t> m_Tail{0};
+        };
+    }
+}
+
+#endif // SLIMEVR_SPSCRING_H_
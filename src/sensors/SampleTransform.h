@@ -0,0 +1,117 @@
+/*
+    SlimeVR Code is placed under the MIT license
+    Copyright (c) 2024 SlimeVR Contributors
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+
+#ifndef SLIMEVR_SAMPLETRANSFORM_H_
+#define SLIMEVR_SAMPLETRANSFORM_H_
+
+#include <cstdint>
+
+#include "../motionprocessing/types.h"
+#include "axisremap.h"
+
+namespace SlimeVR
+{
+    namespace Sensors
+    {
+        // Affine map from raw sensor counts to calibrated units in the sensor frame, out = m * raw + t.
+        // Offsets, calibration matrices, unit scale and axis remap are composed into it whenever one
+        // of them changes, so each sample costs a single 3x4 multiply however many stages there are.
+        // The mounting rotation stays a quaternion on the fused output: rotating the samples instead
+        // would change the frame the fusion filters settle their heading in.
+        struct SampleTransform
+        {
+            sensor_real_t m[3][3] = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+            sensor_real_t t[3] = {0, 0, 0};
+
+            // out = scale * (raw - offset), per axis
+            template <typename Offset, typename Scale>
+            static SampleTransform offsetScale(const Offset offset[3], const Scale scale[3])
+            {
+                SampleTransform result;
+                for (uint8_t i = 0; i < 3; i++) {
+                    result.m[i][i] = static_cast<sensor_real_t>(scale[i]);
+                    result.t[i] = static_cast<sensor_real_t>(-static_cast<double>(scale[i]) * offset[i]);
+                }
+                return result;
+            }
+
+            // out = scale * matrix * (raw - bias)
+            template <typename Bias, typename Matrix>
+            static SampleTransform biasMatrixScale(const Bias bias[3], const Matrix matrix[3][3], double scale)
+            {
+                SampleTransform result;
+                for (uint8_t i = 0; i < 3; i++) {
+                    double offset = 0;
+                    for (uint8_t j = 0; j < 3; j++) {
+                        const double element = matrix[i][j] * scale;
+                        result.m[i][j] = static_cast<sensor_real_t>(element);
+                        offset -= element * bias[j];
+                    }
+                    result.t[i] = static_cast<sensor_real_t>(offset);
+                }
+                return result;
+            }
+
+            // axis selection as built by AXIS_REMAP_BUILD, for one of the sensors (9 bits)
+            static SampleTransform remap(int axisdesc)
+            {
+                SampleTransform result;
+                const int axes[3] = {AXIS_REMAP_GET_X(axisdesc), AXIS_REMAP_GET_Y(axisdesc), AXIS_REMAP_GET_Z(axisdesc)};
+                for (uint8_t i = 0; i < 3; i++) {
+                    result.m[i][0] = remapOneAxis<sensor_real_t>(axes[i], 1, 0, 0);
+                    result.m[i][1] = remapOneAxis<sensor_real_t>(axes[i], 0, 1, 0);
+                    result.m[i][2] = remapOneAxis<sensor_real_t>(axes[i], 0, 0, 1);
+                }
+                return result;
+            }
+
+            // this transform followed by next
+            SampleTransform then(const SampleTransform &next) const
+            {
+                SampleTransform result;
+                for (uint8_t i = 0; i < 3; i++) {
+                    for (uint8_t j = 0; j < 3; j++) {
+                        result.m[i][j] = next.m[i][0] * m[0][j] + next.m[i][1] * m[1][j] + next.m[i][2] * m[2][j];
+                    }
+                    result.t[i] = next.m[i][0] * t[0] + next.m[i][1] * t[1] + next.m[i][2] * t[2] + next.t[i];
+                }
+                return result;
+            }
+
+            void apply(sensor_real_t x, sensor_real_t y, sensor_real_t z, sensor_real_t out[3]) const
+            {
+                out[0] = m[0][0] * x + m[0][1] * y + m[0][2] * z + t[0];
+                out[1] = m[1][0] * x + m[1][1] * y + m[1][2] * z + t[1];
+                out[2] = m[2][0] * x + m[2][1] * y + m[2][2] * z + t[2];
+            }
+
+            void apply(const int16_t raw[3], sensor_real_t out[3]) const
+            {
+                apply(static_cast<sensor_real_t>(raw[0]), static_cast<sensor_real_t>(raw[1]),
+                      static_cast<sensor_real_t>(raw[2]), out);
+            }
+        };
+    }
+}
+
+#endif // SLIMEVR_SAMPLETRANSFORM_H_
@@ -0,0 +1,126 @@
+/*
+    SlimeVR Code is placed under the MIT license
+    Copyright (c) 2024 SlimeVR Contributors
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+
+#ifndef SLIMEVR_SENDRATESCHEDULER_H_
+#define SLIMEVR_SENDRATESCHEDULER_H_
+
+#include <algorithm>
+#include <cstdint>
+
+#include "debug.h"
+
+namespace SlimeVR
+{
+    namespace Sensors
+    {
+        // Picks how often a fusion sensor sends its rotation. At rest it only keeps the server
+        // updated at SEND_RATE_REST_HZ, in motion the rate goes from SEND_RATE_MOVING_HZ up to
+        // SEND_RATE_MAX_HZ at SEND_RATE_FAST_MOTION_DPS, but never above the gyro rate as faster
+        // sends would only repeat rotations. The angular speed is held for a moment so the rate
+        // doesn't drop between two swings of a limb.
+        class SendRateScheduler
+        {
+        public:
+            static constexpr uint32_t SpeedHoldMicros = 200000;
+            static constexpr uint32_t StatsWindowMicros = 1000000;
+
+            explicit SendRateScheduler(float gyroRateHz)
+                : maxRateHz(std::min(static_cast<float>(SEND_RATE_MAX_HZ), gyroRateHz))
+                , movingRateHz(std::min(static_cast<float>(SEND_RATE_MOVING_HZ), maxRateHz))
+            {
+                setRate(movingRateHz);
+            }
+
+            // angularSpeed in rad/s, true when a rotation is due now
+            bool shouldSend(uint32_t now, float angularSpeed, bool restDetected)
+            {
+                #if SEND_RATE_ADAPTIVE
+                    updateRate(now, angularSpeed, restDetected);
+                #endif
+
+                if (now - statsStart >= StatsWindowMicros) {
+                    averageRateHz = sentInWindow * 1e6f / (now - statsStart);
+                    sentInWindow = 0;
+                    statsStart = now;
+                }
+
+                const uint32_t elapsed = now - lastSent;
+                if (elapsed < intervalMicros) {
+                    return false;
+                }
+                // keep the cadence, unless the rate just went up and we are far behind it
+                lastSent = elapsed < 2 * intervalMicros ? lastSent + intervalMicros : now;
+                sentInWindow++;
+                return true;
+            }
+
+            float getRateHz() const { return rateHz; }
+            float getAverageRateHz() const { return averageRateHz; }
+            float getMaxRateHz() const { return maxRateHz; }
+            float getMovingRateHz() const { return movingRateHz; }
+            static constexpr float getRestRateHz() { return SEND_RATE_REST_HZ; }
+
+        private:
+            void updateRate(uint32_t now, float angularSpeed, bool restDetected)
+            {
+                if (angularSpeed >= heldSpeed || now - heldSince >= SpeedHoldMicros) {
+                    heldSpeed = angularSpeed;
+                    heldSince = now;
+                }
+
+                float target;
+                if (restDetected) {
+                    target = SEND_RATE_REST_HZ;
+                } else {
+                    constexpr float fastMotion = SEND_RATE_FAST_MOTION_DPS * (3.14159265f / 180.0f);
+                    const float motion = std::min(heldSpeed / fastMotion, 1.0f);
+                    target = movingRateHz + (maxRateHz - movingRateHz) * motion;
+                }
+                if (target != rateHz) {
+                    setRate(target);
+                }
+            }
+
+            void setRate(float hz)
+            {
+                rateHz = hz;
+                intervalMicros = static_cast<uint32_t>(1e6f / hz);
+            }
+
+            const float maxRateHz;
+            const float movingRateHz;
+            float rateHz = 0;
+            uint32_t intervalMicros = 0;
+            uint32_t lastSent = 0;
+
+            float heldSpeed = 0;
+            uint32_t heldSince = 0;
+
+            uint32_t statsStart = 0;
+            uint32_t sentInWindow = 0;
+            float averageRateHz = 0;
+        };
+    }
+}
+
+#endif // SLIMEVR_SENDRATESCHEDULER_H_
@@ -18,17 +18,65 @@ namespace SlimeVR
             updateGyro(Gxyz, deltat);
         }
 
+        void SensorFusion::setEngine(FusionEngineType engineType)
+        {
+            engine = createFusionEngine(engineType, engineGyrTs(), accTs, magTs);
+            gyroPreintegrator.reset();
+            // the new engine only gets the magnetometer from its next non-zero sample on
+            magExist = false;
+            engineCycles = 0;
+            engineUpdates = 0;
+            qwxyz[0] = 1.0f;
+            qwxyz[1] = qwxyz[2] = qwxyz[3] = 0.0f;
+            updated = false;
+            gravityReady = false;
+            linaccelReady = false;
+        }
+
+        FusionEngineType SensorFusion::getEngineType() const
+        {
+            return engine->getType();
+        }
+
+        uint8_t SensorFusion::getGyroPreintegration() const
+        {
+            return gyroPreintegrator.getSamples();
+        }
+
+        sensor_real_t SensorFusion::getAngularSpeed() const
+        {
+            return sqrt(lastGxyz[0] * lastGxyz[0] + lastGxyz[1] * lastGxyz[1] + lastGxyz[2] * lastGxyz[2]);
+        }
+
+        float SensorFusion::getMicrosPerUpdate() const
+        {
+            if (engineUpdates == 0) {
+                return 0.0f;
+            }
+            return static_cast<float>(engineCycles) / engineUpdates / ESP.getCpuFreqMHz();
+        }
+
+        void SensorFusion::addEngineCycles(uint32_t cycles, uint32_t gyroUpdates)
+        {
+            engineCycles += cycles;
+            engineUpdates += gyroUpdates;
+            if (engineUpdates >= EngineStatsWindow) {
+                engineCycles /= 2;
+                engineUpdates /= 2;
+            }
+        }
+
         void SensorFusion::updateAcc(const sensor_real_t Axyz[3], sensor_real_t deltat)
         {
             if (deltat < 0) deltat = accTs;
 
             std::copy(Axyz, Axyz+3, bAxyz);
-            #if SENSOR_USE_MAHONY || SENSOR_USE_MADGWICK
-                accelUpdated = true;
-            #elif SENSOR_USE_BASICVQF
-                basicvqf.updateAcc(Axyz);
-            #elif SENSOR_USE_VQF
-                vqf.updateAcc(Axyz);
+            #if SFUSION_DEBUG
+                const uint32_t cyclesStart = ESP.getCycleCount();
+            #endif
+            engine->updateAcc(Axyz);
+            #if SFUSION_DEBUG
+                addEngineCycles(ESP.getCycleCount() - cyclesStart, 0);
             #endif
         }
 
@@ -44,12 +92,12 @@ namespace SlimeVR
                 }
             }
 
-            #if SENSOR_USE_MAHONY || SENSOR_USE_MADGWICK
-                std::copy(Mxyz, Mxyz+3, bMxyz);
-            #elif SENSOR_USE_BASICVQF
-                basicvqf.updateMag(Mxyz);
-            #elif SENSOR_USE_VQF
-                vqf.updateMag(Mxyz);
+            #if SFUSION_DEBUG
+                const uint32_t cyclesStart = ESP.getCycleCount();
+            #endif
+            engine->updateMag(Mxyz);
+            #if SFUSION_DEBUG
+                addEngineCycles(ESP.getCycleCount() - cyclesStart, 0);
             #endif
         }
 
@@ -57,40 +105,28 @@ namespace SlimeVR
         {
             if (deltat < 0) deltat = gyrTs;
 
-            #if SENSOR_USE_MAHONY || SENSOR_USE_MADGWICK
-                sensor_real_t Axyz[3] {0.0f, 0.0f, 0.0f};
-                if (accelUpdated) {
-                    std::copy(bAxyz, bAxyz+3, Axyz);
-                    accelUpdated = false;
-                }
+            std::copy(Gxyz, Gxyz+3, lastGxyz);
+            #if SFUSION_DEBUG
+                const uint32_t cyclesStart = ESP.getCycleCount();
             #endif
-
-            #if SENSOR_USE_MAHONY
-                if (!magExist) {
-                    mahony.update(qwxyz, Axyz[0], Axyz[1], Axyz[2],
-                                         Gxyz[0], Gxyz[1], Gxyz[2],
-                                         deltat);
-                } else {
-                    mahony.update(qwxyz,  Axyz[0],  Axyz[1],  Axyz[2],
-                                          Gxyz[0],  Gxyz[1],  Gxyz[2],
-                                         bMxyz[0], bMxyz[1], bMxyz[2],
-                                         deltat);
-                }
-            #elif SENSOR_USE_MADGWICK
-                if (!magExist) {
-                    madgwick.update(qwxyz, Axyz[0], Axyz[1], Axyz[2],
-                                           Gxyz[0], Gxyz[1], Gxyz[2],
-                                           deltat);
-                } else {
-                    madgwick.update(qwxyz,  Axyz[0],  Axyz[1],  Axyz[2],
-                                            Gxyz[0],  Gxyz[1],  Gxyz[2],
-                                           bMxyz[0], bMxyz[1], bMxyz[2],
-                                           deltat);
+            if (gyroPreintegrator.getSamples() > 1) {
+                if (!gyroPreintegrator.add(Gxyz, deltat)) {
+                    #if SFUSION_DEBUG
+                        addEngineCycles(ESP.getCycleCount() - cyclesStart, 1);
+                    #endif
+                    return;
                 }
-            #elif SENSOR_USE_BASICVQF
-                basicvqf.updateGyr(Gxyz, deltat);
-            #elif SENSOR_USE_VQF
-                vqf.updateGyr(Gxyz, deltat);
+                // accel samples in between went into the engine before this rotation, at most
+                // gyroPreintegration - 1 gyro samples early, which its slow accel filter doesn't notice
+                sensor_real_t integratedGxyz[3];
+                sensor_real_t integratedDeltat;
+                gyroPreintegrator.takeUpdate(integratedGxyz, integratedDeltat);
+                engine->updateGyro(integratedGxyz, integratedDeltat);
+            } else {
+                engine->updateGyro(Gxyz, deltat);
+            }
+            #if SFUSION_DEBUG
+                addEngineCycles(ESP.getCycleCount() - cyclesStart, 1);
             #endif
 
             updated = true;
@@ -98,6 +134,33 @@ namespace SlimeVR
             linaccelReady = false;
         }
 
+        void SensorFusion::updateBatches(RawSampleBatch &gyro, const SampleTransform &gyroTransform,
+                                         const RawSampleBatch &accel, const SampleTransform &accelTransform, sensor_real_t accelDeltat)
+        {
+            sensor_real_t Gxyz[RawSampleBatch::Capacity][3];
+            sensor_real_t Axyz[RawSampleBatch::Capacity][3];
+            transformBatch(gyro, gyroTransform, Gxyz);
+            transformBatch(accel, accelTransform, Axyz);
+            size_t a = 0;
+            for (size_t g = 0; g < gyro.count; g++) {
+                for (; a < accel.count && accel.otherBefore[a] <= g; a++) {
+                    updateAcc(Axyz[a], accelDeltat);
+                }
+                updateGyro(Gxyz[g], gyro.dt[g]);
+            }
+            for (; a < accel.count; a++) {
+                updateAcc(Axyz[a], accelDeltat);
+            }
+        }
+
+        void SensorFusion::transformBatch(const RawSampleBatch &batch, const SampleTransform &transform, sensor_real_t out[][3])
+        {
+            for (size_t i = 0; i < batch.count; i++) {
+                transform.apply(static_cast<sensor_real_t>(batch.x[i]), static_cast<sensor_real_t>(batch.y[i]),
+                                static_cast<sensor_real_t>(batch.z[i]), out[i]);
+            }
+        }
+
         bool SensorFusion::isUpdated()
         {
             return updated;
@@ -110,19 +173,7 @@ namespace SlimeVR
         
         sensor_real_t const * SensorFusion::getQuaternion()
         {
-            #if SENSOR_USE_BASICVQF
-                if(magExist) {
-                    basicvqf.getQuat9D(qwxyz);
-                } else {
-                    basicvqf.getQuat6D(qwxyz);
-                }
-            #elif SENSOR_USE_VQF
-                if(magExist) {
-                    vqf.getQuat9D(qwxyz);
-                } else {
-                    vqf.getQuat6D(qwxyz);
-                }
-            #endif
+            engine->getQuaternion(qwxyz);
 
             return qwxyz;
         }
@@ -133,6 +184,35 @@ namespace SlimeVR
             return Quat(qwxyz[1], qwxyz[2], qwxyz[3], qwxyz[0]);
         }
 
+        Quat SensorFusion::getPredictedQuaternionQuat(sensor_real_t seconds)
+        {
+            getQuaternion();
+
+            sensor_real_t bias[3];
+            engine->getGyroBias(bias);
+            sensor_real_t rotation[3];
+            sensor_real_t pendingTime;
+            gyroPreintegrator.getPending(rotation, pendingTime);
+            for (uint8_t i = 0; i < 3; i++) {
+                rotation[i] += (lastGxyz[i] - bias[i]) * seconds - bias[i] * pendingTime;
+            }
+
+            // q * exp(rotation / 2), the rates are in the sensor frame
+            const sensor_real_t angle = sqrt(rotation[0]*rotation[0] + rotation[1]*rotation[1] + rotation[2]*rotation[2]);
+            const sensor_real_t w = cos(angle * 0.5f);
+            const sensor_real_t k = angle > 1e-6f ? sin(angle * 0.5f) / angle : 0.5f;
+            const sensor_real_t x = rotation[0] * k;
+            const sensor_real_t y = rotation[1] * k;
+            const sensor_real_t z = rotation[2] * k;
+            const sensor_real_t *q = qwxyz;
+            return Quat(
+                q[0] * x + q[1] * w + q[2] * z - q[3] * y,
+                q[0] * y - q[1] * z + q[2] * w + q[3] * x,
+                q[0] * z + q[1] * y - q[2] * x + q[3] * w,
+                q[0] * w - q[1] * x - q[2] * y - q[3] * z
+            );
+        }
+
         sensor_real_t const * SensorFusion::getGravityVec()
         {
             if (!gravityReady) {
@@ -3,85 +3,64 @@
 
 #include "globals.h"
 #include "sensor.h"
+#include "RawSampleBatch.h"
+#include "SampleTransform.h"
 
 #define SENSOR_DOUBLE_PRECISION 0
 
+// Engine new sensors start with, SET FUSION picks another one per sensor at runtime
 #define SENSOR_FUSION_TYPE SENSOR_FUSION_VQF
 
-#define SENSOR_FUSION_MAHONY 1
-#define SENSOR_FUSION_MADGWICK 2
-#define SENSOR_FUSION_BASICVQF 3
-#define SENSOR_FUSION_VQF 4
-
-#if SENSOR_FUSION_TYPE == SENSOR_FUSION_MAHONY
-    #define SENSOR_FUSION_TYPE_STRING "mahony"
-#elif SENSOR_FUSION_TYPE == SENSOR_FUSION_MADGWICK
-    #define SENSOR_FUSION_TYPE_STRING "madgwick"
-#elif SENSOR_FUSION_TYPE == SENSOR_FUSION_BASICVQF
-    #define SENSOR_FUSION_TYPE_STRING "bvqf"
-#elif SENSOR_FUSION_TYPE == SENSOR_FUSION_VQF
-    #define SENSOR_FUSION_TYPE_STRING "vqf"
-#endif
-
-#define SENSOR_USE_MAHONY (SENSOR_FUSION_TYPE == SENSOR_FUSION_MAHONY)
-#define SENSOR_USE_MADGWICK (SENSOR_FUSION_TYPE == SENSOR_FUSION_MADGWICK)
-#define SENSOR_USE_BASICVQF (SENSOR_FUSION_TYPE == SENSOR_FUSION_BASICVQF)
-#define SENSOR_USE_VQF (SENSOR_FUSION_TYPE == SENSOR_FUSION_VQF)
-
-
+#include "FusionEngine.h"
 #include "../motionprocessing/types.h"
-
-#include "mahony.h"
-#include "madgwick.h"
-#include <vqf.h>
-#include <basicvqf.h>
+#include "../motionprocessing/GyroPreintegrator.h"
 
 namespace SlimeVR
 {
     namespace Sensors
     {
-        #if SENSOR_USE_VQF
-        struct SensorVQFParams: VQFParams {
-            SensorVQFParams() : VQFParams() {
-                #ifndef VQF_NO_MOTION_BIAS_ESTIMATION
-                motionBiasEstEnabled = true;
-                #endif
-                tauAcc = 2.0f;
-                restMinT = 2.0f;
-                restThGyr = 0.6f; // 400 norm
-                restThAcc = 0.06f; // 100 norm
-            }
-        };
-        #endif
+        constexpr FusionEngineType DefaultFusionEngine = static_cast<FusionEngineType>(SENSOR_FUSION_TYPE);
 
         class SensorFusion
         {
         public:
-            SensorFusion(sensor_real_t gyrTs, sensor_real_t accTs=-1.0, sensor_real_t magTs=-1.0)
+            // gyroPreintegration: gyro samples integrated into one engine update, 1 updates on every sample
+            SensorFusion(sensor_real_t gyrTs, sensor_real_t accTs=-1.0, sensor_real_t magTs=-1.0,
+                         FusionEngineType engineType=DefaultFusionEngine, uint8_t gyroPreintegration=1)
                 : gyrTs(gyrTs), 
                   accTs( (accTs<0) ? gyrTs : accTs ), 
-                  magTs( (magTs<0) ? gyrTs : magTs )
-            #if SENSOR_USE_MAHONY
-            #elif SENSOR_USE_MADGWICK
-            #elif SENSOR_USE_BASICVQF
-                , basicvqf(gyrTs, ((accTs<0) ? gyrTs : accTs),
-                                    ((magTs<0) ? gyrTs : magTs))
-            #elif SENSOR_USE_VQF
-                , vqf(vqfParams, gyrTs, ((accTs<0) ? gyrTs : accTs), 
-                                        ((magTs<0) ? gyrTs : magTs))
-            #endif
+                  magTs( (magTs<0) ? gyrTs : magTs ),
+                  gyroPreintegrator(gyroPreintegration),
+                  engine(createFusionEngine(engineType, engineGyrTs(), this->accTs, this->magTs))
             {}
 
+            // Replaces the engine with a fresh one, orientation restarts from its initial estimate
+            void setEngine(FusionEngineType engineType);
+            FusionEngineType getEngineType() const;
+            uint8_t getGyroPreintegration() const;
+            // Average engine time per gyro sample, including the accel and mag updates in between,
+            // only measured with SFUSION_DEBUG, 0 otherwise
+            float getMicrosPerUpdate() const;
+            // Magnitude of the last calibrated gyro sample, in rad/s
+            sensor_real_t getAngularSpeed() const;
+
             void update6D(sensor_real_t Axyz[3], sensor_real_t Gxyz[3], sensor_real_t deltat=-1.0f);
             void update9D(sensor_real_t Axyz[3], sensor_real_t Gxyz[3], sensor_real_t Mxyz[3], sensor_real_t deltat=-1.0f);
             void updateAcc(const sensor_real_t Axyz[3], sensor_real_t deltat=-1.0f);
             void updateMag(const sensor_real_t Mxyz[3], sensor_real_t deltat=-1.0f);
             void updateGyro(const sensor_real_t Gxyz[3], sensor_real_t deltat=-1.0f);
+            // transform the gyro and accel batches of one FIFO burst and feed them to fusion in FIFO order,
+            // accel sample i goes in after accel.otherBefore[i] gyro samples, gyro uses gyro.dt
+            void updateBatches(RawSampleBatch &gyro, const SampleTransform &gyroTransform,
+                               const RawSampleBatch &accel, const SampleTransform &accelTransform, sensor_real_t accelDeltat);
 
             bool isUpdated();
             void clearUpdated();
             sensor_real_t const * getQuaternion();
             Quat getQuaternionQuat();
+            // Orientation extrapolated by `seconds` past the last gyro sample with its bias corrected rate,
+            // gyro samples still waiting for pre-integration are applied as well
+            Quat getPredictedQuaternionQuat(sensor_real_t seconds);
             sensor_real_t const * getGravityVec();
             sensor_real_t const * getLinearAcc();
             void getLinearAcc(sensor_real_t outLinAccel[3]);
@@ -89,32 +68,32 @@ namespace SlimeVR
 
             static void calcGravityVec(const sensor_real_t qwxyz[4], sensor_real_t gravVec[3]);
             static void calcLinearAcc(const sensor_real_t accin[3], const sensor_real_t gravVec[3], sensor_real_t accout[3]);
+            static void transformBatch(const RawSampleBatch &batch, const SampleTransform &transform, sensor_real_t out[][3]);
 
         protected:
             sensor_real_t gyrTs;
             sensor_real_t accTs;
             sensor_real_t magTs;
 
-            #if SENSOR_USE_MAHONY
-                Mahony<sensor_real_t> mahony;
-            #elif SENSOR_USE_MADGWICK
-                Madgwick<sensor_real_t> madgwick;
-            #elif SENSOR_USE_BASICVQF
-                BasicVQF basicvqf;
-            #elif SENSOR_USE_VQF
-                SensorVQFParams vqfParams {};
-                VQF vqf;
-            #endif
+            void addEngineCycles(uint32_t cycles, uint32_t gyroUpdates);
+            // the engine filters run at the rate it gets gyro updates
+            sensor_real_t engineGyrTs() const {
+                return gyrTs * gyroPreintegrator.getSamples();
+            }
+
+            GyroPreintegrator gyroPreintegrator;
+
+            std::unique_ptr<FusionEngine> engine;
+            // halved every EngineStatsWindow gyro updates, so the average follows the current load
+            static constexpr uint32_t EngineStatsWindow = 4096;
+            uint32_t engineCycles = 0;
+            uint32_t engineUpdates = 0;
+
+            sensor_real_t lastGxyz[3]{0.0f, 0.0f, 0.0f};
 
             // A also used for linear acceleration extraction
             sensor_real_t bAxyz[3]{0.0f, 0.0f, 0.0f};
 
-            #if SENSOR_USE_MAHONY || SENSOR_USE_MADGWICK
-                // Buffer M here to keep the behavior of BMI160
-                sensor_real_t bMxyz[3]{0.0f, 0.0f, 0.0f};
-                bool accelUpdated = false;
-            #endif
-
             bool magExist = false;
             sensor_real_t qwxyz[4]{1.0f, 0.0f, 0.0f, 0.0f};
             bool updated = false;
@@ -4,29 +4,51 @@ namespace SlimeVR
 {
     namespace Sensors
     {
-        #if !SENSOR_FUSION_WITH_RESTDETECT
         void SensorFusionRestDetect::updateAcc(const sensor_real_t Axyz[3], sensor_real_t deltat)
         {
             if (deltat < 0) deltat = accTs;
-            restDetection.updateAcc(deltat, Axyz);
+            if (!engine->hasRestDetection()) {
+                restDetection.updateAcc(deltat, Axyz);
+            }
             SensorFusion::updateAcc(Axyz, deltat);
         }
 
         void SensorFusionRestDetect::updateGyro(const sensor_real_t Gxyz[3], sensor_real_t deltat)
         {
             if (deltat < 0) deltat = gyrTs;
-            restDetection.updateGyr(Gxyz);
+            if (!engine->hasRestDetection()) {
+                restDetection.updateGyr(Gxyz);
+            }
             SensorFusion::updateGyro(Gxyz, deltat);
         }
-        #endif
+
+        void SensorFusionRestDetect::updateBatches(RawSampleBatch &gyro, const SampleTransform &gyroTransform,
+                                                   const RawSampleBatch &accel, const SampleTransform &accelTransform, sensor_real_t accelDeltat)
+        {
+            sensor_real_t Gxyz[RawSampleBatch::Capacity][3];
+            sensor_real_t Axyz[RawSampleBatch::Capacity][3];
+            transformBatch(gyro, gyroTransform, Gxyz);
+            transformBatch(accel, accelTransform, Axyz);
+            size_t a = 0;
+            for (size_t g = 0; g < gyro.count; g++) {
+                for (; a < accel.count && accel.otherBefore[a] <= g; a++) {
+                    updateAcc(Axyz[a], accelDeltat);
+                }
+                // rest state up to the previous sample, as the calibrations fed from the FIFO callbacks saw it
+                gyro.atRest[g] = getRestDetected();
+                updateGyro(Gxyz[g], gyro.dt[g]);
+            }
+            for (; a < accel.count; a++) {
+                updateAcc(Axyz[a], accelDeltat);
+            }
+        }
 
         bool SensorFusionRestDetect::getRestDetected()
         {
-            #if !SENSOR_FUSION_WITH_RESTDETECT
-                return restDetection.getRestDetected();
-            #elif SENSOR_USE_VQF
-                return vqf.getRestDetected();
-            #endif
+            if (engine->hasRestDetection()) {
+                return engine->getRestDetected();
+            }
+            return restDetection.getRestDetected();
         }
     }
 }
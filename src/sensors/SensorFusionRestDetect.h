@@ -5,17 +5,10 @@
 
 #include "../motionprocessing/RestDetection.h"
 
-#if SENSOR_USE_VQF
-    #define SENSOR_FUSION_WITH_RESTDETECT 1
-#else
-    #define SENSOR_FUSION_WITH_RESTDETECT 0
-#endif
-
 namespace SlimeVR
 {
     namespace Sensors
     {
-        #if !SENSOR_FUSION_WITH_RESTDETECT
         struct SensorRestDetectionParams: RestDetectionParams {
             SensorRestDetectionParams() : RestDetectionParams() {
                 restMinTime = 2.0f;
@@ -23,31 +16,29 @@ namespace SlimeVR
                 restThAcc = 0.06f; // 100 norm
             }
         };
-        #endif
 
+        // Rest detection from the fusion engine when it has one, from a separate RestDetection otherwise
         class SensorFusionRestDetect : public SensorFusion
         {
         public:
-            SensorFusionRestDetect(float gyrTs, float accTs=-1.0, float magTs=-1.0)
-                : SensorFusion(gyrTs, accTs, magTs)
-            #if !SENSOR_FUSION_WITH_RESTDETECT
+            SensorFusionRestDetect(float gyrTs, float accTs=-1.0, float magTs=-1.0,
+                                   FusionEngineType engineType=DefaultFusionEngine, uint8_t gyroPreintegration=1)
+                : SensorFusion(gyrTs, accTs, magTs, engineType, gyroPreintegration)
                 , restDetection(restDetectionParams, gyrTs,
                                 (accTs<0) ? gyrTs : accTs)
-            #endif
             {}
 
             bool getRestDetected();
 
-            #if !SENSOR_FUSION_WITH_RESTDETECT
-                void updateAcc(const sensor_real_t Axyz[3], const sensor_real_t deltat);
-                void updateGyro(const sensor_real_t Gxyz[3], const sensor_real_t deltat);
-            #endif
+            void updateAcc(const sensor_real_t Axyz[3], const sensor_real_t deltat);
+            void updateGyro(const sensor_real_t Gxyz[3], const sensor_real_t deltat);
+            // also records the rest state of every gyro sample in gyro.atRest
+            void updateBatches(RawSampleBatch &gyro, const SampleTransform &gyroTransform,
+                               const RawSampleBatch &accel, const SampleTransform &accelTransform, sensor_real_t accelDeltat);
         protected:
-            #if !SENSOR_FUSION_WITH_RESTDETECT
-                SensorRestDetectionParams restDetectionParams {};
-                RestDetection restDetection;
-            #endif
-            
+            SensorRestDetectionParams restDetectionParams {};
+            RestDetection restDetection;
+
         };
     }
 }
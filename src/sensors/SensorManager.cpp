@@ -40,6 +40,7 @@
 #include "softfusion/drivers/mpu6050.h"
 
 #include "softfusion/i2cimpl.h"
+#include "softfusion/spiimpl.h"
 
 #if ESP32
     #include "driver/i2c.h"
@@ -56,10 +57,19 @@ namespace SlimeVR
         using SoftFusionLSM6DSO = SoftFusionSensor<SoftFusion::Drivers::LSM6DSO, SoftFusion::I2CImpl>;
         using SoftFusionLSM6DSR = SoftFusionSensor<SoftFusion::Drivers::LSM6DSR, SoftFusion::I2CImpl>;
         using SoftFusionMPU6050 = SoftFusionSensor<SoftFusion::Drivers::MPU6050, SoftFusion::I2CImpl>;
+        using SoftFusionICM42688SPI = SoftFusionSensor<SoftFusion::Drivers::ICM42688, SoftFusion::SPIImpl>;
+        using SoftFusionBMI270SPI = SoftFusionSensor<SoftFusion::Drivers::BMI270, SoftFusion::SPIImpl>;
+        using SoftFusionLSM6DSVSPI = SoftFusionSensor<SoftFusion::Drivers::LSM6DSV, SoftFusion::SPIImpl>;
 
         // TODO Make it more generic in the future and move another place (abstract sensor interface)
         void SensorManager::swapI2C(uint8_t sclPin, uint8_t sdaPin)
         {
+            #if SENSORMANAGER_DEDICATED_I2C_BUSES
+                if (m_SecondaryBusUsed && sclPin == m_SecondarySCL && sdaPin == m_SecondarySDA) {
+                    // these pins have their own controller, nothing to re-pin
+                    return;
+                }
+            #endif
             if (sclPin != activeSCL || sdaPin != activeSDA || !running) {
                 Wire.flush();
                 #if ESP32
@@ -87,11 +97,155 @@ namespace SlimeVR
             }
         }
 
+        void SensorManager::assignI2CBuses()
+        {
+            #if SENSORMANAGER_DEDICATED_I2C_BUSES
+                m_SecondaryBusUsed = false;
+                if (m_I2CPinPairs.size() != 2) {
+                    // single pair needs no second controller, more than two still have to share by swapping
+                    return;
+                }
+
+                // only softfusion IMUs can be moved off Wire, the rest of the drivers are hardwired to it
+                for (int i = 1; i >= 0; i--) {
+                    if (m_I2CPinPairs[i].supportsSecondaryBus) {
+                        m_SecondaryBusUsed = true;
+                        m_SecondarySCL = m_I2CPinPairs[i].scl;
+                        m_SecondarySDA = m_I2CPinPairs[i].sda;
+                        m_Logger.info("Using second I2C controller for SCL %d SDA %d", m_SecondarySCL, m_SecondarySDA);
+                        return;
+                    }
+                }
+            #endif
+        }
+
+        TwoWire *SensorManager::getI2CBus(uint8_t sclPin, uint8_t sdaPin)
+        {
+            #if SENSORMANAGER_DEDICATED_I2C_BUSES
+                if (m_SecondaryBusUsed && sclPin == m_SecondarySCL && sdaPin == m_SecondarySDA) {
+                    return &Wire1;
+                }
+            #endif
+            return &Wire;
+        }
+
+        void SensorManager::beginSecondaryI2CBus()
+        {
+            #if SENSORMANAGER_DEDICATED_I2C_BUSES
+                // Reset HWI2C to avoid being affected by I2CBUS reset
+                Wire1.end();
+                Wire1.begin(static_cast<int>(m_SecondarySDA), static_cast<int>(m_SecondarySCL), I2C_SPEED);
+                Wire1.setTimeOut(150);
+            #endif
+        }
+
+        void SensorManager::discoverImus()
+        {
+            const uint32_t discoveryStart = millis();
+            uint32_t busClearMillis = 0;
+
+            // the last boot's topology is only trusted while the descriptor list still matches it
+            const auto cachedTopology = configuration.loadImuTopology();
+            bool useCache = !m_ImuProbes.empty() && cachedTopology.size() == m_ImuProbes.size();
+            for (size_t i = 0; useCache && i < m_ImuProbes.size(); i++) {
+                useCache = cachedTopology[i].sclPin == m_ImuProbes[i].scl
+                    && cachedTopology[i].sdaPin == m_ImuProbes[i].sda
+                    && cachedTopology[i].address == m_ImuProbes[i].address;
+                m_ImuProbes[i].expected = cachedTopology[i].present;
+            }
+
+            for (size_t i = 0; i < m_ImuProbes.size(); i++) {
+                const uint8_t scl = m_ImuProbes[i].scl;
+                const uint8_t sda = m_ImuProbes[i].sda;
+                // every pin pair is cleared and swept once, when its first address comes up
+                bool pairDone = false;
+                for (size_t j = 0; j < i && !pairDone; j++) {
+                    pairDone = m_ImuProbes[j].scl == scl && m_ImuProbes[j].sda == sda;
+                }
+                if (pairDone) {
+                    continue;
+                }
+
+                const uint32_t clearStart = millis();
+                // Make sure the bus isn't stuck when resetting the MCU without powering the IMUs down
+                I2CSCAN::clearBus(sda, scl);
+                busClearMillis += millis() - clearStart;
+
+                TwoWire *wire = getI2CBus(scl, sda);
+                if (wire == &Wire) {
+                    swapI2C(scl, sda);
+                }
+                else {
+                    beginSecondaryI2CBus();
+                }
+
+                // IMUs still booting don't answer yet and get another sweep until the boot timeout.
+                // Mandatory IMUs are always waited for, with a verified cache optional ones only
+                // if they answered last boot
+                while (true) {
+                    bool waiting = false;
+                    for (auto &probe : m_ImuProbes) {
+                        if (probe.scl != scl || probe.sda != sda || probe.present) {
+                            continue;
+                        }
+                        probe.present = I2CSCAN::hasDevOnBus(probe.address, *wire);
+                        waiting |= !probe.present && (!probe.optional || !useCache || probe.expected);
+                    }
+                    if (!waiting || !imuBootPending()) {
+                        break;
+                    }
+                    delay(1);
+                }
+            }
+
+            if (m_ImuProbes.empty()) {
+                return;
+            }
+
+            std::vector<SlimeVR::Configuration::ImuTopologyEntry> topology;
+            bool topologyChanged = !useCache;
+            for (const auto &probe : m_ImuProbes) {
+                topology.push_back({probe.scl, probe.sda, probe.address, probe.present});
+                topologyChanged |= probe.present != probe.expected;
+            }
+            if (topologyChanged) {
+                if (useCache) {
+                    m_Logger.info("IMU topology changed since the last boot");
+                }
+                configuration.saveImuTopology(topology);
+            }
+
+            const uint32_t discoveryMillis = millis() - discoveryStart;
+            m_Logger.info("IMU discovery took %u ms (bus clear %u ms, %s)",
+                discoveryMillis,
+                busClearMillis,
+                useCache ? "verified cached topology" : "full probe");
+        }
+
+        bool SensorManager::isImuPresent(uint8_t sclPin, uint8_t sdaPin, uint8_t address) const
+        {
+            for (const auto &probe : m_ImuProbes) {
+                if (probe.scl == sclPin && probe.sda == sdaPin && probe.address == address) {
+                    return probe.present;
+                }
+            }
+            return false;
+        }
+
         void SensorManager::setup()
         {
             running = false;
             activeSCL = PIN_IMU_SCL;
             activeSDA = PIN_IMU_SDA;
+            m_ImuBootDeadline = millis() + IMU_BOOT_TIMEOUT_MS;
+
+#define IMU_DESC_ENTRY(ImuType, addrSuppl, rotation, sclPin, sdaPin, ...) \
+            planI2CBus<ImuType>(sclPin, sdaPin);                              \
+            planImuProbe<ImuType>(addrSuppl, sclPin, sdaPin, __VA_ARGS__);
+            IMU_DESC_LIST;
+#undef IMU_DESC_ENTRY
+            assignI2CBuses();
+            discoverImus();
 
             uint8_t sensorID = 0;
             uint8_t activeSensorCount = 0;
@@ -109,6 +263,7 @@ namespace SlimeVR
             IMU_DESC_LIST;
 
 #undef IMU_DESC_ENTRY
+            applyConfiguredFusionEngines();
             m_Logger.info("%d sensor(s) configured", activeSensorCount);
             // Check and scan i2c if no sensors active
             if (activeSensorCount == 0) {
@@ -117,26 +272,185 @@ namespace SlimeVR
             }
         }
 
+        void SensorManager::applyConfiguredFusionEngines()
+        {
+            for (auto &sensor : m_Sensors) {
+                SensorFusion *fusion = sensor->getSensorFusion();
+                const uint8_t engine = configuration.getFusionEngine(sensor->getSensorId());
+                if (fusion == nullptr || !isValidFusionEngine(engine)) {
+                    continue;
+                }
+                fusion->setEngine(static_cast<FusionEngineType>(engine));
+                m_Logger.info("Sensor[%d] uses fusion engine %s", sensor->getSensorId(), getFusionEngineName(fusion->getEngineType()));
+            }
+        }
+
+        bool SensorManager::setFusionEngine(Sensor &sensor, FusionEngineType engine)
+        {
+            SensorFusion *fusion = sensor.getSensorFusion();
+            if (fusion == nullptr) {
+                return false;
+            }
+            fusion->setEngine(engine);
+            configuration.setFusionEngine(sensor.getSensorId(), static_cast<uint8_t>(engine));
+            return true;
+        }
+
         void SensorManager::postSetup()
         {
             running = true;
             for (auto &sensor : m_Sensors) {
                 if (sensor->isWorking()) {
-                    swapI2C(sensor->sclPin, sensor->sdaPin);
+                    if (sensor->usesI2C()) swapI2C(sensor->sclPin, sensor->sdaPin);
                     sensor->postSetup();
                 }
             }
+
+            #if SENSORMANAGER_ACQUISITION_TASK
+                startAcquisitionTask();
+            #endif
         }
 
-        void SensorManager::update()
+        void SensorManager::pollSensors()
         {
-            // Gather IMU data
-            bool allIMUGood = true;
             for (auto &sensor : m_Sensors) {
                 if (sensor->isWorking()) {
-                    swapI2C(sensor->sclPin, sensor->sdaPin);
+                    if (sensor->usesI2C()) swapI2C(sensor->sclPin, sensor->sdaPin);
                     sensor->motionLoop();
                 }
+            }
+        }
+
+        #if SENSORMANAGER_ACQUISITION_TASK
+            void SensorManager::startAcquisitionTask()
+            {
+                for (auto &sensor : m_Sensors) {
+                    if (sensor->isWorking() && !sensor->supportsAcquisitionTask()) {
+                        // the sensors share buses, so either all of them move to the task or none
+                        m_Logger.info("%s needs the main loop, not starting the sensor acquisition task",
+                            getIMUNameByType(sensor->getSensorType()));
+                        return;
+                    }
+                }
+
+                m_PendingFrames.resize(m_Sensors.size(), PendingFrame{SensorFrame{}, false});
+                m_SensorsMutex.create();
+                // setup and the Arduino loop run on the same core, take the other one
+                const BaseType_t core = xPortGetCoreID() == 0 ? 1 : 0;
+                if (xTaskCreatePinnedToCore(acquisitionTask, "sensors", 8192, this,
+                        SENSOR_ACQUISITION_TASK_PRIORITY, &m_AcquisitionTask, core) != pdPASS) {
+                    m_AcquisitionTask = nullptr;
+                    m_Logger.error("Can't create the sensor acquisition task, reading sensors from the main loop");
+                    return;
+                }
+                m_Logger.info("Reading sensors in their own task on core %d", core);
+            }
+
+            void SensorManager::acquisitionTask(void *arg)
+            {
+                auto *manager = static_cast<SensorManager *>(arg);
+                while (true) {
+                    manager->m_SensorsMutex.lock();
+                    manager->pollSensors();
+                    manager->publishFrames();
+                    manager->m_SensorsMutex.unlock();
+                    // also lets the idle task of this core run, which feeds the task watchdog
+                    vTaskDelay(1);
+                }
+            }
+
+            // acquisition task side of m_Frames
+            void SensorManager::publishFrames()
+            {
+                SensorFrame frame;
+                for (auto &sensor : m_Sensors) {
+                    if (sensor->isWorking() && sensor->takeNewData(frame) && !m_Frames.push(frame)) {
+                        m_DroppedFrames.fetch_add(1, std::memory_order_relaxed);
+                    }
+                }
+            }
+
+            // main loop side of m_Frames, only the newest rotation, acceleration and temperature of every sensor is kept for sending
+            void SensorManager::collectFrames()
+            {
+                SensorFrame frame;
+                while (m_Frames.pop(frame)) {
+                    if (frame.sensorId >= m_PendingFrames.size()) {
+                        continue;
+                    }
+                    auto &pending = m_PendingFrames[frame.sensorId];
+                    if (pending.pending) {
+                        const SensorFrame &older = pending.frame;
+                        if (older.hasRotation && !frame.hasRotation) {
+                            frame.hasRotation = true;
+                            frame.rotation = older.rotation;
+                            frame.timestamp = older.timestamp;
+                            frame.calibrationAccuracy = older.calibrationAccuracy;
+                        }
+                        if (older.hasAcceleration && !frame.hasAcceleration) {
+                            frame.hasAcceleration = true;
+                            frame.acceleration = older.acceleration;
+                        }
+                        if (older.hasTemperature && !frame.hasTemperature) {
+                            frame.hasTemperature = true;
+                            frame.temperature = older.temperature;
+                        }
+                    }
+                    pending.frame = frame;
+                    pending.pending = true;
+                }
+
+                uint32_t now = millis();
+                if (now - m_LastDropCheck >= 1000) {
+                    m_LastDropCheck = now;
+                    uint32_t dropped = m_DroppedFrames.exchange(0, std::memory_order_relaxed);
+                    if (dropped > 0) {
+                        m_Logger.warn("Main loop fell behind, %u sensor frames dropped", dropped);
+                    }
+                }
+            }
+        #endif
+
+        bool SensorManager::hasDataToSend(size_t index)
+        {
+            #if SENSORMANAGER_ACQUISITION_TASK
+                if (m_AcquisitionTask != nullptr) {
+                    return m_PendingFrames[index].pending;
+                }
+            #endif
+            return m_Sensors[index]->hasNewDataToSend();
+        }
+
+        void SensorManager::sendSensorData(size_t index)
+        {
+            #if SENSORMANAGER_ACQUISITION_TASK
+                if (m_AcquisitionTask != nullptr) {
+                    auto &pending = m_PendingFrames[index];
+                    if (pending.pending) {
+                        pending.pending = false;
+                        m_Sensors[index]->sendFrame(pending.frame);
+                    }
+                    return;
+                }
+            #endif
+            m_Sensors[index]->sendData();
+        }
+
+        void SensorManager::update()
+        {
+            // Gather IMU data
+            #if SENSORMANAGER_ACQUISITION_TASK
+                if (m_AcquisitionTask != nullptr) {
+                    collectFrames();
+                } else {
+                    pollSensors();
+                }
+            #else
+                pollSensors();
+            #endif
+
+            bool allIMUGood = true;
+            for (auto &sensor : m_Sensors) {
                 if (sensor->getSensorState() == SensorStatus::SENSOR_ERROR)
                 {
                     allIMUGood = false;
@@ -145,6 +459,13 @@ namespace SlimeVR
 
             statusManager.setStatus(SlimeVR::Status::IMU_ERROR, !allIMUGood);
 
+            for (auto &sensor : m_Sensors) {
+                if (sensor->isWorking() && sensor->hasDeferredWork()) {
+                    auto sensorsLock = lockSensors();
+                    sensor->runDeferredWork();
+                }
+            }
+
             if (!networkConnection.isConnected()) {
                 return;
             }
@@ -156,10 +477,10 @@ namespace SlimeVR
                 uint32_t now = micros();
                 bool shouldSend = false;
                 bool allSensorsReady = true;
-                for (auto &sensor : m_Sensors) {
-                    if (!sensor->isWorking()) continue;
-                    if (sensor->hasNewDataToSend()) shouldSend = true;
-                    allSensorsReady &= sensor->hasNewDataToSend();
+                for (size_t i = 0; i < m_Sensors.size(); i++) {
+                    if (!m_Sensors[i]->isWorking()) continue;
+                    if (hasDataToSend(i)) shouldSend = true;
+                    allSensorsReady &= hasDataToSend(i);
                 }
 
                 if (now - m_LastBundleSentAtMicros < PACKET_BUNDLING_BUFFER_SIZE_MICROS) {
@@ -177,9 +498,13 @@ namespace SlimeVR
                 networkConnection.beginBundle();
             #endif
 
-            for (auto &sensor : m_Sensors) {
-                if (sensor->isWorking()) {
-                    sensor->sendData();
+            for (size_t i = 0; i < m_Sensors.size(); i++) {
+                if (m_Sensors[i]->isWorking()) {
+                    if (!m_FirstDataSent && hasDataToSend(i)) {
+                        m_FirstDataSent = true;
+                        m_Logger.info("First sensor data sent %lu ms after power on", millis());
+                    }
+                    sendSensorData(i);
                 }
             }
 
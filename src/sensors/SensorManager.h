@@ -26,19 +26,84 @@
 
 #include "globals.h"
 #include "sensor.h"
+#include "SensorFusion.h"
 #include "EmptySensor.h"
 #include "ErroneousSensor.h"
 #include "logging/Logger.h"
+#include "SPSCRing.h"
 
 #include <i2cscan.h>
 
+#include <atomic>
 #include <memory>
 
+#if ESP32
+    #include "sdkconfig.h"
+    #include "soc/soc_caps.h"
+#endif
+
+// IMUs on a second SCL/SDA pair get the second I2C controller instead of re-pinning the first one
+#if ESP32 && defined(SOC_I2C_NUM) && SOC_I2C_NUM > 1 && !I2C_FORCE_BUS_SWAP
+    #define SENSORMANAGER_DEDICATED_I2C_BUSES true
+#else
+    #define SENSORMANAGER_DEDICATED_I2C_BUSES false
+#endif
+
+// On dual-core ESP32 the IMUs are read and fused in their own task, on the core the Arduino loop isn't using
+#if ESP32 && !CONFIG_FREERTOS_UNICORE && SENSOR_ACQUISITION_TASK
+    #define SENSORMANAGER_ACQUISITION_TASK true
+    #include "freertos/FreeRTOS.h"
+    #include "freertos/semphr.h"
+    #include "freertos/task.h"
+#else
+    #define SENSORMANAGER_ACQUISITION_TASK false
+#endif
+
 
 namespace SlimeVR
 {
     namespace Sensors
     {
+        // Held by the acquisition task while it runs the sensors, and by the main loop when it
+        // touches them (or their I2C bus) directly. Does nothing without an acquisition task.
+        class SensorsMutex
+        {
+        public:
+            void lock() {
+                #if SENSORMANAGER_ACQUISITION_TASK
+                    if (m_Handle != nullptr) {
+                        xSemaphoreTake(m_Handle, portMAX_DELAY);
+                    }
+                #endif
+            }
+            void unlock() {
+                #if SENSORMANAGER_ACQUISITION_TASK
+                    if (m_Handle != nullptr) {
+                        xSemaphoreGive(m_Handle);
+                    }
+                #endif
+            }
+
+        #if SENSORMANAGER_ACQUISITION_TASK
+            void create() {
+                m_Handle = xSemaphoreCreateMutex();
+            }
+        private:
+            SemaphoreHandle_t m_Handle = nullptr;
+        #endif
+        };
+
+        class SensorsLock
+        {
+        public:
+            explicit SensorsLock(SensorsMutex &mutex) : m_Mutex(mutex) { m_Mutex.lock(); }
+            ~SensorsLock() { m_Mutex.unlock(); }
+            SensorsLock(const SensorsLock &) = delete;
+            SensorsLock &operator=(const SensorsLock &) = delete;
+        private:
+            SensorsMutex &m_Mutex;
+        };
+
         class SensorManager
         {
         public:
@@ -48,6 +113,16 @@ namespace SlimeVR
             void postSetup();
 
             void update();
+
+            // Keep the returned lock alive while calling into sensors from the main loop
+            SensorsLock lockSensors() { return SensorsLock(m_SensorsMutex); }
+            bool usesAcquisitionTask() const {
+                #if SENSORMANAGER_ACQUISITION_TASK
+                    return m_AcquisitionTask != nullptr;
+                #else
+                    return false;
+                #endif
+            }
             
             std::vector<std::unique_ptr<Sensor>> & getSensors() { return m_Sensors; };
             ImuID getSensorType(size_t id) {
@@ -57,6 +132,10 @@ namespace SlimeVR
                 return ImuID::Unknown;
             }
 
+            // Switches the fusion engine of a sensor and keeps it for the next boot, false when
+            // the sensor fuses on the IMU. Call with the sensors locked
+            bool setFusionEngine(Sensor &sensor, FusionEngineType engine);
+
         private:
             SlimeVR::Logging::Logger m_Logger;
 
@@ -75,35 +154,139 @@ namespace SlimeVR
                 // Now start detecting and building the IMU
                 std::unique_ptr<Sensor> sensor;
 
-                // Clear and reset I2C bus for each sensor upon startup
-                I2CSCAN::clearBus(sdaPin, sclPin);
-                swapI2C(sclPin, sdaPin);
+                TwoWire *wire = getI2CBus(sclPin, sdaPin);
+
+                // SPI sensors have nothing on the I2C bus to probe, they are detected by WHO_AM_I in motionSetup
+                constexpr bool isSPI = requires { requires ImuType::IsSPI; };
+                if constexpr(!isSPI) {
+                    // buses were already cleared and probed by discoverImus()
+                    if (wire == &Wire) {
+                        swapI2C(sclPin, sdaPin);
+                    }
 
-                if (I2CSCAN::hasDevOnBus(address)) {
-                    m_Logger.trace("Sensor %d found at address 0x%02X", sensorID + 1, address);
-                } else {
-                    if (!optional) {
-                        m_Logger.error("Mandatory sensor %d not found at address 0x%02X", sensorID + 1, address);
-                        sensor = std::make_unique<ErroneousSensor>(sensorID, ImuType::TypeID);
+                    if (isImuPresent(sclPin, sdaPin, address)) {
+                        m_Logger.trace("Sensor %d found at address 0x%02X", sensorID + 1, address);
+                    } else {
+                        if (!optional) {
+                            m_Logger.error("Mandatory sensor %d not found at address 0x%02X", sensorID + 1, address);
+                            sensor = std::make_unique<ErroneousSensor>(sensorID, ImuType::TypeID);
+                        }
+                        else {
+                            m_Logger.debug("Optional sensor %d not found at address 0x%02X", sensorID + 1, address);
+                            sensor = std::make_unique<EmptySensor>(sensorID);
+                        }
+                        return sensor;
                     }
-                    else {
-                        m_Logger.debug("Optional sensor %d not found at address 0x%02X", sensorID + 1, address);
-                        sensor = std::make_unique<EmptySensor>(sensorID);
+                }
+
+                if constexpr(!requires { requires ImuType::WaitsUntilReady; }) {
+                    // older drivers expect the IMU to have had its full boot time
+                    while (imuBootPending()) {
+                        delay(1);
                     }
-                    return sensor;
                 }
 
                 uint8_t intPin = extraParam;
-                sensor = std::make_unique<ImuType>(sensorID, addrSuppl, rotation, sclPin, sdaPin, intPin);
+                auto imu = std::make_unique<ImuType>(sensorID, addrSuppl, rotation, sclPin, sdaPin, intPin);
+                if constexpr(requires(ImuType &s) { s.setI2CBus(wire); }) {
+                    imu->setI2CBus(wire);
+                }
+                sensor = std::move(imu);
 
                 sensor->motionSetup();
                 return sensor;
             }            
+            template <typename ImuType>
+            void planI2CBus(uint8_t sclPin, uint8_t sdaPin)
+            {
+                #if SENSORMANAGER_DEDICATED_I2C_BUSES
+                    if constexpr(requires { requires ImuType::IsSPI; }) {
+                        return;
+                    }
+                    constexpr bool supportsSecondaryBus = requires(ImuType &s) { s.setI2CBus(&Wire1); };
+                    for (auto &pair : m_I2CPinPairs) {
+                        if (pair.scl == sclPin && pair.sda == sdaPin) {
+                            pair.supportsSecondaryBus &= supportsSecondaryBus;
+                            return;
+                        }
+                    }
+                    m_I2CPinPairs.push_back({sclPin, sdaPin, supportsSecondaryBus});
+                #endif
+            }
+
+            bool imuBootPending() const {
+                return static_cast<int32_t>(m_ImuBootDeadline - millis()) > 0;
+            }
+
+            template <typename ImuType>
+            void planImuProbe(uint8_t addrSuppl, uint8_t sclPin, uint8_t sdaPin, bool optional = false, int /* extraParam */ = 0)
+            {
+                if constexpr(!requires { requires ImuType::IsSPI; }) {
+                    m_ImuProbes.push_back({sclPin, sdaPin, static_cast<uint8_t>(ImuType::Address + addrSuppl), optional, false, false});
+                }
+            }
+
+            void discoverImus();
+            bool isImuPresent(uint8_t sclPin, uint8_t sdaPin, uint8_t address) const;
+
+            void assignI2CBuses();
+            TwoWire *getI2CBus(uint8_t scl, uint8_t sda);
+            void beginSecondaryI2CBus();
+
+            #if SENSORMANAGER_DEDICATED_I2C_BUSES
+                struct I2CPinPair {
+                    uint8_t scl;
+                    uint8_t sda;
+                    bool supportsSecondaryBus;
+                };
+                std::vector<I2CPinPair> m_I2CPinPairs;
+                bool m_SecondaryBusUsed = false;
+                uint8_t m_SecondarySCL = 0;
+                uint8_t m_SecondarySDA = 0;
+            #endif
+
+            struct ImuProbe {
+                uint8_t scl;
+                uint8_t sda;
+                uint8_t address;
+                bool optional; // from the IMU list, only optional IMUs may skip the boot wait
+                bool expected; // answered on the last boot, according to the cached topology
+                bool present;
+            };
+            std::vector<ImuProbe> m_ImuProbes;
+
             uint8_t activeSCL = 0;
             uint8_t activeSDA = 0;
             bool running = false;
             void swapI2C(uint8_t scl, uint8_t sda);
-            
+            void applyConfiguredFusionEngines();
+
+            void pollSensors();
+            bool hasDataToSend(size_t index);
+            void sendSensorData(size_t index);
+
+            SensorsMutex m_SensorsMutex;
+
+            #if SENSORMANAGER_ACQUISITION_TASK
+                void startAcquisitionTask();
+                static void acquisitionTask(void *arg);
+                void publishFrames();
+                void collectFrames();
+
+                struct PendingFrame {
+                    SensorFrame frame;
+                    bool pending;
+                };
+
+                TaskHandle_t m_AcquisitionTask = nullptr;
+                SPSCRing<SensorFrame, 32> m_Frames;
+                std::vector<PendingFrame> m_PendingFrames;
+                std::atomic<uint32_t> m_DroppedFrames{0};
+                uint32_t m_LastDropCheck = 0;
+            #endif
+
+            uint32_t m_ImuBootDeadline = 0;
+            bool m_FirstDataSent = false;
             uint32_t m_LastBundleSentAtMicros = micros();
         };
     }
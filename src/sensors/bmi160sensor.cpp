@@ -208,6 +208,8 @@ void BMI160Sensor::motionSetup() {
     #if !USE_6_AXIS
     m_Logger.info("Calibration data for mag: %s", isMagCalibrated ? "found" : "not found");
     #endif
+    updateGyroTransform();
+    updateAccelTransform();
 
     imu.setFIFOHeaderModeEnabled(true);
     imu.setGyroFIFOEnabled(true);
@@ -249,48 +251,19 @@ void BMI160Sensor::motionLoop() {
 
     {
         uint32_t now = micros();
-        constexpr uint32_t BMI160_TARGET_SYNC_INTERVAL_MICROS = 25000;
         uint32_t elapsed = now - lastClockPollTime;
         if (elapsed >= BMI160_TARGET_SYNC_INTERVAL_MICROS) {
             lastClockPollTime = now - (elapsed - BMI160_TARGET_SYNC_INTERVAL_MICROS);
 
-            const uint32_t nextLocalTime1 = micros();
+            const uint32_t localTime = micros();
             uint32_t rawSensorTime;
             if (imu.getSensorTime(&rawSensorTime)) {
-                localTime0 = localTime1;
-                localTime1 = nextLocalTime1;
-                syncLatencyMicros = (micros() - localTime1) * 0.3;
-                sensorTime0 = sensorTime1;
-                sensorTime1 = rawSensorTime;
-                if ((sensorTime0 > 0 || localTime0 > 0) && (sensorTime1 > 0 || sensorTime1 > 0)) {
-                    // handle 24 bit overflow
-                    double remoteDt =
-                        sensorTime1 >= sensorTime0 ?
-                        sensorTime1 - sensorTime0 :
-                        (sensorTime1 + 0xFFFFFF) - sensorTime0;
-                    double localDt = localTime1 - localTime0;
-                    const double nextSensorTimeRatio = localDt / (remoteDt * BMI160_TIMESTAMP_RESOLUTION_MICROS);
-
-                    // handle sdk lags and time travel
-                    if (round(nextSensorTimeRatio) == 1.0) {
-                        sensorTimeRatio = nextSensorTimeRatio;
-
-                        if (round(sensorTimeRatioEma) != 1.0) {
-                            sensorTimeRatioEma = sensorTimeRatio;
-                        }
-
-                        constexpr double EMA_APPROX_SECONDS = 1.0;
-                        constexpr uint32_t EMA_SAMPLES = (EMA_APPROX_SECONDS / 3 * 1e6) / BMI160_TARGET_SYNC_INTERVAL_MICROS;
-                        sensorTimeRatioEma -= sensorTimeRatioEma / EMA_SAMPLES;
-                        sensorTimeRatioEma += sensorTimeRatio / EMA_SAMPLES;
-
-                        sampleDtMicros = BMI160_ODR_GYR_MICROS * sensorTimeRatioEma;
-                        samplesSinceClockSync = 0;
-                    }
-                }
+                clockSync.update(localTime, rawSensorTime, micros() - localTime);
             }
 
-            getTemperature(&temperature);
+            if (getTemperature(&temperature)) {
+                updateGyroTransform();
+            }
             optimistic_yield(100);
         }
     }
@@ -311,14 +284,15 @@ void BMI160Sensor::motionLoop() {
                 if (end - lastCpuUsagePrinted > 1e6) {
                     bool restDetected = sfusion.getRestDetected();
 
-                    m_Logger.debug("readFIFO took %0.4f ms, read gyr %i acc %i mag %i rest %i resets %i readerrs %i type " SENSOR_FUSION_TYPE_STRING,
+                    m_Logger.debug("readFIFO took %0.4f ms, read gyr %i acc %i mag %i rest %i resets %i readerrs %i type %s",
                         ((float)cpuUsageMicros / 1e3f),
                         gyrReads,
                         accReads,
                         magReads,
                         restDetected,
                         numFIFODropped,
-                        numFIFOFailedReads
+                        numFIFOFailedReads,
+                        SlimeVR::Sensors::getFusionEngineName(sfusion.getEngineType())
                     );
 
                     cpuUsageMicros = 0;
@@ -346,9 +320,9 @@ void BMI160Sensor::motionLoop() {
             lastTemperaturePacketSent = now - (elapsed - sendInterval);
             #if BMI160_TEMPCAL_DEBUG
                 uint32_t isCalibrating = gyroTempCalibrator->isCalibrating() ? 10000 : 0;
-                networkConnection.sendTemperature(sensorId, isCalibrating + 10000 + (gyroTempCalibrator->config.samplesTotal * 100) + temperature);
+                setTemperature(isCalibrating + 10000 + (gyroTempCalibrator->config.samplesTotal * 100) + temperature);
             #else
-                networkConnection.sendTemperature(sensorId, temperature);
+                setTemperature(temperature);
             #endif
             optimistic_yield(100);
         }
@@ -356,13 +330,8 @@ void BMI160Sensor::motionLoop() {
 
     {
         uint32_t now = micros();
-        constexpr float maxSendRateHz = 120.0f;
-        constexpr uint32_t sendInterval = 1.0f/maxSendRateHz * 1e6;
-        uint32_t elapsed = now - lastRotationPacketSent;
-        if (elapsed >= sendInterval) {
-            lastRotationPacketSent = now - (elapsed - sendInterval);
-
-            setFusedRotation(sfusion.getQuaternionQuat());
+        if (sendRate.shouldSend(now, sfusion.getAngularSpeed(), sfusion.getRestDetected())) {
+            setFusedRotation(sfusion.getQuaternionQuat(), clockSync.getLastSampleTimestamp());
             setAcceleration(sfusion.getLinearAccVec());
 
             optimistic_yield(100);
@@ -470,23 +439,7 @@ void BMI160Sensor::readFIFO() {
             #endif
             if (anew) onAccelRawSample(BMI160_ODR_ACC_MICROS, ax, ay, az);
             if (gnew) {
-                constexpr uint32_t alignmentBitmask = ~(0xFFFFFFFF << (16 - BMI160_GYRO_RATE));
-                uint32_t alignmentOffset =
-                    (sensorTime1 & alignmentBitmask) * BMI160_TIMESTAMP_RESOLUTION_MICROS * sensorTimeRatioEma;
-
-                timestamp0 = timestamp1;
-                timestamp1 = (localTime1 - alignmentOffset - syncLatencyMicros) +
-                    (++samplesSinceClockSync) * sampleDtMicros;
-                int32_t dtMicros = timestamp1 - timestamp0;
-
-                constexpr float invPeriod = 1.0f / BMI160_ODR_GYR_MICROS;
-                int32_t sampleOffset = round((float)dtMicros * invPeriod) - 1;
-                if (abs(sampleOffset) > 3) {
-                    dtMicros = sampleDtMicros;
-                } else if (sampleOffset != 0) {
-                    dtMicros -= sampleOffset * sampleDtMicros;
-                }
-
+                const uint32_t dtMicros = clockSync.nextSampleDtMicros();
                 onGyroRawSample(dtMicros, gx, gy, gz);
             }
         } else {
@@ -505,26 +458,7 @@ void BMI160Sensor::onGyroRawSample(uint32_t dtMicros, int16_t x, int16_t y, int1
         gyroTempCalibrator->updateGyroTemperatureCalibration(temperature, restDetected, x, y, z);
     #endif
 
-    sensor_real_t gyroCalibratedStatic[3];
-    gyroCalibratedStatic[0] = (sensor_real_t)((((double)x - m_Calibration.G_off[0]) * gscaleX));
-    gyroCalibratedStatic[1] = (sensor_real_t)((((double)y - m_Calibration.G_off[1]) * gscaleY));
-    gyroCalibratedStatic[2] = (sensor_real_t)((((double)z - m_Calibration.G_off[2]) * gscaleZ));
-
-    #if BMI160_USE_TEMPCAL
-    float GOxyz[3];
-    if (gyroTempCalibrator->approximateOffset(temperature, GOxyz)) {
-        Gxyz[0] = (sensor_real_t)((((double)x - GOxyz[0] - GOxyzStaticTempCompensated[0]) * gscaleX));
-        Gxyz[1] = (sensor_real_t)((((double)y - GOxyz[1] - GOxyzStaticTempCompensated[1]) * gscaleY));
-        Gxyz[2] = (sensor_real_t)((((double)z - GOxyz[2] - GOxyzStaticTempCompensated[2]) * gscaleZ));
-    }
-    else
-    #endif
-    {
-        Gxyz[0] = gyroCalibratedStatic[0];
-        Gxyz[1] = gyroCalibratedStatic[1];
-        Gxyz[2] = gyroCalibratedStatic[2];
-    }
-    remapGyroAccel(&Gxyz[0], &Gxyz[1], &Gxyz[2]);
+    gyroTransform.apply(x, y, z, Gxyz);
 
 	sfusion.updateGyro(Gxyz, (sensor_real_t)dtMicros * 1.0e-6);
 
@@ -535,11 +469,7 @@ void BMI160Sensor::onAccelRawSample(uint32_t dtMicros, int16_t x, int16_t y, int
         accReads++;
     #endif
 
-    Axyz[0] = (sensor_real_t)x;
-    Axyz[1] = (sensor_real_t)y;
-    Axyz[2] = (sensor_real_t)z;
-    applyAccelCalibrationAndScale(Axyz);
-    remapGyroAccel(&Axyz[0], &Axyz[1], &Axyz[2]);
+    accelTransform.apply(x, y, z, Axyz);
     lastAxyz[0] = Axyz[0];
     lastAxyz[1] = Axyz[1];
     lastAxyz[2] = Axyz[2];
@@ -564,47 +494,10 @@ void BMI160Sensor::onMagRawSample(uint32_t dtMicros, int16_t x, int16_t y, int16
 }
 
 void BMI160Sensor::printTemperatureCalibrationState() {
-    const auto degCtoF = [](float degC) { return (degC * 9.0f/5.0f) + 32.0f; };
-
-    m_Logger.info("Sensor %i temperature calibration state:", sensorId);
-    m_Logger.info("  current temp: %0.4f C (%0.4f F)", temperature, degCtoF(temperature));
-    auto printTemperatureRange = [&](const char* label, float min, float max) {
-        m_Logger.info("  %s: min %0.4f C max %0.4f C (min %0.4f F max %0.4f F)",
-            label, min, max, degCtoF(min), degCtoF(max)
-        );
-    };
-    printTemperatureRange("total range",
-        TEMP_CALIBRATION_MIN,
-        TEMP_CALIBRATION_MAX
-    );
-    printTemperatureRange("calibrated range",
-        gyroTempCalibrator->config.minTemperatureRange,
-        gyroTempCalibrator->config.maxTemperatureRange
-    );
-    m_Logger.info("  done: %0.1f%", gyroTempCalibrator->config.getCalibrationDonePercent());
+    gyroTempCalibrator->printState(m_Logger, temperature);
 }
 void BMI160Sensor::printDebugTemperatureCalibrationState() {
-    m_Logger.info("Sensor %i gyro odr %f hz, sensitivity %f lsb",
-        sensorId,
-        BMI160_ODR_GYR_HZ,
-        BMI160_GYRO_TYPICAL_SENSITIVITY_LSB
-    );
-    m_Logger.info("Sensor %i temperature calibration matrix (tempC x y z):", sensorId);
-    m_Logger.info("BUF %i %i", sensorId, TEMP_CALIBRATION_BUFFER_SIZE);
-    m_Logger.info("SENS %i %f", sensorId, BMI160_GYRO_TYPICAL_SENSITIVITY_LSB);
-    m_Logger.info("DATA %i", sensorId);
-    for (int i = 0; i < TEMP_CALIBRATION_BUFFER_SIZE; i++) {
-        m_Logger.info("%f %f %f %f",
-            gyroTempCalibrator->config.samples[i].t,
-            gyroTempCalibrator->config.samples[i].x,
-            gyroTempCalibrator->config.samples[i].y,
-            gyroTempCalibrator->config.samples[i].z
-        );
-    }
-    m_Logger.info("END %i", sensorId);
-    m_Logger.info("y = %f + (%fx) + (%fxx) + (%fxxx)", UNPACK_VECTOR_ARRAY(gyroTempCalibrator->config.cx), gyroTempCalibrator->config.cx[3]);
-    m_Logger.info("y = %f + (%fx) + (%fxx) + (%fxxx)", UNPACK_VECTOR_ARRAY(gyroTempCalibrator->config.cy), gyroTempCalibrator->config.cy[3]);
-    m_Logger.info("y = %f + (%fx) + (%fxx) + (%fxxx)", UNPACK_VECTOR_ARRAY(gyroTempCalibrator->config.cz), gyroTempCalibrator->config.cz[3]);
+    gyroTempCalibrator->printDebugState(m_Logger, BMI160_ODR_GYR_HZ);
 }
 void BMI160Sensor::saveTemperatureCalibration() {
     gyroTempCalibrator->saveConfig();
@@ -623,24 +516,36 @@ bool BMI160Sensor::getTemperature(float* out) {
     return false;
 }
 
-void BMI160Sensor::applyAccelCalibrationAndScale(sensor_real_t Axyz[3]) {
+// offsets depend on the temperature when it is compensated, so this is redone on every temperature read
+void BMI160Sensor::updateGyroTransform() {
+    double offset[3] = {m_Calibration.G_off[0], m_Calibration.G_off[1], m_Calibration.G_off[2]};
+    #if BMI160_USE_TEMPCAL
+    float GOxyz[3];
+    if (gyroTempCalibrator && gyroTempCalibrator->approximateOffset(temperature, GOxyz)) {
+        for (uint8_t i = 0; i < 3; i++) {
+            offset[i] = GOxyz[i] + GOxyzStaticTempCompensated[i];
+        }
+    }
+    #endif
+    const double scale[3] = {gscaleX, gscaleY, gscaleZ};
+    gyroTransform = SlimeVR::Sensors::SampleTransform::offsetScale(offset, scale)
+        .then(SlimeVR::Sensors::SampleTransform::remap(AXIS_REMAP_GET_ALL_IMU(axisRemap)));
+}
+
+void BMI160Sensor::updateAccelTransform() {
     //apply offsets (bias) and scale factors from Magneto
+    constexpr float identity[3][3] = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+    constexpr float noBias[3] = {0, 0, 0};
+    const float (*matrix)[3] = identity;
+    const float *bias = noBias;
     if (isAccelCalibrated) {
+        bias = m_Calibration.A_B;
         #if useFullCalibrationMatrix == true
-            float tmp[3];
-            for (uint8_t i = 0; i < 3; i++)
-                tmp[i] = (Axyz[i] - m_Calibration.A_B[i]);
-            Axyz[0] = m_Calibration.A_Ainv[0][0] * tmp[0] + m_Calibration.A_Ainv[0][1] * tmp[1] + m_Calibration.A_Ainv[0][2] * tmp[2];
-            Axyz[1] = m_Calibration.A_Ainv[1][0] * tmp[0] + m_Calibration.A_Ainv[1][1] * tmp[1] + m_Calibration.A_Ainv[1][2] * tmp[2];
-            Axyz[2] = m_Calibration.A_Ainv[2][0] * tmp[0] + m_Calibration.A_Ainv[2][1] * tmp[1] + m_Calibration.A_Ainv[2][2] * tmp[2];
-        #else
-            for (uint8_t i = 0; i < 3; i++)
-                Axyz[i] = (Axyz[i] - calibration->A_B[i]);
+            matrix = m_Calibration.A_Ainv;
         #endif
     }
-    Axyz[0] *= BMI160_ASCALE;
-    Axyz[1] *= BMI160_ASCALE;
-    Axyz[2] *= BMI160_ASCALE;
+    accelTransform = SlimeVR::Sensors::SampleTransform::biasMatrixScale(bias, matrix, BMI160_ASCALE)
+        .then(SlimeVR::Sensors::SampleTransform::remap(AXIS_REMAP_GET_ALL_IMU(axisRemap)));
 }
 
 void BMI160Sensor::applyMagCalibrationAndScale(sensor_real_t Mxyz[3]) {
@@ -704,6 +609,8 @@ void BMI160Sensor::startCalibration(int calibrationType) {
     calibration.data.bmi160 = m_Calibration;
     configuration.setCalibration(sensorId, calibration);
     configuration.save();
+    updateGyroTransform();
+    updateAccelTransform();
 
     m_Logger.debug("Saved the calibration data");
 
@@ -974,10 +881,6 @@ void BMI160Sensor::maybeCalibrateMag() {
 #endif
 }
 
-void BMI160Sensor::remapGyroAccel(sensor_real_t* x, sensor_real_t* y, sensor_real_t* z) {
-    remapAllAxis(AXIS_REMAP_GET_ALL_IMU(axisRemap), x, y, z);
-}
-
 void BMI160Sensor::remapMagnetometer(sensor_real_t* x, sensor_real_t* y, sensor_real_t* z) {
     remapAllAxis(AXIS_REMAP_GET_ALL_MAG(axisRemap), x, y, z);
 }
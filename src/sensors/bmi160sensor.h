@@ -30,10 +30,13 @@
 
 #include <BMI160.h>
 #include "SensorFusionRestDetect.h"
+#include "SampleTransform.h"
+#include "SendRateScheduler.h"
 #include "../motionprocessing/types.h"
 
 #include "../motionprocessing/GyroTemperatureCalibrator.h"
 #include "../motionprocessing/RestDetection.h"
+#include "../motionprocessing/SensorClockSync.h"
 
 #if BMI160_USE_VQF
     #if USE_6_AXIS
@@ -63,6 +66,7 @@
 constexpr float BMI160_ODR_GYR_HZ = 25.0f * (1 << (BMI160_GYRO_RATE - 6));
 constexpr float BMI160_ODR_ACC_HZ = 12.5f * (1 << (BMI160_ACCEL_RATE - 5));
 constexpr float BMI160_ODR_GYR_MICROS = BMI160_MAP_ODR_MICROS(1.0f / BMI160_ODR_GYR_HZ * 1e6f);
+constexpr uint32_t BMI160_TARGET_SYNC_INTERVAL_MICROS = 25000;
 constexpr float BMI160_ODR_ACC_MICROS = BMI160_MAP_ODR_MICROS(1.0f / BMI160_ODR_ACC_HZ * 1e6f);
 #if !USE_6_AXIS
 // note: this value only sets polling and fusion update rate - HMC is internally sampled at 75hz, QMC at 200hz
@@ -143,6 +147,12 @@ class BMI160Sensor : public Sensor {
         void motionSetup() override final;
         void motionLoop() override final;
         void startCalibration(int calibrationType) override final;
+        SlimeVR::Sensors::SensorFusion *getSensorFusion() override final {
+            return &sfusion;
+        };
+        const SlimeVR::Sensors::SendRateScheduler *getSendRateScheduler() const override final {
+            return &sendRate;
+        };
         void maybeCalibrateGyro();
         void maybeCalibrateAccel();
         void maybeCalibrateMag();
@@ -154,8 +164,15 @@ class BMI160Sensor : public Sensor {
             m_Logger.info("Temperature calibration state has been reset for sensorId:%i", sensorId);
         };
         void saveTemperatureCalibration() override final;
+        bool hasDeferredWork() override final {
+            return gyroTempCalibrator && gyroTempCalibrator->configSavePending;
+        };
+        void runDeferredWork() override final {
+            gyroTempCalibrator->savePendingConfig();
+        };
 
-        void applyAccelCalibrationAndScale(sensor_real_t Axyz[3]);
+        void updateGyroTransform();
+        void updateAccelTransform();
         void applyMagCalibrationAndScale(sensor_real_t Mxyz[3]);
 
         bool hasGyroCalibration();
@@ -169,7 +186,6 @@ class BMI160Sensor : public Sensor {
 
         void getMagnetometerXYZFromBuffer(uint8_t* data, int16_t* x, int16_t* y, int16_t* z);
 
-        void remapGyroAccel(sensor_real_t* x, sensor_real_t* y, sensor_real_t* z);
         void remapMagnetometer(sensor_real_t* x, sensor_real_t* y, sensor_real_t* z);
         void getRemappedRotation(int16_t* x, int16_t* y, int16_t* z);
         void getRemappedAcceleration(int16_t* x, int16_t* y, int16_t* z);
@@ -183,17 +199,7 @@ class BMI160Sensor : public Sensor {
         SlimeVR::Sensors::SensorFusionRestDetect sfusion;
 
         // clock sync and sample timestamping
-        uint32_t sensorTime0 = 0;
-        uint32_t sensorTime1 = 0;
-        uint32_t localTime0 = 0;
-        uint32_t localTime1 = 0;
-        double sensorTimeRatio = 1;
-        double sensorTimeRatioEma = 1;
-        double sampleDtMicros = BMI160_ODR_GYR_MICROS;
-        uint32_t syncLatencyMicros = 0;
-        uint32_t samplesSinceClockSync = 0;
-        uint32_t timestamp0 = 0;
-        uint32_t timestamp1 = 0;
+        SensorClockSync clockSync{BMI160_TIMESTAMP_RESOLUTION_MICROS, 0xFFFFFF, BMI160_ODR_GYR_MICROS, true, BMI160_TARGET_SYNC_INTERVAL_MICROS};
 
         // scheduling
         uint32_t lastPollTime = micros();
@@ -208,7 +214,7 @@ class BMI160Sensor : public Sensor {
         uint16_t numFIFOFailedReads = 0;
         #endif
 
-        uint32_t lastRotationPacketSent = 0;
+        SlimeVR::Sensors::SendRateScheduler sendRate{1e6f / BMI160_ODR_GYR_MICROS};
         uint32_t lastTemperaturePacketSent = 0;
 
         struct BMI160FIFO {
@@ -221,6 +227,8 @@ class BMI160Sensor : public Sensor {
         sensor_real_t Axyz[3] = {0};
         sensor_real_t Mxyz[3] = {0};
         sensor_real_t lastAxyz[3] = {0};
+        SlimeVR::Sensors::SampleTransform gyroTransform;
+        SlimeVR::Sensors::SampleTransform accelTransform;
 
         double gscaleX = BMI160_GSCALE;
         double gscaleY = BMI160_GSCALE;
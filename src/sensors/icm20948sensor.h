@@ -43,6 +43,9 @@ public:
 
     void motionLoop() override final;
     void sendData() override final;
+    bool supportsAcquisitionTask() const override final {
+        return false;
+    };
     void startCalibration(int calibrationType) override final;
 
 private:
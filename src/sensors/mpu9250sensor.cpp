@@ -88,6 +88,7 @@ void MPU9250Sensor::motionSetup() {
             m_Logger.info("Calibration is advised");
         }
     }
+    updateSampleTransforms();
 
 #if MPU_USE_DMPMAG
     uint8_t devStatus = imu.dmpInitialize();
@@ -328,6 +329,7 @@ void MPU9250Sensor::startCalibration(int calibrationType) {
     calibration.data.mpu9250 = m_Calibration;
     configuration.setCalibration(sensorId, calibration);
     configuration.save();
+    updateSampleTransforms();
 
     ledManager.off();
     m_Logger.debug("Saved the calibration data");
@@ -361,37 +363,30 @@ void MPU9250Sensor::parseMagData(int16_t data[3]) {
 
 void MPU9250Sensor::parseAccelData(int16_t data[3]) {
     // reading big endian int16
-    Axyz[0] = (float)data[0];
-    Axyz[1] = (float)data[1];
-    Axyz[2] = (float)data[2];
+    accelTransform.apply(data, Axyz);
+}
 
-    #if !MPU_USE_DMPMAG
-    float temp[3];
-    #endif
+void MPU9250Sensor::parseGyroData(int16_t data[3]) {
+    // reading big endian int16
+    gyroTransform.apply(data, Gxyz); //250 LSB(d/s) default to radians/s
+}
+
+void MPU9250Sensor::updateSampleTransforms() {
+    constexpr float gscales[3] = {gscale, gscale, gscale};
+    gyroTransform = SlimeVR::Sensors::SampleTransform::offsetScale(m_Calibration.G_off, gscales);
 
     //apply offsets (bias) and scale factors from Magneto
-    for (unsigned i = 0; i < 3; i++) {
-        #if !MPU_USE_DMPMAG
-        temp[i] = (Axyz[i] - m_Calibration.A_B[i]);
-    }
-    
-    for (unsigned i = 0; i < 3; i++) {
+    constexpr float identity[3][3] = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+    constexpr float noBias[3] = {0, 0, 0};
+    const float (*matrix)[3] = identity;
+    const float *bias = noBias;
+    #if !MPU_USE_DMPMAG
+        bias = m_Calibration.A_B;
         #if useFullCalibrationMatrix == true
-            Axyz[i] = m_Calibration.A_Ainv[i][0] * temp[0] + m_Calibration.A_Ainv[i][1] * temp[1] + m_Calibration.A_Ainv[i][2] * temp[2];
-        #else
-            Axyz[i] = temp[i];
+            matrix = m_Calibration.A_Ainv;
         #endif
-        #endif
-        Axyz[i] *= ASCALE_2G;
-    }
-}
-
-// TODO: refactor so that calibration/conversion to float is only done in one place.
-void MPU9250Sensor::parseGyroData(int16_t data[3]) {
-    // reading big endian int16
-    Gxyz[0] = ((float)data[0] - m_Calibration.G_off[0]) * gscale; //250 LSB(d/s) default to radians/s
-    Gxyz[1] = ((float)data[1] - m_Calibration.G_off[1]) * gscale;
-    Gxyz[2] = ((float)data[2] - m_Calibration.G_off[2]) * gscale;
+    #endif
+    accelTransform = SlimeVR::Sensors::SampleTransform::biasMatrixScale(bias, matrix, ASCALE_2G);
 }
 
 // really just an implementation detail of getNextSample...
@@ -26,6 +26,7 @@
 
 #include "sensor.h"
 #include "logging/Logger.h"
+#include "SampleTransform.h"
 
 #include <MPU9250_6Axis_MotionApps_V6_12.h>
 
@@ -57,6 +58,11 @@ public:
     void motionSetup() override final;
     void motionLoop() override final;
     void startCalibration(int calibrationType) override final;
+#if !MPU_USE_DMPMAG
+    SlimeVR::Sensors::SensorFusion *getSensorFusion() override final {
+        return &sfusion;
+    };
+#endif
     void getMPUScaled();
 
 private:
@@ -80,6 +86,10 @@ private:
     Quat correction{0, 0, 0, 0};
 
     SlimeVR::Configuration::MPU9250CalibrationConfig m_Calibration = {};
+    // raw accel and gyro counts to calibrated units, rebuilt when the calibration changes
+    SlimeVR::Sensors::SampleTransform gyroTransform;
+    SlimeVR::Sensors::SampleTransform accelTransform;
+    void updateSampleTransforms();
 
     // outputs to respective member variables
     void parseAccelData(int16_t data[3]);
@@ -34,8 +34,18 @@ void Sensor::setAcceleration(Vector3 a) {
     newAcceleration = true;
 }
 
+void Sensor::setTemperature(float t) {
+    pendingTemperature = t;
+    newTemperature = true;
+}
+
 void Sensor::setFusedRotation(Quat r) {
+    setFusedRotation(r, micros());
+}
+
+void Sensor::setFusedRotation(Quat r, uint32_t sampleMicros) {
     fusedRotation = r * sensorOffset;
+    fusedRotationMicros = sampleMicros;
     bool changed = OPTIMIZE_UPDATES ? !lastFusedRotationSent.equalsWithEpsilon(fusedRotation) : true;
     if (ENABLE_INSPECTION || changed) {
         newFusedRotation = true;
@@ -44,21 +54,72 @@ void Sensor::setFusedRotation(Quat r) {
 }
 
 void Sensor::sendData() {
+    SensorFrame frame;
+    if (takeNewData(frame)) {
+        sendFrame(frame);
+    }
+}
+
+bool Sensor::takeNewData(SensorFrame &frame) {
+    if (!newFusedRotation && !newTemperature) {
+        return false;
+    }
+    frame.sensorId = sensorId;
+    frame.calibrationAccuracy = calibrationAccuracy;
+    frame.hasRotation = newFusedRotation;
+    frame.rotation = fusedRotation;
+    frame.timestamp = fusedRotationMicros;
+    // acceleration waits for the rotation it's sent with
+    frame.hasAcceleration = newFusedRotation && newAcceleration;
+    frame.acceleration = acceleration;
+    frame.hasTemperature = newTemperature;
+    frame.temperature = pendingTemperature;
     if (newFusedRotation) {
-        newFusedRotation = false;
-        networkConnection.sendRotationData(sensorId, &fusedRotation, DATA_TYPE_NORMAL, calibrationAccuracy);
+        newAcceleration = false;
+    }
+    newFusedRotation = false;
+    newTemperature = false;
+    return true;
+}
 
+void Sensor::sendFrame(const SensorFrame &frame) {
+    if (frame.hasTemperature) {
+        networkConnection.sendTemperature(frame.sensorId, frame.temperature);
+    }
+    if (!frame.hasRotation) {
+        return;
+    }
+
+#if SEND_ACCELERATION
+    // The compact packets always carry an acceleration, the last one is still the current one
+    bool sentCompact = true;
+    if (networkConnection.canSendSampleTimestamps()) {
+        networkConnection.sendRotationAccelerationTimestamped(frame.sensorId, frame.rotation, frame.acceleration, frame.calibrationAccuracy, frame.timestamp);
+    } else if (networkConnection.supportsCompactRotationAcceleration()) {
+        networkConnection.sendRotationAccelerationCompact(frame.sensorId, frame.rotation, frame.acceleration, frame.calibrationAccuracy);
+    } else {
+        sentCompact = false;
+    }
+    if (sentCompact) {
 #ifdef DEBUG_SENSOR
-        m_Logger.trace("Quaternion: %f, %f, %f, %f", UNPACK_QUATERNION(fusedRotation));
+        m_Logger.trace("Quaternion: %f, %f, %f, %f", UNPACK_QUATERNION(frame.rotation));
+#endif
+        return;
+    }
 #endif
 
-#if SEND_ACCELERATION
-        if (newAcceleration) {
-            newAcceleration = false;
-            networkConnection.sendSensorAcceleration(sensorId, acceleration);
-        }
+    Quat rotation = frame.rotation;
+    networkConnection.sendRotationData(frame.sensorId, &rotation, DATA_TYPE_NORMAL, frame.calibrationAccuracy);
+
+#ifdef DEBUG_SENSOR
+    m_Logger.trace("Quaternion: %f, %f, %f, %f", UNPACK_QUATERNION(rotation));
 #endif
+
+#if SEND_ACCELERATION
+    if (frame.hasAcceleration) {
+        networkConnection.sendSensorAcceleration(frame.sensorId, frame.acceleration);
     }
+#endif
 }
 
 void Sensor::printTemperatureCalibrationUnsupported() {
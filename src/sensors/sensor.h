@@ -32,6 +32,13 @@
 #include "logging/Logger.h"
 #include "utils.h"
 
+namespace SlimeVR {
+    namespace Sensors {
+        class SensorFusion;
+        class SendRateScheduler;
+    }
+}
+
 #define DATA_TYPE_NORMAL 1
 #define DATA_TYPE_CORRECTION 2
 
@@ -41,6 +48,20 @@ enum class SensorStatus : uint8_t {
     SENSOR_ERROR = 2
 };
 
+// Data sendData() would send, handed from the sensor acquisition task to the main loop
+struct SensorFrame
+{
+    uint8_t sensorId = 0;
+    uint8_t calibrationAccuracy = 0;
+    bool hasRotation = false;
+    bool hasAcceleration = false;
+    bool hasTemperature = false;
+    uint32_t timestamp = 0;
+    Quat rotation{};
+    Vector3 acceleration{};
+    float temperature = 0.0f;
+};
+
 class Sensor
 {
 public:
@@ -58,9 +79,36 @@ public:
     virtual void postSetup(){};
     virtual void motionLoop(){};
     virtual void sendData();
+    // Split version of sendData() for the acquisition task: takeNewData() runs next to motionLoop(),
+    // sendFrame() on the main loop
+    bool takeNewData(SensorFrame &frame);
+    void sendFrame(const SensorFrame &frame);
+    // Sensors that send more than rotation, acceleration and temperature, or are driven from timers,
+    // keep everything on the main loop. Inspection packets are sent straight from motionLoop
+    virtual bool supportsAcquisitionTask() const {
+        return !ENABLE_INSPECTION;
+    };
     virtual void setAcceleration(Vector3 a);
     virtual void setFusedRotation(Quat r);
+    // For sensors that know when the IMU sample behind the rotation was taken (micros() time),
+    // setFusedRotation(r) stamps it with the current time
+    void setFusedRotation(Quat r, uint32_t sampleMicros);
+    // Sent with the next frame, motionLoop may run on the acquisition task and can't send it itself
+    void setTemperature(float t);
+    // Flash writes requested from motionLoop are done from the main loop, with the sensors locked
+    virtual bool hasDeferredWork() {
+        return false;
+    };
+    virtual void runDeferredWork(){};
     virtual void startCalibration(int calibrationType){};
+    // Sensors fusing in firmware expose it for SET FUSION, nullptr when fusion runs on the IMU
+    virtual SlimeVR::Sensors::SensorFusion *getSensorFusion() {
+        return nullptr;
+    };
+    // Sensors that adapt their rotation send rate to the motion, for telemetry
+    virtual const SlimeVR::Sensors::SendRateScheduler *getSendRateScheduler() const {
+        return nullptr;
+    };
     virtual SensorStatus getSensorState();
     virtual void printTemperatureCalibrationState();
     virtual void printDebugTemperatureCalibrationState();
@@ -75,6 +123,9 @@ public:
     bool isValid() {
         return sclPin != sdaPin;
     };
+    virtual bool usesI2C() const {
+        return true;
+    };
     uint8_t getSensorId() {
         return sensorId;
     };
@@ -88,7 +139,7 @@ public:
         return fusedRotation;
     };
     bool hasNewDataToSend() {
-        return newFusedRotation || newAcceleration;
+        return newFusedRotation || newAcceleration || newTemperature;
     };
 
 protected:
@@ -102,11 +153,15 @@ protected:
 
     bool newFusedRotation = false;
     Quat fusedRotation{};
+    uint32_t fusedRotationMicros = 0;
     Quat lastFusedRotationSent{};
 
     bool newAcceleration = false;
     Vector3 acceleration{};
 
+    bool newTemperature = false;
+    float pendingTemperature = 0.0f;
+
     mutable SlimeVR::Logging::Logger m_Logger;
     
 public:
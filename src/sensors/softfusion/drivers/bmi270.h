@@ -28,29 +28,59 @@
 #include <algorithm>
 #include <limits>
 #include "bmi270fw.h"
+#include "../registertable.h"
+#include "../profiles.h"
 
 namespace SlimeVR::Sensors::SoftFusion::Drivers
 {
 
 // Driver uses acceleration range at 16g
-// and gyroscope range at 1000dps
-// Gyroscope ODR = 400Hz, accel ODR = 100Hz
-// Timestamps reading are not used
+// and gyroscope range at 1000dps by default
+// Gyroscope ODR = 400Hz, accel ODR = 100Hz with the default profile
+// Sensor time register is used for clock sync, fifo sensortime frames are not used
 
-template <typename I2CImpl>
+template <typename I2CImpl, typename Profile = Profiles::Selected>
 struct BMI270
 {
     static constexpr uint8_t Address = 0x68;
     static constexpr auto Name = "BMI270";
     static constexpr auto Type = ImuID::BMI270;
 
-    static constexpr float GyrTs=1.0/400.0;
-    static constexpr float AccTs=1.0/100.0;
+    static constexpr std::array<Profiles::RateCode, 8> GyroRates{{
+        {25, 6}, {50, 7}, {100, 8}, {200, 9}, {400, 10}, {800, 11}, {1600, 12}, {3200, 13},
+    }};
+    // accel filter performance mode needs at least 12.5Hz
+    static constexpr std::array<Profiles::RateCode, 8> AccelRates{{
+        {12.5f, 5}, {25, 6}, {50, 7}, {100, 8}, {200, 9}, {400, 10}, {800, 11}, {1600, 12},
+    }};
+    static constexpr std::array<Profiles::RangeCode, 5> GyroRanges{{
+        {125, 4, 262.144f}, {250, 3, 131.072f}, {500, 2, 65.536f}, {1000, 1, 32.768f}, {2000, 0, 16.384f},
+    }};
+    static constexpr std::array<Profiles::RangeCode, 4> AccelRanges{{
+        {2, 0, 16384.0f}, {4, 1, 8192.0f}, {8, 2, 4096.0f}, {16, 3, 2048.0f},
+    }};
+    static constexpr auto GyroRate = Profiles::nearestRate(GyroRates, Profile::GyroOdrHz);
+    static constexpr auto AccelRate = Profiles::nearestRate(AccelRates, Profile::AccelOdrHz);
+    static constexpr auto GyroRange = Profiles::exactRange(GyroRanges, Profiles::gyroRangeDps<Profile>(1000));
+    static constexpr auto AccelRange = Profiles::exactRange(AccelRanges, Profiles::accelRangeG<Profile>(16));
+    static_assert(GyroRange.sensitivity > 0, "Gyro range not supported by BMI270");
+    static_assert(AccelRange.sensitivity > 0, "Accel range not supported by BMI270");
+
+    static constexpr float GyrTs=1.0/GyroRate.hz;
+    static constexpr float AccTs=1.0/AccelRate.hz;
 
     static constexpr float MagTs=1.0/100;
 
-    static constexpr float GyroSensitivity = 32.768f;
-    static constexpr float AccelSensitivity = 2048.0f;
+    static constexpr float GyroSensitivity = GyroRange.sensitivity;
+    static constexpr float AccelSensitivity = AccelRange.sensitivity;
+
+    // 24 bit sensor time, the gyro sample grid is aligned to it like on the BMI160
+    static constexpr float SensorTimeTickMicros = 39.0625f;
+    static constexpr uint32_t SensorTimeMask = 0xFFFFFF;
+    static constexpr bool SensorTimeAlignedToSamples = true;
+
+    // on SPI the first byte clocked out after the register address is a dummy
+    static constexpr uint8_t SPIReadDummyBytes = 1;
 
     struct MotionlessCalibrationData
     {
@@ -70,6 +100,7 @@ struct BMI270
             static constexpr uint8_t value = 0x24;
         };
         static constexpr uint8_t TempData = 0x22;
+        static constexpr uint8_t SensorTime = 0x18;
 
         struct Cmd {
             static constexpr uint8_t reg = 0x7e;
@@ -103,6 +134,12 @@ struct BMI270
         struct InternalStatus {
             static constexpr uint8_t reg = 0x21;
             static constexpr uint8_t initializedBit = 0x01;
+            static constexpr uint8_t messageMask = 0x0f;
+        };
+
+        struct Status {
+            static constexpr uint8_t reg = 0x03;
+            static constexpr uint8_t drdyAccGyr = (1 << 7) | (1 << 6);
         };
 
         struct GyrConf {
@@ -124,7 +161,7 @@ struct BMI270
             static constexpr uint8_t noisePerfMode = 1 << 6;
             static constexpr uint8_t filterHighPerfMode = 1 << 7;
 
-            static constexpr uint8_t value = rate400Hz | DLPFModeNorm | noisePerfMode | filterHighPerfMode;
+            static constexpr uint8_t value = GyroRate.code | DLPFModeNorm | noisePerfMode | filterHighPerfMode;
         };
 
         struct GyrRange {
@@ -136,7 +173,7 @@ struct BMI270
             static constexpr uint8_t range1000dps = 1;
             static constexpr uint8_t range2000dps = 0;
 
-            static constexpr uint8_t value = range1000dps;
+            static constexpr uint8_t value = GyroRange.code;
         };
 
         struct AccConf {
@@ -162,7 +199,7 @@ struct BMI270
 
             static constexpr uint8_t filterHighPerfMode = 1 << 7;
 
-            static constexpr uint8_t value = rate100Hz | DLPFModeAvg4 | filterHighPerfMode;
+            static constexpr uint8_t value = AccelRate.code | DLPFModeAvg4 | filterHighPerfMode;
         };
 
         struct AccRange {
@@ -173,7 +210,7 @@ struct BMI270
             static constexpr uint8_t range8G = 2;
             static constexpr uint8_t range16G = 3;
 
-            static constexpr uint8_t value = range16G;
+            static constexpr uint8_t value = AccelRange.code;
         };
 
         struct FifoConfig0 {
@@ -186,6 +223,24 @@ struct BMI270
             static constexpr uint8_t value = (1 << 4) | (1 << 6) | (1 << 7); // header en, acc en, gyr en
         };
 
+        static constexpr uint8_t FifoWtm0 = 0x46;
+        static constexpr uint8_t FifoWtm1 = 0x47;
+
+        struct Int1IoCtrl {
+            static constexpr uint8_t reg = 0x53;
+            static constexpr uint8_t value = (1 << 1) | (1 << 3); // active high, push-pull, output enabled
+        };
+
+        struct IntLatch {
+            static constexpr uint8_t reg = 0x55;
+            static constexpr uint8_t valueNonLatched = 0x0;
+        };
+
+        struct IntMapData {
+            static constexpr uint8_t reg = 0x58;
+            static constexpr uint8_t valueFwmInt1 = (1 << 1);
+        };
+
         struct GyrCrtConf {
             static constexpr uint8_t reg = 0x69;
             static constexpr uint8_t valueRunning = (1 << 2); // crt_running = 1
@@ -225,13 +280,34 @@ struct BMI270
         static constexpr uint8_t AccelDataBit = 0b00000100;
     };
 
+    // init data has to be written in whole words
+    static constexpr uint16_t FirmwareChunkSize = I2CImpl::MaxTransactionLength & ~1;
+
+    // acc and gyr config/range are consecutive and go out as one burst
+    static constexpr std::array<RegisterWrite, 4> SensorConfigTable{{
+        {Regs::AccConf::reg, Regs::AccConf::value},
+        {Regs::AccRange::reg, Regs::AccRange::value},
+        {Regs::GyrConf::reg, Regs::GyrConf::value},
+        {Regs::GyrRange::reg, Regs::GyrRange::value},
+    }};
+
+    static constexpr std::array<RegisterWrite, 2> FifoConfigTable{{
+        {Regs::FifoConfig0::reg, Regs::FifoConfig0::value},
+        {Regs::FifoConfig1::reg, Regs::FifoConfig1::value},
+    }};
+
     bool restartAndInit() {
         // perform initialization step
         i2c.writeReg(Regs::Cmd::reg, Regs::Cmd::valueSwReset);
-        delay(12);
+        // soft reset puts the interface back to I2C, any read switches it to SPI again (harmless on I2C),
+        // the chip id reads back correctly once the device finished booting
+        if (!waitForRegister(i2c, Regs::WhoAmI::reg, 0xff, Regs::WhoAmI::value, 12000)) {
+            logger.error("Soft reset timed out, CHIP_ID (0x%02x) reads 0x%02x", Regs::WhoAmI::reg, i2c.readReg(Regs::WhoAmI::reg));
+            return false;
+        }
         // disable power saving
         i2c.writeReg(Regs::PwrConf::reg, Regs::PwrConf::valueNoPowerSaving);
-        delay(1);
+        delayMicroseconds(450);
         
         // firmware upload
         i2c.writeReg(Regs::InitCtrl::reg, Regs::InitCtrl::valueStartInit);
@@ -247,22 +323,21 @@ struct BMI270
             const uint16_t position = (pos_words & 0x0F) | ((pos_words << 4) & 0xff00);
             i2c.writeReg16(Regs::InitAddr, position);
             // write actual payload chunk
-            const uint16_t burstWrite = std::min(sizeof(bmi270_firmware) - pos, I2CImpl::MaxTransactionLength);
+            const uint16_t burstWrite = std::min(sizeof(bmi270_firmware) - pos, static_cast<size_t>(FirmwareChunkSize));
             i2c.writeBytes(Regs::InitData, burstWrite, const_cast<uint8_t*>(bmi270_firmware + pos));
             pos += burstWrite;
         }
         i2c.writeReg(Regs::InitCtrl::reg, Regs::InitCtrl::valueEndInit);
-        delay(140);
-
-        // leave fifo_self_wakeup enabled
-        i2c.writeReg(Regs::PwrConf::reg, Regs::PwrConf::valueFifoSelfWakeup);
-        // check if IMU initialized correctly
-        if (!(i2c.readReg(Regs::InternalStatus::reg) & Regs::InternalStatus::initializedBit))
-        {
+        // the datasheet allows up to 140ms for the firmware to start
+        if (!waitForRegister(i2c, Regs::InternalStatus::reg, Regs::InternalStatus::messageMask, Regs::InternalStatus::initializedBit, 150000)) {
             // firmware upload fail or sensor not initialized
+            logger.error("Firmware start timed out, INTERNAL_STATUS (0x%02x) reads 0x%02x", Regs::InternalStatus::reg, i2c.readReg(Regs::InternalStatus::reg));
             return false;
         }
 
+        // leave fifo_self_wakeup enabled
+        i2c.writeReg(Regs::PwrConf::reg, Regs::PwrConf::valueFifoSelfWakeup);
+
         // read zx factor used to reduce gyro cross-sensitivity error
         const uint8_t zx_factor_reg = i2c.readReg(Regs::RaGyrCas);
         const uint8_t sign_byte = (zx_factor_reg << 1) & 0x80;
@@ -270,13 +345,9 @@ struct BMI270
         return true;
     }
 
-    void setNormalConfig(MotionlessCalibrationData &gyroSensitivity)
+    bool setNormalConfig(MotionlessCalibrationData &gyroSensitivity)
     {
-        i2c.writeReg(Regs::GyrConf::reg, Regs::GyrConf::value);
-        i2c.writeReg(Regs::GyrRange::reg, Regs::GyrRange::value);
-
-        i2c.writeReg(Regs::AccConf::reg, Regs::AccConf::value);
-        i2c.writeReg(Regs::AccRange::reg, Regs::AccRange::value);
+        writeRegisterTable(i2c, SensorConfigTable);
 
         if (gyroSensitivity.valid)
         {
@@ -285,13 +356,17 @@ struct BMI270
         }
 
         i2c.writeReg(Regs::PwrCtrl::reg, Regs::PwrCtrl::valueGyrAccTempOn);
-        delay(100); // power up delay
-        i2c.writeReg(Regs::FifoConfig0::reg, Regs::FifoConfig0::value);
-        i2c.writeReg(Regs::FifoConfig1::reg, Regs::FifoConfig1::value);
+        // power up, up to 100ms until both sensors deliver data
+        if (!waitForRegister(i2c, Regs::Status::reg, Regs::Status::drdyAccGyr, Regs::Status::drdyAccGyr, 100000)) {
+            logger.error("Power up timed out, STATUS (0x%02x) reads 0x%02x", Regs::Status::reg, i2c.readReg(Regs::Status::reg));
+            return false;
+        }
+        writeRegisterTable(i2c, FifoConfigTable);
 
         delay(4);
         i2c.writeReg(Regs::Cmd::reg, Regs::Cmd::valueFifoFlush);
         delay(2);
+        return true;
     }
 
     bool initialize(MotionlessCalibrationData &gyroSensitivity)
@@ -300,16 +375,16 @@ struct BMI270
             return false;
         }
 
-        setNormalConfig(gyroSensitivity);
-
-        return true;
+        return setNormalConfig(gyroSensitivity);
     }
 
     void motionlessCalibration(MotionlessCalibrationData &gyroSensitivity)
     {
         // perfrom gyroscope motionless sensitivity calibration (CRT)
         // need to start from clean state according to spec
-        restartAndInit();
+        if (!restartAndInit()) {
+            return;
+        }
         // only Accel ON
         i2c.writeReg(Regs::PwrCtrl::reg, Regs::PwrCtrl::valueAccOn);
         delay(100);
@@ -350,6 +425,26 @@ struct BMI270
         setNormalConfig(gyroSensitivity);
     }
 
+    // 2 gyro frames (header + 6 bytes each), ~5ms at 400Hz
+    static constexpr uint16_t FifoWatermarkBytes = 14;
+
+    void enableFifoInterrupt()
+    {
+        // soft reset clears these, so this is reapplied after motionlessCalibration
+        i2c.writeReg(Regs::FifoWtm0, FifoWatermarkBytes & 0xff);
+        i2c.writeReg(Regs::FifoWtm1, (FifoWatermarkBytes >> 8) & 0x1f);
+        i2c.writeReg(Regs::IntLatch::reg, Regs::IntLatch::valueNonLatched);
+        i2c.writeReg(Regs::Int1IoCtrl::reg, Regs::Int1IoCtrl::value);
+        i2c.writeReg(Regs::IntMapData::reg, Regs::IntMapData::valueFwmInt1);
+    }
+
+    uint32_t getSensorTime() const
+    {
+        uint8_t buffer[3];
+        i2c.readBytes(Regs::SensorTime, sizeof(buffer), buffer);
+        return buffer[0] | (buffer[1] << 8) | (static_cast<uint32_t>(buffer[2]) << 16);
+    }
+
     float getDirectTemp() const
     {
         // middle value is 23 degrees C (0x0000)
@@ -370,50 +465,67 @@ struct BMI270
         return to_ret;
     }
 
+    static constexpr uint32_t MaxFifoChunks = 32;
+
+    // reads at most maxChunks fifo transactions, returns true if data is still left in the fifo
     template <typename AccelCall, typename GyroCall>
-    void bulkRead(AccelCall &&processAccelSample, GyroCall &&processGyroSample) {
-        const auto fifo_bytes = i2c.readReg16(Regs::FifoCount);
-        
-        const auto bytes_to_read = std::min(static_cast<size_t>(read_buffer.size()),
-            static_cast<size_t>(fifo_bytes));
-        i2c.readBytes(Regs::FifoData, bytes_to_read, read_buffer.data());
-
-        for (uint32_t i=0u; i<bytes_to_read;) {
-            const uint8_t header = getFromFifo<uint8_t>(i, read_buffer);
-            if ((header & Fifo::ModeMask) == Fifo::SkipFrame && (i - bytes_to_read) >= 1) {
-                getFromFifo<uint8_t>(i, read_buffer); // skip 1 byte
+    bool bulkRead(AccelCall &&processAccelSample, GyroCall &&processGyroSample, uint32_t maxChunks = MaxFifoChunks) {
+        // re-read the count only if the backlog didn't fit in one transaction
+        for (uint32_t chunk = 0; chunk < maxChunks; chunk++) {
+            const auto fifo_bytes = i2c.readReg16(Regs::FifoCount);
+
+            const auto bytes_to_read = std::min(static_cast<size_t>(read_buffer.size()),
+                static_cast<size_t>(fifo_bytes));
+            if (bytes_to_read == 0) {
+                return false;
             }
-            else if ((header & Fifo::ModeMask) == Fifo::DataFrame) {
-                const uint8_t required_length = 
-                    (((header & Fifo::GyrDataBit) >> Fifo::GyrDataBit) +
-                    ((header & Fifo::AccelDataBit) >> Fifo::AccelDataBit)) * 6;
-                if (i - bytes_to_read < required_length) {
-                    // incomplete frame, will be re-read next time
-                    break;
-                }
-                if (header & Fifo::GyrDataBit) {
-                    int16_t gyro[3];
-                    gyro[0] = getFromFifo<uint16_t>(i, read_buffer);
-                    gyro[1] = getFromFifo<uint16_t>(i, read_buffer);
-                    gyro[2] = getFromFifo<uint16_t>(i, read_buffer);
-                    using ShortLimit = std::numeric_limits<int16_t>;
-                    // apply zx factor, todo: this awful line should be simplified and validated
-                    gyro[0] = std::clamp(static_cast<int32_t>(gyro[0]) - static_cast<int16_t>((static_cast<int32_t>(zxFactor) * gyro[2]) / 512),
-                                         static_cast<int32_t>(ShortLimit::min()), static_cast<int32_t>(ShortLimit::max()));
-                    processGyroSample(gyro, GyrTs);
-                }
+            i2c.readBytes(Regs::FifoData, bytes_to_read, read_buffer.data());
 
-                if (header & Fifo::AccelDataBit) {
-                    int16_t accel[3];
-                    accel[0] = getFromFifo<uint16_t>(i, read_buffer);
-                    accel[1] = getFromFifo<uint16_t>(i, read_buffer);
-                    accel[2] = getFromFifo<uint16_t>(i, read_buffer);
-                    processAccelSample(accel, AccTs);
+            for (uint32_t i=0u; i<bytes_to_read;) {
+                const uint8_t header = getFromFifo<uint8_t>(i, read_buffer);
+                if ((header & Fifo::ModeMask) == Fifo::SkipFrame && (bytes_to_read - i) >= 1) {
+                    getFromFifo<uint8_t>(i, read_buffer); // skip 1 byte
+                }
+                else if ((header & Fifo::ModeMask) == Fifo::DataFrame) {
+                    const uint8_t required_length =
+                        ((header & Fifo::GyrDataBit) ? 6 : 0) +
+                        ((header & Fifo::AccelDataBit) ? 6 : 0);
+                    if (bytes_to_read - i < required_length) {
+                        // incomplete frame at the end of the chunk, will be re-read by the next pass
+                        break;
+                    }
+                    if (header & Fifo::GyrDataBit) {
+                        int16_t gyro[3];
+                        gyro[0] = getFromFifo<uint16_t>(i, read_buffer);
+                        gyro[1] = getFromFifo<uint16_t>(i, read_buffer);
+                        gyro[2] = getFromFifo<uint16_t>(i, read_buffer);
+                        using ShortLimit = std::numeric_limits<int16_t>;
+                        // apply zx factor, todo: this awful line should be simplified and validated
+                        gyro[0] = std::clamp(static_cast<int32_t>(gyro[0]) - static_cast<int16_t>((static_cast<int32_t>(zxFactor) * gyro[2]) / 512),
+                                             static_cast<int32_t>(ShortLimit::min()), static_cast<int32_t>(ShortLimit::max()));
+                        processGyroSample(gyro, GyrTs);
+                    }
+
+                    if (header & Fifo::AccelDataBit) {
+                        int16_t accel[3];
+                        accel[0] = getFromFifo<uint16_t>(i, read_buffer);
+                        accel[1] = getFromFifo<uint16_t>(i, read_buffer);
+                        accel[2] = getFromFifo<uint16_t>(i, read_buffer);
+                        processAccelSample(accel, AccTs);
+                    }
                 }
             }
+            if (fifo_bytes <= read_buffer.size()) {
+                return false;
+            }
         }
+        return true;
     }
 
 };
 
+template <typename Profile>
+using BMI270ProfileCheck = BMI270<Profiles::NoBus, Profile>;
+static_assert(Profiles::supportsAllProfiles<BMI270ProfileCheck>());
+
 } // namespace
\ No newline at end of file
@@ -27,28 +27,57 @@
 #include <array>
 #include <algorithm>
 
+#include "../registertable.h"
+#include "../profiles.h"
+
 namespace SlimeVR::Sensors::SoftFusion::Drivers
 {
 
 // Driver uses acceleration range at 8g
-// and gyroscope range at 1000dps
-// Gyroscope ODR = 500Hz, accel ODR = 100Hz
-// Timestamps reading not used, as they're useless (constant predefined increment)
+// and gyroscope range at 1000dps by default
+// Gyroscope ODR = 500Hz, accel ODR = 100Hz with the default profile
+// Fifo timestamps are not used, as they're useless (constant predefined increment),
+// the free running TMST counter is latched and read for clock sync instead
 
-template <typename I2CImpl>
+template <typename I2CImpl, typename Profile = Profiles::Selected>
 struct ICM42688
 {
     static constexpr uint8_t Address = 0x68;
     static constexpr auto Name = "ICM-42688";
     static constexpr auto Type = ImuID::ICM42688;
 
-    static constexpr float GyrTs=1.0/500.0;
-    static constexpr float AccTs=1.0/100.0;
+    // ODR codes are shared by GYRO_CONFIG0 and ACCEL_CONFIG0
+    static constexpr std::array<Profiles::RateCode, 9> Rates{{
+        {25, 0b1010}, {50, 0b1001}, {100, 0b1000}, {200, 0b0111}, {500, 0b1111},
+        {1000, 0b0110}, {2000, 0b0101}, {4000, 0b0100}, {8000, 0b0011},
+    }};
+    static constexpr std::array<Profiles::RangeCode, 5> GyroRanges{{
+        {125, 0b100, 262.4f}, {250, 0b011, 131.2f}, {500, 0b010, 65.6f}, {1000, 0b001, 32.8f}, {2000, 0b000, 16.4f},
+    }};
+    static constexpr std::array<Profiles::RangeCode, 4> AccelRanges{{
+        {2, 0b11, 16384.0f}, {4, 0b10, 8192.0f}, {8, 0b01, 4096.0f}, {16, 0b00, 2048.0f},
+    }};
+    static constexpr auto GyroRate = Profiles::nearestRate(Rates, Profile::GyroOdrHz);
+    static constexpr auto AccelRate = Profiles::nearestRate(Rates, Profile::AccelOdrHz);
+    static constexpr auto GyroRange = Profiles::exactRange(GyroRanges, Profiles::gyroRangeDps<Profile>(1000));
+    static constexpr auto AccelRange = Profiles::exactRange(AccelRanges, Profiles::accelRangeG<Profile>(8));
+    static_assert(GyroRange.sensitivity > 0, "Gyro range not supported by ICM-42688");
+    static_assert(AccelRange.sensitivity > 0, "Accel range not supported by ICM-42688");
+    // fifo packets carry one gyro sample each, accel is marked invalid in between its samples
+    static_assert(AccelRate.hz <= GyroRate.hz, "ICM-42688 fifo handling needs accel ODR <= gyro ODR");
+
+    static constexpr float GyrTs=1.0/GyroRate.hz;
+    static constexpr float AccTs=1.0/AccelRate.hz;
 
     static constexpr float MagTs=1.0/100;
 
-    static constexpr float GyroSensitivity = 32.8f;
-    static constexpr float AccelSensitivity = 4096.0f;
+    // 20 bit timestamp counter at 1us, runs from the same oscillator as the ODR
+    static constexpr float SensorTimeTickMicros = 1.0f;
+    static constexpr uint32_t SensorTimeMask = 0xFFFFF;
+    static constexpr bool SensorTimeAlignedToSamples = false;
+
+    static constexpr float GyroSensitivity = GyroRange.sensitivity;
+    static constexpr float AccelSensitivity = AccelRange.sensitivity;
 
     I2CImpl i2c;
     SlimeVR::Logging::Logger &logger;
@@ -80,11 +109,11 @@ struct ICM42688
         };
         struct GyroConfig {
             static constexpr uint8_t reg = 0x4f;
-            static constexpr uint8_t value = (0b001 << 5) | 0b1111; //1000dps, odr=500Hz
+            static constexpr uint8_t value = (GyroRange.code << 5) | GyroRate.code; //1000dps, odr=500Hz by default
         };
         struct AccelConfig {
             static constexpr uint8_t reg = 0x50;
-            static constexpr uint8_t value = (0b001 << 5) | 0b1000; //8g, odr = 100Hz
+            static constexpr uint8_t value = (AccelRange.code << 5) | AccelRate.code; //8g, odr = 100Hz by default
         };
         struct PwrMgmt {
             static constexpr uint8_t reg = 0x4e;
@@ -96,6 +125,40 @@ struct ICM42688
         //GYRO_ACCEL_CONFIG0
         //ACCEL_CONFIG1
 
+        struct IntConfig {
+            static constexpr uint8_t reg = 0x14;
+            static constexpr uint8_t value = (1 << 0) | (1 << 1) | (1 << 2); //INT1 active high, push-pull, latched
+        };
+        struct IntConfig1 {
+            static constexpr uint8_t reg = 0x64;
+            static constexpr uint8_t value = 0; //INT_ASYNC_RESET = 0, required for INT1 operation
+        };
+        struct IntSource0 {
+            static constexpr uint8_t reg = 0x65;
+            static constexpr uint8_t value = (1 << 2); //FIFO threshold routed to INT1
+        };
+        struct FifoConfig1Watermark {
+            static constexpr uint8_t reg = 0x5f;
+            static constexpr uint8_t value = FifoConfig1::value | (1 << 5); //keep asserting while fifo count >= watermark
+        };
+        static constexpr uint8_t FifoConfig2 = 0x60; // watermark, LSB
+        static constexpr uint8_t FifoConfig3 = 0x61; // watermark, MSB
+        struct IntStatus {
+            static constexpr uint8_t reg = 0x2d;
+            static constexpr uint8_t resetDone = (1 << 4);
+        };
+
+        struct SignalPathReset {
+            static constexpr uint8_t reg = 0x4b;
+            static constexpr uint8_t valueTmstStrobe = (1 << 2); //latch timestamp counter into TMSTVAL
+        };
+        struct RegBankSel {
+            static constexpr uint8_t reg = 0x76;
+            static constexpr uint8_t bank0 = 0;
+            static constexpr uint8_t bank1 = 1;
+        };
+        static constexpr uint8_t TmstVal = 0x62; // bank 1
+
         static constexpr uint8_t FifoCount = 0x2e;
         static constexpr uint8_t FifoData = 0x30;
     };
@@ -116,23 +179,61 @@ struct ICM42688
 
     static constexpr size_t FullFifoEntrySize = 16;
 
+    // sensors are powered on last, gyro and accel config go out as one burst
+    static constexpr std::array<RegisterWrite, 6> InitTable{{
+        {Regs::IntfConfig0::reg, Regs::IntfConfig0::value},
+        {Regs::GyroConfig::reg, Regs::GyroConfig::value},
+        {Regs::AccelConfig::reg, Regs::AccelConfig::value},
+        {Regs::FifoConfig0::reg, Regs::FifoConfig0::value},
+        {Regs::FifoConfig1::reg, Regs::FifoConfig1::value},
+        {Regs::PwrMgmt::reg, Regs::PwrMgmt::value},
+    }};
+
     bool initialize()
     {
         // perform initialization step
         i2c.writeReg(Regs::DeviceConfig::reg, Regs::DeviceConfig::valueSwReset);
-        delay(20);
+        if (!waitForRegister(i2c, Regs::IntStatus::reg, Regs::IntStatus::resetDone, Regs::IntStatus::resetDone, 20000)) {
+            logger.error("Soft reset timed out, INT_STATUS (0x%02x) never reported RESET_DONE", Regs::IntStatus::reg);
+            return false;
+        }
 
-        i2c.writeReg(Regs::IntfConfig0::reg, Regs::IntfConfig0::value);
-        i2c.writeReg(Regs::GyroConfig::reg, Regs::GyroConfig::value);
-        i2c.writeReg(Regs::AccelConfig::reg, Regs::AccelConfig::value);
-        i2c.writeReg(Regs::FifoConfig0::reg, Regs::FifoConfig0::value);
-        i2c.writeReg(Regs::FifoConfig1::reg, Regs::FifoConfig1::value);
-        i2c.writeReg(Regs::PwrMgmt::reg, Regs::PwrMgmt::value);
-        delay(1);
+        writeRegisterTable(i2c, InitTable);
+        // no register writes for 200us after the gyro is switched on
+        delayMicroseconds(200);
 
         return true;
     }
 
+    // 2 fifo entries = 4ms of gyro data
+    static constexpr uint16_t FifoWatermarkBytes = FullFifoEntrySize * 2;
+
+    void enableFifoInterrupt()
+    {
+        i2c.writeReg(Regs::IntConfig::reg, Regs::IntConfig::value);
+        i2c.writeReg(Regs::IntConfig1::reg, Regs::IntConfig1::value);
+        i2c.writeReg(Regs::FifoConfig2, FifoWatermarkBytes & 0xff);
+        i2c.writeReg(Regs::FifoConfig3, FifoWatermarkBytes >> 8);
+        i2c.writeReg(Regs::FifoConfig1Watermark::reg, Regs::FifoConfig1Watermark::value);
+        i2c.writeReg(Regs::IntSource0::reg, Regs::IntSource0::value);
+    }
+
+    void ackFifoInterrupt()
+    {
+        // latched interrupt is cleared by reading the status register
+        i2c.readReg(Regs::IntStatus::reg);
+    }
+
+    uint32_t getSensorTime() const
+    {
+        uint8_t buffer[3];
+        i2c.writeReg(Regs::SignalPathReset::reg, Regs::SignalPathReset::valueTmstStrobe);
+        i2c.writeReg(Regs::RegBankSel::reg, Regs::RegBankSel::bank1);
+        i2c.readBytes(Regs::TmstVal, sizeof(buffer), buffer);
+        i2c.writeReg(Regs::RegBankSel::reg, Regs::RegBankSel::bank0);
+        return buffer[0] | (buffer[1] << 8) | (static_cast<uint32_t>(buffer[2] & 0x0f) << 16);
+    }
+
     float getDirectTemp() const
     {
         const auto value = static_cast<int16_t>(i2c.readReg16(Regs::TempData));
@@ -140,25 +241,41 @@ struct ICM42688
         return result;
     }
 
+    static constexpr uint32_t MaxFifoChunks = 32;
+
+    // reads at most maxChunks fifo transactions, returns true if data is still left in the fifo
     template <typename AccelCall, typename GyroCall>
-    void bulkRead(AccelCall &&processAccelSample, GyroCall &&processGyroSample) {
-        const auto fifo_bytes = i2c.readReg16(Regs::FifoCount);
-        
-        std::array<uint8_t, FullFifoEntrySize * 8> read_buffer; // max 8 readings
-        const auto bytes_to_read = std::min(static_cast<size_t>(read_buffer.size()),
-            static_cast<size_t>(fifo_bytes)) / FullFifoEntrySize * FullFifoEntrySize;
-        i2c.readBytes(Regs::FifoData, bytes_to_read, read_buffer.data());
-        for (auto i=0u; i<bytes_to_read; i+=FullFifoEntrySize) {
-            FifoEntryAligned entry;
-            memcpy(entry.raw, &read_buffer[i+0x1], sizeof(FifoEntryAligned)); // skip fifo header
-            processGyroSample(entry.part.gyro, GyrTs);
-
-            if (entry.part.accel[0] != -32768) {
-                processAccelSample(entry.part.accel, AccTs);
-            }            
-        }      
+    bool bulkRead(AccelCall &&processAccelSample, GyroCall &&processGyroSample, uint32_t maxChunks = MaxFifoChunks) {
+        // re-read the count only if the backlog didn't fit in one transaction
+        std::array<uint8_t, I2CImpl::MaxTransactionLength / FullFifoEntrySize * FullFifoEntrySize> read_buffer;
+        for (uint32_t chunk = 0; chunk < maxChunks; chunk++) {
+            const auto fifo_bytes = i2c.readReg16(Regs::FifoCount);
+            const auto bytes_to_read = std::min(static_cast<size_t>(read_buffer.size()),
+                static_cast<size_t>(fifo_bytes)) / FullFifoEntrySize * FullFifoEntrySize;
+            if (bytes_to_read == 0) {
+                return false;
+            }
+            i2c.readBytes(Regs::FifoData, bytes_to_read, read_buffer.data());
+            for (auto i=0u; i<bytes_to_read; i+=FullFifoEntrySize) {
+                FifoEntryAligned entry;
+                memcpy(entry.raw, &read_buffer[i+0x1], sizeof(FifoEntryAligned)); // skip fifo header
+                processGyroSample(entry.part.gyro, GyrTs);
+
+                if (entry.part.accel[0] != -32768) {
+                    processAccelSample(entry.part.accel, AccTs);
+                }
+            }
+            if (fifo_bytes <= read_buffer.size()) {
+                return false;
+            }
+        }
+        return true;
     }
 
 };
 
+template <typename Profile>
+using ICM42688ProfileCheck = ICM42688<Profiles::NoBus, Profile>;
+static_assert(Profiles::supportsAllProfiles<ICM42688ProfileCheck>());
+
 } // namespace
\ No newline at end of file
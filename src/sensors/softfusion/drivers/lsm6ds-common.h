@@ -27,9 +27,28 @@
 #include <array>
 #include <algorithm>
 
+#include "../registertable.h"
+#include "../profiles.h"
+
 namespace SlimeVR::Sensors::SoftFusion::Drivers
 {
 
+// ODR and full scale encodings shared by LSM6DSO, LSM6DSR and LSM6DS3TR-C
+// range codes are already shifted into place for CTRL1_XL/CTRL2_G, rate codes go to the upper nibble
+struct LSM6DSCodes
+{
+    static constexpr std::array<Profiles::RateCode, 10> Rates{{
+        {12.5f, 1}, {26, 2}, {52, 3}, {104, 4}, {208, 5}, {416, 6}, {833, 7}, {1666, 8}, {3332, 9}, {6664, 10},
+    }};
+    static constexpr std::array<Profiles::RangeCode, 5> GyroRanges{{
+        {125, 0b0010, 1000 / 4.375f}, {250, 0b0000, 1000 / 8.75f}, {500, 0b0100, 1000 / 17.5f},
+        {1000, 0b1000, 1000 / 35.0f}, {2000, 0b1100, 1000 / 70.0f},
+    }};
+    static constexpr std::array<Profiles::RangeCode, 4> AccelRanges{{
+        {2, 0b0000, 1000 / 0.061f}, {4, 0b1000, 1000 / 0.122f}, {8, 0b1100, 1000 / 0.244f}, {16, 0b0100, 1000 / 0.488f},
+    }};
+};
+
 template <typename I2CImpl>
 struct LSM6DSOutputHandler
 {
@@ -49,6 +68,34 @@ struct LSM6DSOutputHandler
         return result;
     }
 
+    template<typename Regs>
+    bool softReset()
+    {
+        i2c.writeReg(Regs::Ctrl3C::reg, Regs::Ctrl3C::valueSwReset);
+        // done once SW_RESET cleared itself and IF_INC is back at its default
+        if (!waitForRegister(i2c, Regs::Ctrl3C::reg, Regs::Ctrl3C::valueSwReset | Regs::Ctrl3C::defaultIfInc, Regs::Ctrl3C::defaultIfInc, 20000)) {
+            logger.error("Soft reset timed out, CTRL3_C (0x%02x) reads 0x%02x", Regs::Ctrl3C::reg, i2c.readReg(Regs::Ctrl3C::reg));
+            return false;
+        }
+        return true;
+    }
+
+    template<typename Regs>
+    uint32_t getSensorTime() const
+    {
+        uint8_t buffer[4];
+        i2c.readBytes(Regs::Timestamp0, sizeof(buffer), buffer);
+        return buffer[0] | (buffer[1] << 8) | (buffer[2] << 16) | (static_cast<uint32_t>(buffer[3]) << 24);
+    }
+
+    template<typename Regs>
+    void enableFifoInterrupt(uint8_t watermarkEntries)
+    {
+        // INT1 is push-pull, active high by default; the fifo threshold flag stays set while the fifo is above watermark
+        i2c.writeReg(Regs::FifoCtrl1WTM, watermarkEntries);
+        i2c.writeReg(Regs::Int1Ctrl::reg, Regs::Int1Ctrl::valueFifoTh);
+    }
+
     #pragma pack(push, 1)
     struct FifoEntryAligned {
         union {
@@ -60,37 +107,50 @@ struct LSM6DSOutputHandler
 
     static constexpr size_t FullFifoEntrySize = sizeof(FifoEntryAligned) + 1;
 
+    static constexpr uint32_t MaxFifoChunks = 32;
+
+    // reads at most maxChunks fifo transactions, returns true if data is still left in the fifo
     template <typename AccelCall, typename GyroCall, typename Regs>
-    void bulkRead(AccelCall &processAccelSample, GyroCall &processGyroSample, float GyrTs, float AccTs) {
+    bool bulkRead(AccelCall &processAccelSample, GyroCall &processGyroSample, float GyrTs, float AccTs, uint32_t maxChunks = MaxFifoChunks) {
         constexpr auto FIFO_SAMPLES_MASK = 0x3ff;
         constexpr auto FIFO_OVERRUN_LATCHED_MASK = 0x800;
-        
-        const auto fifo_status = i2c.readReg16(Regs::FifoStatus);
-        const auto available_axes = fifo_status & FIFO_SAMPLES_MASK;
-        const auto fifo_bytes = available_axes * FullFifoEntrySize;
-        if (fifo_status & FIFO_OVERRUN_LATCHED_MASK) {
-            // FIFO overrun is expected to happen during startup and calibration
-            logger.error("FIFO OVERRUN! This occuring during normal usage is an issue.");
-        }
-        
-        std::array<uint8_t, FullFifoEntrySize * 8> read_buffer; // max 8 readings
-        const auto bytes_to_read = std::min(static_cast<size_t>(read_buffer.size()),
-            static_cast<size_t>(fifo_bytes)) / FullFifoEntrySize * FullFifoEntrySize;
-        i2c.readBytes(Regs::FifoData, bytes_to_read, read_buffer.data());
-        for (auto i=0u; i<bytes_to_read; i+=FullFifoEntrySize) {
-            FifoEntryAligned entry;
-            uint8_t tag = read_buffer[i] >> 3;
-            memcpy(entry.raw, &read_buffer[i+0x1], sizeof(FifoEntryAligned)); // skip fifo header
-
-            switch (tag) {
-                case 0x01: // Gyro NC
-                    processGyroSample(entry.xyz, GyrTs);
-                    break;
-                case 0x02: // Accel NC
-                    processAccelSample(entry.xyz, AccTs);
-                    break;
+        // re-read the status only if the backlog didn't fit in one transaction
+
+        std::array<uint8_t, I2CImpl::MaxTransactionLength / FullFifoEntrySize * FullFifoEntrySize> read_buffer;
+        for (uint32_t chunk = 0; chunk < maxChunks; chunk++) {
+            const auto fifo_status = i2c.readReg16(Regs::FifoStatus);
+            const auto available_axes = fifo_status & FIFO_SAMPLES_MASK;
+            const auto fifo_bytes = available_axes * FullFifoEntrySize;
+            if (fifo_status & FIFO_OVERRUN_LATCHED_MASK) {
+                // FIFO overrun is expected to happen during startup and calibration
+                logger.error("FIFO OVERRUN! This occuring during normal usage is an issue.");
+            }
+
+            const auto bytes_to_read = std::min(static_cast<size_t>(read_buffer.size()),
+                static_cast<size_t>(fifo_bytes)) / FullFifoEntrySize * FullFifoEntrySize;
+            if (bytes_to_read == 0) {
+                return false;
             }
-        }      
+            i2c.readBytes(Regs::FifoData, bytes_to_read, read_buffer.data());
+            for (auto i=0u; i<bytes_to_read; i+=FullFifoEntrySize) {
+                FifoEntryAligned entry;
+                uint8_t tag = read_buffer[i] >> 3;
+                memcpy(entry.raw, &read_buffer[i+0x1], sizeof(FifoEntryAligned)); // skip fifo header
+
+                switch (tag) {
+                    case 0x01: // Gyro NC
+                        processGyroSample(entry.xyz, GyrTs);
+                        break;
+                    case 0x02: // Accel NC
+                        processAccelSample(entry.xyz, AccTs);
+                        break;
+                }
+            }
+            if (fifo_bytes <= read_buffer.size()) {
+                return false;
+            }
+        }
+        return true;
     }
 
 
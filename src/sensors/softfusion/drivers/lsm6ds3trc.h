@@ -27,28 +27,45 @@
 #include <array>
 #include <algorithm>
 
+#include "../registertable.h"
+#include "lsm6ds-common.h"
+
 namespace SlimeVR::Sensors::SoftFusion::Drivers
 {
 
 // Driver uses acceleration range at 8g
-// and gyroscope range at 1000dps
-// Gyroscope ODR = 416Hz, accel ODR = 416Hz
+// and gyroscope range at 1000dps by default
+// Gyroscope ODR = 416Hz, accel ODR = 416Hz with the default profile,
+// the fifo is read as gyro+accel pairs so accel always follows the profile's gyro ODR
 
-template <typename I2CImpl>
+template <typename I2CImpl, typename Profile = Profiles::Selected>
 struct LSM6DS3TRC
 {
     static constexpr uint8_t Address = 0x6a;
     static constexpr auto Name = "LSM6DS3TR-C";
     static constexpr auto Type = ImuID::LSM6DS3TRC;
 
-    static constexpr float Freq = 416;
+    static constexpr auto Rate = Profiles::nearestRate(LSM6DSCodes::Rates, Profile::GyroOdrHz);
+    static constexpr auto GyroRange = Profiles::exactRange(LSM6DSCodes::GyroRanges, Profiles::gyroRangeDps<Profile>(1000));
+    static constexpr auto AccelRange = Profiles::exactRange(LSM6DSCodes::AccelRanges, Profiles::accelRangeG<Profile>(8));
+    static_assert(GyroRange.sensitivity > 0, "Gyro range not supported by LSM6DS3TR-C");
+    static_assert(AccelRange.sensitivity > 0, "Accel range not supported by LSM6DS3TR-C");
+    // fifo runs one ODR step above the sensors
+    static constexpr uint8_t FifoRateCode = std::min<uint8_t>(Rate.code + 1, 10);
+
+    static constexpr float Freq = Rate.hz;
 
     static constexpr float GyrTs=1.0/Freq;
     static constexpr float AccTs=1.0/Freq;
     static constexpr float MagTs=1.0/Freq;
 
-    static constexpr float GyroSensitivity = 28.571428571f;
-    static constexpr float AccelSensitivity = 4098.360655738f;
+    // 24 bit timestamp counter in high resolution mode, 25us per LSB
+    static constexpr float SensorTimeTickMicros = 25.0f;
+    static constexpr uint32_t SensorTimeMask = 0xFFFFFF;
+    static constexpr bool SensorTimeAlignedToSamples = false;
+
+    static constexpr float GyroSensitivity = GyroRange.sensitivity;
+    static constexpr float AccelSensitivity = AccelRange.sensitivity;
 
     I2CImpl i2c;
     SlimeVR::Logging::Logger logger;
@@ -63,15 +80,16 @@ struct LSM6DS3TRC
         static constexpr uint8_t OutTemp = 0x20;
         struct Ctrl1XL {
             static constexpr uint8_t reg = 0x10;
-            static constexpr uint8_t value = (0b11 << 2) | (0b0110 << 4); //8g, 416Hz
+            static constexpr uint8_t value = AccelRange.code | (Rate.code << 4); //8g, 416Hz by default
         };
         struct Ctrl2G {
             static constexpr uint8_t reg = 0x11;
-            static constexpr uint8_t value = (0b10 << 2) | (0b0110 << 4); //1000dps, 416Hz
+            static constexpr uint8_t value = GyroRange.code | (Rate.code << 4); //1000dps, 416Hz by default
         };
         struct Ctrl3C {
             static constexpr uint8_t reg = 0x12;
             static constexpr uint8_t valueSwReset = 1;
+            static constexpr uint8_t defaultIfInc = (1 << 2);
             static constexpr uint8_t value = (1 << 6) | (1 << 2); //BDU = 1, IF_INC = 1
         };
         struct FifoCtrl3 {
@@ -80,26 +98,70 @@ struct LSM6DS3TRC
         };
         struct FifoCtrl5 {
             static constexpr uint8_t reg = 0x0a;
-            static constexpr uint8_t value = 0b110 | (0b0111 << 3); //continuous mode, odr = 833Hz
+            static constexpr uint8_t value = 0b110 | (FifoRateCode << 3); //continuous mode, odr = 833Hz by default
         };
 
+        struct FifoCtrl1 {
+            static constexpr uint8_t reg = 0x06; //FTH[7:0]
+        };
+        struct FifoCtrl2 {
+            static constexpr uint8_t reg = 0x07; //FTH[10:8]
+        };
+        struct Int1Ctrl {
+            static constexpr uint8_t reg = 0x0d;
+            static constexpr uint8_t valueFifoTh = (1 << 3); //INT1_FTH
+        };
+        struct Ctrl10C {
+            static constexpr uint8_t reg = 0x19;
+            static constexpr uint8_t value = (1 << 5); //TIMER_EN
+        };
+        struct WakeUpDur {
+            static constexpr uint8_t reg = 0x5c;
+            static constexpr uint8_t value = (1 << 4); //TIMER_HR, 25us resolution
+        };
+        static constexpr uint8_t Timestamp0 = 0x40;
+
         static constexpr uint8_t FifoStatus = 0x3a;
         static constexpr uint8_t FifoData = 0x3e;
     };
 
+    // CTRL1..3 go out as one burst
+    static constexpr std::array<RegisterWrite, 7> InitTable{{
+        {Regs::Ctrl1XL::reg, Regs::Ctrl1XL::value},
+        {Regs::Ctrl2G::reg, Regs::Ctrl2G::value},
+        {Regs::Ctrl3C::reg, Regs::Ctrl3C::value},
+        {Regs::FifoCtrl3::reg, Regs::FifoCtrl3::value},
+        {Regs::FifoCtrl5::reg, Regs::FifoCtrl5::value},
+        {Regs::WakeUpDur::reg, Regs::WakeUpDur::value},
+        {Regs::Ctrl10C::reg, Regs::Ctrl10C::value},
+    }};
+
     bool initialize()
     {
         // perform initialization step
         i2c.writeReg(Regs::Ctrl3C::reg, Regs::Ctrl3C::valueSwReset);
-        delay(20);
-        i2c.writeReg(Regs::Ctrl1XL::reg, Regs::Ctrl1XL::value);
-        i2c.writeReg(Regs::Ctrl2G::reg, Regs::Ctrl2G::value);
-        i2c.writeReg(Regs::Ctrl3C::reg, Regs::Ctrl3C::value);
-        i2c.writeReg(Regs::FifoCtrl3::reg, Regs::FifoCtrl3::value);
-        i2c.writeReg(Regs::FifoCtrl5::reg, Regs::FifoCtrl5::value);
+        // done once SW_RESET cleared itself and IF_INC is back at its default
+        if (!waitForRegister(i2c, Regs::Ctrl3C::reg, Regs::Ctrl3C::valueSwReset | Regs::Ctrl3C::defaultIfInc, Regs::Ctrl3C::defaultIfInc, 20000)) {
+            logger.error("Soft reset timed out, CTRL3_C (0x%02x) reads 0x%02x", Regs::Ctrl3C::reg, i2c.readReg(Regs::Ctrl3C::reg));
+            return false;
+        }
+        writeRegisterTable(i2c, InitTable);
         return true;
     }
 
+    // in 16bit words, 2 gyro+accel sets = ~4.8ms
+    static constexpr uint16_t FifoWatermarkWords = 6 * 2;
+
+    void enableFifoInterrupt()
+    {
+        // INT1 is push-pull, active high by default; FTH stays set while the fifo is above watermark
+        i2c.writeReg(Regs::FifoCtrl1::reg, FifoWatermarkWords & 0xff);
+        // FTH[10:8] shares FIFO_CTRL2 with the temperature and pedometer FIFO enables
+        const uint8_t fifoCtrl2 = i2c.readReg(Regs::FifoCtrl2::reg);
+        i2c.writeReg(Regs::FifoCtrl2::reg, (fifoCtrl2 & ~0x07) | ((FifoWatermarkWords >> 8) & 0x07));
+        i2c.writeReg(Regs::Int1Ctrl::reg, Regs::Int1Ctrl::valueFifoTh);
+    }
+
     float getDirectTemp() const
     {
         const auto value = static_cast<int16_t>(i2c.readReg16(Regs::OutTemp));
@@ -108,32 +170,56 @@ struct LSM6DS3TRC
         return result;
     }
 
+    uint32_t getSensorTime() const
+    {
+        uint8_t buffer[3];
+        i2c.readBytes(Regs::Timestamp0, sizeof(buffer), buffer);
+        return buffer[0] | (buffer[1] << 8) | (static_cast<uint32_t>(buffer[2]) << 16);
+    }
+
+    static constexpr uint32_t MaxFifoChunks = 32;
+
+    // reads at most maxChunks fifo transactions, returns true if data is still left in the fifo
     template <typename AccelCall, typename GyroCall>
-    void bulkRead(AccelCall &&processAccelSample, GyroCall &&processGyroSample) {
-        const auto read_result = i2c.readReg16(Regs::FifoStatus);
-        if (read_result & 0x4000) { // overrun!
-            // disable and re-enable fifo to clear it
-            logger.debug("Fifo overrun, resetting...");
-            i2c.writeReg(Regs::FifoCtrl5::reg, 0);
-            i2c.writeReg(Regs::FifoCtrl5::reg, Regs::FifoCtrl5::value);
-            return;
-        }
-        const auto unread_entries = read_result & 0x7ff;
+    bool bulkRead(AccelCall &&processAccelSample, GyroCall &&processGyroSample, uint32_t maxChunks = MaxFifoChunks) {
         constexpr auto single_measurement_words = 6;
         constexpr auto single_measurement_bytes = sizeof(uint16_t) * single_measurement_words;
-        
-        std::array<int16_t, 60> read_buffer; // max 10 packages of 6 16bit values of data form fifo
-        const auto bytes_to_read = std::min(static_cast<size_t>(read_buffer.size()), static_cast<size_t>(unread_entries)) \
-                     * sizeof(uint16_t) / single_measurement_bytes * single_measurement_bytes;
-
-        i2c.readBytes(Regs::FifoData, bytes_to_read, reinterpret_cast<uint8_t *>(read_buffer.data()));
-        for (uint16_t i=0; i<bytes_to_read/sizeof(uint16_t); i+=single_measurement_words) {
-            processGyroSample(reinterpret_cast<const int16_t *>(&read_buffer[i]), GyrTs);
-            processAccelSample(reinterpret_cast<const int16_t *>(&read_buffer[i+3]), AccTs);
+        // re-read the status only if the backlog didn't fit in one transaction
+
+        std::array<int16_t, I2CImpl::MaxTransactionLength / single_measurement_bytes * single_measurement_words> read_buffer;
+        for (uint32_t chunk = 0; chunk < maxChunks; chunk++) {
+            const auto read_result = i2c.readReg16(Regs::FifoStatus);
+            if (read_result & 0x4000) { // overrun!
+                // disable and re-enable fifo to clear it
+                logger.debug("Fifo overrun, resetting...");
+                i2c.writeReg(Regs::FifoCtrl5::reg, 0);
+                i2c.writeReg(Regs::FifoCtrl5::reg, Regs::FifoCtrl5::value);
+                return false;
+            }
+            const auto unread_entries = read_result & 0x7ff;
+            const auto bytes_to_read = std::min(static_cast<size_t>(read_buffer.size()), static_cast<size_t>(unread_entries)) \
+                        * sizeof(uint16_t) / single_measurement_bytes * single_measurement_bytes;
+            if (bytes_to_read == 0) {
+                return false;
+            }
+
+            i2c.readBytes(Regs::FifoData, bytes_to_read, reinterpret_cast<uint8_t *>(read_buffer.data()));
+            for (uint16_t i=0; i<bytes_to_read/sizeof(uint16_t); i+=single_measurement_words) {
+                processGyroSample(reinterpret_cast<const int16_t *>(&read_buffer[i]), GyrTs);
+                processAccelSample(reinterpret_cast<const int16_t *>(&read_buffer[i+3]), AccTs);
+            }
+            if (unread_entries <= read_buffer.size()) {
+                return false;
+            }
         }
+        return true;
     }
 
 
 };
 
+template <typename Profile>
+using LSM6DS3TRCProfileCheck = LSM6DS3TRC<Profiles::NoBus, Profile>;
+static_assert(Profiles::supportsAllProfiles<LSM6DS3TRCProfileCheck>());
+
 } // namespace
\ No newline at end of file
@@ -33,28 +33,41 @@ namespace SlimeVR::Sensors::SoftFusion::Drivers
 {
 
 // Driver uses acceleration range at 8g
-// and gyroscope range at 1000dps
-// Gyroscope ODR = 416Hz, accel ODR = 104Hz
+// and gyroscope range at 1000dps by default
+// Gyroscope ODR = 416Hz, accel ODR = 104Hz with the default profile
 
-template <typename I2CImpl>
+template <typename I2CImpl, typename Profile = Profiles::Selected>
 struct LSM6DSO : LSM6DSOutputHandler<I2CImpl>
 {
     static constexpr uint8_t Address = 0x6a;
     static constexpr auto Name = "LSM6DSO";
     static constexpr auto Type = ImuID::LSM6DSO;
 
-    static constexpr float GyrFreq = 416;
-    static constexpr float AccFreq = 104;
+    static constexpr auto GyroRate = Profiles::nearestRate(LSM6DSCodes::Rates, Profile::GyroOdrHz);
+    static constexpr auto AccelRate = Profiles::nearestRate(LSM6DSCodes::Rates, Profile::AccelOdrHz);
+    static constexpr auto GyroRange = Profiles::exactRange(LSM6DSCodes::GyroRanges, Profiles::gyroRangeDps<Profile>(1000));
+    static constexpr auto AccelRange = Profiles::exactRange(LSM6DSCodes::AccelRanges, Profiles::accelRangeG<Profile>(8));
+    static_assert(GyroRange.sensitivity > 0, "Gyro range not supported by LSM6DSO");
+    static_assert(AccelRange.sensitivity > 0, "Accel range not supported by LSM6DSO");
+
+    static constexpr float GyrFreq = GyroRate.hz;
+    static constexpr float AccFreq = AccelRate.hz;
     static constexpr float MagFreq = 120;
 
     static constexpr float GyrTs=1.0/GyrFreq;
     static constexpr float AccTs=1.0/AccFreq;
     static constexpr float MagTs=1.0/MagFreq;
 
-    static constexpr float GyroSensitivity = 1000 / 35.0f;
-    static constexpr float AccelSensitivity = 1000 / 0.244f;
+    // 32 bit timestamp counter, 25us per LSB
+    static constexpr float SensorTimeTickMicros = 25.0f;
+    static constexpr uint32_t SensorTimeMask = 0xFFFFFFFF;
+    static constexpr bool SensorTimeAlignedToSamples = false;
+
+    static constexpr float GyroSensitivity = GyroRange.sensitivity;
+    static constexpr float AccelSensitivity = AccelRange.sensitivity;
 
     using LSM6DSOutputHandler<I2CImpl>::i2c;
+    using LSM6DSOutputHandler<I2CImpl>::MaxFifoChunks;
 
     struct Regs {
         struct WhoAmI {
@@ -64,26 +77,39 @@ struct LSM6DSO : LSM6DSOutputHandler<I2CImpl>
         static constexpr uint8_t OutTemp = 0x20;
         struct Ctrl1XL {
             static constexpr uint8_t reg = 0x10;
-            static constexpr uint8_t value = (0b01001100); // XL at 104 Hz, 8g FS
+            static constexpr uint8_t value = (AccelRate.code << 4) | AccelRange.code; // XL at 104 Hz, 8g FS by default
         };
         struct Ctrl2GY {
             static constexpr uint8_t reg = 0x11;
-            static constexpr uint8_t value = (0b01101000); //GY at 416 Hz, 1000dps FS
+            static constexpr uint8_t value = (GyroRate.code << 4) | GyroRange.code; //GY at 416 Hz, 1000dps FS by default
         };
         struct Ctrl3C {
             static constexpr uint8_t reg = 0x12;
             static constexpr uint8_t valueSwReset = 1;
+            static constexpr uint8_t defaultIfInc = (1 << 2);
             static constexpr uint8_t value = (1 << 6) | (1 << 2); //BDU = 1, IF_INC = 1
         };
         struct FifoCtrl3BDR {
             static constexpr uint8_t reg = 0x09;
-            static constexpr uint8_t value = (0b0110) | (0b0110 << 4); //gyro and accel batched at 417Hz
+            static constexpr uint8_t value = GyroRate.code | (GyroRate.code << 4); //gyro and accel batched at gyro ODR
         };
         struct FifoCtrl4Mode {
             static constexpr uint8_t reg = 0x0a;
             static constexpr uint8_t value = (0b110); //continuous mode
         };
 
+        struct Ctrl10C {
+            static constexpr uint8_t reg = 0x19;
+            static constexpr uint8_t value = (1 << 5); //TIMESTAMP_EN
+        };
+        static constexpr uint8_t Timestamp0 = 0x40;
+
+        static constexpr uint8_t FifoCtrl1WTM = 0x07;
+        struct Int1Ctrl {
+            static constexpr uint8_t reg = 0x0d;
+            static constexpr uint8_t valueFifoTh = (1 << 3); //INT1_FIFO_TH
+        };
+
         static constexpr uint8_t FifoStatus = 0x3a;
         static constexpr uint8_t FifoData = 0x78;
     };
@@ -92,29 +118,52 @@ struct LSM6DSO : LSM6DSOutputHandler<I2CImpl>
         : LSM6DSOutputHandler<I2CImpl>(i2c, logger) {
     }
 
+    // CTRL1..3 and FIFO_CTRL3..4 are consecutive, 3 transactions in total
+    static constexpr std::array<RegisterWrite, 6> InitTable{{
+        {Regs::Ctrl1XL::reg, Regs::Ctrl1XL::value},
+        {Regs::Ctrl2GY::reg, Regs::Ctrl2GY::value},
+        {Regs::Ctrl3C::reg, Regs::Ctrl3C::value},
+        {Regs::FifoCtrl3BDR::reg, Regs::FifoCtrl3BDR::value},
+        {Regs::FifoCtrl4Mode::reg, Regs::FifoCtrl4Mode::value},
+        {Regs::Ctrl10C::reg, Regs::Ctrl10C::value},
+    }};
+
     bool initialize()
     {
         // perform initialization step
-        i2c.writeReg(Regs::Ctrl3C::reg, Regs::Ctrl3C::valueSwReset);
-        delay(20);
-        i2c.writeReg(Regs::Ctrl1XL::reg, Regs::Ctrl1XL::value);
-        i2c.writeReg(Regs::Ctrl2GY::reg, Regs::Ctrl2GY::value);
-        i2c.writeReg(Regs::Ctrl3C::reg, Regs::Ctrl3C::value);
-        i2c.writeReg(Regs::FifoCtrl3BDR::reg, Regs::FifoCtrl3BDR::value);
-        i2c.writeReg(Regs::FifoCtrl4Mode::reg, Regs::FifoCtrl4Mode::value);
+        if (!LSM6DSOutputHandler<I2CImpl>::template softReset<Regs>()) {
+            return false;
+        }
+        writeRegisterTable(i2c, InitTable);
         return true;
     }
 
+    static constexpr uint8_t FifoWatermarkEntries = 4; // 2 gyro + 2 accel entries, ~4.8ms at 416Hz
+
+    void enableFifoInterrupt()
+    {
+        LSM6DSOutputHandler<I2CImpl>::template enableFifoInterrupt<Regs>(FifoWatermarkEntries);
+    }
+
     float getDirectTemp() const
     {
         return LSM6DSOutputHandler<I2CImpl>::template getDirectTemp<Regs>();
     }
 
+    uint32_t getSensorTime() const
+    {
+        return LSM6DSOutputHandler<I2CImpl>::template getSensorTime<Regs>();
+    }
+
     template <typename AccelCall, typename GyroCall>
-    void bulkRead(AccelCall &&processAccelSample, GyroCall &&processGyroSample) {
-        LSM6DSOutputHandler<I2CImpl>::template bulkRead<AccelCall, GyroCall, Regs>(processAccelSample, processGyroSample, GyrTs, AccTs);
+    bool bulkRead(AccelCall &&processAccelSample, GyroCall &&processGyroSample, uint32_t maxChunks = MaxFifoChunks) {
+        return LSM6DSOutputHandler<I2CImpl>::template bulkRead<AccelCall, GyroCall, Regs>(processAccelSample, processGyroSample, GyrTs, AccTs, maxChunks);
     }
 
 };
 
+template <typename Profile>
+using LSM6DSOProfileCheck = LSM6DSO<Profiles::NoBus, Profile>;
+static_assert(Profiles::supportsAllProfiles<LSM6DSOProfileCheck>());
+
 } // namespace
\ No newline at end of file
@@ -33,28 +33,52 @@ namespace SlimeVR::Sensors::SoftFusion::Drivers
 {
 
 // Driver uses acceleration range at 8g
-// and gyroscope range at 1000dps
-// Gyroscope ODR = 480Hz, accel ODR = 120Hz
+// and gyroscope range at 1000dps by default
+// Gyroscope ODR = 480Hz, accel ODR = 120Hz with the default profile
 
-template <typename I2CImpl>
+template <typename I2CImpl, typename Profile = Profiles::Selected>
 struct LSM6DSV : LSM6DSOutputHandler<I2CImpl>
 {
     static constexpr uint8_t Address = 0x6a;
     static constexpr auto Name = "LSM6DSV";
     static constexpr auto Type = ImuID::LSM6DSV;
 
-    static constexpr float GyrFreq = 480;
-    static constexpr float AccFreq = 120;
+    // ODR codes of the 1st HAODR table, shared by CTRL1, CTRL2 and the fifo BDR fields
+    static constexpr std::array<Profiles::RateCode, 11> Rates{{
+        {7.5f, 2}, {15, 3}, {30, 4}, {60, 5}, {120, 6}, {240, 7}, {480, 8}, {960, 9}, {1920, 10}, {3840, 11}, {7680, 12},
+    }};
+    static constexpr std::array<Profiles::RangeCode, 6> GyroRanges{{
+        {125, 0b0000, 1000 / 4.375f}, {250, 0b0001, 1000 / 8.75f}, {500, 0b0010, 1000 / 17.5f},
+        {1000, 0b0011, 1000 / 35.0f}, {2000, 0b0100, 1000 / 70.0f}, {4000, 0b1100, 1000 / 140.0f},
+    }};
+    static constexpr std::array<Profiles::RangeCode, 4> AccelRanges{{
+        {2, 0b00, 1000 / 0.061f}, {4, 0b01, 1000 / 0.122f}, {8, 0b10, 1000 / 0.244f}, {16, 0b11, 1000 / 0.488f},
+    }};
+    static constexpr auto GyroRate = Profiles::nearestRate(Rates, Profile::GyroOdrHz);
+    static constexpr auto AccelRate = Profiles::nearestRate(Rates, Profile::AccelOdrHz);
+    static constexpr auto GyroRange = Profiles::exactRange(GyroRanges, Profiles::gyroRangeDps<Profile>(1000));
+    static constexpr auto AccelRange = Profiles::exactRange(AccelRanges, Profiles::accelRangeG<Profile>(8));
+    static_assert(GyroRange.sensitivity > 0, "Gyro range not supported by LSM6DSV");
+    static_assert(AccelRange.sensitivity > 0, "Accel range not supported by LSM6DSV");
+
+    static constexpr float GyrFreq = GyroRate.hz;
+    static constexpr float AccFreq = AccelRate.hz;
     static constexpr float MagFreq = 120;
 
     static constexpr float GyrTs=1.0/GyrFreq;
     static constexpr float AccTs=1.0/AccFreq;
     static constexpr float MagTs=1.0/MagFreq;
 
-    static constexpr float GyroSensitivity = 1000 / 35.0f;
-    static constexpr float AccelSensitivity = 1000 / 0.244f;
+    // 32 bit timestamp counter, 21.75us per LSB
+    static constexpr float SensorTimeTickMicros = 21.75f;
+    static constexpr uint32_t SensorTimeMask = 0xFFFFFFFF;
+    static constexpr bool SensorTimeAlignedToSamples = false;
+
+    static constexpr float GyroSensitivity = GyroRange.sensitivity;
+    static constexpr float AccelSensitivity = AccelRange.sensitivity;
 
     using LSM6DSOutputHandler<I2CImpl>::i2c;
+    using LSM6DSOutputHandler<I2CImpl>::MaxFifoChunks;
 
     struct Regs {
         struct WhoAmI {
@@ -68,34 +92,47 @@ struct LSM6DSV : LSM6DSOutputHandler<I2CImpl>
         };
         struct Ctrl1XLODR {
             static constexpr uint8_t reg = 0x10;
-            static constexpr uint8_t value = (0b0010110); //120Hz, HAODR
+            static constexpr uint8_t value = (0b001 << 4) | AccelRate.code; //120Hz by default, HAODR
         };
         struct Ctrl2GODR {
             static constexpr uint8_t reg = 0x11;
-            static constexpr uint8_t value = (0b0011000); //480Hz, HAODR
+            static constexpr uint8_t value = (0b001 << 4) | GyroRate.code; //480Hz by default, HAODR
         };
         struct Ctrl3C {
             static constexpr uint8_t reg = 0x12;
             static constexpr uint8_t valueSwReset = 1;
+            static constexpr uint8_t defaultIfInc = (1 << 2);
             static constexpr uint8_t value = (1 << 6) | (1 << 2); //BDU = 1, IF_INC = 1
         };
         struct Ctrl6GFS {
             static constexpr uint8_t reg = 0x15;
-            static constexpr uint8_t value = (0b0011); //1000dps
+            static constexpr uint8_t value = GyroRange.code; //1000dps by default
         };
         struct Ctrl8XLFS {
             static constexpr uint8_t reg = 0x17;
-            static constexpr uint8_t value = (0b10); //8g
+            static constexpr uint8_t value = AccelRange.code; //8g by default
         };
         struct FifoCtrl3BDR {
             static constexpr uint8_t reg = 0x09;
-            static constexpr uint8_t value = (0b1000) | (0b1000 << 4); //gyro and accel batched at 480Hz
+            static constexpr uint8_t value = GyroRate.code | (GyroRate.code << 4); //gyro and accel batched at gyro ODR
         };
         struct FifoCtrl4Mode {
             static constexpr uint8_t reg = 0x0a;
             static constexpr uint8_t value = (0b110); //continuous mode
         };
 
+        struct FunctionsEnable {
+            static constexpr uint8_t reg = 0x50;
+            static constexpr uint8_t value = (1 << 6); //TIMESTAMP_EN
+        };
+        static constexpr uint8_t Timestamp0 = 0x40;
+
+        static constexpr uint8_t FifoCtrl1WTM = 0x07;
+        struct Int1Ctrl {
+            static constexpr uint8_t reg = 0x0d;
+            static constexpr uint8_t valueFifoTh = (1 << 3); //INT1_FIFO_TH
+        };
+
         static constexpr uint8_t FifoStatus = 0x1b;
         static constexpr uint8_t FifoData = 0x78;
     };
@@ -104,32 +141,55 @@ struct LSM6DSV : LSM6DSOutputHandler<I2CImpl>
         : LSM6DSOutputHandler<I2CImpl>(i2c, logger) {
     }
 
+    // the HAODR table has to be selected before the ODRs, CTRL1..3 go out as one burst
+    static constexpr std::array<RegisterWrite, 9> InitTable{{
+        {Regs::HAODRCFG::reg, Regs::HAODRCFG::value},
+        {Regs::Ctrl1XLODR::reg, Regs::Ctrl1XLODR::value},
+        {Regs::Ctrl2GODR::reg, Regs::Ctrl2GODR::value},
+        {Regs::Ctrl3C::reg, Regs::Ctrl3C::value},
+        {Regs::Ctrl6GFS::reg, Regs::Ctrl6GFS::value},
+        {Regs::Ctrl8XLFS::reg, Regs::Ctrl8XLFS::value},
+        {Regs::FifoCtrl3BDR::reg, Regs::FifoCtrl3BDR::value},
+        {Regs::FifoCtrl4Mode::reg, Regs::FifoCtrl4Mode::value},
+        {Regs::FunctionsEnable::reg, Regs::FunctionsEnable::value},
+    }};
+
     bool initialize()
     {
         // perform initialization step
-        i2c.writeReg(Regs::Ctrl3C::reg, Regs::Ctrl3C::valueSwReset);
-        delay(20);
-        i2c.writeReg(Regs::HAODRCFG::reg, Regs::HAODRCFG::value);
-        i2c.writeReg(Regs::Ctrl1XLODR::reg, Regs::Ctrl1XLODR::value);
-        i2c.writeReg(Regs::Ctrl2GODR::reg, Regs::Ctrl2GODR::value);
-        i2c.writeReg(Regs::Ctrl3C::reg, Regs::Ctrl3C::value);
-        i2c.writeReg(Regs::Ctrl6GFS::reg, Regs::Ctrl6GFS::value);
-        i2c.writeReg(Regs::Ctrl8XLFS::reg, Regs::Ctrl8XLFS::value);
-        i2c.writeReg(Regs::FifoCtrl3BDR::reg, Regs::FifoCtrl3BDR::value);
-        i2c.writeReg(Regs::FifoCtrl4Mode::reg, Regs::FifoCtrl4Mode::value);
+        if (!LSM6DSOutputHandler<I2CImpl>::template softReset<Regs>()) {
+            return false;
+        }
+        writeRegisterTable(i2c, InitTable);
         return true;
     }
 
+    static constexpr uint8_t FifoWatermarkEntries = 4; // 2 gyro + 2 accel entries, ~4.2ms at 480Hz
+
+    void enableFifoInterrupt()
+    {
+        LSM6DSOutputHandler<I2CImpl>::template enableFifoInterrupt<Regs>(FifoWatermarkEntries);
+    }
+
     float getDirectTemp() const
     {
         return LSM6DSOutputHandler<I2CImpl>::template getDirectTemp<Regs>();
     }
 
+    uint32_t getSensorTime() const
+    {
+        return LSM6DSOutputHandler<I2CImpl>::template getSensorTime<Regs>();
+    }
+
     template <typename AccelCall, typename GyroCall>
-    void bulkRead(AccelCall &&processAccelSample, GyroCall &&processGyroSample) {
-        LSM6DSOutputHandler<I2CImpl>::template bulkRead<AccelCall, GyroCall, Regs>(processAccelSample, processGyroSample, GyrTs, AccTs);
+    bool bulkRead(AccelCall &&processAccelSample, GyroCall &&processGyroSample, uint32_t maxChunks = MaxFifoChunks) {
+        return LSM6DSOutputHandler<I2CImpl>::template bulkRead<AccelCall, GyroCall, Regs>(processAccelSample, processGyroSample, GyrTs, AccTs, maxChunks);
     }
 
 };
 
+template <typename Profile>
+using LSM6DSVProfileCheck = LSM6DSV<Profiles::NoBus, Profile>;
+static_assert(Profiles::supportsAllProfiles<LSM6DSVProfileCheck>());
+
 } // namespace
\ No newline at end of file
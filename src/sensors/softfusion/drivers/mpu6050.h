@@ -29,6 +29,8 @@
 
 #include <MPU6050.h>
 
+#include "../registertable.h"
+
 
 namespace SlimeVR::Sensors::SoftFusion::Drivers
 {
@@ -110,24 +112,32 @@ struct MPU6050
         i2c.writeReg(Regs::UserCtrl::reg, Regs::UserCtrl::fifoResetValue);
     }
 
+    // SMPLRT_DIV, CONFIG, GYRO_CONFIG and ACCEL_CONFIG are consecutive and go out as one burst
+    static constexpr std::array<RegisterWrite, 8> InitTable{{
+        {MPU6050_RA_PWR_MGMT_1,   0x01}, // 0000 0001 PWR_MGMT_1:Clock Source Select PLL_X_gyro
+        {MPU6050_RA_USER_CTRL,    0x00}, // 0000 0000 USER_CTRL: Disable FIFO / I2C master / DMP
+        {MPU6050_RA_INT_ENABLE,   0x10}, // 0001 0000 INT_ENABLE: only FIFO overflow interrupt
+        {MPU6050_RA_SMPLRT_DIV,   0x03}, // 0000 0011 SMPLRT_DIV: Divides the internal sample rate 250Hz (Sample Rate = Gyroscope Output Rate / (1 + SMPLRT_DIV))
+        {MPU6050_RA_CONFIG,       0x02}, // 0000 0010 CONFIG: No EXT_SYNC_SET, DLPF set to 98Hz(also lowers gyro output rate to 1KHz)
+        {Regs::GyroConfig::reg, Regs::GyroConfig::value},
+        {Regs::AccelConfig::reg, Regs::AccelConfig::value},
+        {MPU6050_RA_FIFO_EN,      0x78}, // 0111 1000 FIFO_EN: All gyro axes + Accel
+    }};
+
     bool initialize()
     {
         // Reset
-        i2c.writeReg(MPU6050_RA_PWR_MGMT_1, 0x80); //PWR_MGMT_1: reset with 100ms delay (also disables sleep)
-        delay(100);
-        i2c.writeReg(MPU6050_RA_SIGNAL_PATH_RESET, 0x07); // full SIGNAL_PATH_RESET: with another 100ms delay
+        i2c.writeReg(MPU6050_RA_PWR_MGMT_1, 0x80); //PWR_MGMT_1: reset (also disables sleep)
+        // done once DEVICE_RESET cleared itself and SLEEP is back at its default, the datasheet only gives 100ms as upper bound
+        if (!waitForRegister(i2c, MPU6050_RA_PWR_MGMT_1, 0xc0, 0x40, 100000)) {
+            logger.error("Reset timed out, PWR_MGMT_1 (0x%02x) reads 0x%02x", MPU6050_RA_PWR_MGMT_1, i2c.readReg(MPU6050_RA_PWR_MGMT_1));
+            return false;
+        }
+        i2c.writeReg(MPU6050_RA_SIGNAL_PATH_RESET, 0x07); // full SIGNAL_PATH_RESET: no completion flag, keep the 100ms delay
         delay(100);
-        
-        // Configure
-        i2c.writeReg(MPU6050_RA_PWR_MGMT_1,   0x01); // 0000 0001 PWR_MGMT_1:Clock Source Select PLL_X_gyro
-        i2c.writeReg(MPU6050_RA_USER_CTRL,    0x00); // 0000 0000 USER_CTRL: Disable FIFO / I2C master / DMP
-        i2c.writeReg(MPU6050_RA_INT_ENABLE,   0x10); // 0001 0000 INT_ENABLE: only FIFO overflow interrupt
-        i2c.writeReg(Regs::GyroConfig::reg, Regs::GyroConfig::value);
-        i2c.writeReg(Regs::AccelConfig::reg, Regs::AccelConfig::value);
-        i2c.writeReg(MPU6050_RA_CONFIG,       0x02); // 0000 0010 CONFIG: No EXT_SYNC_SET, DLPF set to 98Hz(also lowers gyro output rate to 1KHz)
-        i2c.writeReg(MPU6050_RA_SMPLRT_DIV,   0x03); // 0000 0011 SMPLRT_DIV: Divides the internal sample rate 250Hz (Sample Rate = Gyroscope Output Rate / (1 + SMPLRT_DIV))
 
-        i2c.writeReg(MPU6050_RA_FIFO_EN,      0x78); // 0111 1000 FIFO_EN: All gyro axes + Accel
+        // Configure
+        writeRegisterTable(i2c, InitTable);
 
         resetFIFO();
 
@@ -141,8 +151,11 @@ struct MPU6050
         return result;
     }
 
+    static constexpr uint32_t MaxFifoChunks = 32;
+
+    // reads at most maxChunks fifo transactions, returns true if data is still left in the fifo
     template <typename AccelCall, typename GyroCall>
-    void bulkRead(AccelCall &&processAccelSample, GyroCall &&processGyroSample) {
+    bool bulkRead(AccelCall &&processAccelSample, GyroCall &&processGyroSample, uint32_t maxChunks = MaxFifoChunks) {
         const auto status = i2c.readReg(Regs::IntStatus);
 
         if (status & (1 << MPU6050_INTERRUPT_FIFO_OFLOW_BIT)) {
@@ -150,33 +163,40 @@ struct MPU6050
             // This necessitates a reset
             logger.debug("Fifo overrun, resetting...");
             resetFIFO();
-            return;
+            return false;
         }
 
-        std::array<uint8_t, 12 * 10> readBuffer; // max 10 packages of 12byte values (sample) of data form fifo
-        auto byteCount = byteSwap(i2c.readReg16(Regs::FifoCount));
-
-        auto readBytes = min(static_cast<size_t>(byteCount), readBuffer.size()) / sizeof(FifoSample) * sizeof(FifoSample);
-        if (!readBytes) {
-            return;
-        }
-
-        i2c.readBytes(Regs::FifoData, readBytes, readBuffer.data());
-        for (auto i = 0u; i < readBytes; i += sizeof(FifoSample)) {
-            const FifoSample *sample = reinterpret_cast<FifoSample *>(&readBuffer[i]);
-            
-            int16_t xyz[3];
-
-            xyz[0] = MPU6050_FIFO_VALUE(sample, accel_x);
-            xyz[1] = MPU6050_FIFO_VALUE(sample, accel_y);
-            xyz[2] = MPU6050_FIFO_VALUE(sample, accel_z);
-            processAccelSample(xyz, AccTs);
-
-            xyz[0] = MPU6050_FIFO_VALUE(sample, gyro_x);
-            xyz[1] = MPU6050_FIFO_VALUE(sample, gyro_y);
-            xyz[2] = MPU6050_FIFO_VALUE(sample, gyro_z);
-            processGyroSample(xyz, GyrTs);
+        // re-read the count only if the backlog didn't fit in one transaction
+        std::array<uint8_t, I2CImpl::MaxTransactionLength / sizeof(FifoSample) * sizeof(FifoSample)> readBuffer;
+        for (uint32_t chunk = 0; chunk < maxChunks; chunk++) {
+            auto byteCount = byteSwap(i2c.readReg16(Regs::FifoCount));
+
+            auto readBytes = min(static_cast<size_t>(byteCount), readBuffer.size()) / sizeof(FifoSample) * sizeof(FifoSample);
+            if (!readBytes) {
+                return false;
+            }
+
+            i2c.readBytes(Regs::FifoData, readBytes, readBuffer.data());
+            for (auto i = 0u; i < readBytes; i += sizeof(FifoSample)) {
+                const FifoSample *sample = reinterpret_cast<FifoSample *>(&readBuffer[i]);
+
+                int16_t xyz[3];
+
+                xyz[0] = MPU6050_FIFO_VALUE(sample, accel_x);
+                xyz[1] = MPU6050_FIFO_VALUE(sample, accel_y);
+                xyz[2] = MPU6050_FIFO_VALUE(sample, accel_z);
+                processAccelSample(xyz, AccTs);
+
+                xyz[0] = MPU6050_FIFO_VALUE(sample, gyro_x);
+                xyz[1] = MPU6050_FIFO_VALUE(sample, gyro_y);
+                xyz[2] = MPU6050_FIFO_VALUE(sample, gyro_z);
+                processGyroSample(xyz, GyrTs);
+            }
+            if (byteCount <= readBuffer.size()) {
+                return false;
+            }
         }
+        return true;
     }
 
 
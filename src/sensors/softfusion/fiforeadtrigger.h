@@ -0,0 +1,103 @@
+/*
+    SlimeVR Code is placed under the MIT license
+    Copyright (c) 2024 SlimeVR Contributors
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <Arduino.h>
+
+#include "globals.h"
+
+namespace SlimeVR::Sensors::SoftFusion
+{
+
+// Decides when SoftFusionSensor reads the IMU FIFO. It is polled every PollIntervalMicros, unless
+// SFUSION_USE_FIFO_INTERRUPT is set, an INT pin is given and the driver can route its FIFO watermark
+// to it. Then the FIFO is read when the pin is high, and still polled if the pin stays quiet for
+// InterruptTimeoutMicros, so a missing or broken INT connection degrades to slow polling instead of stalling.
+template <typename IMU>
+class FifoReadTrigger
+{
+public:
+    static constexpr bool HasFifoInterrupt = requires(IMU &i) { i.enableFifoInterrupt(); };
+    static constexpr bool HasFifoInterruptAck = requires(IMU &i) { i.ackFifoInterrupt(); };
+
+    static constexpr uint32_t PollIntervalMicros = 6000;
+    static constexpr uint32_t InterruptTimeoutMicros = 50000;
+
+    FifoReadTrigger(uint8_t intPin, uint32_t now)
+        : m_intPin(intPin), m_lastReadTime(now) {}
+
+    // has to run again after anything that reinitializes the IMU
+    void setup(IMU &imu, bool useInterrupt = SFUSION_USE_FIFO_INTERRUPT)
+    {
+        if constexpr(HasFifoInterrupt) {
+            if (!useInterrupt || m_intPin == 255) {
+                return;
+            }
+            pinMode(m_intPin, INPUT);
+            imu.enableFifoInterrupt();
+            m_useInterrupt = true;
+        }
+    }
+
+    bool usesInterrupt() const { return m_useInterrupt; }
+    uint8_t getIntPin() const { return m_intPin; }
+
+    // true when a FIFO read should start now
+    bool readDue(uint32_t now)
+    {
+        const uint32_t elapsed = now - m_lastReadTime;
+        if (!m_useInterrupt) {
+            if (elapsed < PollIntervalMicros) {
+                return false;
+            }
+            // keep the poll cadence, the loop running late doesn't shift the following polls
+            m_lastReadTime = now - (elapsed - PollIntervalMicros);
+            return true;
+        }
+        // watermark interrupt is routed as a level, it stays asserted while the fifo is above the threshold
+        if (digitalRead(m_intPin) != HIGH && elapsed < InterruptTimeoutMicros) {
+            return false;
+        }
+        m_lastReadTime = now;
+        return true;
+    }
+
+    // after a read that emptied the FIFO, clears the interrupt of drivers that latch it
+    void fifoDrained(IMU &imu)
+    {
+        if constexpr(HasFifoInterruptAck) {
+            if (m_useInterrupt) {
+                imu.ackFifoInterrupt();
+            }
+        }
+    }
+
+private:
+    uint8_t m_intPin;
+    bool m_useInterrupt = false;
+    uint32_t m_lastReadTime;
+};
+
+}
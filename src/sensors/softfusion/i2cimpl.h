@@ -24,6 +24,7 @@
 #pragma once
 
 #include <cstdint>
+#include <Wire.h>
 #include "I2Cdev.h"
 
 
@@ -34,39 +35,44 @@ struct I2CImpl
 {
     static constexpr size_t MaxTransactionLength = I2C_BUFFER_LENGTH - 2;
 
-    I2CImpl(uint8_t devAddr)
-        : m_devAddr(devAddr) {}
+    I2CImpl(uint8_t devAddr, TwoWire *wire = &Wire)
+        : m_devAddr(devAddr), m_wire(wire) {}
+
+    void setWire(TwoWire *wire) {
+        m_wire = wire;
+    }
 
     uint8_t readReg(uint8_t regAddr) const {
         uint8_t buffer = 0;
-        I2Cdev::readByte(m_devAddr, regAddr, &buffer);
+        I2Cdev::readByte(m_devAddr, regAddr, &buffer, I2Cdev::readTimeout, m_wire);
         return buffer;
     }
 
     uint16_t readReg16(uint8_t regAddr) const {
         uint16_t buffer = 0;
-        I2Cdev::readBytes(m_devAddr, regAddr, sizeof(buffer), reinterpret_cast<uint8_t*>(&buffer));
+        I2Cdev::readBytes(m_devAddr, regAddr, sizeof(buffer), reinterpret_cast<uint8_t*>(&buffer), I2Cdev::readTimeout, m_wire);
         return buffer;
     }
 
     void writeReg(uint8_t regAddr, uint8_t value) const {
-        I2Cdev::writeByte(m_devAddr, regAddr, value);
+        I2Cdev::writeByte(m_devAddr, regAddr, value, m_wire);
     }
 
     void writeReg16(uint8_t regAddr, uint16_t value) const {
-        I2Cdev::writeBytes(m_devAddr, regAddr, sizeof(value), reinterpret_cast<uint8_t*>(&value));
+        I2Cdev::writeBytes(m_devAddr, regAddr, sizeof(value), reinterpret_cast<uint8_t*>(&value), m_wire);
     }
 
     void readBytes(uint8_t regAddr, uint8_t size, uint8_t* buffer) const {
-        I2Cdev::readBytes(m_devAddr, regAddr, size, buffer);
+        I2Cdev::readBytes(m_devAddr, regAddr, size, buffer, I2Cdev::readTimeout, m_wire);
     }
 
     void writeBytes(uint8_t regAddr, uint8_t size, uint8_t* buffer) const {
-        I2Cdev::writeBytes(m_devAddr, regAddr, size, buffer);
+        I2Cdev::writeBytes(m_devAddr, regAddr, size, buffer, m_wire);
     }
 
     private:
         uint8_t m_devAddr;
+        TwoWire *m_wire;
 };
 
 }
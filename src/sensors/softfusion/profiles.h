@@ -0,0 +1,168 @@
+/*
+    SlimeVR Code is placed under the MIT license
+    Copyright (c) 2024 SlimeVR Contributors
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <array>
+#include <tuple>
+
+#include "globals.h"
+
+namespace SlimeVR::Sensors::SoftFusion::Profiles
+{
+
+// Output data rate and range profiles for the softfusion drivers.
+// Each driver picks its supported ODR closest to the requested one and derives register values,
+// sensitivities and sample periods from it at compile time.
+// Ranges are optional, without them every driver keeps its own default range.
+// Changing the ODR or range changes raw units and sample rate, so the IMUs have to be recalibrated.
+
+struct LowPower
+{
+    static constexpr float GyroOdrHz = 200;
+    static constexpr float AccelOdrHz = 50;
+};
+
+struct Default
+{
+    static constexpr float GyroOdrHz = 450;
+    static constexpr float AccelOdrHz = 100;
+};
+
+struct HighRate1k
+{
+    static constexpr float GyroOdrHz = 1000;
+    static constexpr float AccelOdrHz = 200;
+};
+
+// example of a profile that also sets the ranges
+// struct HighRange
+// {
+//     static constexpr float GyroOdrHz = 450;
+//     static constexpr float AccelOdrHz = 100;
+//     static constexpr float GyroRangeDps = 2000;
+//     static constexpr float AccelRangeG = 16;
+// };
+
+using Selected = SFUSION_PROFILE;
+
+// Profiles every driver has to support, not just the selected one
+using All = std::tuple<LowPower, Default, HighRate1k>;
+
+// Stand-in bus for instantiating a driver only to run its compile-time checks
+struct NoBus
+{
+    static constexpr size_t MaxTransactionLength = 32;
+};
+
+// Instantiates Driver<Profile> for every profile in All, so the rate and range
+// static_asserts of a driver run for each of them
+template <template <typename> class Driver>
+constexpr bool supportsAllProfiles()
+{
+    return []<typename... Profile>(std::tuple<Profile...> *) {
+        return ((sizeof(Driver<Profile>) > 0) && ...);
+    }(static_cast<All *>(nullptr));
+}
+
+// Sample times measured during calibration stay within a few percent of nominal (oscillator tolerance),
+// while the ODRs of two profiles are at least 2x apart. A bigger difference means the calibration was
+// taken with another SFUSION_PROFILE.
+constexpr float SampleTimeTolerance = 0.05f;
+
+constexpr bool sampleTimeMatches(float measuredTs, float nominalTs)
+{
+    const float diff = measuredTs > nominalTs ? measuredTs - nominalTs : nominalTs - measuredTs;
+    return diff <= nominalTs * SampleTimeTolerance;
+}
+
+template <typename IMU>
+constexpr bool sampleTimesMatch(float gyroTs, float accelTs)
+{
+    return sampleTimeMatches(gyroTs, IMU::GyrTs) && sampleTimeMatches(accelTs, IMU::AccTs);
+}
+
+struct RateCode
+{
+    float hz;
+    uint8_t code;
+};
+
+struct RangeCode
+{
+    float range;
+    uint8_t code;
+    float sensitivity; // LSB per dps or per g
+};
+
+template <size_t N>
+constexpr RateCode nearestRate(const std::array<RateCode, N> &table, float hz)
+{
+    RateCode best = table[0];
+    for (const auto &entry : table) {
+        const float diff = entry.hz > hz ? entry.hz - hz : hz - entry.hz;
+        const float bestDiff = best.hz > hz ? best.hz - hz : hz - best.hz;
+        if (diff < bestDiff) {
+            best = entry;
+        }
+    }
+    return best;
+}
+
+// returns an entry with sensitivity 0 if the range isn't supported, drivers static_assert on that
+template <size_t N>
+constexpr RangeCode exactRange(const std::array<RangeCode, N> &table, float range)
+{
+    for (const auto &entry : table) {
+        if (entry.range == range) {
+            return entry;
+        }
+    }
+    return {range, 0, 0};
+}
+
+template <typename Profile>
+constexpr float gyroRangeDps(float driverDefault)
+{
+    if constexpr(requires { Profile::GyroRangeDps; }) {
+        return Profile::GyroRangeDps;
+    }
+    else {
+        return driverDefault;
+    }
+}
+
+template <typename Profile>
+constexpr float accelRangeG(float driverDefault)
+{
+    if constexpr(requires { Profile::AccelRangeG; }) {
+        return Profile::AccelRangeG;
+    }
+    else {
+        return driverDefault;
+    }
+}
+
+} // namespace
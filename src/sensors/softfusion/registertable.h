@@ -0,0 +1,81 @@
+/*
+    SlimeVR Code is placed under the MIT license
+    Copyright (c) 2024 SlimeVR Contributors
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <array>
+#include <Arduino.h>
+
+namespace SlimeVR::Sensors::SoftFusion
+{
+
+struct RegisterWrite
+{
+    uint8_t reg;
+    uint8_t value;
+};
+
+// Applies an init table in order. Runs of entries with consecutive register addresses
+// go out as a single burst, relying on the address auto increment all supported IMUs have on by default.
+template <typename I2CImpl, size_t N>
+void writeRegisterTable(const I2CImpl &i2c, const std::array<RegisterWrite, N> &table)
+{
+    std::array<uint8_t, N> burst;
+    for (size_t start = 0; start < N;) {
+        size_t length = 1;
+        burst[0] = table[start].value;
+        while (start + length < N
+            && length < I2CImpl::MaxTransactionLength
+            && table[start + length].reg == table[start].reg + length) {
+            burst[length] = table[start + length].value;
+            length++;
+        }
+
+        if (length == 1) {
+            i2c.writeReg(table[start].reg, burst[0]);
+        }
+        else {
+            i2c.writeBytes(table[start].reg, length, burst.data());
+        }
+        start += length;
+    }
+}
+
+// Polls a register until (value & mask) == expected instead of sleeping for the worst case datasheet time.
+// A device that doesn't answer yet reads as 0, so masks should wait for a bit to become set where possible.
+template <typename I2CImpl>
+bool waitForRegister(const I2CImpl &i2c, uint8_t reg, uint8_t mask, uint8_t expected, uint32_t timeoutMicros)
+{
+    constexpr uint32_t PollIntervalMicros = 250;
+    const uint32_t start = micros();
+    while ((i2c.readReg(reg) & mask) != expected) {
+        if (micros() - start >= timeoutMicros) {
+            return false;
+        }
+        delayMicroseconds(PollIntervalMicros);
+    }
+    return true;
+}
+
+} // namespace
@@ -23,8 +23,17 @@
 
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+
 #include "../sensor.h"
 #include "../SensorFusionRestDetect.h"
+#include "../SendRateScheduler.h"
+#include "../../motionprocessing/SensorClockSync.h"
+#include "../../motionprocessing/GyroTemperatureCalibrator.h"
+#include "../../motionprocessing/BackgroundCalibrator.h"
+#include "profiles.h"
+#include "fiforeadtrigger.h"
 
 #include "GlobalVars.h"
 
@@ -49,6 +58,15 @@ class SoftFusionSensor : public Sensor
     static constexpr double AScale = CONST_EARTH_GRAVITY / imu::AccelSensitivity;
 
     static constexpr bool HasMotionlessCalib = requires(imu& i){ typename imu::MotionlessCalibrationData; };
+    static constexpr bool HasSensorTime = requires(imu& i){ i.getSensorTime(); };
+
+    static constexpr uint32_t ClockSyncIntervalMicros = 25000;
+    // bus transactions per FIFO read, the driver limit drains the whole FIFO
+    static constexpr uint32_t FifoChunksPerLoop = SFUSION_FIFO_CHUNKS_PER_LOOP > 0 ? SFUSION_FIFO_CHUNKS_PER_LOOP : imu::MaxFifoChunks;
+    // the temperature changes slowly, it is read on this cadence and cached for the gyro path
+    static constexpr uint32_t TemperatureIntervalMicros = 500000;
+    static constexpr uint32_t TempCalSamplesPerStep = TEMP_CALIBRATION_SECONDS_PER_STEP / imu::GyrTs;
+    static_assert(0x7FFF * TempCalSamplesPerStep < 0x7FFFFFFF, "Temperature calibration sum overflow");
     static constexpr size_t MotionlessCalibDataSize() {
         if constexpr(HasMotionlessCalib) {
             return sizeof(typename imu::MotionlessCalibrationData);
@@ -58,9 +76,45 @@ class SoftFusionSensor : public Sensor
         }
     }
 
+    static I2CImpl makeTransport(uint8_t addrSuppl)
+    {
+        if constexpr(IsSPI) {
+            // on SPI the address slot of the descriptor carries the chip select pin
+            if constexpr(requires { imu::SPIReadDummyBytes; }) {
+                return I2CImpl(addrSuppl, imu::SPIReadDummyBytes);
+            }
+            else {
+                return I2CImpl(addrSuppl);
+            }
+        }
+        else {
+            return I2CImpl(imu::Address + addrSuppl);
+        }
+    }
+
+    static SensorClockSync makeClockSync()
+    {
+        if constexpr(HasSensorTime) {
+            return SensorClockSync(imu::SensorTimeTickMicros, imu::SensorTimeMask, imu::GyrTs * 1e6f,
+                imu::SensorTimeAlignedToSamples, ClockSyncIntervalMicros);
+        }
+        else {
+            // never synced, only keeps the nominal sample timestamps going
+            return SensorClockSync(1.0f, 0xFFFFFFFF, imu::GyrTs * 1e6f, false, ClockSyncIntervalMicros);
+        }
+    }
+
     bool detected() const
     {
-        const auto value = m_sensor.i2c.readReg(imu::Regs::WhoAmI::reg);
+        // the IMU may still be booting, on SPI it wasn't probed on the bus before either.
+        // Only an IMU that doesn't answer yet (0x00 from a failed read, 0xFF from an idle bus) is retried, a different
+        // ID is another IMU and autodetection moves on to the next driver right away
+        const uint32_t start = millis();
+        auto value = m_sensor.i2c.readReg(imu::Regs::WhoAmI::reg);
+        while ((value == 0x00 || value == 0xFF) && millis() - start < IMU_BOOT_TIMEOUT_MS) {
+            delay(1);
+            value = m_sensor.i2c.readReg(imu::Regs::WhoAmI::reg);
+        }
         if (imu::Regs::WhoAmI::value != value) {
             m_Logger.error("Sensor not detected, expected reg 0x%02x = 0x%02x but got 0x%02x",
                 imu::Regs::WhoAmI::reg, imu::Regs::WhoAmI::value, value);
@@ -71,49 +125,218 @@ class SoftFusionSensor : public Sensor
     }
 
 
-    void sendTempIfNeeded()
+    void syncSensorClockIfNeeded()
+    {
+        if constexpr(HasSensorTime) {
+            const uint32_t now = micros();
+            if (!m_clockSync.syncDue(now)) {
+                return;
+            }
+            const uint32_t rawSensorTime = m_sensor.getSensorTime();
+            m_clockSync.update(now, rawSensorTime, micros() - now);
+        }
+    }
+
+    #if SFUSION_DEBUG
+    void updateFifoStats(uint32_t stepStart, uint32_t stepGyroSamples, bool drainFinished)
+    {
+        // gyro samples drained by one poll is the backlog the tracker was running behind by
+        uint32_t end = micros();
+        m_fifoStats.readMicros += end - stepStart;
+        m_fifoStats.currentBacklog += stepGyroSamples;
+        if (!drainFinished) {
+            return;
+        }
+        m_fifoStats.polls++;
+        m_fifoStats.gyroSamples += m_fifoStats.currentBacklog;
+        m_fifoStats.maxBacklog = std::max(m_fifoStats.maxBacklog, m_fifoStats.currentBacklog);
+        m_fifoStats.currentBacklog = 0;
+        if (end - m_fifoStats.lastPrinted < 1000000) {
+            return;
+        }
+
+        m_Logger.debug("FIFO: %u polls, %u gyro samples, backlog avg %.1f max %u (%.1f ms), bulkRead took %.3f ms, fusion %.0f cycles/sample",
+            m_fifoStats.polls,
+            m_fifoStats.gyroSamples,
+            m_fifoStats.polls ? static_cast<float>(m_fifoStats.gyroSamples) / m_fifoStats.polls : 0.0f,
+            m_fifoStats.maxBacklog,
+            m_fifoStats.maxBacklog * m_calibration.G_Ts * 1e3f,
+            m_fifoStats.readMicros / 1e3f,
+            m_fifoStats.fusedSamples ? static_cast<float>(m_fifoStats.fusionCycles) / m_fifoStats.fusedSamples : 0.0f);
+        m_fifoStats = {};
+        m_fifoStats.lastPrinted = end;
+    }
+    #endif
+
+    void updateTemperatureIfNeeded()
     {
         uint32_t now = micros();
-        constexpr float maxSendRateHz = 2.0f;
-        constexpr uint32_t sendInterval = 1.0f/maxSendRateHz * 1e6;
-        uint32_t elapsed = now - m_lastTemperaturePacketSent;
-        if (elapsed >= sendInterval) {
-            const float temperature = m_sensor.getDirectTemp();
-            m_lastTemperaturePacketSent = now - (elapsed - sendInterval);
-            networkConnection.sendTemperature(sensorId, temperature);
+        uint32_t elapsed = now - m_lastTemperatureRead;
+        if (elapsed >= TemperatureIntervalMicros) {
+            m_temperature = m_sensor.getDirectTemp();
+            m_lastTemperatureRead = now - (elapsed - TemperatureIntervalMicros);
+            setTemperature(m_temperature);
+            if (m_tempCalibrator) {
+                updateGyroTransform();
+            }
         }
     }
 
-    void recalcFusion()
+    void setupTemperatureCalibration()
+    {
+        #if SFUSION_USE_TEMPCAL
+            m_tempCalibrator = std::make_unique<GyroTemperatureCalibrator>(
+                SlimeVR::Configuration::CalibrationConfigType::SFUSION,
+                sensorId,
+                imu::GyroSensitivity,
+                TempCalSamplesPerStep
+            );
+            m_tempCalibrator->loadConfig(imu::GyroSensitivity);
+            m_temperature = m_sensor.getDirectTemp();
+            updateTempCalStaticOffset();
+        #endif
+    }
+
+    // G_off was measured at the calibration temperature, the curve supplies the change from there.
+    // Without a gyro calibration the curve is used as the offset directly
+    void updateTempCalStaticOffset()
     {
-        m_fusion = SensorFusionRestDetect(m_calibration.G_Ts, m_calibration.A_Ts, m_calibration.M_Ts);
+        float offsetAtCalibration[3];
+        const bool hasStaticOffset = m_tempCalibrator && m_calibration.temperature != 0.0f
+            && m_tempCalibrator->approximateOffset(m_calibration.temperature, offsetAtCalibration);
+        for (uint8_t i = 0; i < 3; i++) {
+            m_tempCalStaticOffset[i] = hasStaticOffset ? m_calibration.G_off[i] - offsetAtCalibration[i] : 0.0f;
+        }
+        updateGyroTransform();
+    }
+
+    #if SFUSION_BACKGROUND_CALIBRATION
+    // takes the latest background estimates into the calibration, the fusion filters are left
+    // alone as rebuilding them would reset the orientation
+    void applyBackgroundCalibration()
+    {
+        float offset[3];
+        float temperature;
+        if (m_backgroundCalibrator.takeGyroOffset(offset, temperature)) {
+            for (uint8_t i = 0; i < 3; i++) {
+                m_calibration.G_off[i] = offset[i];
+            }
+            m_calibration.temperature = temperature;
+            updateTempCalStaticOffset();
+            m_backgroundCalibrationChanged = true;
+        }
+
+        float gyrTs;
+        float accTs;
+        if (m_backgroundCalibrator.takeSamplePeriods(gyrTs, accTs)) {
+            m_calibration.G_Ts = gyrTs;
+            m_calibration.A_Ts = accTs;
+            m_backgroundCalibrationChanged = true;
+        }
+
+        constexpr uint32_t saveIntervalMillis = SFUSION_BACKGROUND_CALIBRATION_SAVE_MINUTES * 60 * 1000;
+        if (!m_backgroundCalibrationChanged
+            || millis() - m_lastBackgroundCalibrationSave < saveIntervalMillis) {
+            return;
+        }
+        m_Logger.debug("Background calibration: gyro offset %f %f %f at %.1f C, gyro %.2f Hz, accel %.2f Hz",
+            UNPACK_VECTOR_ARRAY(m_calibration.G_off), m_calibration.temperature,
+            1.0 / m_calibration.G_Ts, 1.0 / m_calibration.A_Ts);
+        m_calibrationSavePending = true;
+        m_lastBackgroundCalibrationSave = millis();
+        m_backgroundCalibrationChanged = false;
     }
+    #endif
 
-    void processAccelSample(const int16_t xyz[3], const sensor_real_t timeDelta)
+    // rebuilt whenever the offset, the temperature it depends on or the accel calibration changes,
+    // queued batches are flushed first so they still go through the transform they were sampled with
+    void updateGyroTransform()
     {
-        sensor_real_t accelData[] = {
-            static_cast<sensor_real_t>(xyz[0]),
-            static_cast<sensor_real_t>(xyz[1]),
-            static_cast<sensor_real_t>(xyz[2]) };
+        flushSampleBatches();
+        double offset[3] = {m_calibration.G_off[0], m_calibration.G_off[1], m_calibration.G_off[2]};
+        float offsetAtTemperature[3];
+        if (m_tempCalibrator && m_tempCalibrator->approximateOffset(m_temperature, offsetAtTemperature)) {
+            for (uint8_t i = 0; i < 3; i++) {
+                offset[i] = offsetAtTemperature[i] + m_tempCalStaticOffset[i];
+            }
+        }
+        constexpr double scale[3] = {GScale, GScale, GScale};
+        m_gyroTransform = SampleTransform::offsetScale(offset, scale);
+    }
 
-        float tmp[3];
-        for (uint8_t i = 0; i < 3; i++)
-            tmp[i] = (accelData[i] - m_calibration.A_B[i]);
+    void updateAccelTransform()
+    {
+        flushSampleBatches();
+        m_accelTransform = SampleTransform::biasMatrixScale(m_calibration.A_B, m_calibration.A_Ainv, AScale);
+    }
 
-        accelData[0] = (m_calibration.A_Ainv[0][0] * tmp[0] + m_calibration.A_Ainv[0][1] * tmp[1] + m_calibration.A_Ainv[0][2] * tmp[2]) * AScale;
-        accelData[1] = (m_calibration.A_Ainv[1][0] * tmp[0] + m_calibration.A_Ainv[1][1] * tmp[1] + m_calibration.A_Ainv[1][2] * tmp[2]) * AScale;
-        accelData[2] = (m_calibration.A_Ainv[2][0] * tmp[0] + m_calibration.A_Ainv[2][1] * tmp[1] + m_calibration.A_Ainv[2][2] * tmp[2]) * AScale;
+    void recalcFusion()
+    {
+        m_fusion = SensorFusionRestDetect(m_calibration.G_Ts, m_calibration.A_Ts, m_calibration.M_Ts,
+                                          m_fusion.getEngineType(), SFUSION_GYRO_PREINTEGRATION);
+    }
 
-        m_fusion.updateAcc(accelData, m_calibration.A_Ts);
+    // Samples of a bulkRead are queued per kind and fused once the FIFO burst is read. Each accel
+    // sample remembers how many gyro samples came before it, so fusion still sees them in FIFO order
+    void queueAccelSample(const int16_t xyz[3])
+    {
+        #if SFUSION_BACKGROUND_CALIBRATION
+            m_backgroundCalibrator.onAccelSample();
+        #endif
+        if (m_accelBatch.full()) {
+            flushSampleBatches();
+        }
+        m_accelBatch.push(xyz, m_gyroBatch.count);
     }
 
-    void processGyroSample(const int16_t xyz[3], const sensor_real_t timeDelta)
+    void queueGyroSample(const int16_t xyz[3])
     {
-        const sensor_real_t scaledData[] = {
-            static_cast<sensor_real_t>(GScale * (static_cast<sensor_real_t>(xyz[0]) - m_calibration.G_off[0])),
-            static_cast<sensor_real_t>(GScale * (static_cast<sensor_real_t>(xyz[1]) - m_calibration.G_off[1])),
-            static_cast<sensor_real_t>(GScale * (static_cast<sensor_real_t>(xyz[2]) - m_calibration.G_off[2]))};
-        m_fusion.updateGyro(scaledData, m_calibration.G_Ts);
+        if (m_gyroBatch.full()) {
+            flushSampleBatches();
+        }
+        m_gyroBatch.push(xyz);
+    }
+
+    void flushSampleBatches()
+    {
+        if (m_gyroBatch.empty() && m_accelBatch.empty()) {
+            return;
+        }
+        #if SFUSION_DEBUG
+            const uint32_t cyclesStart = ESP.getCycleCount();
+        #endif
+
+        // the calibrated sample rate is only a fallback until the sensor clock is tracked
+        const bool synced = m_clockSync.isSynced();
+        for (size_t i = 0; i < m_gyroBatch.count; i++) {
+            const double sampleDtMicros = m_clockSync.nextSampleDtMicros();
+            m_gyroBatch.dt[i] = synced
+                ? static_cast<sensor_real_t>(sampleDtMicros * 1e-6)
+                : m_calibration.G_Ts;
+        }
+        // accel shares the oscillator with the gyro, so it drifts by the same ratio
+        const sensor_real_t accelDelta = synced
+            ? static_cast<sensor_real_t>(imu::AccTs * m_clockSync.getRatio())
+            : m_calibration.A_Ts;
+        m_fusion.updateBatches(m_gyroBatch, m_gyroTransform, m_accelBatch, m_accelTransform, accelDelta);
+
+        #if SFUSION_DEBUG
+            m_fifoStats.fusionCycles += ESP.getCycleCount() - cyclesStart;
+            m_fifoStats.fusedSamples += m_gyroBatch.count + m_accelBatch.count;
+        #endif
+
+        // the calibrations get every gyro sample with the rest state fusion had reached at that sample
+        for (size_t i = 0; i < m_gyroBatch.count; i++) {
+            const int16_t xyz[3] = {m_gyroBatch.x[i], m_gyroBatch.y[i], m_gyroBatch.z[i]};
+            if (m_tempCalibrator) {
+                m_tempCalibrator->updateGyroTemperatureCalibration(m_temperature, m_gyroBatch.atRest[i], xyz[0], xyz[1], xyz[2]);
+            }
+            #if SFUSION_BACKGROUND_CALIBRATION
+                m_backgroundCalibrator.onGyroSample(xyz, m_gyroBatch.atRest[i], m_temperature);
+            #endif
+        }
+        m_gyroBatch.clear();
+        m_accelBatch.clear();
     }
 
     void eatSamplesForSeconds(const uint32_t seconds) {
@@ -162,26 +385,54 @@ class SoftFusionSensor : public Sensor
 public:
     static constexpr auto TypeID = imu::Type;
     static constexpr uint8_t Address = imu::Address;
-
-    SoftFusionSensor(uint8_t id, uint8_t addrSuppl, float rotation, uint8_t sclPin, uint8_t sdaPin, uint8_t)
-    : Sensor(imu::Name, imu::Type, id, imu::Address + addrSuppl, rotation, sclPin, sdaPin),
-      m_fusion(imu::GyrTs, imu::AccTs, imu::MagTs), m_sensor(I2CImpl(imu::Address + addrSuppl), m_Logger) {}
+    static constexpr bool IsSPI = requires { requires I2CImpl::IsSPI; };
+    // initialize() polls the IMU until it is ready, there is no need to wait out the boot time first
+    static constexpr bool WaitsUntilReady = true;
+
+    SoftFusionSensor(uint8_t id, uint8_t addrSuppl, Quat rotation, uint8_t sclPin, uint8_t sdaPin, uint8_t intPin)
+    : Sensor(imu::Name, imu::Type, id, IsSPI ? imu::Address : imu::Address + addrSuppl, rotation, sclPin, sdaPin),
+      m_fusion(imu::GyrTs, imu::AccTs, imu::MagTs, DefaultFusionEngine, SFUSION_GYRO_PREINTEGRATION), m_sensor(makeTransport(addrSuppl), m_Logger),
+      m_fifoTrigger(intPin, micros()) {}
     ~SoftFusionSensor(){}
 
     void motionLoop() override final
     {
-        sendTempIfNeeded();
+        updateTemperatureIfNeeded();
+        syncSensorClockIfNeeded();
 
         // read fifo updating fusion
+        // with SFUSION_FIFO_CHUNKS_PER_LOOP set, a backlog bigger than that many transactions is drained
+        // over the following loops, so other sensors and the network get their turn between the bus transfers
         uint32_t now = micros();
-        constexpr uint32_t targetPollIntervalMicros = 6000;
-        uint32_t elapsed = now - m_lastPollTime;
-        if (elapsed >= targetPollIntervalMicros) {
-            m_lastPollTime = now - (elapsed - targetPollIntervalMicros);
-            m_sensor.bulkRead(
-                [&](const int16_t xyz[3], const sensor_real_t timeDelta) { processAccelSample(xyz, timeDelta); },
-                [&](const int16_t xyz[3], const sensor_real_t timeDelta) { processGyroSample(xyz, timeDelta); }
-            );
+        if (m_fifoDrainPending || m_fifoTrigger.readDue(now)) {
+            #if SFUSION_DEBUG
+                uint32_t stepGyroSamples = 0;
+                m_fifoDrainPending = m_sensor.bulkRead(
+                    [&](const int16_t xyz[3], const sensor_real_t timeDelta) { queueAccelSample(xyz); },
+                    [&](const int16_t xyz[3], const sensor_real_t timeDelta) { queueGyroSample(xyz); ++stepGyroSamples; },
+                    FifoChunksPerLoop
+                );
+                flushSampleBatches();
+                updateFifoStats(now, stepGyroSamples, !m_fifoDrainPending);
+            #else
+                m_fifoDrainPending = m_sensor.bulkRead(
+                    [&](const int16_t xyz[3], const sensor_real_t timeDelta) { queueAccelSample(xyz); },
+                    [&](const int16_t xyz[3], const sensor_real_t timeDelta) { queueGyroSample(xyz); },
+                    FifoChunksPerLoop
+                );
+                flushSampleBatches();
+            #endif
+            if (!m_fifoDrainPending) {
+                const uint32_t drainedAt = micros();
+                m_clockSync.anchorLastSample(drainedAt);
+                #if SFUSION_BACKGROUND_CALIBRATION
+                    m_backgroundCalibrator.onFifoDrained(drainedAt);
+                    applyBackgroundCalibration();
+                #endif
+            }
+            if (!m_fifoDrainPending) {
+                m_fifoTrigger.fifoDrained(m_sensor);
+            }
             optimistic_yield(100);
             if (!m_fusion.isUpdated()) return;
             hadData = true;
@@ -191,18 +442,30 @@ public:
 
         // send new fusion values when time is up
         now = micros();
-        constexpr float maxSendRateHz = 120.0f;
-        constexpr uint32_t sendInterval = 1.0f/maxSendRateHz * 1e6;
-        elapsed = now - m_lastRotationPacketSent;
-        if (elapsed >= sendInterval) {
-            m_lastRotationPacketSent = now - (elapsed - sendInterval);
-
-            setFusedRotation(m_fusion.getQuaternionQuat());
+        if (m_sendRate.shouldSend(now, m_fusion.getAngularSpeed(), m_fusion.getRestDetected())) {
+            uint32_t rotationMicros;
+            const Quat rotation = predictedRotation(now, rotationMicros);
+            setFusedRotation(rotation, rotationMicros);
             setAcceleration(m_fusion.getLinearAccVec());
             optimistic_yield(100);
         }
     }
 
+    // rotation extrapolated from the last gyro sample to `now`, by at most SFUSION_PREDICTION_HORIZON_MS,
+    // rotationMicros gets the time the rotation is for
+    Quat predictedRotation(uint32_t now, uint32_t &rotationMicros)
+    {
+        rotationMicros = getLastSampleTimestamp();
+        if constexpr(SFUSION_PREDICTION_HORIZON_MS <= 0) {
+            return m_fusion.getQuaternionQuat();
+        }
+        constexpr int32_t maxHorizonMicros = SFUSION_PREDICTION_HORIZON_MS * 1000;
+        const int32_t sampleAge = now - getLastSampleTimestamp();
+        const int32_t horizonMicros = std::clamp(sampleAge, static_cast<int32_t>(0), maxHorizonMicros);
+        rotationMicros += horizonMicros;
+        return m_fusion.getPredictedQuaternionQuat(horizonMicros * 1e-6f);
+    }
+
     void motionSetup() override final
     {
         if (!detected()) {
@@ -215,10 +478,19 @@ public:
         // If no compatible calibration data is found, the calibration data will just be zero-ed out
         if (sensorCalibration.type == SlimeVR::Configuration::CalibrationConfigType::SFUSION
             && (sensorCalibration.data.sfusion.ImuType == imu::Type)
-            && (sensorCalibration.data.sfusion.MotionlessDataLen == MotionlessCalibDataSize())) {
+            && (sensorCalibration.data.sfusion.MotionlessDataLen == MotionlessCalibDataSize())
+            && SoftFusion::Profiles::sampleTimesMatch<imu>(sensorCalibration.data.sfusion.G_Ts, sensorCalibration.data.sfusion.A_Ts)) {
             m_calibration = sensorCalibration.data.sfusion;
             recalcFusion();
         }
+        else if (sensorCalibration.type == SlimeVR::Configuration::CalibrationConfigType::SFUSION
+            && (sensorCalibration.data.sfusion.ImuType == imu::Type)) {
+            m_Logger.warn("Calibration data for sensor %d was made with a different ODR profile, ignoring...", sensorId);
+            m_Logger.warn("Calibrated at gyro %.1fHz, accel %.1fHz, the current profile runs at %.1fHz, %.1fHz (+-%.0f%%)",
+                1.0f / sensorCalibration.data.sfusion.G_Ts, 1.0f / sensorCalibration.data.sfusion.A_Ts,
+                1.0f / imu::GyrTs, 1.0f / imu::AccTs, SoftFusion::Profiles::SampleTimeTolerance * 100);
+            m_Logger.info("Please recalibrate");
+        }
         else if (sensorCalibration.type == SlimeVR::Configuration::CalibrationConfigType::NONE) {
             m_Logger.warn("No calibration data found for sensor %d, ignoring...", sensorId);
             m_Logger.info("Calibration is advised");
@@ -245,6 +517,14 @@ public:
             return;
         }
 
+        setupTemperatureCalibration();
+        updateGyroTransform();
+        updateAccelTransform();
+        m_fifoTrigger.setup(m_sensor);
+        if (m_fifoTrigger.usesInterrupt()) {
+            m_Logger.info("Reading FIFO on watermark interrupt (INT pin %d)", m_fifoTrigger.getIntPin());
+        }
+
         m_status = SensorStatus::SENSOR_OK;
         working = true;
         [[maybe_unused]] auto lastRawSample = eatSamplesReturnLast(1000);
@@ -279,6 +559,7 @@ public:
                 typename imu::MotionlessCalibrationData calibData;
                 m_sensor.motionlessCalibration(calibData);
                 std::memcpy(m_calibration.MotionlessData, &calibData, sizeof(calibData));
+                m_fifoTrigger.setup(m_sensor);
             }
             calibrateAccel();
         }
@@ -299,12 +580,69 @@ public:
                 typename imu::MotionlessCalibrationData calibData;
                 m_sensor.motionlessCalibration(calibData);
                 std::memcpy(m_calibration.MotionlessData, &calibData, sizeof(calibData));
+                m_fifoTrigger.setup(m_sensor);
             } else {
                 m_Logger.info("Sensor doesn't provide any custom motionless calibration");
             }
         }
 
-        saveCalibration();
+        // estimates in progress still hold data from before the calibration
+        #if SFUSION_BACKGROUND_CALIBRATION
+            m_backgroundCalibrator = BackgroundCalibrator(imu::GyrTs, imu::AccTs);
+            m_backgroundCalibrationChanged = false;
+        #endif
+        updateGyroTransform();
+        updateAccelTransform();
+        m_calibrationSavePending = true;
+    }
+
+    bool hasDeferredWork() override final
+    {
+        return m_calibrationSavePending || (m_tempCalibrator && m_tempCalibrator->configSavePending);
+    }
+
+    void runDeferredWork() override final
+    {
+        if (m_calibrationSavePending.exchange(false)) {
+            saveCalibration();
+        }
+        if (m_tempCalibrator) {
+            m_tempCalibrator->savePendingConfig();
+        }
+    }
+
+    void printTemperatureCalibrationState() override final
+    {
+        if (!m_tempCalibrator) {
+            return Sensor::printTemperatureCalibrationState();
+        }
+        m_tempCalibrator->printState(m_Logger, m_temperature);
+    }
+
+    void printDebugTemperatureCalibrationState() override final
+    {
+        if (!m_tempCalibrator) {
+            return Sensor::printDebugTemperatureCalibrationState();
+        }
+        m_tempCalibrator->printDebugState(m_Logger, 1.0f / imu::GyrTs);
+    }
+
+    void resetTemperatureCalibrationState() override final
+    {
+        if (!m_tempCalibrator) {
+            return Sensor::resetTemperatureCalibrationState();
+        }
+        m_tempCalibrator->reset();
+        updateTempCalStaticOffset();
+        m_Logger.info("Temperature calibration state has been reset for sensorId:%i", sensorId);
+    }
+
+    void saveTemperatureCalibration() override final
+    {
+        if (!m_tempCalibrator) {
+            return Sensor::saveTemperatureCalibration();
+        }
+        m_tempCalibrator->saveConfig();
     }
 
     void saveCalibration()
@@ -358,6 +696,7 @@ public:
         m_calibration.G_off[2] = ((double)sumXYZ[2]) / sampleCount;
 
         m_Logger.info("Gyro offset after %d samples: %f %f %f", sampleCount, UNPACK_VECTOR_ARRAY(m_calibration.G_off));
+        updateTempCalStaticOffset();
     }
 
     void calibrateAccel()
@@ -498,11 +837,38 @@ public:
         recalcFusion();
     }
 
+    // moves the IMU to another I2C controller, has to be called before motionSetup
+    void setI2CBus(TwoWire *wire) requires(!IsSPI)
+    {
+        m_sensor.i2c.setWire(wire);
+    }
+
+    // local micros() timestamp of the newest gyro sample fed to fusion
+    uint32_t getLastSampleTimestamp() const
+    {
+        return m_clockSync.getLastSampleTimestamp();
+    }
+
+    bool usesI2C() const override final
+    {
+        return !IsSPI;
+    }
+
     SensorStatus getSensorState() override final
     {
         return m_status;
     }
 
+    SensorFusion *getSensorFusion() override final
+    {
+        return &m_fusion;
+    }
+
+    const SendRateScheduler *getSendRateScheduler() const override final
+    {
+        return &m_sendRate;
+    }
+
     SensorFusionRestDetect m_fusion;
     T<I2CImpl> m_sensor;
     SlimeVR::Configuration::SoftFusionCalibrationConfig m_calibration = {
@@ -523,9 +889,37 @@ public:
     };
 
     SensorStatus m_status = SensorStatus::SENSOR_OFFLINE;
-    uint32_t m_lastPollTime = micros();
-    uint32_t m_lastRotationPacketSent = 0;
-    uint32_t m_lastTemperaturePacketSent = 0;
+    SoftFusion::FifoReadTrigger<imu> m_fifoTrigger;
+    bool m_fifoDrainPending = false;
+    SensorClockSync m_clockSync = makeClockSync();
+    #if SFUSION_DEBUG
+    struct {
+        uint32_t lastPrinted = 0;
+        uint32_t readMicros = 0;
+        uint32_t polls = 0;
+        uint32_t gyroSamples = 0;
+        uint32_t maxBacklog = 0;
+        uint32_t currentBacklog = 0;
+        uint32_t fusionCycles = 0;
+        uint32_t fusedSamples = 0;
+    } m_fifoStats;
+    #endif
+    RawSampleBatch m_gyroBatch;
+    RawSampleBatch m_accelBatch;
+    SampleTransform m_gyroTransform;
+    SampleTransform m_accelTransform;
+    SendRateScheduler m_sendRate{static_cast<float>(1.0 / imu::GyrTs)};
+    uint32_t m_lastTemperatureRead = 0;
+    float m_temperature = 0.0f;
+    std::unique_ptr<GyroTemperatureCalibrator> m_tempCalibrator;
+    // calibration changes are saved by runDeferredWork() on the main loop
+    std::atomic<bool> m_calibrationSavePending{false};
+    #if SFUSION_BACKGROUND_CALIBRATION
+    BackgroundCalibrator m_backgroundCalibrator{imu::GyrTs, imu::AccTs};
+    bool m_backgroundCalibrationChanged = false;
+    uint32_t m_lastBackgroundCalibrationSave = millis();
+    #endif
+    float m_tempCalStaticOffset[3]{0.0f, 0.0f, 0.0f};
 };
 
 } // namespace
@@ -0,0 +1,122 @@
+/*
+    SlimeVR Code is placed under the MIT license
+    Copyright (c) 2024 Tailsy13 & SlimeVR Contributors
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <Arduino.h>
+#include <SPI.h>
+
+#include "globals.h"
+
+namespace SlimeVR::Sensors::SoftFusion
+{
+
+// Same register access surface as I2CImpl, for IMUs wired over SPI.
+// All SPI IMUs share one bus, each one selected by its own chip select pin.
+struct SPIImpl
+{
+    static constexpr bool IsSPI = true;
+    // even, so BMI270 firmware upload chunks stay word aligned
+    static constexpr size_t MaxTransactionLength = 252;
+
+    static constexpr uint8_t ReadBit = 0x80;
+
+    SPIImpl(uint8_t csPin, uint8_t readDummyBytes = 0)
+        : m_csPin(csPin), m_readDummyBytes(readDummyBytes)
+    {
+        beginBus();
+        pinMode(m_csPin, OUTPUT);
+        // rising edge on CS also switches Bosch IMUs from I2C to SPI mode
+        digitalWrite(m_csPin, LOW);
+        digitalWrite(m_csPin, HIGH);
+    }
+
+    uint8_t readReg(uint8_t regAddr) const {
+        uint8_t buffer = 0;
+        readBytes(regAddr, sizeof(buffer), &buffer);
+        return buffer;
+    }
+
+    uint16_t readReg16(uint8_t regAddr) const {
+        uint16_t buffer = 0;
+        readBytes(regAddr, sizeof(buffer), reinterpret_cast<uint8_t*>(&buffer));
+        return buffer;
+    }
+
+    void writeReg(uint8_t regAddr, uint8_t value) const {
+        writeBytes(regAddr, sizeof(value), &value);
+    }
+
+    void writeReg16(uint8_t regAddr, uint16_t value) const {
+        writeBytes(regAddr, sizeof(value), reinterpret_cast<uint8_t*>(&value));
+    }
+
+    void readBytes(uint8_t regAddr, uint8_t size, uint8_t* buffer) const {
+        select();
+        SPI.transfer(regAddr | ReadBit);
+        for (uint8_t i = 0; i < m_readDummyBytes; i++) {
+            SPI.transfer(0);
+        }
+        std::memset(buffer, 0, size);
+        SPI.transfer(buffer, size);
+        deselect();
+    }
+
+    void writeBytes(uint8_t regAddr, uint8_t size, uint8_t* buffer) const {
+        select();
+        SPI.transfer(regAddr & ~ReadBit);
+        SPI.writeBytes(buffer, size);
+        deselect();
+    }
+
+    private:
+        void select() const {
+            SPI.beginTransaction(SPISettings(SPI_SPEED, MSBFIRST, SPI_MODE3));
+            digitalWrite(m_csPin, LOW);
+        }
+
+        void deselect() const {
+            digitalWrite(m_csPin, HIGH);
+            SPI.endTransaction();
+        }
+
+        static void beginBus() {
+            static bool started = false;
+            if (started) {
+                return;
+            }
+            #if defined(ESP32) && defined(PIN_IMU_SPI_SCK)
+                SPI.begin(PIN_IMU_SPI_SCK, PIN_IMU_SPI_MISO, PIN_IMU_SPI_MOSI);
+            #else
+                SPI.begin();
+            #endif
+            started = true;
+        }
+
+        uint8_t m_csPin;
+        uint8_t m_readDummyBytes;
+};
+
+}
@@ -28,6 +28,7 @@
 #include "GlobalVars.h"
 #include "batterymonitor.h"
 #include "utils.h"
+#include "sensors/SendRateScheduler.h"
 
 #if ESP32
     #include "nvs_flash.h"
@@ -114,6 +115,47 @@ namespace SerialCommands {
 					WiFiNetwork::setWiFiCredentials(ssid, ppass);
 					logger.info("CMD SET BWIFI OK: New wifi credentials set, reconnecting");
 				}
+			} else if (parser->equalCmdParam(1, "FUSION")) {
+				if(parser->getParamCount() < 4) {
+					logger.error("CMD SET FUSION ERROR: Too few arguments");
+					logger.info("Syntax: SET FUSION <SENSOR ID|ALL> <mahony|madgwick|bvqf|vqf|fixedmahony>");
+				} else {
+					SlimeVR::Sensors::FusionEngineType engine;
+					if (!SlimeVR::Sensors::parseFusionEngineName(parser->getCmdParam(3), engine)) {
+						logger.error("CMD SET FUSION ERROR: Unknown fusion engine %s", parser->getCmdParam(3));
+						return;
+					}
+
+					const bool allSensors = parser->equalCmdParam(2, "ALL");
+					uint8_t sensorId = 0;
+					if (!allSensors) {
+						const char *sensorParam = parser->getCmdParam(2);
+						char *sensorParamEnd = nullptr;
+						const unsigned long parsedId = sensorParam == nullptr ? 0 : strtoul(sensorParam, &sensorParamEnd, 10);
+						if (sensorParamEnd == sensorParam || sensorParamEnd == nullptr || *sensorParamEnd != '\0'
+							|| parsedId > UINT8_MAX) {
+							logger.error("CMD SET FUSION ERROR: Invalid sensor id %s", sensorParam == nullptr ? "" : sensorParam);
+							return;
+						}
+						sensorId = parsedId;
+					}
+					bool found = false;
+					auto sensorsLock = sensorManager.lockSensors();
+					for (auto &sensor : sensorManager.getSensors()) {
+						if (!allSensors && sensor->getSensorId() != sensorId) {
+							continue;
+						}
+						found = true;
+						if (sensorManager.setFusionEngine(*sensor, engine)) {
+							logger.info("CMD SET FUSION OK: Sensor[%d] uses %s", sensor->getSensorId(), SlimeVR::Sensors::getFusionEngineName(engine));
+						} else if (!allSensors) {
+							logger.error("CMD SET FUSION ERROR: Sensor[%d] fuses on the IMU", sensor->getSensorId());
+						}
+					}
+					if (!found) {
+						logger.error("CMD SET FUSION ERROR: No sensor %s", parser->getCmdParam(2));
+					}
+				}
 			} else {
 				logger.error("CMD SET ERROR: Unrecognized variable to set");
 			}
@@ -134,6 +176,7 @@ namespace SerialCommands {
             statusManager.getStatus(),
             WiFiNetwork::getWiFiState()
         );
+        auto sensorsLock = sensorManager.lockSensors();
         for (auto &sensor : sensorManager.getSensors()) {
             logger.info(
                 "Sensor[%d]: %s (%.3f %.3f %.3f %.3f) is working: %s, had data: %s",
@@ -143,6 +186,64 @@ namespace SerialCommands {
                 sensor->isWorking() ? "true" : "false",
                 sensor->getHadData() ? "true" : "false"
             );
+            if (auto *fusion = sensor->getSensorFusion()) {
+                #if SFUSION_DEBUG
+                logger.info(
+                    "Sensor[%d] fusion: %s, %.1f us/update, gyro samples per fusion update: %d",
+                    sensor->getSensorId(),
+                    SlimeVR::Sensors::getFusionEngineName(fusion->getEngineType()),
+                    fusion->getMicrosPerUpdate(),
+                    fusion->getGyroPreintegration()
+                );
+                #else
+                logger.info(
+                    "Sensor[%d] fusion: %s, gyro samples per fusion update: %d",
+                    sensor->getSensorId(),
+                    SlimeVR::Sensors::getFusionEngineName(fusion->getEngineType()),
+                    fusion->getGyroPreintegration()
+                );
+                #endif
+            }
+            if (auto *sendRate = sensor->getSendRateScheduler()) {
+                logger.info(
+                    "Sensor[%d] send rate: %.0f Hz now, %.1f Hz average (%.0f Hz at rest, %.0f-%.0f Hz in motion)",
+                    sensor->getSensorId(),
+                    sendRate->getRateHz(),
+                    sendRate->getAverageRateHz(),
+                    SlimeVR::Sensors::SendRateScheduler::getRestRateHz(),
+                    sendRate->getMovingRateHz(),
+                    sendRate->getMaxRateHz()
+                );
+            }
+        }
+        #if PACKET_BUNDLING != PACKET_BUNDLING_DISABLED
+        const auto& bundles = networkConnection.getBundleStats();
+        logger.info(
+            "Packet bundles: %u sent, %.1f packets per bundle (max %u), %u sent early when full, %u packets too big, %u failed to send",
+            bundles.bundlesSent,
+            bundles.bundlesSent ? (float)bundles.bundledPackets / bundles.bundlesSent : 0.0f,
+            bundles.maxPacketsPerBundle,
+            bundles.overflowFlushes,
+            bundles.packetsDropped,
+            bundles.sendFailures
+        );
+        #endif
+        const auto& received = networkConnection.getReceiveStats();
+        logger.info(
+            "Received packets: %u in %u loops (max %u per loop), receive budget used up %u times, %u unknown",
+            received.packetsHandled,
+            received.updatesWithPackets,
+            received.maxPacketsPerUpdate,
+            received.budgetExhausted,
+            received.unknownPackets
+        );
+        if (networkConnection.canSendSampleTimestamps()) {
+            const auto& clock = networkConnection.getClockOffset();
+            logger.info(
+                "Server clock offset: %lld us, round trip: %lld us",
+                static_cast<long long>(clock.getOffsetMicros()),
+                static_cast<long long>(clock.getDelayMicros())
+            );
         }
         logger.info(
             "Battery voltage: %.3f, level: %.1f%%",
@@ -215,6 +316,7 @@ namespace SerialCommands {
                 statusManager.getStatus(),
                 WiFiNetwork::getWiFiState()
             );
+            auto sensorsLock = sensorManager.lockSensors();
             auto& sensor0 = sensorManager.getSensors()[0];
             sensor0->motionLoop();
             logger.info(
@@ -276,6 +378,8 @@ namespace SerialCommands {
     void cmdFactoryReset(CmdParser * parser) {
         logger.info("FACTORY RESET");
 
+        // sensors may save calibration from the acquisition task, don't let them write in between
+        auto sensorsLock = sensorManager.lockSensors();
         configuration.reset();
 
         WiFi.disconnect(true); // Clear WiFi credentials
@@ -303,6 +407,7 @@ namespace SerialCommands {
 
     void cmdTemperatureCalibration(CmdParser* parser) {
         if (parser->getParamCount() > 1) {
+            auto sensorsLock = sensorManager.lockSensors();
             if (parser->equalCmdParam(1, "PRINT")) {
                 for (auto &sensor : sensorManager.getSensors()) {
                     sensor->printTemperatureCalibrationState();
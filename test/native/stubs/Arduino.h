@@ -0,0 +1,106 @@
+/*
+	SlimeVR Code is placed under the MIT license
+	Copyright (c) 2024 SlimeVR Contributors
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+	THE SOFTWARE.
+*/
+
+// Stands in for the Arduino core in the native tests, with only what the tested code uses.
+// The clock is driven by the tests through ArduinoStub::microsNow, delays advance it.
+// Pin levels are kept in ArduinoStub::pinLevels, Serial output in ArduinoStub::serialOutput.
+// ESP.getCycleCount() counts real nanoseconds, so the firmware's cycle statistics work as a
+// host benchmark.
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#define LOW 0
+#define HIGH 1
+#define INPUT 0
+#define OUTPUT 1
+
+namespace ArduinoStub {
+inline uint32_t microsNow = 0;
+inline uint8_t pinLevels[256] = {};
+inline std::string serialOutput;
+}  // namespace ArduinoStub
+
+inline unsigned long micros() { return ArduinoStub::microsNow; }
+inline unsigned long millis() { return ArduinoStub::microsNow / 1000; }
+inline void delayMicroseconds(uint32_t us) { ArduinoStub::microsNow += us; }
+inline void delay(uint32_t ms) { ArduinoStub::microsNow += ms * 1000; }
+
+struct EspClass {
+	uint32_t getCycleCount() {
+		return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()
+		).count());
+	}
+	uint32_t getCpuFreqMHz() { return 1000; }
+};
+
+inline EspClass ESP;
+
+using std::max;
+using std::min;
+
+template <typename T, typename L, typename H>
+inline T constrain(T value, L low, H high) {
+	return value < low ? low : (value > high ? high : value);
+}
+
+inline void pinMode(uint8_t pin, uint8_t mode) {}
+inline void digitalWrite(uint8_t pin, uint8_t level) { ArduinoStub::pinLevels[pin] = level; }
+inline int digitalRead(uint8_t pin) { return ArduinoStub::pinLevels[pin]; }
+
+struct HardwareSerial {
+	int printf(const char* format, ...) {
+		char buffer[512];
+		va_list args;
+		va_start(args, format);
+		const int length = vsnprintf(buffer, sizeof(buffer), format, args);
+		va_end(args);
+		ArduinoStub::serialOutput += buffer;
+		return length;
+	}
+
+	template <typename T>
+	size_t print(T value) {
+		const auto text = std::to_string(value);
+		ArduinoStub::serialOutput += text;
+		return text.size();
+	}
+
+	size_t println() {
+		ArduinoStub::serialOutput += "\n";
+		return 1;
+	}
+};
+
+inline HardwareSerial Serial;
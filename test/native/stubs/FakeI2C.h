@@ -0,0 +1,121 @@
+/*
+	SlimeVR Code is placed under the MIT license
+	Copyright (c) 2024 SlimeVR Contributors
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+	THE SOFTWARE.
+*/
+
+
+// Stands in for SoftFusion::I2CImpl in the native tests. Registers live in a FakeI2CDevice,
+// reads of its FIFO data register pop bytes from `fifo` instead, and every transfer is
+// recorded. Hooks let a test model status registers and bits that clear themselves.
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <vector>
+
+struct FakeI2CDevice {
+	struct Transfer {
+		bool write;
+		uint8_t reg;
+		size_t length;
+	};
+
+	uint8_t regs[256] = {};
+	std::deque<uint8_t> fifo;
+	int fifoDataReg = -1;
+	std::vector<Transfer> transfers;
+	// called before every read transfer, e.g. to put the FIFO fill level into the status registers
+	std::function<void(FakeI2CDevice&)> beforeRead;
+	// called after every byte written
+	std::function<void(FakeI2CDevice&, uint8_t reg, uint8_t value)> afterWrite;
+
+	void read(uint8_t reg, size_t length, uint8_t* buffer) {
+		if (beforeRead) {
+			beforeRead(*this);
+		}
+		transfers.push_back({false, reg, length});
+		for (size_t i = 0; i < length; i++) {
+			if (reg == fifoDataReg) {
+				buffer[i] = fifo.empty() ? 0 : fifo.front();
+				if (!fifo.empty()) {
+					fifo.pop_front();
+				}
+			} else {
+				buffer[i] = regs[static_cast<uint8_t>(reg + i)];
+			}
+		}
+	}
+
+	void write(uint8_t reg, size_t length, const uint8_t* buffer) {
+		transfers.push_back({true, reg, length});
+		for (size_t i = 0; i < length; i++) {
+			const uint8_t target = reg + i;
+			regs[target] = buffer[i];
+			if (afterWrite) {
+				afterWrite(*this, target, buffer[i]);
+			}
+		}
+	}
+
+	size_t readTransfers(uint8_t reg) const {
+		size_t count = 0;
+		for (const auto& transfer : transfers) {
+			count += !transfer.write && transfer.reg == reg;
+		}
+		return count;
+	}
+};
+
+struct FakeI2CImpl {
+	// I2C_BUFFER_LENGTH of the ESP cores minus the register address
+	static constexpr size_t MaxTransactionLength = 126;
+
+	FakeI2CDevice* device;
+
+	uint8_t readReg(uint8_t regAddr) const {
+		uint8_t value;
+		device->read(regAddr, 1, &value);
+		return value;
+	}
+
+	uint16_t readReg16(uint8_t regAddr) const {
+		uint8_t buffer[2];
+		device->read(regAddr, 2, buffer);
+		return buffer[0] | (buffer[1] << 8);
+	}
+
+	void writeReg(uint8_t regAddr, uint8_t value) const { device->write(regAddr, 1, &value); }
+
+	void writeReg16(uint8_t regAddr, uint16_t value) const {
+		const uint8_t buffer[2] = {static_cast<uint8_t>(value), static_cast<uint8_t>(value >> 8)};
+		device->write(regAddr, 2, buffer);
+	}
+
+	void readBytes(uint8_t regAddr, uint8_t size, uint8_t* buffer) const {
+		device->read(regAddr, size, buffer);
+	}
+
+	void writeBytes(uint8_t regAddr, uint8_t size, uint8_t* buffer) const {
+		device->write(regAddr, size, buffer);
+	}
+};
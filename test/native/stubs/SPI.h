@@ -0,0 +1,115 @@
+/*
+	SlimeVR Code is placed under the MIT license
+	Copyright (c) 2024 SlimeVR Contributors
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+	THE SOFTWARE.
+*/
+
+// Records SPI transactions for the native tests instead of driving a bus. Every
+// beginTransaction() starts a new Transaction, bytes read back come from misoBytes.
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "Arduino.h"
+
+#define MSBFIRST 1
+#define SPI_MODE3 3
+
+struct SPISettings {
+	SPISettings(uint32_t clock, uint8_t bitOrder, uint8_t dataMode)
+		: clock(clock)
+		, bitOrder(bitOrder)
+		, dataMode(dataMode) {}
+
+	uint32_t clock;
+	uint8_t bitOrder;
+	uint8_t dataMode;
+};
+
+class SPIClass {
+public:
+	struct Transaction {
+		SPISettings settings;
+		std::vector<uint8_t> mosi;
+		// chipSelectPin was low for every byte
+		bool selected = true;
+	};
+
+	void begin() { begun = true; }
+
+	void beginTransaction(SPISettings settings) {
+		transactions.push_back(Transaction{settings, {}});
+		inTransaction = true;
+	}
+
+	void endTransaction() { inTransaction = false; }
+
+	uint8_t transfer(uint8_t value) {
+		record(value);
+		if (misoBytes.empty()) {
+			return 0;
+		}
+		const uint8_t reply = misoBytes.front();
+		misoBytes.pop_front();
+		return reply;
+	}
+
+	void transfer(void* buffer, size_t size) {
+		auto* bytes = static_cast<uint8_t*>(buffer);
+		for (size_t i = 0; i < size; i++) {
+			bytes[i] = transfer(bytes[i]);
+		}
+	}
+
+	void writeBytes(const uint8_t* data, uint32_t size) {
+		for (uint32_t i = 0; i < size; i++) {
+			record(data[i]);
+		}
+	}
+
+	void reset() {
+		transactions.clear();
+		misoBytes.clear();
+		bytesOutsideTransactions = 0;
+	}
+
+	uint8_t chipSelectPin = 0;
+	std::deque<uint8_t> misoBytes;
+	std::vector<Transaction> transactions;
+	size_t bytesOutsideTransactions = 0;
+	bool begun = false;
+
+private:
+	void record(uint8_t value) {
+		if (!inTransaction) {
+			bytesOutsideTransactions++;
+			return;
+		}
+		transactions.back().mosi.push_back(value);
+		transactions.back().selected &= ArduinoStub::pinLevels[chipSelectPin] == LOW;
+	}
+
+	bool inTransaction = false;
+};
+
+inline SPIClass SPI;
@@ -0,0 +1,210 @@
+/*
+    SlimeVR Code is placed under the MIT license
+    Copyright (c) 2024 SlimeVR Contributors
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+
+#include <unity.h>
+
+#include <cmath>
+#include <random>
+
+#include "motionprocessing/BackgroundCalibrator.h"
+
+constexpr float GyrTs = 1.0f / 800;
+constexpr float AccTs = 1.0f / 100;
+
+static std::mt19937 rng;
+
+// raw gyro around `offset` with a couple of counts of noise, or a turn when moving
+static void gyroSample(const float offset[3], bool moving, int16_t xyz[3])
+{
+    std::normal_distribution<float> noise(0.0f, 2.0f);
+    for (uint8_t i = 0; i < 3; i++) {
+        xyz[i] = static_cast<int16_t>(std::lround(offset[i] + noise(rng) + (moving ? 3000 : 0)));
+    }
+}
+
+// feeds `seconds` of gyro samples, at rest or not
+static void feed(BackgroundCalibrator &calibrator, const float offset[3], float seconds, bool atRest,
+                 float temperature = 30.0f)
+{
+    for (int i = 0; i < static_cast<int>(seconds / GyrTs + 0.5f); i++) {
+        int16_t xyz[3];
+        gyroSample(offset, !atRest, xyz);
+        calibrator.onGyroSample(xyz, atRest, temperature);
+    }
+}
+
+// A FIFO filled by an IMU whose clock is off by `ratio`, losing a fraction of the gyro samples,
+// and drained every 5 ms
+struct SimulatedFifo
+{
+    double ratio;
+    double lost;
+    double now = 1000;
+    double nextGyro = 0;
+    double nextAccel = 0;
+    double dropped = 0;
+
+    void run(BackgroundCalibrator &calibrator, double seconds)
+    {
+        const double gyroPeriod = GyrTs * ratio * 1e6;
+        const double accelPeriod = AccTs * ratio * 1e6;
+        const float offset[3] = {0, 0, 0};
+        for (const double end = now + seconds * 1e6; now < end; now += 5000) {
+            while (nextGyro <= now) {
+                dropped += lost;
+                if (dropped >= 1) {
+                    dropped -= 1;
+                } else {
+                    int16_t xyz[3];
+                    gyroSample(offset, true, xyz);
+                    calibrator.onGyroSample(xyz, false, 30.0f);
+                }
+                nextGyro += gyroPeriod;
+            }
+            while (nextAccel <= now) {
+                calibrator.onAccelSample();
+                nextAccel += accelPeriod;
+            }
+            calibrator.onFifoDrained(static_cast<uint32_t>(now));
+        }
+    }
+};
+
+void setUp()
+{
+    rng.seed(3);
+}
+
+void tearDown() {}
+
+void test_offset_after_rest_and_guard()
+{
+    BackgroundCalibrator calibrator(GyrTs, AccTs);
+    const float offset[3] = {12.3f, -40.7f, 3.1f};
+    float out[3];
+    float temperature;
+
+    feed(calibrator, offset, BackgroundCalibrator::RestWindowSeconds, true, 31.5f);
+    // the window is complete, but rest still has to hold through the guard
+    TEST_ASSERT_FALSE(calibrator.takeGyroOffset(out, temperature));
+    feed(calibrator, offset, BackgroundCalibrator::RestGuardSeconds, true, 31.5f);
+    TEST_ASSERT_TRUE(calibrator.takeGyroOffset(out, temperature));
+    for (uint8_t i = 0; i < 3; i++) {
+        TEST_ASSERT_FLOAT_WITHIN(0.2f, offset[i], out[i]);
+    }
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 31.5f, temperature);
+    // handed out once
+    TEST_ASSERT_FALSE(calibrator.takeGyroOffset(out, temperature));
+}
+
+void test_motion_in_guard_discards_window()
+{
+    BackgroundCalibrator calibrator(GyrTs, AccTs);
+    const float offset[3] = {5, 5, 5};
+    float out[3];
+    float temperature;
+
+    // rest detection flagged motion late, the window before it may already hold some of it
+    feed(calibrator, offset, BackgroundCalibrator::RestWindowSeconds + 0.2f, true);
+    feed(calibrator, offset, 0.1f, false);
+    feed(calibrator, offset, 1.0f, true);
+    TEST_ASSERT_FALSE(calibrator.takeGyroOffset(out, temperature));
+}
+
+void test_motion_restarts_window()
+{
+    BackgroundCalibrator calibrator(GyrTs, AccTs);
+    const float offset[3] = {-7, 2, 9};
+    float out[3];
+    float temperature;
+
+    feed(calibrator, offset, 2.0f, true);
+    feed(calibrator, offset, 0.1f, false);
+    feed(calibrator, offset, BackgroundCalibrator::RestWindowSeconds + BackgroundCalibrator::RestGuardSeconds - 0.1f, true);
+    TEST_ASSERT_FALSE(calibrator.takeGyroOffset(out, temperature));
+    feed(calibrator, offset, 0.2f, true);
+    TEST_ASSERT_TRUE(calibrator.takeGyroOffset(out, temperature));
+    for (uint8_t i = 0; i < 3; i++) {
+        TEST_ASSERT_FLOAT_WITHIN(0.2f, offset[i], out[i]);
+    }
+}
+
+void test_long_rest_keeps_refining()
+{
+    BackgroundCalibrator calibrator(GyrTs, AccTs);
+    float offset[3] = {1, 2, 3};
+    float out[3];
+    float temperature;
+
+    feed(calibrator, offset, BackgroundCalibrator::RestWindowSeconds + BackgroundCalibrator::RestGuardSeconds, true, 30.0f);
+    TEST_ASSERT_TRUE(calibrator.takeGyroOffset(out, temperature));
+
+    // the offset moves as the sensor warms up, the windows that follow pick that up; the one
+    // running during the guard is partly from before, and only the latest estimate is kept
+    offset[0] = 4;
+    feed(calibrator, offset, 2 * BackgroundCalibrator::RestWindowSeconds, true, 35.0f);
+    TEST_ASSERT_TRUE(calibrator.takeGyroOffset(out, temperature));
+    TEST_ASSERT_FLOAT_WITHIN(0.2f, 4.0f, out[0]);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 35.0f, temperature);
+}
+
+void test_sample_periods_follow_imu_clock()
+{
+    BackgroundCalibrator calibrator(GyrTs, AccTs);
+    float gyrTs;
+    float accTs;
+
+    // the IMU runs 0.3% slow, one window has to pass after the first empty FIFO
+    SimulatedFifo fifo{1.003, 0};
+    fifo.run(calibrator, BackgroundCalibrator::RateWindowSeconds - 1);
+    TEST_ASSERT_FALSE(calibrator.takeSamplePeriods(gyrTs, accTs));
+    fifo.run(calibrator, 2);
+    TEST_ASSERT_TRUE(calibrator.takeSamplePeriods(gyrTs, accTs));
+    TEST_ASSERT_FLOAT_WITHIN(GyrTs * 1e-4f, GyrTs * 1.003f, gyrTs);
+    TEST_ASSERT_FLOAT_WITHIN(AccTs * 1e-3f, AccTs * 1.003f, accTs);
+    TEST_ASSERT_FALSE(calibrator.takeSamplePeriods(gyrTs, accTs));
+}
+
+void test_sample_periods_ignore_lost_samples()
+{
+    BackgroundCalibrator calibrator(GyrTs, AccTs);
+    float gyrTs;
+    float accTs;
+
+    // a fifth of the gyro samples lost to FIFO overflows looks like a 25% longer period
+    SimulatedFifo fifo{1.0, 0.2};
+    fifo.run(calibrator, 2 * BackgroundCalibrator::RateWindowSeconds + 1);
+    TEST_ASSERT_FALSE(calibrator.takeSamplePeriods(gyrTs, accTs));
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_offset_after_rest_and_guard);
+    RUN_TEST(test_motion_in_guard_discards_window);
+    RUN_TEST(test_motion_restarts_window);
+    RUN_TEST(test_long_rest_keeps_refining);
+    RUN_TEST(test_sample_periods_follow_imu_clock);
+    RUN_TEST(test_sample_periods_ignore_lost_samples);
+    return UNITY_END();
+}
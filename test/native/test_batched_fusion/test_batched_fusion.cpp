@@ -0,0 +1,303 @@
+/*
+    SlimeVR Code is placed under the MIT license
+    Copyright (c) 2024 SlimeVR Contributors
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+
+#include <unity.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "sensors/SensorFusionRestDetect.h"
+
+using namespace SlimeVR::Sensors;
+
+// LSM6DSV at its default profile: 480 Hz gyro, 120 Hz accel, 1000 dps, 8 g
+constexpr float GyrTs = 1.0f / 480;
+constexpr float AccTs = 1.0f / 120;
+constexpr double GyroSensitivity = 1000 / 35.0;
+constexpr double AccelSensitivity = 1000 / 0.244;
+constexpr double GScale = (1.0 / GyroSensitivity) * (M_PI / 180.0);
+constexpr double AScale = 9.80665 / AccelSensitivity;
+
+const double GyroOffset[3] = {12.0, -7.0, 3.0};
+const double AccelBias[3] = {20.0, -8.0, 30.0}; // raw counts
+const double AccelMatrix[3][3] = {{1.01, 0.002, 0.0}, {0.002, 0.99, -0.001}, {0.0, -0.001, 1.005}};
+
+struct FifoSample
+{
+    bool gyro;
+    int16_t xyz[3];
+};
+
+// FIFO content as the LSM6DSV delivers it, an accel entry after every 4th gyro entry. The device
+// turns about a tilted axis for `movingSeconds` and lies still afterwards
+static std::vector<FifoSample> makeFifo(float movingSeconds, float restSeconds, uint32_t seed = 1)
+{
+    std::mt19937 rng(seed);
+    // quiet enough for the rest detection thresholds
+    std::normal_distribution<double> gyroNoise(0.0, 0.7);
+    std::normal_distribution<double> accelNoise(0.0, 2.0);
+    std::vector<FifoSample> fifo;
+    const int gyroSamples = static_cast<int>((movingSeconds + restSeconds) / GyrTs);
+    double angle = 0.0;
+    for (int i = 0; i < gyroSamples; i++) {
+        const bool moving = i * GyrTs < movingSeconds;
+        const double rate = moving ? 2.0 * std::sin(i * GyrTs * 3.0) : 0.0;
+        angle += rate * GyrTs;
+
+        FifoSample gyro{true, {}};
+        const double w[3] = {rate * 0.6, rate * 0.8, 0.0};
+        for (int k = 0; k < 3; k++) {
+            gyro.xyz[k] = static_cast<int16_t>(std::lround(w[k] / GScale + GyroOffset[k] + gyroNoise(rng)));
+        }
+        fifo.push_back(gyro);
+
+        if (i % 4 == 3) {
+            FifoSample accel{false, {}};
+            const double g[3] = {0.8 * 9.80665 * std::sin(angle), -0.6 * 9.80665 * std::sin(angle), 9.80665 * std::cos(angle)};
+            for (int k = 0; k < 3; k++) {
+                accel.xyz[k] = static_cast<int16_t>(std::lround(g[k] / AScale + AccelBias[k] + accelNoise(rng)));
+            }
+            fifo.push_back(accel);
+        }
+    }
+    return fifo;
+}
+
+static SampleTransform gyroTransform()
+{
+    const double scale[3] = {GScale, GScale, GScale};
+    return SampleTransform::offsetScale(GyroOffset, scale);
+}
+
+static SampleTransform accelTransform()
+{
+    return SampleTransform::biasMatrixScale(AccelBias, AccelMatrix, AScale);
+}
+
+// the path before batching: every sample calibrated in double and fused right away
+struct PerSampleFusion
+{
+    SensorFusionRestDetect fusion;
+    std::vector<bool> atRest;
+
+    explicit PerSampleFusion(FusionEngineType engine) : fusion(GyrTs, AccTs, -1.0f, engine) {}
+
+    void run(const FifoSample *begin, const FifoSample *end)
+    {
+        for (const FifoSample *sample = begin; sample != end; sample++) {
+            sensor_real_t out[3];
+            if (sample->gyro) {
+                atRest.push_back(fusion.getRestDetected());
+                for (int k = 0; k < 3; k++) {
+                    out[k] = static_cast<sensor_real_t>((sample->xyz[k] - GyroOffset[k]) * GScale);
+                }
+                fusion.updateGyro(out, GyrTs);
+            } else {
+                double unbiased[3];
+                for (int k = 0; k < 3; k++) {
+                    unbiased[k] = sample->xyz[k] - AccelBias[k];
+                }
+                for (int k = 0; k < 3; k++) {
+                    out[k] = static_cast<sensor_real_t>(AScale * (AccelMatrix[k][0] * unbiased[0] + AccelMatrix[k][1] * unbiased[1]
+                                                                  + AccelMatrix[k][2] * unbiased[2]));
+                }
+                fusion.updateAcc(out, AccTs);
+            }
+        }
+    }
+
+    void run(const std::vector<FifoSample> &fifo) { run(fifo.data(), fifo.data() + fifo.size()); }
+};
+
+// the batched path of SoftFusionSensor, flushed whenever a batch is full and after every burst
+struct BatchedFusion
+{
+    SensorFusionRestDetect fusion;
+    SampleTransform gyro = gyroTransform();
+    SampleTransform accel = accelTransform();
+    RawSampleBatch gyroBatch;
+    RawSampleBatch accelBatch;
+    std::vector<bool> atRest;
+
+    explicit BatchedFusion(FusionEngineType engine) : fusion(GyrTs, AccTs, -1.0f, engine) {}
+
+    void flush()
+    {
+        for (size_t i = 0; i < gyroBatch.count; i++) {
+            gyroBatch.dt[i] = GyrTs;
+        }
+        fusion.updateBatches(gyroBatch, gyro, accelBatch, accel, AccTs);
+        atRest.insert(atRest.end(), gyroBatch.atRest, gyroBatch.atRest + gyroBatch.count);
+        gyroBatch.clear();
+        accelBatch.clear();
+    }
+
+    // one bulkRead
+    void run(const FifoSample *begin, const FifoSample *end)
+    {
+        for (const FifoSample *sample = begin; sample != end; sample++) {
+            if (sample->gyro) {
+                if (gyroBatch.full()) {
+                    flush();
+                }
+                gyroBatch.push(sample->xyz);
+            } else {
+                if (accelBatch.full()) {
+                    flush();
+                }
+                accelBatch.push(sample->xyz, gyroBatch.count);
+            }
+        }
+        flush();
+    }
+
+    void run(const std::vector<FifoSample> &fifo, size_t burst)
+    {
+        for (size_t i = 0; i < fifo.size(); i += burst) {
+            run(fifo.data() + i, fifo.data() + std::min(i + burst, fifo.size()));
+        }
+    }
+};
+
+static float angleBetween(Quat a, Quat b)
+{
+    const float dot = std::fabs(a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w) / (a.length() * b.length());
+    return 2.0f * std::acos(std::min(1.0f, dot));
+}
+
+void setUp() {}
+void tearDown() {}
+
+static void assertBatchMatchesPerSample(FusionEngineType engine, size_t burst)
+{
+    // rest is detected a few seconds after the motion, once the filters settled
+    const auto fifo = makeFifo(2.0f, 6.0f);
+    PerSampleFusion reference(engine);
+    BatchedFusion batched(engine);
+    float maxAngle = 0.0f;
+    for (size_t i = 0; i < fifo.size(); i += burst) {
+        const FifoSample *end = fifo.data() + std::min(i + burst, fifo.size());
+        reference.run(fifo.data() + i, end);
+        batched.run(fifo.data() + i, end);
+        maxAngle = std::max(maxAngle, angleBetween(reference.fusion.getQuaternionQuat(), batched.fusion.getQuaternionQuat()));
+    }
+
+    // only float vs double calibration differs, the order of the updates is the same. Fusing the
+    // accel of a burst after all of its gyro drifts by 0.02 rad and more on this motion
+    TEST_ASSERT_TRUE(maxAngle < 2e-3f);
+    TEST_ASSERT_EQUAL(reference.atRest.size(), batched.atRest.size());
+    TEST_ASSERT_FALSE(reference.atRest.front());
+    TEST_ASSERT_TRUE(reference.atRest.back());
+    size_t restMismatches = 0;
+    for (size_t i = 0; i < reference.atRest.size(); i++) {
+        restMismatches += reference.atRest[i] != batched.atRest[i];
+    }
+    TEST_ASSERT_EQUAL(0, restMismatches);
+}
+
+void test_vqf_batches_match_per_sample_fusion()
+{
+    assertBatchMatchesPerSample(FusionEngineType::VQF, 25);
+}
+
+void test_mahony_batches_match_per_sample_fusion()
+{
+    assertBatchMatchesPerSample(FusionEngineType::Mahony, 25);
+}
+
+void test_bursts_bigger_than_a_batch_keep_order()
+{
+    // a full gyro batch flushes the accel queued in between
+    assertBatchMatchesPerSample(FusionEngineType::VQF, 500);
+}
+
+void test_accel_goes_in_between_gyro_samples()
+{
+    // one accel sample ahead of the first gyro sample and one after both of them
+    BatchedFusion batched(FusionEngineType::Mahony);
+    const int16_t gyro[3] = {12, -7, 3};
+    const int16_t accel[3] = {0, 0, 4096};
+    batched.accelBatch.push(accel, batched.gyroBatch.count);
+    batched.gyroBatch.push(gyro);
+    batched.gyroBatch.push(gyro);
+    batched.accelBatch.push(accel, batched.gyroBatch.count);
+    TEST_ASSERT_EQUAL(0, batched.accelBatch.otherBefore[0]);
+    TEST_ASSERT_EQUAL(2, batched.accelBatch.otherBefore[1]);
+    batched.flush();
+    TEST_ASSERT_TRUE(batched.gyroBatch.empty());
+    TEST_ASSERT_TRUE(batched.accelBatch.empty());
+}
+
+void test_rest_flag_follows_samples_within_a_burst()
+{
+    // the whole run is read as one burst per batch, rest is still detected in its middle
+    const auto fifo = makeFifo(1.0f, 6.0f);
+    BatchedFusion batched(FusionEngineType::Mahony);
+    batched.run(fifo, fifo.size());
+
+    TEST_ASSERT_FALSE(batched.atRest.front());
+    TEST_ASSERT_TRUE(batched.atRest.back());
+    size_t changes = 0;
+    for (size_t i = 1; i < batched.atRest.size(); i++) {
+        changes += batched.atRest[i] != batched.atRest[i - 1];
+    }
+    TEST_ASSERT_EQUAL(1, changes);
+}
+
+// Host benchmark of calibration plus fusion, per sample in double against the batches. Prints ns
+// per FIFO sample and doesn't assert on them, the numbers depend on the host and the build flags
+void test_benchmark_batched_fusion()
+{
+    const auto fifo = makeFifo(10.0f, 10.0f);
+    using Clock = std::chrono::steady_clock;
+    double perSampleNs = 1e30;
+    double batchedNs = 1e30;
+    for (int round = 0; round < 3; round++) {
+        PerSampleFusion reference(FusionEngineType::VQF);
+        auto start = Clock::now();
+        reference.run(fifo);
+        perSampleNs = std::min(perSampleNs, std::chrono::duration<double, std::nano>(Clock::now() - start).count() / fifo.size());
+
+        BatchedFusion batched(FusionEngineType::VQF);
+        start = Clock::now();
+        batched.run(fifo, 25);
+        batchedNs = std::min(batchedNs, std::chrono::duration<double, std::nano>(Clock::now() - start).count() / fifo.size());
+        TEST_ASSERT_EQUAL(reference.atRest.size(), batched.atRest.size());
+    }
+    printf("calibration + VQF per FIFO sample: per sample %.1f ns, batched %.1f ns\n", perSampleNs, batchedNs);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_vqf_batches_match_per_sample_fusion);
+    RUN_TEST(test_mahony_batches_match_per_sample_fusion);
+    RUN_TEST(test_bursts_bigger_than_a_batch_keep_order);
+    RUN_TEST(test_accel_goes_in_between_gyro_samples);
+    RUN_TEST(test_rest_flag_follows_samples_within_a_burst);
+    RUN_TEST(test_benchmark_batched_fusion);
+    return UNITY_END();
+}
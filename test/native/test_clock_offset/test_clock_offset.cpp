@@ -0,0 +1,158 @@
+/*
+	SlimeVR Code is placed under the MIT license
+	Copyright (c) 2024 SlimeVR Contributors
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+	THE SOFTWARE.
+*/
+
+#include <unity.h>
+
+#include <cmath>
+#include <random>
+
+#include "network/ClockOffsetEstimator.h"
+
+using SlimeVR::Network::ClockOffsetEstimator;
+
+void setUp() {}
+void tearDown() {}
+
+void test_unwrap_extends_micros_past_wrap() {
+	ClockOffsetEstimator estimator;
+	TEST_ASSERT_EQUAL_INT64(0x7ff00000ll, estimator.unwrap(0x7ff00000u));
+	TEST_ASSERT_EQUAL_INT64(0xffe00000ll, estimator.unwrap(0xffe00000u));
+	TEST_ASSERT_EQUAL_INT64(0x100100000ll, estimator.unwrap(0x00100000u));
+	// timestamps from before the wrap still convert
+	TEST_ASSERT_EQUAL_INT64(0xffff0000ll, estimator.toServerMicros(0xffff0000u));
+}
+
+void test_symmetric_round_trip_gives_exact_offset() {
+	ClockOffsetEstimator estimator;
+	const int64_t offset = 1000000000;
+	for (int64_t i = 0; i < 3; i++) {
+		const int64_t sent = i * 1000000;
+		estimator.unwrap(sent + 2500);
+		// 1 ms each way, 500 us on the server
+		estimator.addSample(sent, sent + 1000 + offset, sent + 1500 + offset, sent + 2500);
+		TEST_ASSERT_EQUAL(i >= 2, estimator.isSynced());
+	}
+	TEST_ASSERT_EQUAL_INT64(offset, estimator.getOffsetMicros());
+	TEST_ASSERT_EQUAL_INT64(2000, estimator.getDelayMicros());
+	TEST_ASSERT_EQUAL_INT64(2000000 + offset, estimator.toServerMicros(2000000));
+}
+
+void test_rejects_round_trips_with_negative_delay() {
+	ClockOffsetEstimator estimator;
+	estimator.addSample(0, 1000, 1500, 2500);
+	// server reply before the request arrived
+	estimator.addSample(10000, 12000, 11000, 13000);
+	// answered faster than the server took to reply
+	estimator.addSample(20000, 21000, 25000, 22000);
+	TEST_ASSERT_FALSE(estimator.isSynced());
+	TEST_ASSERT_EQUAL_INT64(0, estimator.getOffsetMicros());
+}
+
+// One ping per second over a network with 1 ms base delay, exponential jitter of 5 ms on
+// average, 10% of packets held up by 100 ms and 5% lost, while micros() wraps around.
+// Sample timestamps converted over the following second must stay within a few ms.
+static void simulateWithDrift(double drift) {
+	std::mt19937 rng(7);
+	std::exponential_distribution<double> jitter(1 / 5000.0);
+	std::uniform_real_distribution<double> uniform(0, 1);
+	auto oneWayDelay = [&]() { return 1000 + jitter(rng) + (uniform(rng) < 0.1 ? 100000 : 0); };
+	const double localStart = 4294967296.0 - 20e6;
+	auto localAt = [&](double t) { return static_cast<uint32_t>(static_cast<uint64_t>(localStart + t)); };
+	auto serverAt = [&](double t) { return static_cast<int64_t>(1.7e15 + t * (1 + drift)); };
+
+	ClockOffsetEstimator estimator;
+	int64_t lastPong = 0;
+	int64_t lastPongServerReceived = 0;
+	bool pongArrived = false;
+	double maxError = 0;
+	double sumSquaredError = 0;
+	int errors = 0;
+	int syncedAt = -1;
+	for (int ping = 0; ping < 600; ping++) {
+		const double pingSent = ping * 1e6;
+		// the ping carries the send time of the last pong and when the server got it
+		const int64_t origin = pongArrived ? lastPong : 0;
+		const int64_t serverReceived = lastPongServerReceived;
+		const int64_t serverSent = serverAt(pingSent);
+		if (uniform(rng) < 0.05) {
+			continue;
+		}
+		const double pingReceived = pingSent + oneWayDelay();
+		const int64_t localReceived = estimator.unwrap(localAt(pingReceived));
+		if (origin != 0 && origin == lastPong) {
+			estimator.addSample(origin, serverReceived, serverSent, localReceived);
+		}
+
+		const double pongSent = pingReceived + 200;
+		lastPong = estimator.unwrap(localAt(pongSent));
+		pongArrived = uniform(rng) >= 0.05;
+		if (pongArrived) {
+			lastPongServerReceived = serverAt(pongSent + oneWayDelay());
+		}
+
+		if (!estimator.isSynced()) {
+			continue;
+		}
+		if (syncedAt < 0) {
+			syncedAt = ping;
+		}
+		// rotations sent over the next second, stamped with IMU samples a few ms old
+		for (int k = 1; k < 10; k++) {
+			const double sampleTime = pingReceived + k * 100000;
+			estimator.unwrap(localAt(sampleTime + 3000));
+			const double error = std::abs(static_cast<double>(estimator.toServerMicros(localAt(sampleTime)) - serverAt(sampleTime)));
+			if (ping >= 20) {
+				maxError = std::max(maxError, error);
+			}
+			sumSquaredError += error * error;
+			errors++;
+		}
+	}
+
+	TEST_ASSERT_LESS_OR_EQUAL(5, syncedAt);
+	TEST_ASSERT_LESS_THAN_FLOAT(3000.0f, maxError);
+	TEST_ASSERT_LESS_THAN_FLOAT(1000.0f, std::sqrt(sumSquaredError / errors));
+}
+
+void test_simulated_network_without_drift() {
+	simulateWithDrift(0);
+}
+
+void test_simulated_network_with_fast_server_clock() {
+	simulateWithDrift(30e-6);
+}
+
+void test_simulated_network_with_slow_server_clock() {
+	simulateWithDrift(-40e-6);
+}
+
+int main() {
+	UNITY_BEGIN();
+	RUN_TEST(test_unwrap_extends_micros_past_wrap);
+	RUN_TEST(test_symmetric_round_trip_gives_exact_offset);
+	RUN_TEST(test_rejects_round_trips_with_negative_delay);
+	RUN_TEST(test_simulated_network_without_drift);
+	RUN_TEST(test_simulated_network_with_fast_server_clock);
+	RUN_TEST(test_simulated_network_with_slow_server_clock);
+	return UNITY_END();
+}
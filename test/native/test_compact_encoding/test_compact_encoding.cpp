@@ -0,0 +1,122 @@
+/*
+	SlimeVR Code is placed under the MIT license
+	Copyright (c) 2024 SlimeVR Contributors
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+	THE SOFTWARE.
+*/
+
+#include <unity.h>
+
+#include <random>
+
+#include "network/CompactEncoding.h"
+
+using namespace SlimeVR::Network::CompactEncoding;
+
+// Angle of the rotation between a and b in degrees, q and -q being the same rotation.
+// 4 asin(|a - b| / 2) stays precise for tiny angles where 2 acos(|a.b|) doesn't
+static double rotationErrorDegrees(const Quat& a, const Quat& b) {
+	double dot = 0;
+	for (int i = 0; i < 4; i++) {
+		dot += static_cast<double>(a[i]) * b[i];
+	}
+	const double sign = dot < 0 ? -1.0 : 1.0;
+	double distanceSquared = 0;
+	for (int i = 0; i < 4; i++) {
+		const double d = a[i] - sign * b[i];
+		distanceSquared += d * d;
+	}
+	return 4 * std::asin(std::sqrt(distanceSquared) / 2) * 180 / M_PI;
+}
+
+static void assertRoundTrip(Quat q) {
+	q.normalize();
+	const uint64_t bits = encodeQuaternion(q);
+	TEST_ASSERT_EQUAL(0, bits >> 47);
+	TEST_ASSERT_LESS_THAN_FLOAT(0.01f, rotationErrorDegrees(q, decodeQuaternion(bits)));
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_random_rotations_round_trip() {
+	std::mt19937 rng(1);
+	std::normal_distribution<float> normal;
+	double maxError = 0;
+	for (int i = 0; i < 100000; i++) {
+		Quat q(normal(rng), normal(rng), normal(rng), normal(rng));
+		q.normalize();
+		maxError = std::max(maxError, rotationErrorDegrees(q, decodeQuaternion(encodeQuaternion(q))));
+	}
+	TEST_ASSERT_LESS_THAN_FLOAT(0.01f, maxError);
+}
+
+void test_axis_rotations_round_trip() {
+	for (int i = 0; i < 4; i++) {
+		for (float sign : {1.0f, -1.0f}) {
+			Quat q(0, 0, 0, 0);
+			q[i] = sign;
+			assertRoundTrip(q);
+			// two components of the same size, either may be taken as the largest
+			q[(i + 1) % 4] = -sign;
+			assertRoundTrip(q);
+		}
+	}
+	assertRoundTrip(Quat(0.5f, 0.5f, 0.5f, 0.5f));
+	assertRoundTrip(Quat(-0.5f, 0.5f, -0.5f, 0.5f));
+}
+
+void test_largest_component_index() {
+	for (int i = 0; i < 4; i++) {
+		Quat q(0.1f, 0.1f, 0.1f, 0.1f);
+		q[i] = -0.9f;
+		q.normalize();
+		TEST_ASSERT_EQUAL(i, static_cast<int>((encodeQuaternion(q) >> 45) & 3));
+	}
+}
+
+void test_zero_quaternion_is_identity() {
+	const Quat decoded = decodeQuaternion(encodeQuaternion(Quat(0, 0, 0, 0)));
+	TEST_ASSERT_LESS_THAN_FLOAT(0.01f, rotationErrorDegrees(Quat(), decoded));
+}
+
+void test_acceleration_round_trip() {
+	std::mt19937 rng(2);
+	std::uniform_real_distribution<float> range(-255.0f, 255.0f);
+	for (int i = 0; i < 100000; i++) {
+		const float value = range(rng);
+		TEST_ASSERT_FLOAT_WITHIN(0.5f / AccelerationScale, value, decodeAcceleration(encodeAcceleration(value)));
+	}
+}
+
+void test_acceleration_clamps() {
+	TEST_ASSERT_EQUAL(INT16_MAX, encodeAcceleration(1000.0f));
+	TEST_ASSERT_EQUAL(INT16_MIN, encodeAcceleration(-1000.0f));
+}
+
+int main() {
+	UNITY_BEGIN();
+	RUN_TEST(test_random_rotations_round_trip);
+	RUN_TEST(test_axis_rotations_round_trip);
+	RUN_TEST(test_largest_component_index);
+	RUN_TEST(test_zero_quaternion_is_identity);
+	RUN_TEST(test_acceleration_round_trip);
+	RUN_TEST(test_acceleration_clamps);
+	return UNITY_END();
+}
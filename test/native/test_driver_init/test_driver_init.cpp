@@ -0,0 +1,134 @@
+/*
+    SlimeVR Code is placed under the MIT license
+    Copyright (c) 2024 SlimeVR Contributors
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+
+#include <unity.h>
+
+#include "FakeI2C.h"
+#include "logging/Logger.h"
+#include "sensors/softfusion/drivers/bmi270.h"
+#include "sensors/softfusion/drivers/icm42688.h"
+#include "sensors/softfusion/drivers/lsm6ds3trc.h"
+#include "sensors/softfusion/drivers/lsm6dsv.h"
+
+using namespace SlimeVR::Sensors::SoftFusion;
+
+static SlimeVR::Logging::Logger logger("DriverInitTest");
+
+// a reset bit that the device clears again, writing `done` into `statusReg` once finished
+static void completeResetOn(FakeI2CDevice &device, uint8_t resetReg, uint8_t resetBit, uint8_t statusReg, uint8_t done)
+{
+    device.afterWrite = [=](FakeI2CDevice &dev, uint8_t reg, uint8_t value) {
+        if (reg == resetReg && (value & resetBit)) {
+            dev.regs[resetReg] &= ~resetBit;
+            dev.regs[statusReg] |= done;
+        }
+    };
+}
+
+static bool logged(const char *text)
+{
+    return ArduinoStub::serialOutput.find(text) != std::string::npos;
+}
+
+void setUp()
+{
+    ArduinoStub::serialOutput.clear();
+}
+void tearDown() {}
+
+void test_lsm6dsv_initializes_once_reset_completes()
+{
+    using Imu = Drivers::LSM6DSV<FakeI2CImpl, Profiles::Default>;
+    FakeI2CDevice device;
+    completeResetOn(device, Imu::Regs::Ctrl3C::reg, Imu::Regs::Ctrl3C::valueSwReset,
+                    Imu::Regs::Ctrl3C::reg, Imu::Regs::Ctrl3C::defaultIfInc);
+    Imu imu(FakeI2CImpl{&device}, logger);
+
+    TEST_ASSERT_TRUE(imu.initialize());
+    TEST_ASSERT_EQUAL(Imu::Regs::Ctrl3C::value, device.regs[Imu::Regs::Ctrl3C::reg]);
+    TEST_ASSERT_FALSE(logged("timed out"));
+}
+
+void test_lsm6dsv_fails_when_reset_never_completes()
+{
+    using Imu = Drivers::LSM6DSV<FakeI2CImpl, Profiles::Default>;
+    FakeI2CDevice device;
+    Imu imu(FakeI2CImpl{&device}, logger);
+
+    TEST_ASSERT_FALSE(imu.initialize());
+    TEST_ASSERT_TRUE(logged("CTRL3_C (0x12)"));
+    // nothing is configured on a device that didn't come back from reset
+    TEST_ASSERT_EQUAL(0, device.regs[Imu::Regs::Ctrl1XLODR::reg]);
+}
+
+void test_lsm6ds3trc_fails_when_reset_never_completes()
+{
+    using Imu = Drivers::LSM6DS3TRC<FakeI2CImpl, Profiles::Default>;
+    FakeI2CDevice device;
+    Imu imu(FakeI2CImpl{&device}, logger);
+
+    TEST_ASSERT_FALSE(imu.initialize());
+    TEST_ASSERT_TRUE(logged("CTRL3_C (0x12)"));
+}
+
+void test_icm42688_fails_without_reset_done()
+{
+    using Imu = Drivers::ICM42688<FakeI2CImpl, Profiles::Default>;
+    FakeI2CDevice device;
+    Imu imu(FakeI2CImpl{&device}, logger);
+
+    TEST_ASSERT_FALSE(imu.initialize());
+    TEST_ASSERT_TRUE(logged("INT_STATUS (0x2d)"));
+
+    ArduinoStub::serialOutput.clear();
+    completeResetOn(device, Imu::Regs::DeviceConfig::reg, Imu::Regs::DeviceConfig::valueSwReset,
+                    Imu::Regs::IntStatus::reg, Imu::Regs::IntStatus::resetDone);
+    TEST_ASSERT_TRUE(imu.initialize());
+    TEST_ASSERT_FALSE(logged("timed out"));
+}
+
+void test_bmi270_fails_when_chip_id_never_returns()
+{
+    using Imu = Drivers::BMI270<FakeI2CImpl, Profiles::Default>;
+    FakeI2CDevice device;
+    Imu imu(FakeI2CImpl{&device}, logger);
+    Imu::MotionlessCalibrationData calibration{};
+
+    const auto start = ArduinoStub::microsNow;
+    TEST_ASSERT_FALSE(imu.initialize(calibration));
+    TEST_ASSERT_TRUE(logged("CHIP_ID (0x00)"));
+    // gave up after the timeout instead of uploading the firmware to a missing chip
+    TEST_ASSERT_TRUE(ArduinoStub::microsNow - start < 20000);
+    TEST_ASSERT_EQUAL(0, device.readTransfers(Imu::Regs::InternalStatus::reg));
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_lsm6dsv_initializes_once_reset_completes);
+    RUN_TEST(test_lsm6dsv_fails_when_reset_never_completes);
+    RUN_TEST(test_lsm6ds3trc_fails_when_reset_never_completes);
+    RUN_TEST(test_icm42688_fails_without_reset_done);
+    RUN_TEST(test_bmi270_fails_when_chip_id_never_returns);
+    return UNITY_END();
+}
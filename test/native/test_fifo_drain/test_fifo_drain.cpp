@@ -0,0 +1,191 @@
+/*
+    SlimeVR Code is placed under the MIT license
+    Copyright (c) 2024 SlimeVR Contributors
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+
+#include <unity.h>
+
+#include <cstring>
+#include <vector>
+
+#include "FakeI2C.h"
+#include "logging/Logger.h"
+#include "sensors/softfusion/drivers/lsm6dsv.h"
+
+using namespace SlimeVR::Sensors::SoftFusion;
+
+using Imu = Drivers::LSM6DSV<FakeI2CImpl, Profiles::Default>;
+using Regs = Imu::Regs;
+
+static SlimeVR::Logging::Logger logger("FifoDrainTest");
+
+// I2CImpl::MaxTransactionLength rounded down to whole 7 byte FIFO entries
+constexpr size_t EntriesPerChunk = FakeI2CImpl::MaxTransactionLength / Imu::FullFifoEntrySize;
+
+struct Sample
+{
+    bool gyro;
+    int16_t sequence;
+};
+
+// LSM6DSV FIFO with the fill level in FIFO_STATUS1/2, entries alternate between gyro and accel
+// and carry a running sequence number in their x axis
+struct FakeLsm6dsv
+{
+    FakeI2CDevice device;
+    int16_t nextSequence = 0;
+
+    FakeLsm6dsv()
+    {
+        device.fifoDataReg = Regs::FifoData;
+        device.beforeRead = [](FakeI2CDevice &dev) {
+            const auto entries = dev.fifo.size() / Imu::FullFifoEntrySize;
+            dev.regs[Regs::FifoStatus] = entries & 0xff;
+            dev.regs[Regs::FifoStatus + 1] = (entries >> 8) & 0x03;
+        };
+    }
+
+    void push(size_t entries)
+    {
+        for (size_t i = 0; i < entries; i++) {
+            const int16_t sequence = nextSequence++;
+            const uint8_t tag = sequence % 2 == 0 ? 0x01 : 0x02;
+            const int16_t xyz[3] = {sequence, 0, 0};
+            uint8_t raw[6];
+            memcpy(raw, xyz, sizeof(raw));
+            device.fifo.push_back(tag << 3);
+            device.fifo.insert(device.fifo.end(), raw, raw + sizeof(raw));
+        }
+    }
+
+    size_t fifoDataTransfers() const { return device.readTransfers(Regs::FifoData); }
+};
+
+struct Drain
+{
+    FakeLsm6dsv fake;
+    Imu imu{FakeI2CImpl{&fake.device}, logger};
+    std::vector<Sample> samples;
+
+    bool read(uint32_t maxChunks = Imu::MaxFifoChunks)
+    {
+        return imu.bulkRead(
+            [&](const int16_t xyz[3], float) { samples.push_back({false, xyz[0]}); },
+            [&](const int16_t xyz[3], float) { samples.push_back({true, xyz[0]}); },
+            maxChunks);
+    }
+
+    // every sample exactly once, in FIFO order and with its type
+    void assertInOrder(size_t count)
+    {
+        TEST_ASSERT_EQUAL(count, samples.size());
+        for (size_t i = 0; i < samples.size(); i++) {
+            TEST_ASSERT_EQUAL(static_cast<int16_t>(i), samples[i].sequence);
+            TEST_ASSERT_EQUAL(i % 2 == 0, samples[i].gyro);
+        }
+    }
+};
+
+void setUp() {}
+void tearDown() {}
+
+void test_default_read_drains_whole_backlog()
+{
+    Drain drain;
+    drain.fake.push(150);
+
+    TEST_ASSERT_FALSE(drain.read());
+    TEST_ASSERT_TRUE(drain.fake.device.fifo.empty());
+    drain.assertInOrder(150);
+    // 150 entries don't fit into fewer transactions
+    TEST_ASSERT_EQUAL((150 + EntriesPerChunk - 1) / EntriesPerChunk, drain.fake.fifoDataTransfers());
+}
+
+void test_transfers_are_whole_entries_within_bus_limit()
+{
+    Drain drain;
+    drain.fake.push(101);
+    drain.read();
+
+    for (const auto &transfer : drain.fake.device.transfers) {
+        if (transfer.reg != Regs::FifoData) {
+            continue;
+        }
+        TEST_ASSERT_TRUE(transfer.length <= FakeI2CImpl::MaxTransactionLength);
+        TEST_ASSERT_EQUAL(0, transfer.length % Imu::FullFifoEntrySize);
+    }
+}
+
+void test_empty_fifo_reads_only_status()
+{
+    Drain drain;
+
+    TEST_ASSERT_FALSE(drain.read());
+    TEST_ASSERT_EQUAL(0, drain.fake.fifoDataTransfers());
+    TEST_ASSERT_EQUAL(1, drain.fake.device.readTransfers(Regs::FifoStatus));
+}
+
+void test_chunk_cap_resumes_without_loss()
+{
+    Drain drain;
+    drain.fake.push(3 * EntriesPerChunk + 5);
+
+    // one transaction per call, the rest stays queued in the FIFO
+    TEST_ASSERT_TRUE(drain.read(1));
+    TEST_ASSERT_EQUAL(EntriesPerChunk, drain.samples.size());
+    TEST_ASSERT_TRUE(drain.read(1));
+    TEST_ASSERT_TRUE(drain.read(1));
+    TEST_ASSERT_FALSE(drain.read(1));
+
+    TEST_ASSERT_TRUE(drain.fake.device.fifo.empty());
+    drain.assertInOrder(3 * EntriesPerChunk + 5);
+}
+
+void test_samples_arriving_during_drain_are_read()
+{
+    Drain drain;
+    drain.fake.push(2 * EntriesPerChunk);
+    // the IMU keeps writing while the backlog is read out
+    drain.fake.device.beforeRead = [&, status = drain.fake.device.beforeRead](FakeI2CDevice &dev) {
+        if (dev.transfers.size() < 4) {
+            drain.fake.push(3);
+        }
+        status(dev);
+    };
+
+    TEST_ASSERT_FALSE(drain.read());
+    // whatever arrived after the last status read waits for the next one
+    TEST_ASSERT_TRUE(drain.samples.size() > 2 * EntriesPerChunk);
+    drain.read();
+    TEST_ASSERT_TRUE(drain.fake.device.fifo.empty());
+    drain.assertInOrder(drain.fake.nextSequence);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_default_read_drains_whole_backlog);
+    RUN_TEST(test_transfers_are_whole_entries_within_bus_limit);
+    RUN_TEST(test_empty_fifo_reads_only_status);
+    RUN_TEST(test_chunk_cap_resumes_without_loss);
+    RUN_TEST(test_samples_arriving_during_drain_are_read);
+    return UNITY_END();
+}
@@ -0,0 +1,251 @@
+/*
+    SlimeVR Code is placed under the MIT license
+    Copyright (c) 2024 SlimeVR Contributors
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+
+#include <unity.h>
+
+#include <cstring>
+#include <vector>
+
+#include "FakeI2C.h"
+#include "logging/Logger.h"
+#include "sensors/softfusion/drivers/icm42688.h"
+#include "sensors/softfusion/drivers/lsm6dsv.h"
+#include "sensors/softfusion/fiforeadtrigger.h"
+
+using namespace SlimeVR::Sensors::SoftFusion;
+
+// The FIFO read path of SoftFusionSensor::motionLoop() with SFUSION_USE_FIFO_INTERRUPT: the sensor
+// loop spins much faster than the IMU fills its FIFO and only reads when the INT pin says so.
+
+using Lsm = Drivers::LSM6DSV<FakeI2CImpl, Profiles::Default>;
+using Icm = Drivers::ICM42688<FakeI2CImpl, Profiles::Default>;
+
+constexpr uint8_t IntPin = 5;
+constexpr uint32_t LoopMicros = 100;
+// one FIFO entry per millisecond
+constexpr uint32_t EntryMicros = 1000;
+
+static SlimeVR::Logging::Logger logger("FifoInterruptTest");
+
+// LSM6DSV with INT1 wired: the FIFO threshold flag is a level, high while the FIFO holds at
+// least FIFO_CTRL1 entries and INT1_FIFO_TH is set
+struct FakeLsm6dsv
+{
+    FakeI2CDevice device;
+    int16_t nextSequence = 0;
+
+    FakeLsm6dsv()
+    {
+        device.fifoDataReg = Lsm::Regs::FifoData;
+        device.beforeRead = [](FakeI2CDevice &dev) {
+            const auto entries = dev.fifo.size() / Lsm::FullFifoEntrySize;
+            dev.regs[Lsm::Regs::FifoStatus] = entries & 0xff;
+            dev.regs[Lsm::Regs::FifoStatus + 1] = (entries >> 8) & 0x03;
+        };
+    }
+
+    size_t entries() const { return device.fifo.size() / Lsm::FullFifoEntrySize; }
+
+    void updatePin()
+    {
+        const bool routed = device.regs[Lsm::Regs::Int1Ctrl::reg] & Lsm::Regs::Int1Ctrl::valueFifoTh;
+        const uint8_t watermark = device.regs[Lsm::Regs::FifoCtrl1WTM];
+        ArduinoStub::pinLevels[IntPin] = routed && watermark > 0 && entries() >= watermark ? HIGH : LOW;
+    }
+
+    void push()
+    {
+        const int16_t sequence = nextSequence++;
+        const uint8_t tag = sequence % 2 == 0 ? 0x01 : 0x02;
+        const int16_t xyz[3] = {sequence, 0, 0};
+        uint8_t raw[6];
+        memcpy(raw, xyz, sizeof(raw));
+        device.fifo.push_back(tag << 3);
+        device.fifo.insert(device.fifo.end(), raw, raw + sizeof(raw));
+        updatePin();
+    }
+};
+
+// the motionLoop() read path on a fake clock
+struct Loop
+{
+    FakeLsm6dsv fake;
+    Lsm imu{FakeI2CImpl{&fake.device}, logger};
+    FifoReadTrigger<Lsm> trigger{IntPin, 0};
+    std::vector<int16_t> samples;
+    std::vector<uint32_t> readTimes;
+    // entries in the FIFO when a read started, how far it had filled
+    std::vector<size_t> readBacklogs;
+    uint32_t now = 0;
+
+    void read()
+    {
+        readTimes.push_back(now);
+        readBacklogs.push_back(fake.entries());
+        const bool pending = imu.bulkRead(
+            [&](const int16_t xyz[3], float) { samples.push_back(xyz[0]); },
+            [&](const int16_t xyz[3], float) { samples.push_back(xyz[0]); },
+            Lsm::MaxFifoChunks);
+        fake.updatePin();
+        if (!pending) {
+            trigger.fifoDrained(imu);
+        }
+    }
+
+    void run(uint32_t micros, bool imuRunning = true)
+    {
+        for (const uint32_t end = now + micros; now != end;) {
+            now += LoopMicros;
+            if (imuRunning && now % EntryMicros == 0) {
+                fake.push();
+            }
+            if (trigger.readDue(now)) {
+                read();
+            }
+        }
+    }
+};
+
+void setUp()
+{
+    ArduinoStub::pinLevels[IntPin] = LOW;
+}
+void tearDown() {}
+
+void test_setup_routes_watermark_to_int_pin()
+{
+    Loop loop;
+    loop.trigger.setup(loop.imu, true);
+
+    TEST_ASSERT_TRUE(loop.trigger.usesInterrupt());
+    TEST_ASSERT_EQUAL(Lsm::FifoWatermarkEntries, loop.fake.device.regs[Lsm::Regs::FifoCtrl1WTM]);
+    TEST_ASSERT_EQUAL(Lsm::Regs::Int1Ctrl::valueFifoTh, loop.fake.device.regs[Lsm::Regs::Int1Ctrl::reg]);
+}
+
+void test_interrupt_disabled_or_unwired_keeps_polling()
+{
+    Loop disabled;
+    disabled.trigger.setup(disabled.imu, false);
+    FakeLsm6dsv unwiredFake;
+    Lsm unwiredImu{FakeI2CImpl{&unwiredFake.device}, logger};
+    FifoReadTrigger<Lsm> unwired{255, 0};
+    unwired.setup(unwiredImu, true);
+
+    TEST_ASSERT_FALSE(disabled.trigger.usesInterrupt());
+    TEST_ASSERT_FALSE(unwired.usesInterrupt());
+    TEST_ASSERT_TRUE(disabled.fake.device.transfers.empty());
+    TEST_ASSERT_TRUE(unwiredFake.device.transfers.empty());
+
+    // polled on the fixed interval whatever the pin does
+    ArduinoStub::pinLevels[IntPin] = HIGH;
+    TEST_ASSERT_FALSE(disabled.trigger.readDue(FifoReadTrigger<Lsm>::PollIntervalMicros - 1));
+    TEST_ASSERT_TRUE(disabled.trigger.readDue(FifoReadTrigger<Lsm>::PollIntervalMicros));
+    // a late loop doesn't shift the next poll
+    TEST_ASSERT_TRUE(disabled.trigger.readDue(3 * FifoReadTrigger<Lsm>::PollIntervalMicros - 100));
+    TEST_ASSERT_TRUE(disabled.trigger.readDue(3 * FifoReadTrigger<Lsm>::PollIntervalMicros));
+}
+
+// reads follow the watermark: each starts with a full watermark in the FIFO, drains it and
+// drops the pin, and every sample comes through once and in order
+void test_reads_on_watermark()
+{
+    Loop loop;
+    loop.trigger.setup(loop.imu, true);
+    loop.run(1000000);
+
+    TEST_ASSERT_EQUAL(loop.fake.nextSequence / Lsm::FifoWatermarkEntries, loop.readTimes.size());
+    for (size_t backlog : loop.readBacklogs) {
+        TEST_ASSERT_EQUAL(Lsm::FifoWatermarkEntries, backlog);
+    }
+    TEST_ASSERT_EQUAL(LOW, ArduinoStub::pinLevels[IntPin]);
+    TEST_ASSERT_EQUAL(loop.fake.nextSequence - loop.fake.entries(), loop.samples.size());
+    for (size_t i = 0; i < loop.samples.size(); i++) {
+        TEST_ASSERT_EQUAL(static_cast<int16_t>(i), loop.samples[i]);
+    }
+    // no read is started on a quiet pin, so the bus sees nothing between the watermarks
+    TEST_ASSERT_EQUAL(loop.readTimes.size(), loop.fake.device.readTransfers(Lsm::Regs::FifoStatus));
+}
+
+// with the INT line broken the pin never rises, the FIFO is then read on the timeout
+void test_quiet_pin_falls_back_to_timeout()
+{
+    Loop loop;
+    loop.trigger.setup(loop.imu, true);
+    loop.fake.device.regs[Lsm::Regs::Int1Ctrl::reg] = 0;
+    loop.run(500000);
+
+    TEST_ASSERT_EQUAL(500000 / FifoReadTrigger<Lsm>::InterruptTimeoutMicros, loop.readTimes.size());
+    for (size_t i = 1; i < loop.readTimes.size(); i++) {
+        TEST_ASSERT_EQUAL(FifoReadTrigger<Lsm>::InterruptTimeoutMicros, loop.readTimes[i] - loop.readTimes[i - 1]);
+    }
+    TEST_ASSERT_EQUAL(loop.fake.nextSequence - loop.fake.entries(), loop.samples.size());
+}
+
+// a stopped IMU leaves the pin low, so the loop only checks in on the timeout
+void test_idle_imu_reads_only_on_timeout()
+{
+    Loop loop;
+    loop.trigger.setup(loop.imu, true);
+    loop.run(200000, false);
+
+    TEST_ASSERT_EQUAL(200000 / FifoReadTrigger<Lsm>::InterruptTimeoutMicros, loop.readTimes.size());
+    TEST_ASSERT_TRUE(loop.samples.empty());
+}
+
+// the ICM-42688 latches its interrupt, reading INT_STATUS after a drain releases the pin
+void test_latched_interrupt_acked_after_drain()
+{
+    FakeI2CDevice device;
+    // the only register the acknowledgement reads is INT_STATUS
+    device.beforeRead = [](FakeI2CDevice &) { ArduinoStub::pinLevels[IntPin] = LOW; };
+    Icm imu{FakeI2CImpl{&device}, logger};
+    FifoReadTrigger<Icm> trigger{IntPin, 0};
+
+    // without interrupt mode there is nothing to acknowledge
+    trigger.fifoDrained(imu);
+    TEST_ASSERT_TRUE(device.transfers.empty());
+
+    trigger.setup(imu, true);
+    TEST_ASSERT_TRUE(trigger.usesInterrupt());
+    TEST_ASSERT_EQUAL(Icm::Regs::IntSource0::value, device.regs[Icm::Regs::IntSource0::reg]);
+    TEST_ASSERT_EQUAL(Icm::Regs::IntConfig::value, device.regs[Icm::Regs::IntConfig::reg]);
+
+    ArduinoStub::pinLevels[IntPin] = HIGH;
+    TEST_ASSERT_TRUE(trigger.readDue(1000));
+    trigger.fifoDrained(imu);
+    TEST_ASSERT_EQUAL(1, device.readTransfers(Icm::Regs::IntStatus::reg));
+    TEST_ASSERT_EQUAL(LOW, ArduinoStub::pinLevels[IntPin]);
+    TEST_ASSERT_FALSE(trigger.readDue(2000));
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_setup_routes_watermark_to_int_pin);
+    RUN_TEST(test_interrupt_disabled_or_unwired_keeps_polling);
+    RUN_TEST(test_reads_on_watermark);
+    RUN_TEST(test_quiet_pin_falls_back_to_timeout);
+    RUN_TEST(test_idle_imu_reads_only_on_timeout);
+    RUN_TEST(test_latched_interrupt_acked_after_drain);
+    return UNITY_END();
+}
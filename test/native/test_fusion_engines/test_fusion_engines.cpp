@@ -0,0 +1,164 @@
+/*
+    SlimeVR Code is placed under the MIT license
+    Copyright (c) 2024 SlimeVR Contributors
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+
+#include <unity.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+#include "sensors/SensorFusion.h"
+
+using namespace SlimeVR::Sensors;
+
+// Every engine SET FUSION can pick has to level itself from the accel and follow the gyro,
+// and switching engines has to start the new one from scratch.
+
+constexpr float GyrTs = 1.0f / 480;
+constexpr float AccTs = 1.0f / 120;
+constexpr float Gravity = 9.80665f;
+
+constexpr FusionEngineType Engines[] = {
+    FusionEngineType::Mahony,
+    FusionEngineType::Madgwick,
+    FusionEngineType::BasicVQF,
+    FusionEngineType::VQF,
+    FusionEngineType::FixedMahony,
+};
+
+static void run(SensorFusion &fusion, const sensor_real_t gyro[3], const sensor_real_t accel[3], int samples)
+{
+    for (int i = 0; i < samples; i++) {
+        if (i % 4 == 0) {
+            fusion.updateAcc(accel, AccTs);
+        }
+        fusion.updateGyro(gyro, GyrTs);
+    }
+}
+
+static float angleBetween(Quat a, Quat b)
+{
+    const float dot = std::fabs(a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w) / (a.length() * b.length());
+    return 2.0f * std::acos(std::min(1.0f, dot));
+}
+
+void setUp() {}
+void tearDown() {}
+
+// held still at 30 degrees, the estimated gravity ends up along the accel
+void test_engines_level_from_accel()
+{
+    const float tilt = 30 * (3.14159265f / 180);
+    const sensor_real_t accel[3] = {Gravity * std::sin(tilt), 0, Gravity * std::cos(tilt)};
+    const sensor_real_t gyro[3] = {0, 0, 0};
+    for (FusionEngineType engine : Engines) {
+        SensorFusion fusion(GyrTs, AccTs, -1.0f, engine);
+        run(fusion, gyro, accel, 30 * 480);
+
+        // the gravity vector comes from the last quaternion read out of the engine
+        fusion.getQuaternionQuat();
+        const sensor_real_t *g = fusion.getGravityVec();
+        const float norm = std::sqrt(g[0] * g[0] + g[1] * g[1] + g[2] * g[2]);
+        const float cosAngle = (g[0] * accel[0] + g[1] * accel[1] + g[2] * accel[2]) / (norm * Gravity);
+        const float error = std::acos(std::min(1.0f, cosAngle));
+        TEST_ASSERT_TRUE_MESSAGE(error < 1 * (3.14159265f / 180), getFusionEngineName(engine));
+    }
+}
+
+// turning about the vertical, where the accel has nothing to correct, follows the gyro
+void test_engines_follow_gyro()
+{
+    const sensor_real_t accel[3] = {0, 0, Gravity};
+    const sensor_real_t gyro[3] = {0, 0, 1.0f};
+    const sensor_real_t still[3] = {0, 0, 0};
+    for (FusionEngineType engine : Engines) {
+        SensorFusion fusion(GyrTs, AccTs, -1.0f, engine);
+        run(fusion, still, accel, 480);
+        const Quat start = fusion.getQuaternionQuat();
+        run(fusion, gyro, accel, 480);
+        const float turned = angleBetween(start, fusion.getQuaternionQuat());
+        TEST_ASSERT_FLOAT_WITHIN_MESSAGE(0.01f, 1.0f, turned, getFusionEngineName(engine));
+    }
+}
+
+void test_set_engine_restarts()
+{
+    const float tilt = 30 * (3.14159265f / 180);
+    const sensor_real_t accel[3] = {Gravity * std::sin(tilt), 0, Gravity * std::cos(tilt)};
+    const sensor_real_t gyro[3] = {0.1f, 0, 0};
+    SensorFusion fusion(GyrTs, AccTs, -1.0f, FusionEngineType::VQF);
+    for (FusionEngineType engine : Engines) {
+        run(fusion, gyro, accel, 480);
+        fusion.setEngine(engine);
+        TEST_ASSERT_EQUAL(static_cast<uint8_t>(engine), static_cast<uint8_t>(fusion.getEngineType()));
+        const Quat q = fusion.getQuaternionQuat();
+        TEST_ASSERT_EQUAL_FLOAT(1, q.w);
+        TEST_ASSERT_EQUAL_FLOAT(0, q.x);
+        TEST_ASSERT_EQUAL_FLOAT(0, q.y);
+        TEST_ASSERT_EQUAL_FLOAT(0, q.z);
+        TEST_ASSERT_FALSE(fusion.isUpdated());
+    }
+}
+
+void test_engine_names()
+{
+    for (FusionEngineType engine : Engines) {
+        FusionEngineType parsed;
+        TEST_ASSERT_TRUE(parseFusionEngineName(getFusionEngineName(engine), parsed));
+        TEST_ASSERT_EQUAL(static_cast<uint8_t>(engine), static_cast<uint8_t>(parsed));
+        TEST_ASSERT_TRUE(isValidFusionEngine(static_cast<uint8_t>(engine)));
+    }
+    FusionEngineType parsed;
+    TEST_ASSERT_FALSE(parseFusionEngineName("kalman", parsed));
+    TEST_ASSERT_FALSE(isValidFusionEngine(0));
+    TEST_ASSERT_FALSE(isValidFusionEngine(SENSOR_FUSION_FIXED_MAHONY + 1));
+}
+
+// Host timing of each engine at the firmware's rates, for comparing engines with each other.
+// It says nothing about the cost on the MCUs, SFUSION_DEBUG measures that in GET INFO.
+void test_benchmark_engines()
+{
+    const sensor_real_t accel[3] = {0.5f, -0.3f, Gravity};
+    const sensor_real_t gyro[3] = {0.3f, -0.2f, 0.5f};
+    constexpr int Samples = 480 * 20;
+    for (FusionEngineType engine : Engines) {
+        SensorFusion fusion(GyrTs, AccTs, -1.0f, engine);
+        const auto start = std::chrono::steady_clock::now();
+        run(fusion, gyro, accel, Samples);
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        const double micros = std::chrono::duration<double, std::micro>(elapsed).count() / Samples;
+        printf("%-12s %.3f us per gyro sample\n", getFusionEngineName(engine), micros);
+        TEST_ASSERT_TRUE(std::isfinite(fusion.getQuaternionQuat().w));
+    }
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_engines_level_from_accel);
+    RUN_TEST(test_engines_follow_gyro);
+    RUN_TEST(test_set_engine_restarts);
+    RUN_TEST(test_engine_names);
+    RUN_TEST(test_benchmark_engines);
+    return UNITY_END();
+}
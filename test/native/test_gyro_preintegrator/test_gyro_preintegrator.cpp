@@ -0,0 +1,218 @@
+/*
+    SlimeVR Code is placed under the MIT license
+    Copyright (c) 2024 SlimeVR Contributors
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+
+#include <unity.h>
+
+#include <cmath>
+
+#include "motionprocessing/GyroPreintegrator.h"
+
+// Rotations are checked against chaining every gyro sample as its own exact rotation, in double
+struct Rotation
+{
+    double w = 1, x = 0, y = 0, z = 0;
+
+    static Rotation fromVector(double vx, double vy, double vz)
+    {
+        const double angle = std::sqrt(vx * vx + vy * vy + vz * vz);
+        if (angle == 0) {
+            return Rotation();
+        }
+        const double s = std::sin(angle / 2) / angle;
+        return Rotation{std::cos(angle / 2), vx * s, vy * s, vz * s};
+    }
+
+    // this rotation followed by r in the body frame
+    Rotation then(const Rotation &r) const
+    {
+        return Rotation{w * r.w - x * r.x - y * r.y - z * r.z,
+                        w * r.x + x * r.w + y * r.z - z * r.y,
+                        w * r.y - x * r.z + y * r.w + z * r.x,
+                        w * r.z + x * r.y - y * r.x + z * r.w};
+    }
+
+    double angleTo(const Rotation &r) const
+    {
+        const double dot = std::fabs(w * r.w + x * r.x + y * r.y + z * r.z);
+        return 2 * std::acos(std::fmin(dot, 1.0));
+    }
+};
+
+constexpr sensor_real_t GyroDt = 1.0f / 1600;
+
+// a rate vector whose axis turns around z, so consecutive samples don't commute
+static void coningRate(int i, sensor_real_t Gxyz[3])
+{
+    const double phase = i * 2 * M_PI * 100 * GyroDt;
+    Gxyz[0] = static_cast<sensor_real_t>(10 * std::cos(phase));
+    Gxyz[1] = static_cast<sensor_real_t>(10 * std::sin(phase));
+    Gxyz[2] = 1.5f;
+}
+
+// rotation error of one pre-integrated interval, and of the plain sum of the same samples
+static void intervalErrors(uint8_t samples, double &preintegrated, double &summed)
+{
+    GyroPreintegrator preintegrator(samples);
+    Rotation exact;
+    double sum[3] = {0, 0, 0};
+    for (int i = 0; i < samples; i++) {
+        sensor_real_t Gxyz[3];
+        coningRate(i, Gxyz);
+        exact = exact.then(Rotation::fromVector(Gxyz[0] * GyroDt, Gxyz[1] * GyroDt, Gxyz[2] * GyroDt));
+        for (uint8_t j = 0; j < 3; j++) {
+            sum[j] += Gxyz[j] * GyroDt;
+        }
+        preintegrator.add(Gxyz, GyroDt);
+    }
+    sensor_real_t Gxyz[3];
+    sensor_real_t deltat;
+    preintegrator.takeUpdate(Gxyz, deltat);
+    preintegrated = exact.angleTo(Rotation::fromVector(Gxyz[0] * deltat, Gxyz[1] * deltat, Gxyz[2] * deltat));
+    summed = exact.angleTo(Rotation::fromVector(sum[0], sum[1], sum[2]));
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_completes_after_samples()
+{
+    GyroPreintegrator preintegrator(4);
+    const sensor_real_t Gxyz[3] = {0.1f, 0.2f, 0.3f};
+    for (int interval = 0; interval < 3; interval++) {
+        TEST_ASSERT_FALSE(preintegrator.add(Gxyz, GyroDt));
+        TEST_ASSERT_FALSE(preintegrator.add(Gxyz, GyroDt));
+        TEST_ASSERT_FALSE(preintegrator.add(Gxyz, GyroDt));
+        TEST_ASSERT_TRUE(preintegrator.add(Gxyz, GyroDt));
+        sensor_real_t out[3];
+        sensor_real_t deltat;
+        preintegrator.takeUpdate(out, deltat);
+        TEST_ASSERT_FLOAT_WITHIN(1e-9f, 4 * GyroDt, deltat);
+    }
+}
+
+void test_zero_samples_updates_every_sample()
+{
+    GyroPreintegrator preintegrator(0);
+    TEST_ASSERT_EQUAL_UINT8(1, preintegrator.getSamples());
+    const sensor_real_t Gxyz[3] = {0.1f, 0.2f, 0.3f};
+    TEST_ASSERT_TRUE(preintegrator.add(Gxyz, GyroDt));
+}
+
+void test_constant_rate_passes_through()
+{
+    // a fixed axis has no coning, the interval is the rate itself over the summed time
+    GyroPreintegrator preintegrator(8);
+    const sensor_real_t Gxyz[3] = {1.2f, -0.4f, 2.5f};
+    const sensor_real_t dts[8] = {GyroDt, GyroDt * 1.01f, GyroDt * 0.99f, GyroDt, GyroDt, GyroDt * 1.02f, GyroDt, GyroDt};
+    sensor_real_t time = 0;
+    for (sensor_real_t dt : dts) {
+        preintegrator.add(Gxyz, dt);
+        time += dt;
+    }
+    sensor_real_t out[3];
+    sensor_real_t deltat;
+    preintegrator.takeUpdate(out, deltat);
+    TEST_ASSERT_FLOAT_WITHIN(1e-9f, time, deltat);
+    for (uint8_t i = 0; i < 3; i++) {
+        TEST_ASSERT_FLOAT_WITHIN(1e-5f, Gxyz[i], out[i]);
+    }
+}
+
+void test_pending_matches_update()
+{
+    GyroPreintegrator preintegrator(4);
+    for (int i = 0; i < 3; i++) {
+        sensor_real_t Gxyz[3];
+        coningRate(i, Gxyz);
+        preintegrator.add(Gxyz, GyroDt);
+    }
+    sensor_real_t rotation[3];
+    sensor_real_t pendingDeltat;
+    preintegrator.getPending(rotation, pendingDeltat);
+
+    sensor_real_t Gxyz[3];
+    sensor_real_t deltat;
+    preintegrator.takeUpdate(Gxyz, deltat);
+    TEST_ASSERT_TRUE(pendingDeltat == deltat);
+    for (uint8_t i = 0; i < 3; i++) {
+        TEST_ASSERT_FLOAT_WITHIN(1e-7f, rotation[i], Gxyz[i] * deltat);
+    }
+
+    // nothing pending after the update
+    preintegrator.getPending(rotation, pendingDeltat);
+    TEST_ASSERT_TRUE(pendingDeltat == 0);
+    TEST_ASSERT_TRUE(rotation[0] == 0 && rotation[1] == 0 && rotation[2] == 0);
+}
+
+void test_coning_correction()
+{
+    for (uint8_t samples = 2; samples <= 8; samples *= 2) {
+        double preintegrated;
+        double summed;
+        intervalErrors(samples, preintegrated, summed);
+        // the plain sum loses the turn of the axis, the coning term recovers most of it
+        TEST_ASSERT_GREATER_THAN_FLOAT(1e-6f, summed);
+        TEST_ASSERT_LESS_THAN_FLOAT(summed / 10, preintegrated);
+    }
+}
+
+void test_long_run_tracks_exact_rotation()
+{
+    // 10 s of coning motion, integrated in intervals of 4 samples as the engine gets them
+    GyroPreintegrator preintegrator(4);
+    Rotation exact;
+    Rotation integrated;
+    Rotation summed;
+    double sum[3] = {0, 0, 0};
+    for (int i = 0; i < 16000; i++) {
+        sensor_real_t Gxyz[3];
+        coningRate(i, Gxyz);
+        exact = exact.then(Rotation::fromVector(Gxyz[0] * GyroDt, Gxyz[1] * GyroDt, Gxyz[2] * GyroDt));
+        for (uint8_t j = 0; j < 3; j++) {
+            sum[j] += Gxyz[j] * GyroDt;
+        }
+        if (preintegrator.add(Gxyz, GyroDt)) {
+            sensor_real_t out[3];
+            sensor_real_t deltat;
+            preintegrator.takeUpdate(out, deltat);
+            integrated = integrated.then(Rotation::fromVector(out[0] * deltat, out[1] * deltat, out[2] * deltat));
+            summed = summed.then(Rotation::fromVector(sum[0], sum[1], sum[2]));
+            sum[0] = sum[1] = sum[2] = 0;
+        }
+    }
+    // the coning error of the plain sum builds up as drift, pre-integration keeps it to float rounding
+    TEST_ASSERT_LESS_THAN_FLOAT(exact.angleTo(summed) / 10, exact.angleTo(integrated));
+    TEST_ASSERT_LESS_THAN_FLOAT(1e-3f, exact.angleTo(integrated));
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_completes_after_samples);
+    RUN_TEST(test_zero_samples_updates_every_sample);
+    RUN_TEST(test_constant_rate_passes_through);
+    RUN_TEST(test_pending_matches_update);
+    RUN_TEST(test_coning_correction);
+    RUN_TEST(test_long_run_tracks_exact_rotation);
+    return UNITY_END();
+}
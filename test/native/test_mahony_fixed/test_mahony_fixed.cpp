@@ -0,0 +1,257 @@
+/*
+    SlimeVR Code is placed under the MIT license
+    Copyright (c) 2024 SlimeVR Contributors
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+
+#include <unity.h>
+
+#include <cmath>
+#include <random>
+
+#include "mahony.h"
+#include "mahonyfixed.h"
+
+// The fixed point filter is fed the way FusionEngine does it: accel and mag scaled to integers,
+// gyro as the half angle over the step in Q30. It has to stay with Mahony<float> on the same samples.
+
+constexpr float AccelScale = 65536.0f;
+constexpr float MagScale = 256.0f;
+constexpr float Dt = 1.0f / 400;
+
+struct Trace
+{
+    std::mt19937 rng{11};
+    std::normal_distribution<float> noise{0.0f, 1.0f};
+    // body to world, NWU, as the filters estimate it
+    double q[4];
+    double t = 0;
+
+    explicit Trace(const double start[4]) : q{start[0], start[1], start[2], start[3]} {}
+
+    // a few slow sines per axis, up to about 100 deg/s
+    void rate(double time, double w[3]) const
+    {
+        w[0] = 1.5 * std::sin(0.7 * time);
+        w[1] = 1.0 * std::sin(1.1 * time + 1);
+        w[2] = 0.8 * std::sin(0.5 * time + 2);
+    }
+
+    // world vector v in the body frame
+    void toBody(const double v[3], double out[3]) const
+    {
+        const double w = q[0], x = q[1], y = q[2], z = q[3];
+        out[0] = (1 - 2 * (y * y + z * z)) * v[0] + 2 * (x * y + w * z) * v[1] + 2 * (x * z - w * y) * v[2];
+        out[1] = 2 * (x * y - w * z) * v[0] + (1 - 2 * (x * x + z * z)) * v[1] + 2 * (y * z + w * x) * v[2];
+        out[2] = 2 * (x * z + w * y) * v[0] + 2 * (y * z - w * x) * v[1] + (1 - 2 * (x * x + y * y)) * v[2];
+    }
+
+    // gyro, accel in m/s^2 and mag in uT for the next step, then advances the true orientation
+    void step(float g[3], float a[3], float m[3])
+    {
+        double w[3];
+        rate(t + Dt / 2, w);
+        const double up[3] = {0, 0, 9.81};
+        const double field[3] = {20, 0, -40};
+        double bodyUp[3];
+        double bodyField[3];
+        toBody(up, bodyUp);
+        toBody(field, bodyField);
+        for (int i = 0; i < 3; i++) {
+            g[i] = static_cast<float>(w[i]) + 0.01f * noise(rng);
+            a[i] = static_cast<float>(bodyUp[i]) + 0.05f * noise(rng);
+            m[i] = static_cast<float>(bodyField[i]) + 0.5f * noise(rng);
+        }
+
+        const double angle = std::sqrt(w[0] * w[0] + w[1] * w[1] + w[2] * w[2]) * Dt;
+        const double s = angle > 0 ? std::sin(angle / 2) / (angle / Dt) : 0;
+        const double r[4] = {std::cos(angle / 2), w[0] * s, w[1] * s, w[2] * s};
+        const double n[4] = {q[0] * r[0] - q[1] * r[1] - q[2] * r[2] - q[3] * r[3],
+                             q[0] * r[1] + q[1] * r[0] + q[2] * r[3] - q[3] * r[2],
+                             q[0] * r[2] - q[1] * r[3] + q[2] * r[0] + q[3] * r[1],
+                             q[0] * r[3] + q[1] * r[2] - q[2] * r[1] + q[3] * r[0]};
+        for (int i = 0; i < 4; i++) {
+            q[i] = n[i];
+        }
+        t += Dt;
+    }
+};
+
+static void toFixed(const float in[3], float scale, int32_t out[3])
+{
+    for (int i = 0; i < 3; i++) {
+        out[i] = static_cast<int32_t>(in[i] * scale);
+    }
+}
+
+// Mahony<float> normalizes with the approximate invSqrt, so neither quaternion is taken as unit
+static double angleBetween(const double a[4], const double b[4])
+{
+    const double norms = std::sqrt((a[0] * a[0] + a[1] * a[1] + a[2] * a[2] + a[3] * a[3])
+                                   * (b[0] * b[0] + b[1] * b[1] + b[2] * b[2] + b[3] * b[3]));
+    const double dot = std::fabs(a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3]) / norms;
+    return 2 * std::acos(std::fmin(dot, 1.0)) * 180 / M_PI;
+}
+
+// angle of the tilt error, ignoring heading
+static double tiltError(const Trace &trace, const double q[4])
+{
+    const double norm = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+    const double w = q[0] / norm, x = q[1] / norm, y = q[2] / norm, z = q[3] / norm;
+    const double estimated[3] = {2 * (x * z - w * y), 2 * (y * z + w * x), 1 - 2 * (x * x + y * y)};
+    const double up[3] = {0, 0, 1};
+    double actual[3];
+    trace.toBody(up, actual);
+    const double dot = estimated[0] * actual[0] + estimated[1] * actual[1] + estimated[2] * actual[2];
+    return std::acos(std::fmin(dot, 1.0)) * 180 / M_PI;
+}
+
+// Runs both filters from identity over `seconds` of the trace, returns the largest difference
+// between them after the first second and the final tilt error of the fixed point one
+static void compareFilters(bool withMag, const double start[4], double seconds, double &maxDifference,
+                           double &finalTiltError)
+{
+    Trace trace(start);
+    Mahony<float> reference;
+    float qf[4] = {1, 0, 0, 0};
+    MahonyFixed filter;
+    int32_t qi[4] = {MahonyFixed::One, 0, 0, 0};
+    const int32_t kpHalfDt = static_cast<int32_t>(MahonyFixed::Kp * Dt * 0.5f * MahonyFixed::One);
+
+    maxDifference = 0;
+    const int steps = static_cast<int>(seconds / Dt);
+    for (int i = 0; i < steps; i++) {
+        float g[3], a[3], m[3];
+        trace.step(g, a, m);
+        int32_t h[3], ai[3], mi[3];
+        toFixed(g, Dt * 0.5f * MahonyFixed::One, h);
+        toFixed(a, AccelScale, ai);
+        toFixed(m, MagScale, mi);
+        if (withMag) {
+            reference.update(qf, a[0], a[1], a[2], g[0], g[1], g[2], m[0], m[1], m[2], Dt);
+            filter.update(qi, ai[0], ai[1], ai[2], h[0], h[1], h[2], mi[0], mi[1], mi[2], kpHalfDt);
+        } else {
+            reference.update(qf, a[0], a[1], a[2], g[0], g[1], g[2], Dt);
+            filter.update(qi, ai[0], ai[1], ai[2], h[0], h[1], h[2], kpHalfDt);
+        }
+
+        const double fixed[4] = {qi[0] / double(MahonyFixed::One), qi[1] / double(MahonyFixed::One),
+                                 qi[2] / double(MahonyFixed::One), qi[3] / double(MahonyFixed::One)};
+        const double floating[4] = {qf[0], qf[1], qf[2], qf[3]};
+        if (trace.t > 1) {
+            maxDifference = std::fmax(maxDifference, angleBetween(fixed, floating));
+        }
+        finalTiltError = tiltError(trace, fixed);
+    }
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_normalize()
+{
+    const int32_t vectors[][3] = {
+        {1, 0, 0}, {0, -1, 0}, {3, 4, 0}, {-16384, 16384, 16384}, {642000, -12, 1},
+        {INT32_MAX, INT32_MIN, 0}, {INT32_MIN, INT32_MIN, INT32_MIN}, {7, -7, 7},
+    };
+    for (const auto &vector : vectors) {
+        int32_t v[3] = {vector[0], vector[1], vector[2]};
+        TEST_ASSERT_TRUE(MahonyFixed::normalize(v));
+        const double length = std::sqrt(double(vector[0]) * vector[0] + double(vector[1]) * vector[1]
+                                        + double(vector[2]) * vector[2]);
+        double norm = 0;
+        for (int i = 0; i < 3; i++) {
+            TEST_ASSERT_FLOAT_WITHIN(1e-4f, vector[i] / length, v[i] / double(MahonyFixed::One));
+            norm += (v[i] / double(MahonyFixed::One)) * (v[i] / double(MahonyFixed::One));
+        }
+        TEST_ASSERT_FLOAT_WITHIN(1e-4f, 1.0f, std::sqrt(norm));
+    }
+
+    int32_t zero[3] = {0, 0, 0};
+    TEST_ASSERT_FALSE(MahonyFixed::normalize(zero));
+}
+
+void test_mul_rounds()
+{
+    const int32_t half = MahonyFixed::One / 2;
+    TEST_ASSERT_EQUAL_INT32(half / 2, MahonyFixed::mul(half, half));
+    TEST_ASSERT_EQUAL_INT32(-half, MahonyFixed::mul(-MahonyFixed::One, half));
+    TEST_ASSERT_EQUAL_INT32(1, MahonyFixed::mul(1, half));
+    TEST_ASSERT_EQUAL_INT32(0, MahonyFixed::mul(1, half - 1));
+}
+
+void test_gyro_only_keeps_unit_quaternion()
+{
+    // without accel the quaternion only gets integrated, the Newton step has to hold its norm
+    MahonyFixed filter;
+    int32_t q[4] = {MahonyFixed::One, 0, 0, 0};
+    const int32_t h = static_cast<int32_t>(2.0f * Dt * 0.5f * MahonyFixed::One);
+    for (int i = 0; i < 400 * 60; i++) {
+        filter.update(q, 0, 0, 0, h, -h / 2, h / 3, 0);
+    }
+    double norm = 0;
+    for (int i = 0; i < 4; i++) {
+        norm += (q[i] / double(MahonyFixed::One)) * (q[i] / double(MahonyFixed::One));
+    }
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, 1.0f, std::sqrt(norm));
+}
+
+void test_follows_float_filter_6d()
+{
+    const double start[4] = {1, 0, 0, 0};
+    double maxDifference;
+    double tilt;
+    compareFilters(false, start, 120, maxDifference, tilt);
+    TEST_ASSERT_LESS_THAN_FLOAT(0.05f, maxDifference);
+    TEST_ASSERT_LESS_THAN_FLOAT(1.0f, tilt);
+}
+
+void test_follows_float_filter_9d()
+{
+    const double start[4] = {1, 0, 0, 0};
+    double maxDifference;
+    double tilt;
+    compareFilters(true, start, 120, maxDifference, tilt);
+    TEST_ASSERT_LESS_THAN_FLOAT(0.05f, maxDifference);
+    TEST_ASSERT_LESS_THAN_FLOAT(1.0f, tilt);
+}
+
+void test_converges_from_wrong_start()
+{
+    // the tracker starts tilted by 60 degrees while both filters assume level
+    const double start[4] = {std::cos(M_PI / 6), std::sin(M_PI / 6), 0, 0};
+    double maxDifference;
+    double tilt;
+    compareFilters(false, start, 5, maxDifference, tilt);
+    TEST_ASSERT_LESS_THAN_FLOAT(1.0f, tilt);
+    TEST_ASSERT_LESS_THAN_FLOAT(0.05f, maxDifference);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_normalize);
+    RUN_TEST(test_mul_rounds);
+    RUN_TEST(test_gyro_only_keeps_unit_quaternion);
+    RUN_TEST(test_follows_float_filter_6d);
+    RUN_TEST(test_follows_float_filter_9d);
+    RUN_TEST(test_converges_from_wrong_start);
+    return UNITY_END();
+}
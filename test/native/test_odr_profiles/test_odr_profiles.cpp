@@ -0,0 +1,135 @@
+/*
+    SlimeVR Code is placed under the MIT license
+    Copyright (c) 2024 SlimeVR Contributors
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+
+#include <unity.h>
+
+#include "FakeI2C.h"
+#include "logging/Logger.h"
+#include "sensors/softfusion/drivers/bmi270.h"
+#include "sensors/softfusion/drivers/icm42688.h"
+#include "sensors/softfusion/drivers/lsm6ds3trc.h"
+#include "sensors/softfusion/drivers/lsm6dso.h"
+#include "sensors/softfusion/drivers/lsm6dsr.h"
+#include "sensors/softfusion/drivers/lsm6dsv.h"
+
+using namespace SlimeVR::Sensors::SoftFusion;
+
+// A stored calibration keeps the sample times measured when it was taken. It has to be accepted
+// with the oscillator off by a few percent and rejected when it was taken with another profile.
+
+template <template <typename, typename> class Driver, typename Profile>
+using Imu = Driver<FakeI2CImpl, Profile>;
+
+template <template <typename, typename> class Driver>
+void checkOwnProfileMatches()
+{
+    []<typename... Profile>(std::tuple<Profile...> *) {
+        (([] {
+            using IMU = Imu<Driver, Profile>;
+            TEST_ASSERT_TRUE(Profiles::sampleTimesMatch<IMU>(IMU::GyrTs, IMU::AccTs));
+            TEST_ASSERT_TRUE(Profiles::sampleTimesMatch<IMU>(IMU::GyrTs * 1.04f, IMU::AccTs * 0.96f));
+            TEST_ASSERT_TRUE(Profiles::sampleTimesMatch<IMU>(IMU::GyrTs * 0.96f, IMU::AccTs * 1.04f));
+        }()), ...);
+    }(static_cast<Profiles::All *>(nullptr));
+}
+
+// every other profile the driver runs at a different rate is rejected
+template <template <typename, typename> class Driver>
+void checkOtherProfilesRejected()
+{
+    []<typename... Profile>(std::tuple<Profile...> *) {
+        (([] {
+            using Stored = Imu<Driver, Profile>;
+            []<typename... Current>(std::tuple<Current...> *) {
+                (([] {
+                    using IMU = Imu<Driver, Current>;
+                    const bool sameRates = Stored::GyrTs == IMU::GyrTs && Stored::AccTs == IMU::AccTs;
+                    TEST_ASSERT_EQUAL(sameRates, Profiles::sampleTimesMatch<IMU>(Stored::GyrTs, Stored::AccTs));
+                }()), ...);
+            }(static_cast<Profiles::All *>(nullptr));
+        }()), ...);
+    }(static_cast<Profiles::All *>(nullptr));
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_lsm6dsv_profiles()
+{
+    checkOwnProfileMatches<Drivers::LSM6DSV>();
+    checkOtherProfilesRejected<Drivers::LSM6DSV>();
+}
+
+void test_lsm6dso_profiles()
+{
+    checkOwnProfileMatches<Drivers::LSM6DSO>();
+    checkOtherProfilesRejected<Drivers::LSM6DSO>();
+}
+
+void test_lsm6dsr_profiles()
+{
+    checkOwnProfileMatches<Drivers::LSM6DSR>();
+    checkOtherProfilesRejected<Drivers::LSM6DSR>();
+}
+
+void test_lsm6ds3trc_profiles()
+{
+    checkOwnProfileMatches<Drivers::LSM6DS3TRC>();
+    checkOtherProfilesRejected<Drivers::LSM6DS3TRC>();
+}
+
+void test_icm42688_profiles()
+{
+    checkOwnProfileMatches<Drivers::ICM42688>();
+    checkOtherProfilesRejected<Drivers::ICM42688>();
+}
+
+void test_bmi270_profiles()
+{
+    checkOwnProfileMatches<Drivers::BMI270>();
+    checkOtherProfilesRejected<Drivers::BMI270>();
+}
+
+// the profiles are far enough apart that a drift past the tolerance is all it takes to reject
+void test_tolerance_edges()
+{
+    using IMU = Imu<Drivers::LSM6DSV, Profiles::Default>;
+    TEST_ASSERT_FALSE(Profiles::sampleTimesMatch<IMU>(IMU::GyrTs * 1.06f, IMU::AccTs));
+    TEST_ASSERT_FALSE(Profiles::sampleTimesMatch<IMU>(IMU::GyrTs, IMU::AccTs * 0.94f));
+    // unset or corrupted sample times
+    TEST_ASSERT_FALSE(Profiles::sampleTimesMatch<IMU>(0, 0));
+    TEST_ASSERT_FALSE(Profiles::sampleTimesMatch<IMU>(NAN, IMU::AccTs));
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_lsm6dsv_profiles);
+    RUN_TEST(test_lsm6dso_profiles);
+    RUN_TEST(test_lsm6dsr_profiles);
+    RUN_TEST(test_lsm6ds3trc_profiles);
+    RUN_TEST(test_icm42688_profiles);
+    RUN_TEST(test_bmi270_profiles);
+    RUN_TEST(test_tolerance_edges);
+    return UNITY_END();
+}
@@ -0,0 +1,271 @@
+/*
+	SlimeVR Code is placed under the MIT license
+	Copyright (c) 2024 SlimeVR Contributors
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+	THE SOFTWARE.
+*/
+
+#include <unity.h>
+
+#include <string>
+#include <vector>
+
+#include "network/PacketWriter.h"
+
+using namespace SlimeVR::Network;
+
+// The expected bytes of the packets that existed before PacketWriter were captured from
+// the convert_to_chars encoder it replaced, sending the same values
+
+static std::vector<uint8_t> fromHex(const char* hex) {
+	std::vector<uint8_t> bytes;
+	for (size_t i = 0; hex[i] && hex[i + 1]; i += 2) {
+		bytes.push_back(std::stoi(std::string(hex + i, 2), nullptr, 16));
+	}
+	return bytes;
+}
+
+template <typename Layout, typename... Args>
+static std::vector<uint8_t> encode(uint64_t packetNumber, Args... args) {
+	uint8_t buffer[MaxDatagramSize];
+	PacketWriter packet(buffer, sizeof(buffer));
+	packet.put<uint32_t>(Layout::Type);
+	packet.put<uint64_t>(packetNumber);
+	Layout::write(packet, args...);
+	TEST_ASSERT_TRUE(packet.ok());
+	TEST_ASSERT_EQUAL(Layout::Size, packet.size());
+	return std::vector<uint8_t>(buffer, buffer + packet.size());
+}
+
+template <typename Layout, typename... Args>
+static void addToBundle(BundleWriter& bundle, uint64_t& packetNumber, Args... args) {
+	PacketWriter packet = bundle.beginPacket();
+	packet.put<uint32_t>(Layout::Type);
+	Layout::write(packet, args...);
+	TEST_ASSERT_TRUE(packet.ok());
+	bundle.addPacket(packet, packetNumber);
+}
+
+static void assertBytes(const char* expectedHex, const std::vector<uint8_t>& actual) {
+	const auto expected = fromHex(expectedHex);
+	TEST_ASSERT_EQUAL(expected.size(), actual.size());
+	TEST_ASSERT_EQUAL_HEX8_ARRAY(expected.data(), actual.data(), expected.size());
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_heartbeat() {
+	assertBytes("000000000000000000000000", encode<Packets::Heartbeat>(0));
+}
+
+void test_acceleration() {
+	assertBytes(
+		"0000000400000000000000013fc00000c0100000411cf5c303",
+		encode<Packets::Acceleration>(1, 1.5f, -2.25f, 9.81f, 3)
+	);
+}
+
+void test_battery_level() {
+	assertBytes(
+		"0000000c0000000000000002406ccccd3ed70a3d",
+		encode<Packets::BatteryLevel>(2, 3.7f, 0.42f)
+	);
+}
+
+void test_tap() {
+	assertBytes("0000000d00000000000000030107", encode<Packets::Tap>(3, 1, 7));
+}
+
+void test_error() {
+	assertBytes("0000000e00000000000000040209", encode<Packets::Error>(4, 2, 9));
+}
+
+void test_sensor_info() {
+	// the sensor info packet only went out from a live sensor, the layout is
+	// sensor id, sensor state and IMU type as one byte each
+	assertBytes(
+		"0000000f000000000000000e030114",
+		encode<Packets::SensorInfo>(14, 3, 1, 20)
+	);
+}
+
+void test_rotation_data() {
+	assertBytes(
+		"00000011000000000000000504013dcccccdbe4ccccd3e99999a3f66666602",
+		encode<Packets::RotationData>(5, 4, 1, 0.1f, -0.2f, 0.3f, 0.9f, 2)
+	);
+}
+
+void test_magnetometer_accuracy() {
+	assertBytes(
+		"000000120000000000000006053e000000",
+		encode<Packets::MagnetometerAccuracy>(6, 5, 0.125f)
+	);
+}
+
+void test_signal_strength() {
+	assertBytes(
+		"000000130000000000000007ffc8",
+		encode<Packets::SignalStrength>(7, 255, static_cast<uint8_t>(200))
+	);
+}
+
+void test_temperature() {
+	assertBytes(
+		"0000001400000000000000080642126666",
+		encode<Packets::Temperature>(8, 6, 36.6f)
+	);
+}
+
+void test_inspection_raw_int() {
+	assertBytes(
+		"00000069000000000000000a010101ffffffff00000002ffff8000010000000400000005000000060200000007000000080000000903",
+		encode<Packets::InspectionRawInt>(
+			10,
+			PACKET_INSPECTION_PACKETTYPE_RAW_IMU_DATA, 1, PACKET_INSPECTION_DATATYPE_INT,
+			static_cast<int16_t>(-1), 2, static_cast<int16_t>(-32768), 1,
+			4, 5, 6, 2,
+			7, 8, 9, 3
+		)
+	);
+}
+
+void test_inspection_raw_float() {
+	assertBytes(
+		"00000069000000000000000b010102bf8000004000000040400000014080000040a0000040c000000240e00000410000004110000003",
+		encode<Packets::InspectionRawFloat>(
+			11,
+			PACKET_INSPECTION_PACKETTYPE_RAW_IMU_DATA, 1, PACKET_INSPECTION_DATATYPE_FLOAT,
+			-1.f, 2.f, 3.f, 1,
+			4.f, 5.f, 6.f, 2,
+			7.f, 8.f, 9.f, 3
+		)
+	);
+}
+
+void test_rotation_acceleration_compact() {
+	// header, sensor id, three quaternion words, three accel words, accuracy
+	auto expected = fromHex("000000000000000000000015020001800300047fff8000000003");
+	expected[3] = PACKET_ROTATION_ACCELERATION_COMPACT;
+	const auto actual = encode<Packets::RotationAccelerationCompact>(
+		21, 2, 0x0001, 0x8003, 0x0004, 0x7fff, static_cast<int16_t>(-32768), 0, 3
+	);
+	TEST_ASSERT_EQUAL(expected.size(), actual.size());
+	TEST_ASSERT_EQUAL_HEX8_ARRAY(expected.data(), actual.data(), expected.size());
+}
+
+void test_rotation_acceleration_timestamped() {
+	// header, sensor id, timestamp, then as the compact packet
+	auto expected = fromHex("0000000000000000000000160200000102030405060001800300047fff8000000003");
+	expected[3] = PACKET_ROTATION_ACCELERATION_TIMESTAMPED;
+	const auto actual = encode<Packets::RotationAccelerationTimestamped>(
+		22, 2, 0x0000010203040506ull, 0x0001, 0x8003, 0x0004, 0x7fff, static_cast<int16_t>(-32768), 0, 3
+	);
+	TEST_ASSERT_EQUAL(expected.size(), actual.size());
+	TEST_ASSERT_EQUAL_HEX8_ARRAY(expected.data(), actual.data(), expected.size());
+}
+
+void test_bundle_framing() {
+	uint8_t buffer[MaxDatagramSize];
+	BundleWriter bundle(buffer, sizeof(buffer));
+	uint64_t packetNumber = 12;
+
+	addToBundle<Packets::Heartbeat>(bundle, packetNumber);
+	addToBundle<Packets::Acceleration>(bundle, packetNumber, 1.5f, -2.25f, 9.81f, 3);
+	addToBundle<Packets::BatteryLevel>(bundle, packetNumber, 3.7f, 0.42f);
+	addToBundle<Packets::Tap>(bundle, packetNumber, 1, 7);
+	addToBundle<Packets::Error>(bundle, packetNumber, 2, 9);
+	addToBundle<Packets::RotationData>(bundle, packetNumber, 4, 1, 0.1f, -0.2f, 0.3f, 0.9f, 2);
+	addToBundle<Packets::MagnetometerAccuracy>(bundle, packetNumber, 5, 0.125f);
+	addToBundle<Packets::SignalStrength>(bundle, packetNumber, 255, static_cast<uint8_t>(200));
+	addToBundle<Packets::Temperature>(bundle, packetNumber, 6, 36.6f);
+
+	// only the bundle takes a packet number
+	TEST_ASSERT_EQUAL(13, packetNumber);
+	TEST_ASSERT_EQUAL(9, bundle.packetCount());
+	assertBytes(
+		"00000064000000000000000c"
+		"000400000000"
+		"0011000000043fc00000c0100000411cf5c303"
+		"000c0000000c406ccccd3ed70a3d"
+		"00060000000d0107"
+		"00060000000e0209"
+		"00170000001104013dcccccdbe4ccccd3e99999a3f66666602"
+		"000900000012053e000000"
+		"000600000013ffc8"
+		"0009000000140642126666",
+		std::vector<uint8_t>(bundle.data(), bundle.data() + bundle.size())
+	);
+
+	bundle.clear();
+	addToBundle<Packets::Tap>(bundle, packetNumber, 1, 1);
+	assertBytes(
+		"00000064000000000000000d00060000000d0101",
+		std::vector<uint8_t>(bundle.data(), bundle.data() + bundle.size())
+	);
+}
+
+void test_bundle_overflow() {
+	// room for the bundle header and one tap packet with its length
+	uint8_t buffer[BundleWriter::HeaderSize + 2 + Packets::Tap::PayloadSize + 4];
+	BundleWriter bundle(buffer, sizeof(buffer));
+	uint64_t packetNumber = 0;
+
+	addToBundle<Packets::Tap>(bundle, packetNumber, 1, 1);
+	TEST_ASSERT_EQUAL(sizeof(buffer), bundle.size());
+
+	PacketWriter packet = bundle.beginPacket();
+	packet.put<uint32_t>(Packets::Tap::Type);
+	Packets::Tap::write(packet, 1, 2);
+	TEST_ASSERT_FALSE(packet.ok());
+	TEST_ASSERT_EQUAL(1, bundle.packetCount());
+}
+
+void test_writer_refuses_partial_fields() {
+	uint8_t buffer[5];
+	PacketWriter packet(buffer, sizeof(buffer));
+	packet.put<uint32_t>(1);
+	TEST_ASSERT_TRUE(packet.ok());
+	packet.put<uint16_t>(2);
+	TEST_ASSERT_FALSE(packet.ok());
+	TEST_ASSERT_EQUAL(4, packet.size());
+}
+
+int main() {
+	UNITY_BEGIN();
+	RUN_TEST(test_heartbeat);
+	RUN_TEST(test_acceleration);
+	RUN_TEST(test_battery_level);
+	RUN_TEST(test_tap);
+	RUN_TEST(test_error);
+	RUN_TEST(test_sensor_info);
+	RUN_TEST(test_rotation_data);
+	RUN_TEST(test_magnetometer_accuracy);
+	RUN_TEST(test_signal_strength);
+	RUN_TEST(test_temperature);
+	RUN_TEST(test_inspection_raw_int);
+	RUN_TEST(test_inspection_raw_float);
+	RUN_TEST(test_rotation_acceleration_compact);
+	RUN_TEST(test_rotation_acceleration_timestamped);
+	RUN_TEST(test_bundle_framing);
+	RUN_TEST(test_bundle_overflow);
+	RUN_TEST(test_writer_refuses_partial_fields);
+	return UNITY_END();
+}
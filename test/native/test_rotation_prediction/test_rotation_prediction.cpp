@@ -0,0 +1,141 @@
+/*
+    SlimeVR Code is placed under the MIT license
+    Copyright (c) 2024 SlimeVR Contributors
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+
+#include <unity.h>
+
+#include <cmath>
+
+#include "sensors/SensorFusionRestDetect.h"
+
+using namespace SlimeVR::Sensors;
+
+constexpr float GyrTs = 1.0f / 480;
+constexpr float AccTs = 1.0f / 120;
+// 10 gyro samples, about the send interval the prediction has to bridge
+constexpr int HorizonSamples = 10;
+constexpr float Horizon = HorizonSamples * GyrTs;
+
+// Fusion turning at a constant rate, with gravity on z in the accel when `withAccel` is set
+struct ConstantRotation
+{
+    SensorFusionRestDetect fusion;
+    sensor_real_t rate[3];
+    bool withAccel;
+    int samples = 0;
+
+    ConstantRotation(FusionEngineType engine, const sensor_real_t w[3], bool withAccel, uint8_t preintegration = 1)
+        : fusion(GyrTs, AccTs, -1.0f, engine, preintegration), rate{w[0], w[1], w[2]}, withAccel(withAccel)
+    {
+    }
+
+    void run(int count)
+    {
+        const sensor_real_t gravity[3] = {0.0f, 0.0f, 9.80665f};
+        for (int i = 0; i < count; i++, samples++) {
+            if (withAccel && samples % 4 == 0) {
+                fusion.updateAcc(gravity, AccTs);
+            }
+            fusion.updateGyro(rate, GyrTs);
+        }
+    }
+};
+
+static float angleBetween(Quat a, Quat b)
+{
+    const float dot = std::fabs(a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w) / (a.length() * b.length());
+    return 2.0f * std::acos(std::min(1.0f, dot));
+}
+
+// predicts `Horizon` ahead, then lets the fusion get there and returns the angle between both,
+// `staleError` gets the error of sending the unpredicted rotation instead
+static float predictionError(ConstantRotation &rotation, float &staleError)
+{
+    const Quat predicted = rotation.fusion.getPredictedQuaternionQuat(Horizon);
+    const Quat stale = rotation.fusion.getQuaternionQuat();
+    rotation.run(HorizonSamples);
+    const Quat actual = rotation.fusion.getQuaternionQuat();
+    staleError = angleBetween(stale, actual);
+    return angleBetween(predicted, actual);
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_gyro_only_prediction_matches_integration()
+{
+    // 3 rad/s about a tilted axis, no accel so the engine only integrates
+    const sensor_real_t w[3] = {1.0f, 2.0f, 2.0f};
+    ConstantRotation rotation(FusionEngineType::Mahony, w, false);
+    rotation.run(480);
+
+    float staleError;
+    const float error = predictionError(rotation, staleError);
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, 3.0f * Horizon, staleError);
+    TEST_ASSERT_TRUE(error < 1e-4f);
+}
+
+void test_vqf_prediction_about_gravity()
+{
+    // turning about the vertical keeps the accel consistent, VQF corrects only its bias estimate
+    const sensor_real_t w[3] = {0.0f, 0.0f, 2.0f};
+    ConstantRotation rotation(FusionEngineType::VQF, w, true);
+    rotation.run(2 * 480);
+
+    float staleError;
+    const float error = predictionError(rotation, staleError);
+    TEST_ASSERT_TRUE(staleError > 0.03f);
+    TEST_ASSERT_TRUE(error < 1e-3f);
+}
+
+void test_prediction_includes_pending_preintegration()
+{
+    // 3 of 4 samples wait in the pre-integrator and are not in the engine yet
+    const sensor_real_t w[3] = {2.0f, -1.0f, 0.5f};
+    ConstantRotation rotation(FusionEngineType::Mahony, w, false, 4);
+    rotation.run(483);
+
+    const Quat predicted = rotation.fusion.getPredictedQuaternionQuat(Horizon);
+    // 10 more samples leave 1 pending, a zero horizon still applies it
+    rotation.run(HorizonSamples);
+    const Quat actual = rotation.fusion.getPredictedQuaternionQuat(0.0f);
+    TEST_ASSERT_TRUE(angleBetween(predicted, actual) < 1e-4f);
+}
+
+void test_zero_horizon_is_fused_rotation()
+{
+    const sensor_real_t w[3] = {0.3f, 0.0f, -0.2f};
+    ConstantRotation rotation(FusionEngineType::Mahony, w, true);
+    rotation.run(100);
+
+    TEST_ASSERT_TRUE(angleBetween(rotation.fusion.getPredictedQuaternionQuat(0.0f), rotation.fusion.getQuaternionQuat()) < 1e-6f);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_gyro_only_prediction_matches_integration);
+    RUN_TEST(test_vqf_prediction_about_gravity);
+    RUN_TEST(test_prediction_includes_pending_preintegration);
+    RUN_TEST(test_zero_horizon_is_fused_rotation);
+    return UNITY_END();
+}
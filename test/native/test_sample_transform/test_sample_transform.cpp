@@ -0,0 +1,279 @@
+/*
+    SlimeVR Code is placed under the MIT license
+    Copyright (c) 2024 SlimeVR Contributors
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+
+#include <unity.h>
+
+#include <cfloat>
+#include <cmath>
+#include <random>
+
+#include "sensors/SampleTransform.h"
+
+using SlimeVR::Sensors::SampleTransform;
+
+// Each test runs the per-stage arithmetic that SampleTransform replaced next to the transform.
+// Folding the stages reorders the float operations, so the two may differ by rounding: a few
+// ulp of the largest term that goes into a component. Pure axis remaps must match exactly.
+
+// ICM-42688 at 2000 dps and 8 g, BMI160 gyro at 2000 dps and accel at 4 g
+constexpr double GScale = (2000.0 / 32768.0) * (M_PI / 180.0);
+constexpr double AScale = 9.80665 / 4096.0;
+constexpr double BMI160GScale = (2000.0 / 32768.0) * (M_PI / 180.0);
+constexpr double BMI160AScale = 9.80665 / 8192.0;
+
+constexpr int Samples = 20000;
+
+static std::mt19937 rng;
+
+static float uniform(float low, float high)
+{
+    return std::uniform_real_distribution<float>(low, high)(rng);
+}
+
+static void randomRaw(int16_t raw[3])
+{
+    for (uint8_t i = 0; i < 3; i++) {
+        raw[i] = static_cast<int16_t>(std::uniform_int_distribution<int>(INT16_MIN, INT16_MAX)(rng));
+    }
+}
+
+// a Magneto style inverse soft iron matrix, close to identity
+static void randomMatrix(float matrix[3][3])
+{
+    for (uint8_t i = 0; i < 3; i++) {
+        for (uint8_t j = 0; j < 3; j++) {
+            matrix[i][j] = (i == j ? 1.0f : 0.0f) + uniform(-0.05f, 0.05f);
+        }
+    }
+}
+
+static int randomRemap()
+{
+    const int axes[6] = {AXIS_REMAP_USE_X, AXIS_REMAP_USE_Y, AXIS_REMAP_USE_Z,
+                         AXIS_REMAP_USE_XN, AXIS_REMAP_USE_YN, AXIS_REMAP_USE_ZN};
+    std::uniform_int_distribution<int> pick(0, 5);
+    return AXIS_REMAP_BUILD(axes[pick(rng)], axes[pick(rng)], axes[pick(rng)], 0, 0, 0);
+}
+
+// largest rounding error either side can pick up, from the size of the terms summed per component
+static void assertClose(const SampleTransform &transform, const int16_t raw[3], const sensor_real_t expected[3],
+                        const sensor_real_t actual[3])
+{
+    for (uint8_t i = 0; i < 3; i++) {
+        double magnitude = std::fabs(transform.t[i]);
+        for (uint8_t j = 0; j < 3; j++) {
+            magnitude += std::fabs(static_cast<double>(transform.m[i][j]) * raw[j]);
+        }
+        const double tolerance = 8 * FLT_EPSILON * magnitude;
+        if (std::fabs(static_cast<double>(expected[i]) - actual[i]) > tolerance) {
+            TEST_FAIL_MESSAGE("transformed sample is further from the staged one than rounding allows");
+        }
+    }
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_remap_is_exact()
+{
+    const int axes[6] = {AXIS_REMAP_USE_X, AXIS_REMAP_USE_Y, AXIS_REMAP_USE_Z,
+                         AXIS_REMAP_USE_XN, AXIS_REMAP_USE_YN, AXIS_REMAP_USE_ZN};
+    for (int x : axes) {
+        for (int y : axes) {
+            for (int z : axes) {
+                const int desc = AXIS_REMAP_BUILD(x, y, z, 0, 0, 0);
+                const SampleTransform transform = SampleTransform::remap(desc);
+                for (int n = 0; n < 100; n++) {
+                    int16_t raw[3];
+                    randomRaw(raw);
+                    sensor_real_t expected[3] = {static_cast<sensor_real_t>(raw[0]),
+                                                 static_cast<sensor_real_t>(raw[1]),
+                                                 static_cast<sensor_real_t>(raw[2])};
+                    remapAllAxis(desc, &expected[0], &expected[1], &expected[2]);
+                    sensor_real_t actual[3];
+                    transform.apply(raw, actual);
+                    TEST_ASSERT_TRUE(expected[0] == actual[0]);
+                    TEST_ASSERT_TRUE(expected[1] == actual[1]);
+                    TEST_ASSERT_TRUE(expected[2] == actual[2]);
+                }
+            }
+        }
+    }
+}
+
+void test_identity_calibration_is_exact()
+{
+    // no offset and a unit matrix only scale, which rounds the same either way
+    const float offset[3] = {0, 0, 0};
+    const double scale[3] = {AScale, AScale, AScale};
+    const SampleTransform transform = SampleTransform::offsetScale(offset, scale);
+    const sensor_real_t scaleFloat = static_cast<sensor_real_t>(AScale);
+    for (int n = 0; n < Samples; n++) {
+        int16_t raw[3];
+        randomRaw(raw);
+        sensor_real_t actual[3];
+        transform.apply(raw, actual);
+        for (uint8_t i = 0; i < 3; i++) {
+            TEST_ASSERT_TRUE(scaleFloat * static_cast<sensor_real_t>(raw[i]) == actual[i]);
+        }
+    }
+}
+
+void test_softfusion_gyro()
+{
+    for (int n = 0; n < Samples; n++) {
+        const float offset[3] = {uniform(-60, 60), uniform(-60, 60), uniform(-60, 60)};
+        const double scale[3] = {GScale, GScale, GScale};
+        const SampleTransform transform = SampleTransform::offsetScale(offset, scale);
+
+        int16_t raw[3];
+        randomRaw(raw);
+        // GyroBatchCalibration
+        const sensor_real_t scaleFloat = static_cast<sensor_real_t>(GScale);
+        sensor_real_t expected[3];
+        for (uint8_t i = 0; i < 3; i++) {
+            expected[i] = scaleFloat * (static_cast<sensor_real_t>(raw[i]) - offset[i]);
+        }
+        sensor_real_t actual[3];
+        transform.apply(raw, actual);
+        assertClose(transform, raw, expected, actual);
+    }
+}
+
+void test_softfusion_accel()
+{
+    for (int n = 0; n < Samples; n++) {
+        const float bias[3] = {uniform(-300, 300), uniform(-300, 300), uniform(-300, 300)};
+        float matrix[3][3];
+        randomMatrix(matrix);
+        const SampleTransform transform = SampleTransform::biasMatrixScale(bias, matrix, AScale);
+
+        int16_t raw[3];
+        randomRaw(raw);
+        // AccelBatchCalibration, with the unit scale folded into the matrix
+        sensor_real_t scaled[3][3];
+        for (uint8_t i = 0; i < 3; i++) {
+            for (uint8_t j = 0; j < 3; j++) {
+                scaled[i][j] = static_cast<sensor_real_t>(matrix[i][j] * AScale);
+            }
+        }
+        const sensor_real_t x = static_cast<sensor_real_t>(raw[0]) - bias[0];
+        const sensor_real_t y = static_cast<sensor_real_t>(raw[1]) - bias[1];
+        const sensor_real_t z = static_cast<sensor_real_t>(raw[2]) - bias[2];
+        sensor_real_t expected[3];
+        for (uint8_t i = 0; i < 3; i++) {
+            expected[i] = scaled[i][0] * x + scaled[i][1] * y + scaled[i][2] * z;
+        }
+        sensor_real_t actual[3];
+        transform.apply(raw, actual);
+        assertClose(transform, raw, expected, actual);
+    }
+}
+
+void test_bmi160_gyro()
+{
+    for (int n = 0; n < Samples; n++) {
+        const double offset[3] = {uniform(-60, 60), uniform(-60, 60), uniform(-60, 60)};
+        const double scale[3] = {BMI160GScale * uniform(0.98f, 1.02f), BMI160GScale * uniform(0.98f, 1.02f),
+                                 BMI160GScale * uniform(0.98f, 1.02f)};
+        const int desc = randomRemap();
+        const SampleTransform transform = SampleTransform::offsetScale(offset, scale)
+            .then(SampleTransform::remap(desc));
+
+        int16_t raw[3];
+        randomRaw(raw);
+        // BMI160Sensor::onGyroRawSample, then remapGyroAccel
+        sensor_real_t expected[3];
+        for (uint8_t i = 0; i < 3; i++) {
+            expected[i] = static_cast<sensor_real_t>((static_cast<double>(raw[i]) - offset[i]) * scale[i]);
+        }
+        remapAllAxis(desc, &expected[0], &expected[1], &expected[2]);
+        sensor_real_t actual[3];
+        transform.apply(raw, actual);
+        assertClose(transform, raw, expected, actual);
+    }
+}
+
+void test_bmi160_accel()
+{
+    for (int n = 0; n < Samples; n++) {
+        const float bias[3] = {uniform(-300, 300), uniform(-300, 300), uniform(-300, 300)};
+        float matrix[3][3];
+        randomMatrix(matrix);
+        const int desc = randomRemap();
+        const SampleTransform transform = SampleTransform::biasMatrixScale(bias, matrix, BMI160AScale)
+            .then(SampleTransform::remap(desc));
+
+        int16_t raw[3];
+        randomRaw(raw);
+        // BMI160Sensor::applyAccelCalibrationAndScale, then remapGyroAccel
+        float tmp[3];
+        for (uint8_t i = 0; i < 3; i++) {
+            tmp[i] = static_cast<sensor_real_t>(raw[i]) - bias[i];
+        }
+        sensor_real_t expected[3];
+        for (uint8_t i = 0; i < 3; i++) {
+            expected[i] = matrix[i][0] * tmp[0] + matrix[i][1] * tmp[1] + matrix[i][2] * tmp[2];
+            expected[i] *= BMI160AScale;
+        }
+        remapAllAxis(desc, &expected[0], &expected[1], &expected[2]);
+        sensor_real_t actual[3];
+        transform.apply(raw, actual);
+        assertClose(transform, raw, expected, actual);
+    }
+}
+
+void test_then_composes()
+{
+    for (int n = 0; n < Samples; n++) {
+        const float bias[3] = {uniform(-300, 300), uniform(-300, 300), uniform(-300, 300)};
+        float matrix[3][3];
+        randomMatrix(matrix);
+        const SampleTransform first = SampleTransform::biasMatrixScale(bias, matrix, AScale);
+        const SampleTransform second = SampleTransform::remap(randomRemap());
+        const SampleTransform composed = first.then(second);
+
+        int16_t raw[3];
+        randomRaw(raw);
+        sensor_real_t staged[3];
+        first.apply(raw, staged);
+        sensor_real_t expected[3];
+        second.apply(staged[0], staged[1], staged[2], expected);
+        sensor_real_t actual[3];
+        composed.apply(raw, actual);
+        assertClose(composed, raw, expected, actual);
+    }
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_remap_is_exact);
+    RUN_TEST(test_identity_calibration_is_exact);
+    RUN_TEST(test_softfusion_gyro);
+    RUN_TEST(test_softfusion_accel);
+    RUN_TEST(test_bmi160_gyro);
+    RUN_TEST(test_bmi160_accel);
+    RUN_TEST(test_then_composes);
+    return UNITY_END();
+}
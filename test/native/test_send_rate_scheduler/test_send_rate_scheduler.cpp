@@ -0,0 +1,147 @@
+/*
+    SlimeVR Code is placed under the MIT license
+    Copyright (c) 2024 SlimeVR Contributors
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+
+#include <unity.h>
+
+#include <cmath>
+
+#include "sensors/SendRateScheduler.h"
+
+using SlimeVR::Sensors::SendRateScheduler;
+
+// The scheduler is polled once per gyro sample, like the sensors do, at 1 kHz here
+
+constexpr uint32_t PollMicros = 1000;
+constexpr float FastMotion = SEND_RATE_FAST_MOTION_DPS * (3.14159265f / 180.0f);
+
+struct Run
+{
+    SendRateScheduler scheduler{1000};
+    uint32_t now = 0;
+
+    // polls for `seconds` at a constant angular speed and returns the sends per second
+    float run(float seconds, float angularSpeed, bool rest)
+    {
+        const uint32_t polls = static_cast<uint32_t>(seconds * 1e6f / PollMicros);
+        uint32_t sent = 0;
+        for (uint32_t i = 0; i < polls; i++) {
+            now += PollMicros;
+            sent += scheduler.shouldSend(now, angularSpeed, rest);
+        }
+        return sent / seconds;
+    }
+};
+
+void setUp() {}
+void tearDown() {}
+
+void test_rest_rate()
+{
+    Run r;
+    r.run(1, 0, true);
+    TEST_ASSERT_EQUAL_FLOAT(SEND_RATE_REST_HZ, r.scheduler.getRateHz());
+    TEST_ASSERT_FLOAT_WITHIN(1, SEND_RATE_REST_HZ, r.run(5, 0, true));
+    TEST_ASSERT_FLOAT_WITHIN(1, SEND_RATE_REST_HZ, r.scheduler.getAverageRateHz());
+}
+
+void test_motion_rate()
+{
+    Run r;
+    // slow motion sends at the moving rate
+    TEST_ASSERT_FLOAT_WITHIN(2, SEND_RATE_MOVING_HZ, r.run(2, 0.01f, false));
+
+    // and it scales linearly up to the max at the fast motion speed
+    r.run(1, FastMotion / 2, false);
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, (SEND_RATE_MOVING_HZ + SEND_RATE_MAX_HZ) / 2.0f, r.scheduler.getRateHz());
+    r.run(1, FastMotion, false);
+    TEST_ASSERT_EQUAL_FLOAT(SEND_RATE_MAX_HZ, r.scheduler.getRateHz());
+    TEST_ASSERT_FLOAT_WITHIN(5, SEND_RATE_MAX_HZ, r.run(2, FastMotion * 3, false));
+    TEST_ASSERT_EQUAL_FLOAT(SEND_RATE_MAX_HZ, r.scheduler.getRateHz());
+
+    // rest detection wins over any reported speed
+    r.run(1, FastMotion, true);
+    TEST_ASSERT_EQUAL_FLOAT(SEND_RATE_REST_HZ, r.scheduler.getRateHz());
+}
+
+void test_rate_capped_at_gyro_rate()
+{
+    SendRateScheduler scheduler(100);
+    TEST_ASSERT_EQUAL_FLOAT(100, scheduler.getMaxRateHz());
+    TEST_ASSERT_EQUAL_FLOAT(100, scheduler.getMovingRateHz());
+    uint32_t sent = 0;
+    for (uint32_t now = 10000; now <= 2000000; now += 10000) {
+        sent += scheduler.shouldSend(now, FastMotion * 2, false);
+    }
+    TEST_ASSERT_UINT32_WITHIN(2, 200, sent);
+}
+
+// a speed dithering around the fast motion threshold doesn't make the rate flicker, the peak is
+// held, and the rate only drops once the speed stays below it for the hold time
+void test_hold_at_threshold()
+{
+    Run r;
+    r.run(1, FastMotion, false);
+    for (int i = 0; i < 1000; i++) {
+        r.run(0.001f, i % 2 ? FastMotion * 1.01f : FastMotion * 0.99f, false);
+        TEST_ASSERT_EQUAL_FLOAT(SEND_RATE_MAX_HZ, r.scheduler.getRateHz());
+    }
+
+    const uint32_t slowedAt = r.now;
+    while (r.now - slowedAt < SendRateScheduler::SpeedHoldMicros - PollMicros) {
+        r.run(0.001f, FastMotion * 0.9f, false);
+        TEST_ASSERT_EQUAL_FLOAT(SEND_RATE_MAX_HZ, r.scheduler.getRateHz());
+    }
+    r.run(0.002f, FastMotion * 0.9f, false);
+    TEST_ASSERT_TRUE(r.scheduler.getRateHz() < SEND_RATE_MAX_HZ);
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, SEND_RATE_MOVING_HZ + (SEND_RATE_MAX_HZ - SEND_RATE_MOVING_HZ) * 0.9f,
+                             r.scheduler.getRateHz());
+}
+
+// going from rest into motion picks up the moving rate right away instead of waiting out the
+// keep-alive interval
+void test_rest_to_motion()
+{
+    Run r;
+    r.run(2, 0, true);
+    const uint32_t movedAt = r.now;
+    uint32_t firstSend = 0;
+    for (int i = 0; i < 100 && !firstSend; i++) {
+        r.now += PollMicros;
+        if (r.scheduler.shouldSend(r.now, FastMotion, false)) {
+            firstSend = r.now;
+        }
+    }
+    TEST_ASSERT_TRUE(firstSend != 0);
+    TEST_ASSERT_TRUE(firstSend - movedAt <= 1e6f / SEND_RATE_MAX_HZ + PollMicros);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_rest_rate);
+    RUN_TEST(test_motion_rate);
+    RUN_TEST(test_rate_capped_at_gyro_rate);
+    RUN_TEST(test_hold_at_threshold);
+    RUN_TEST(test_rest_to_motion);
+    return UNITY_END();
+}
@@ -0,0 +1,220 @@
+/*
+    SlimeVR Code is placed under the MIT license
+    Copyright (c) 2024 SlimeVR Contributors
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+
+#include <unity.h>
+
+#include <cmath>
+
+#include "motionprocessing/SensorClockSync.h"
+
+// An IMU oscillator running off the local clock by `ratio` local micros per nominal sensor micro,
+// with its sensor time counter starting at `startTicks`
+struct SimulatedImu
+{
+    double tickMicros;
+    uint32_t counterMask;
+    double ratio;
+    double startTicks;
+
+    double ticksAt(double localMicros) const
+    {
+        return startTicks + localMicros / (tickMicros * ratio);
+    }
+
+    uint32_t sensorTimeAt(double localMicros) const
+    {
+        return static_cast<uint32_t>(static_cast<uint64_t>(ticksAt(localMicros)) & counterMask);
+    }
+
+    double localAt(double ticks) const
+    {
+        return (ticks - startTicks) * tickMicros * ratio;
+    }
+};
+
+constexpr uint32_t SyncInterval = 25000;
+
+// syncs every 25 ms over `seconds`, as the sensors poll it, each read of the sensor time taking 100 us
+static void runSyncs(SensorClockSync &clockSync, const SimulatedImu &imu, double seconds)
+{
+    for (double t = 0; t < seconds * 1e6; t += SyncInterval) {
+        const uint32_t localTime = static_cast<uint32_t>(t);
+        TEST_ASSERT_TRUE(clockSync.syncDue(localTime));
+        clockSync.update(localTime, imu.sensorTimeAt(t), 100);
+    }
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_first_update_only_anchors()
+{
+    SensorClockSync clockSync(25.0f, 0xFFFFFF, 1000.0f, false, SyncInterval);
+    TEST_ASSERT_TRUE(clockSync.syncDue(0));
+    clockSync.update(1000, 500, 100);
+    TEST_ASSERT_FALSE(clockSync.isSynced());
+    TEST_ASSERT_TRUE(clockSync.getSampleDtMicros() == 1000.0);
+    TEST_ASSERT_FALSE(clockSync.syncDue(1000 + SyncInterval - 1));
+    TEST_ASSERT_TRUE(clockSync.syncDue(1000 + SyncInterval));
+    clockSync.update(1000 + SyncInterval, 500 + 1000, 100);
+    TEST_ASSERT_TRUE(clockSync.isSynced());
+    TEST_ASSERT_TRUE(clockSync.getRatio() == 1.0);
+}
+
+static void trackDrift(float tickMicros, uint32_t counterMask, double ratio)
+{
+    const SimulatedImu imu{tickMicros, counterMask, ratio, 12345};
+    SensorClockSync clockSync(tickMicros, counterMask, 1000.0f, false, SyncInterval);
+    runSyncs(clockSync, imu, 5);
+    TEST_ASSERT_TRUE(clockSync.isSynced());
+    TEST_ASSERT_FLOAT_WITHIN(50e-6f, ratio, clockSync.getRatio());
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, 1000.0 * ratio, clockSync.getSampleDtMicros());
+}
+
+void test_tracks_fast_oscillator()
+{
+    // LSM6DSV, 32 bit counter
+    trackDrift(21.75f, 0xFFFFFFFF, 1 - 800e-6);
+}
+
+void test_tracks_slow_oscillator()
+{
+    // BMI270, 24 bit counter
+    trackDrift(39.0625f, 0xFFFFFF, 1 + 1500e-6);
+}
+
+void test_counter_wrap()
+{
+    // the 24 bit counter of a 25 us tick wraps every 419 s, start right before it
+    const SimulatedImu imu{25.0, 0xFFFFFF, 1 + 300e-6, 0xFFFFFF - 20000};
+    SensorClockSync clockSync(25.0f, 0xFFFFFF, 1000.0f, false, SyncInterval);
+    runSyncs(clockSync, imu, 2);
+    TEST_ASSERT_TRUE(imu.sensorTimeAt(2e6) < imu.sensorTimeAt(0));
+    TEST_ASSERT_FLOAT_WITHIN(50e-6f, imu.ratio, clockSync.getRatio());
+}
+
+void test_ignores_sensor_reset()
+{
+    const SimulatedImu imu{25.0, 0xFFFFFF, 1 + 300e-6, 0};
+    SensorClockSync clockSync(25.0f, 0xFFFFFF, 1000.0f, false, SyncInterval);
+    runSyncs(clockSync, imu, 2);
+    const double ratio = clockSync.getRatio();
+
+    // the counter restarts from 0
+    clockSync.update(2000000, 0, 100);
+    TEST_ASSERT_TRUE(clockSync.getRatio() == ratio);
+    // a sync held up by a stall, with the counter read from before it
+    clockSync.update(2200000, imu.sensorTimeAt(25000), 100);
+    TEST_ASSERT_TRUE(clockSync.getRatio() == ratio);
+    TEST_ASSERT_TRUE(clockSync.isSynced());
+
+    // tracking picks up again from the new counter base
+    const SimulatedImu restarted{25.0, 0xFFFFFF, imu.ratio, -2225000 / (25.0 * imu.ratio)};
+    for (double t = 2225000; t < 3e6; t += SyncInterval) {
+        clockSync.update(static_cast<uint32_t>(t), restarted.sensorTimeAt(t), 100);
+    }
+    TEST_ASSERT_FLOAT_WITHIN(50e-6f, imu.ratio, clockSync.getRatio());
+}
+
+void test_unaligned_timestamps_carry_fractions()
+{
+    const SimulatedImu imu{25.0, 0xFFFFFF, 1 + 500e-6, 0};
+    SensorClockSync clockSync(25.0f, 0xFFFFFF, 1000.0f, false, SyncInterval);
+    runSyncs(clockSync, imu, 5);
+
+    const double sampleDt = clockSync.getSampleDtMicros();
+    const uint32_t start = clockSync.getLastSampleTimestamp();
+    double sum = 0;
+    for (int i = 0; i < 10000; i++) {
+        sum += clockSync.nextSampleDtMicros();
+    }
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 10000 * sampleDt, sum);
+    // whole micros go into the timestamp, the fractions add up instead of getting lost
+    TEST_ASSERT_UINT32_WITHIN(1, static_cast<uint32_t>(10000 * sampleDt), clockSync.getLastSampleTimestamp() - start);
+}
+
+void test_anchor_last_sample()
+{
+    SensorClockSync clockSync(25.0f, 0xFFFFFF, 1000.0f, false, SyncInterval);
+    for (int i = 0; i < 10; i++) {
+        clockSync.nextSampleDtMicros();
+    }
+    TEST_ASSERT_EQUAL_UINT32(10000, clockSync.getLastSampleTimestamp());
+
+    // the fifo read empty at 10500, the last sample is not older than one period
+    clockSync.anchorLastSample(10500);
+    TEST_ASSERT_EQUAL_UINT32(10000, clockSync.getLastSampleTimestamp());
+    // samples lagging behind the reads are pulled forward
+    clockSync.anchorLastSample(15000);
+    TEST_ASSERT_EQUAL_UINT32(14000, clockSync.getLastSampleTimestamp());
+    // and never end up after the read that returned them
+    clockSync.anchorLastSample(13000);
+    TEST_ASSERT_EQUAL_UINT32(13000, clockSync.getLastSampleTimestamp());
+}
+
+void test_aligned_timestamps_follow_samples()
+{
+    // BMI160 at 800 Hz: a sample every 32 ticks of 39.0625 us, on multiples of 32 in sensor time
+    const double tick = 39.0625;
+    const double periodTicks = 32;
+    const SimulatedImu imu{tick, 0xFFFFFF, 1 - 700e-6, 1000.3};
+    SensorClockSync clockSync(tick, 0xFFFFFF, tick * periodTicks, true, SyncInterval);
+
+    // the fifo is read every 5 ms, the clock synced right after a read when it is due
+    double nextSample = std::ceil(imu.ticksAt(0) / periodTicks) * periodTicks;
+    double maxError = 0;
+    double maxDtError = 0;
+    for (double t = 0; t < 5e6; t += 5000) {
+        while (imu.localAt(nextSample) <= t) {
+            const double dt = clockSync.nextSampleDtMicros();
+            if (t > 2e6) {
+                const double trueLocal = imu.localAt(nextSample);
+                maxError = std::max(maxError, std::abs(clockSync.getLastSampleTimestamp() - trueLocal));
+                maxDtError = std::max(maxDtError, std::abs(dt - periodTicks * tick * imu.ratio));
+            }
+            nextSample += periodTicks;
+        }
+        const uint32_t localTime = static_cast<uint32_t>(t);
+        if (clockSync.syncDue(localTime)) {
+            clockSync.update(localTime, imu.sensorTimeAt(t), 0);
+        }
+    }
+    TEST_ASSERT_TRUE(clockSync.isSynced());
+    // the sensor time read is a tick off at most, and the timestamps are whole micros
+    TEST_ASSERT_LESS_THAN_FLOAT(tick + 4, maxError);
+    TEST_ASSERT_LESS_THAN_FLOAT(tick + 4, maxDtError);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_first_update_only_anchors);
+    RUN_TEST(test_tracks_fast_oscillator);
+    RUN_TEST(test_tracks_slow_oscillator);
+    RUN_TEST(test_counter_wrap);
+    RUN_TEST(test_ignores_sensor_reset);
+    RUN_TEST(test_unaligned_timestamps_carry_fractions);
+    RUN_TEST(test_anchor_last_sample);
+    RUN_TEST(test_aligned_timestamps_follow_samples);
+    return UNITY_END();
+}
@@ -0,0 +1,148 @@
+/*
+    SlimeVR Code is placed under the MIT license
+    Copyright (c) 2024 SlimeVR Contributors
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+
+#include <unity.h>
+
+#include <vector>
+
+#include "sensors/softfusion/spiimpl.h"
+
+using SlimeVR::Sensors::SoftFusion::SPIImpl;
+
+static constexpr uint8_t ChipSelectPin = 5;
+
+static void assertMosi(const std::vector<uint8_t> &expected, const SPIClass::Transaction &transaction)
+{
+    TEST_ASSERT_EQUAL(expected.size(), transaction.mosi.size());
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected.data(), transaction.mosi.data(), expected.size());
+    TEST_ASSERT_TRUE_MESSAGE(transaction.selected, "chip select was high during the transfer");
+    TEST_ASSERT_EQUAL(SPI_SPEED, transaction.settings.clock);
+    TEST_ASSERT_EQUAL(MSBFIRST, transaction.settings.bitOrder);
+    TEST_ASSERT_EQUAL(SPI_MODE3, transaction.settings.dataMode);
+}
+
+void setUp()
+{
+    SPI.reset();
+    SPI.chipSelectPin = ChipSelectPin;
+}
+
+void tearDown()
+{
+    TEST_ASSERT_EQUAL(0, SPI.bytesOutsideTransactions);
+    TEST_ASSERT_EQUAL(HIGH, ArduinoStub::pinLevels[ChipSelectPin]);
+}
+
+void test_constructor_starts_bus_and_deselects()
+{
+    SPIImpl spi(ChipSelectPin);
+    TEST_ASSERT_TRUE(SPI.begun);
+    TEST_ASSERT_EQUAL(0, SPI.transactions.size());
+}
+
+void test_read_reg_sets_read_bit()
+{
+    SPIImpl spi(ChipSelectPin);
+    SPI.misoBytes = {0xee, 0x6b};
+    TEST_ASSERT_EQUAL(0x6b, spi.readReg(0x0f));
+    TEST_ASSERT_EQUAL(1, SPI.transactions.size());
+    assertMosi({0x8f, 0x00}, SPI.transactions[0]);
+}
+
+void test_read_reg16_is_little_endian()
+{
+    SPIImpl spi(ChipSelectPin);
+    SPI.misoBytes = {0xee, 0x34, 0x12};
+    TEST_ASSERT_EQUAL(0x1234, spi.readReg16(0x22));
+    assertMosi({0xa2, 0x00, 0x00}, SPI.transactions[0]);
+}
+
+void test_read_skips_dummy_bytes()
+{
+    // BMI270 answers a read with one byte of garbage before the data
+    SPIImpl spi(ChipSelectPin, 1);
+    SPI.misoBytes = {0xee, 0xdd, 0x24};
+    TEST_ASSERT_EQUAL(0x24, spi.readReg(0x00));
+    assertMosi({0x80, 0x00, 0x00}, SPI.transactions[0]);
+}
+
+void test_read_bytes_in_one_transaction()
+{
+    SPIImpl spi(ChipSelectPin);
+    std::vector<uint8_t> expectedMosi = {0xbe};
+    SPI.misoBytes.push_back(0xee);
+    for (size_t i = 0; i < SPIImpl::MaxTransactionLength; i++) {
+        SPI.misoBytes.push_back(i);
+        expectedMosi.push_back(0x00);
+    }
+
+    uint8_t buffer[SPIImpl::MaxTransactionLength];
+    memset(buffer, 0x55, sizeof(buffer));
+    spi.readBytes(0x3e, sizeof(buffer), buffer);
+
+    TEST_ASSERT_EQUAL(1, SPI.transactions.size());
+    assertMosi(expectedMosi, SPI.transactions[0]);
+    for (size_t i = 0; i < sizeof(buffer); i++) {
+        TEST_ASSERT_EQUAL(i, buffer[i]);
+    }
+}
+
+void test_write_reg_clears_read_bit()
+{
+    SPIImpl spi(ChipSelectPin);
+    spi.writeReg(0x10, 0xab);
+    spi.writeReg(0x90, 0xcd);
+    TEST_ASSERT_EQUAL(2, SPI.transactions.size());
+    assertMosi({0x10, 0xab}, SPI.transactions[0]);
+    assertMosi({0x10, 0xcd}, SPI.transactions[1]);
+}
+
+void test_write_reg16_is_little_endian()
+{
+    SPIImpl spi(ChipSelectPin);
+    spi.writeReg16(0x20, 0x1234);
+    assertMosi({0x20, 0x34, 0x12}, SPI.transactions[0]);
+}
+
+void test_write_bytes_in_one_transaction()
+{
+    SPIImpl spi(ChipSelectPin);
+    uint8_t data[] = {1, 2, 3, 4, 5};
+    spi.writeBytes(0x5e, sizeof(data), data);
+    TEST_ASSERT_EQUAL(1, SPI.transactions.size());
+    assertMosi({0x5e, 1, 2, 3, 4, 5}, SPI.transactions[0]);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_constructor_starts_bus_and_deselects);
+    RUN_TEST(test_read_reg_sets_read_bit);
+    RUN_TEST(test_read_reg16_is_little_endian);
+    RUN_TEST(test_read_skips_dummy_bytes);
+    RUN_TEST(test_read_bytes_in_one_transaction);
+    RUN_TEST(test_write_reg_clears_read_bit);
+    RUN_TEST(test_write_reg16_is_little_endian);
+    RUN_TEST(test_write_bytes_in_one_transaction);
+    return UNITY_END();
+}
@@ -0,0 +1,148 @@
+/*
+    SlimeVR Code is placed under the MIT license
+    Copyright (c) 2024 SlimeVR Contributors
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+
+#include <unity.h>
+
+#include <thread>
+
+#include "sensors/SPSCRing.h"
+
+using SlimeVR::Sensors::SPSCRing;
+
+// Big enough that a torn copy would show as words out of step with each other
+struct Item
+{
+    uint32_t sequence;
+    uint32_t words[15];
+};
+
+static Item makeItem(uint32_t sequence)
+{
+    Item item;
+    item.sequence = sequence;
+    for (uint32_t i = 0; i < 15; i++) {
+        item.words[i] = sequence * 31 + i;
+    }
+    return item;
+}
+
+static bool isIntact(const Item &item)
+{
+    for (uint32_t i = 0; i < 15; i++) {
+        if (item.words[i] != item.sequence * 31 + i) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_empty_ring_pops_nothing()
+{
+    SPSCRing<uint32_t, 4> ring;
+    uint32_t value;
+    TEST_ASSERT_FALSE(ring.pop(value));
+    TEST_ASSERT_EQUAL(0, ring.size());
+}
+
+void test_full_ring_refuses_push()
+{
+    SPSCRing<uint32_t, 4> ring;
+    for (uint32_t i = 0; i < 4; i++) {
+        TEST_ASSERT_TRUE(ring.push(i));
+    }
+    TEST_ASSERT_FALSE(ring.push(4));
+    TEST_ASSERT_EQUAL(4, ring.size());
+
+    uint32_t value;
+    TEST_ASSERT_TRUE(ring.pop(value));
+    TEST_ASSERT_EQUAL(0, value);
+    TEST_ASSERT_TRUE(ring.push(4));
+}
+
+void test_keeps_order_across_wrap_around()
+{
+    SPSCRing<uint32_t, 4> ring;
+    uint32_t next = 0;
+    uint32_t expected = 0;
+    for (int round = 0; round < 100; round++) {
+        while (ring.push(next)) {
+            next++;
+        }
+        uint32_t value;
+        for (int i = 0; i < 3 && ring.pop(value); i++) {
+            TEST_ASSERT_EQUAL(expected, value);
+            expected++;
+        }
+    }
+}
+
+// The acquisition task and the main loop on two threads. The producer retries until every
+// item is in, so both sides keep running into the full and the empty ring
+void test_producer_and_consumer_threads()
+{
+    constexpr uint32_t ItemCount = 50000;
+    static SPSCRing<Item, 32> ring;
+
+    uint32_t fullRetries = 0;
+    std::thread producer([&]() {
+        for (uint32_t sequence = 1; sequence <= ItemCount; sequence++) {
+            const Item item = makeItem(sequence);
+            while (!ring.push(item)) {
+                fullRetries++;
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    uint32_t received = 0;
+    bool inOrder = true;
+    bool intact = true;
+    Item item;
+    while (received < ItemCount) {
+        if (!ring.pop(item)) {
+            continue;
+        }
+        received++;
+        inOrder &= item.sequence == received;
+        intact &= isIntact(item);
+    }
+    producer.join();
+
+    TEST_ASSERT_TRUE_MESSAGE(inOrder, "items were lost, repeated or reordered");
+    TEST_ASSERT_TRUE_MESSAGE(intact, "an item was read while it was written");
+    TEST_ASSERT_FALSE(ring.pop(item));
+    TEST_ASSERT_GREATER_THAN(0, fullRetries);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_empty_ring_pops_nothing);
+    RUN_TEST(test_full_ring_refuses_push);
+    RUN_TEST(test_keeps_order_across_wrap_around);
+    RUN_TEST(test_producer_and_consumer_threads);
+    return UNITY_END();
+}
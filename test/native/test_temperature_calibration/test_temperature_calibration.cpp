@@ -0,0 +1,168 @@
+/*
+    SlimeVR Code is placed under the MIT license
+    Copyright (c) 2024 SlimeVR Contributors
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+
+#include <unity.h>
+
+#include <cmath>
+#include <random>
+
+#include "GlobalVars.h"
+#include "motionprocessing/GyroTemperatureCalibrator.h"
+
+using SlimeVR::Configuration::CalibrationConfigType;
+
+constexpr float Sensitivity = 1000 / 35.0f;
+constexpr uint32_t SamplesPerStep = 50;
+// temperature change per gyro sample, slow enough to fill every step
+constexpr float RampPerSample = 0.001f;
+
+static SlimeVR::Logging::Logger logger("TempCalTest");
+static std::mt19937 rng;
+
+// raw gyro offset drifting with temperature, bent in y and flat in z
+static void offsetAt(float temperature, float out[3])
+{
+    const float dt = temperature - 30.0f;
+    out[0] = 20.0f + 1.5f * dt;
+    out[1] = -10.0f + 0.05f * dt * dt;
+    out[2] = 5.0f;
+}
+
+// feeds the calibrator a device at rest warming up from `from` to `to`
+static void ramp(GyroTemperatureCalibrator &calibrator, float from, float to)
+{
+    std::normal_distribution<float> noise(0.0f, 1.0f);
+    for (float t = from; t < to; t += RampPerSample) {
+        float offset[3];
+        offsetAt(t, offset);
+        int16_t xyz[3];
+        for (int i = 0; i < 3; i++) {
+            xyz[i] = static_cast<int16_t>(std::lround(offset[i] + noise(rng)));
+        }
+        calibrator.updateGyroTemperatureCalibration(t, true, xyz[0], xyz[1], xyz[2]);
+    }
+}
+
+static void assertOffsetWithin(GyroTemperatureCalibrator &calibrator, float temperature, float tolerance)
+{
+    float expected[3];
+    offsetAt(temperature, expected);
+    float offset[3];
+    TEST_ASSERT_TRUE(calibrator.approximateOffset(temperature, offset));
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT_FLOAT_WITHIN(tolerance, expected[i], offset[i]);
+    }
+}
+
+void setUp()
+{
+    rng.seed(1);
+    configuration = FakeConfiguration{};
+    ArduinoStub::serialOutput.clear();
+}
+void tearDown() {}
+
+void test_full_ramp_fits_curve()
+{
+    GyroTemperatureCalibrator calibrator(CalibrationConfigType::SFUSION, 0, Sensitivity, SamplesPerStep);
+    ramp(calibrator, 14.0f, 46.0f);
+
+    TEST_ASSERT_TRUE(calibrator.config.hasCoeffs);
+    TEST_ASSERT_TRUE(calibrator.config.fullyCalibrated());
+    for (float t = 16.0f; t <= 44.0f; t += 2.0f) {
+        assertOffsetWithin(calibrator, t, 0.25f);
+    }
+}
+
+void test_full_ramp_is_saved_from_main_loop()
+{
+    GyroTemperatureCalibrator calibrator(CalibrationConfigType::SFUSION, 0, Sensitivity, SamplesPerStep);
+    ramp(calibrator, 14.0f, 46.0f);
+
+    // completing the calibration only flags it, the save happens in savePendingConfig()
+    TEST_ASSERT_EQUAL(0, configuration.temperatureCalibrationSaves);
+    TEST_ASSERT_TRUE(calibrator.configSavePending);
+    TEST_ASSERT_TRUE(calibrator.savePendingConfig());
+    TEST_ASSERT_EQUAL(1, configuration.temperatureCalibrationSaves);
+    TEST_ASSERT_FALSE(calibrator.savePendingConfig());
+
+    GyroTemperatureCalibrator reloaded(CalibrationConfigType::SFUSION, 0, Sensitivity, SamplesPerStep);
+    TEST_ASSERT_TRUE(reloaded.loadConfig(Sensitivity));
+    assertOffsetWithin(reloaded, 25.0f, 0.5f);
+}
+
+void test_partial_ramp_uses_nearest_step()
+{
+    GyroTemperatureCalibrator calibrator(CalibrationConfigType::SFUSION, 0, Sensitivity, SamplesPerStep);
+    ramp(calibrator, 14.0f, 25.0f);
+
+    TEST_ASSERT_FALSE(calibrator.config.hasCoeffs);
+    TEST_ASSERT_TRUE(calibrator.config.hasData());
+    // the raw steps average only half a degree of drift
+    assertOffsetWithin(calibrator, 20.0f, 1.0f);
+
+    // above the calibrated range the warmest step is applied
+    float warmest[3];
+    float offset[3];
+    TEST_ASSERT_TRUE(calibrator.approximateOffset(calibrator.config.maxTemperatureRange, warmest));
+    TEST_ASSERT_TRUE(calibrator.approximateOffset(40.0f, offset));
+    TEST_ASSERT_EQUAL_FLOAT_ARRAY(warmest, offset, 3);
+}
+
+void test_moving_samples_are_ignored()
+{
+    GyroTemperatureCalibrator calibrator(CalibrationConfigType::SFUSION, 0, Sensitivity, SamplesPerStep);
+    for (float t = 14.0f; t < 25.0f; t += RampPerSample) {
+        calibrator.updateGyroTemperatureCalibration(t, false, 3000, 3000, 3000);
+    }
+
+    float offset[3];
+    TEST_ASSERT_FALSE(calibrator.config.hasData());
+    TEST_ASSERT_FALSE(calibrator.approximateOffset(20.0f, offset));
+}
+
+void test_print_state_reports_progress()
+{
+    GyroTemperatureCalibrator calibrator(CalibrationConfigType::SFUSION, 3, Sensitivity, SamplesPerStep);
+    ramp(calibrator, 14.0f, 46.0f);
+
+    calibrator.printState(logger, 30.0f);
+    TEST_ASSERT_TRUE(ArduinoStub::serialOutput.find("Sensor 3 temperature calibration state:") != std::string::npos);
+    TEST_ASSERT_TRUE(ArduinoStub::serialOutput.find("done: 100.0%") != std::string::npos);
+
+    ArduinoStub::serialOutput.clear();
+    calibrator.printDebugState(logger, 480.0f);
+    TEST_ASSERT_TRUE(ArduinoStub::serialOutput.find("BUF 3 60") != std::string::npos);
+    TEST_ASSERT_TRUE(ArduinoStub::serialOutput.find("END 3") != std::string::npos);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_full_ramp_fits_curve);
+    RUN_TEST(test_full_ramp_is_saved_from_main_loop);
+    RUN_TEST(test_partial_ramp_uses_nearest_step);
+    RUN_TEST(test_moving_samples_are_ignored);
+    RUN_TEST(test_print_state_reports_progress);
+    return UNITY_END();
+}
@@ -0,0 +1,168 @@
+/*
+    SlimeVR Code is placed under the MIT license
+    Copyright (c) 2024 SlimeVR Contributors
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+
+#include <unity.h>
+
+#include <cmath>
+#include <random>
+
+#include "vqf.h"
+
+// With VQF_SINGLE_PRECISION_FILTERS the Butterworth low passes run in float in delta operator form.
+// The reference here is the upstream direct form filter in double, it has to agree on the inputs
+// VQF actually filters: gravity for the accel low pass and gyro/accel for the rest detection.
+//
+// Once a step has settled, the position state stops moving when its increment drops below half an
+// ulp, which leaves the float filter up to about 7e-5 of the input away from the double one. Noise
+// keeps the filter moving, so there the two agree much closer.
+
+static_assert(sizeof(vqf_filter_t) == sizeof(float), "the float filters are the configuration under test");
+
+constexpr double RelativeBound = 1e-4;
+
+struct DirectFormFilter
+{
+    double b[3];
+    double a[2];
+    double state[2];
+
+    DirectFormFilter(double tau, double Ts, double x0)
+    {
+        double fc = (M_SQRT2 / (2.0 * M_PI)) / tau;
+        double C = std::tan(M_PI * fc * Ts);
+        double D = C * C + std::sqrt(2) * C + 1;
+        double b0 = C * C / D;
+        b[0] = b0;
+        b[1] = 2 * b0;
+        b[2] = b0;
+        a[0] = 2 * (C * C - 1) / D;
+        a[1] = (1 - std::sqrt(2) * C + C * C) / D;
+        state[0] = x0 * (1 - b[0]);
+        state[1] = x0 * (b[2] - a[1]);
+    }
+
+    double step(double x)
+    {
+        double y = b[0] * x + state[0];
+        state[0] = b[1] * x - a[0] * y + state[1];
+        state[1] = b[2] * x - a[1] * y;
+        return y;
+    }
+};
+
+struct FloatFilter
+{
+    vqf_filter_t b[3];
+    vqf_filter_t a[2];
+    vqf_filter_t state[2];
+
+    FloatFilter(float tau, float Ts, float x0)
+    {
+        VQF::filterCoeffs(tau, Ts, b, a);
+        VQF::filterInitialState(x0, b, a, state);
+    }
+
+    float step(float x) { return VQF::filterStep(x, b, a, state); }
+};
+
+// runs both filters over the input and returns the largest output difference
+template <typename Input>
+double maxError(float tau, float Ts, float x0, int samples, Input input)
+{
+    DirectFormFilter reference(tau, Ts, x0);
+    FloatFilter filter(tau, Ts, x0);
+    double maxErr = 0;
+    for (int i = 0; i < samples; i++) {
+        float x = input(i);
+        double err = std::fabs(filter.step(x) - reference.step(x));
+        maxErr = std::max(maxErr, err);
+    }
+    return maxErr;
+}
+
+void setUp() {}
+void tearDown() {}
+
+// a 1 g step settles to the same value with the same overshoot
+void accelStep(float Ts)
+{
+    const float tau = 3.0f;
+    const float g = 9.81f;
+    const int samples = static_cast<int>(60 / Ts);
+    double err = maxError(tau, Ts, 0.0f, samples, [&](int i) { return i < 10 ? 0.0f : g; });
+    TEST_ASSERT_TRUE(err < RelativeBound * g);
+
+    // and ends at the input, up to the same dead band
+    FloatFilter filter(tau, Ts, 0.0f);
+    float y = 0;
+    for (int i = 0; i < samples; i++) {
+        y = filter.step(g);
+    }
+    TEST_ASSERT_FLOAT_WITHIN(RelativeBound * g, g, y);
+}
+
+void test_accel_lowpass_step_480hz() { accelStep(1.0f / 480); }
+
+void test_accel_lowpass_step_1000hz() { accelStep(1.0f / 1000); }
+
+// gravity with accel noise on top, filtered for a few minutes
+void test_accel_lowpass_noise()
+{
+    std::mt19937 rng{3};
+    std::normal_distribution<float> noise{0.0f, 0.5f};
+    const float Ts = 1.0f / 480;
+    const int samples = static_cast<int>(300 / Ts);
+    double err = maxError(3.0f, Ts, 9.81f, samples, [&](int) { return 9.81f + noise(rng); });
+    TEST_ASSERT_TRUE(err < RelativeBound);
+}
+
+// the rest detection filter on a gyro axis in rad/s, step into a turn and back
+void test_rest_lowpass_step()
+{
+    const float Ts = 1.0f / 480;
+    const int samples = static_cast<int>(10 / Ts);
+    double err = maxError(0.5f, Ts, 0.0f, samples, [](int i) { return i > 480 && i < 1440 ? 2.0f : 0.0f; });
+    TEST_ASSERT_TRUE(err < RelativeBound * 2);
+}
+
+// the rest detection filter on gyro noise around a small bias
+void test_rest_lowpass_noise()
+{
+    std::mt19937 rng{5};
+    std::normal_distribution<float> noise{0.0f, 0.01f};
+    const float Ts = 1.0f / 480;
+    const int samples = static_cast<int>(300 / Ts);
+    double err = maxError(0.5f, Ts, 0.0f, samples, [&](int) { return 0.005f + noise(rng); });
+    TEST_ASSERT_TRUE(err < 1e-6);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_accel_lowpass_step_480hz);
+    RUN_TEST(test_accel_lowpass_step_1000hz);
+    RUN_TEST(test_accel_lowpass_noise);
+    RUN_TEST(test_rest_lowpass_step);
+    RUN_TEST(test_rest_lowpass_noise);
+    return UNITY_END();
+}